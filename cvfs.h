@@ -12,16 +12,29 @@
 #include<stdlib.h>
 #include<unistd.h>
 #include<stdbool.h>
+#include<stddef.h>
 #include<string.h>
 #include<fcntl.h>
+#include<sys/uio.h>
+#include<errno.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<time.h>
+#include<pthread.h>
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                          USER DEFINED MACROS
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-#define MAXFILESIZE     1024
-#define MAXOPENFILES    20
-#define MAXINODE        5
+#define MAXFILESIZE     (1LL << 40)             /* Upper bound of a single file (1 TB) */
+#define BLOCKSIZE       4096                    /* Size of one data block */
+#define MAXINPUTSIZE    1024                    /* Longest line accepted by the shell 'write' command */
+#define MAXOPENFILES    20                      /* Descriptor slots a session starts with, doubled when full */
+#define MAXDESCRIPTORS  1048576                 /* Upper bound of the descriptor table of one session */
+#define FDMAP_LEVELS    4                       /* Levels of the free descriptor bitmap, 64^4 bits */
+#define MAXIOVECS       1024                    /* Fragments accepted by one readv/writev call */
+#define MAXINODE        16777216                /* Upper bound of the growable inode table */
+#define INODECHUNKSIZE  1024                    /* Inodes per table chunk (power of two) */
 
 #define READ            1
 #define WRITE           2
@@ -48,9 +61,111 @@
 #define ERR_INSUFFICIENT_SPACE    -6
 #define ERR_INSUFFICIENT_DATA     -7
 #define ERR_MAX_FILES_OPEN        -8
+#define ERR_HOST_IO               -9
+#define ERR_BACKUP_RUNNING        -10
+#define ERR_CHECKSUM              -11
 
 #define BACKUP_FILE "CVFS_Backup.bin"
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                  MACROS FOR FILENAME INDEX
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define INDEX_INITIAL_CAPACITY    64                    /* Must be a power of two */
+#define INDEX_EMPTY_HASH          0
+#define INDEX_TOMBSTONE           ((PINDEXENTRY)1)      /* Marks a slot whose entry was removed */
+#define INDEX_EPOCHS              3                     /* Removed entries are freed two epochs later */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                  MACROS FOR MEMORY ALLOCATOR
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define SLABCLASSES               8                     /* Size classes 16, 32 ... 2048 bytes */
+#define SLABMINOBJECT             16
+#define SLABREGIONSIZE            (64 * 1024)           /* Memory carved into objects of one class at a time */
+#define SLABREGIONALIGN           4096
+#define BLOCKREGIONSIZE           (1024 * 1024)         /* Data blocks are carved from 1 MB regions */
+#define ARENAREGIONSIZE           (1024 * 1024)
+#define MAGAZINESIZE              32                    /* Objects of a size class a thread keeps for itself */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                  MACROS FOR READ VIEWS
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define VIEWWINDOWSIZE            (1024 * 1024)         /* Bytes pinned at a time by cat and export */
+#define VIEWMAXIOV                64                    /* Segments handed to one writev() call */
+#define IMPORTBUFFERSIZE          (1024 * 1024)         /* Host bytes read at a time by import */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                  MACROS FOR BACKUP IMAGE
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define IMAGE_MAGIC               "CVFSIMG"             /* First 8 bytes of an image (with the NUL) */
+#define IMAGE_VERSION             2                     /* 2 adds file ids and delta segments */
+#define IMAGE_V1_HEADERSIZE       56                    /* Header and inode entry sizes of version 1 */
+#define IMAGE_V1_INODESIZE        44
+#define SEGMENT_MAGIC             "CVFSDLT"             /* First 8 bytes of a delta segment */
+#define IMAGE_MAXSEGMENTS         16                    /* A full image is written after this many deltas */
+#define DELTA_FULL                1                     /* Delta record carries the whole file (new/truncated) */
+#define BACKUP_TEMP_FILE          "CVFS_Backup.bin.tmp" /* Written first, then renamed over BACKUP_FILE */
+#define BACKUPBUFFERSIZE          (4 * 1024 * 1024)     /* Staging buffer of backup and restore */
+#define IMAGE_COMPRESSED          1                     /* Header flag: file data is stored as compressed blocks */
+#define IMAGE_CHECKSUMS           2                     /* Header flag: header, table, blocks and segments carry CRC32C */
+#define IMAGE_INDEXED             4                     /* Header flag: a name index follows the block checksums */
+#define RESTORE_MAXTHREADS        8                     /* Threads decompressing or reading an image */
+#define RESTORE_THREADBLOCKS      256                   /* Blocks it takes to be worth another thread */
+#define RESTORE_READBLOCKS        256                   /* Blocks read from an image with one preadv() */
+#define BACKUP_MAXTHREADS         8                     /* Threads writing the shards of a full image */
+#define BACKUP_SHARDBYTES         (16 * 1024 * 1024)    /* File data it takes to be worth another shard */
+#define BACKUP_SHARD_FILE         "CVFS_Backup.bin.tmp%d" /* Compressed shard before it joins the image */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                  MACROS FOR DISK STORAGE
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define STORAGE_FILE              "CVFS_Disk.bin"       /* Host file holding the data blocks in disk mode */
+#define STORAGE_MAGIC             "CVFSDSK"             /* First 8 bytes of the storage file (with the NUL) */
+#define STORAGE_VERSION           1
+#define STORAGE_DIRECT            1                     /* Header flag: open the file with O_DIRECT */
+#define CACHE_DEFAULT_MB          64                    /* Buffer cache size when none is given */
+#define CACHE_MIN_BLOCKS          64                    /* Smallest buffer cache */
+#define CACHE_DIRTY_BACKGROUND    10                    /* % of the cache dirty that wakes the flusher */
+#define CACHE_DIRTY_LIMIT         40                    /* % of the cache dirty that holds writers back */
+#define READAHEAD_MIN_BLOCKS      8                     /* First read-ahead window of a sequential reader */
+#define READAHEAD_MAX_BLOCKS      256                   /* The window doubles up to this */
+#define IO_BATCH_BLOCKS           256                   /* Most blocks the I/O thread takes per pass */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                  MACROS FOR COMPRESSION
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define LZ_HASHLOG                11                    /* Match table of 2048 positions */
+#define LZ_MINMATCH               4
+#define LZ_MFLIMIT                12                    /* No match starts this close to the end */
+#define LZ_LASTLITERALS           5                     /* The last bytes are always literals */
+#define LZ_SKIPSTRENGTH           6                     /* Search step grows every 64 bytes without a match */
+#define LZ_MAXINPUT               65535                 /* Match offsets are 16 bits */
+#define CRC32C_POLY               0x82F63B78u           /* Castagnoli polynomial, bit reversed */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                  MACROS FOR WRITE-AHEAD JOURNAL
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define JOURNAL_FILE              "CVFS_Journal.bin"
+#define JOURNAL_MAGIC             "CVFSJNL"             /* First 8 bytes of the journal (with the NUL) */
+#define JOURNAL_VERSION           2                     /* 2 stamps every record with its generation */
+#define JOURNAL_TEMP_FILE         "CVFS_Journal.bin.tmp"/* Newer records moved here after a backup */
+#define JOURNALBUFFERSIZE         (1024 * 1024)         /* Records staged between two commits */
+#define JOURNAL_DEFAULT_INTERVAL  1000                  /* Microseconds a record may wait for its commit */
+
+#define JOURNAL_CREATE            1                     /* Argument = permission, payload = name */
+#define JOURNAL_WRITE             2                     /* Argument = offset, payload = data */
+#define JOURNAL_TRUNCATE          3
+#define JOURNAL_UNLINK            4
+#define JOURNAL_RENAME            5                     /* Payload = new name */
+#define JOURNAL_CHMOD             6                     /* Argument = permission */
+#define JOURNAL_COPY              7                     /* Argument = file id of the source */
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                      STRUCTURE DEFINITIONS
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -64,6 +179,11 @@ struct Superblock
 {
     int TotalInodes;
     int FreeInodes;
+    long long LogicalBlocks;                    /* Data blocks referenced by files (shared blocks count per file) */
+    long long MappedBlocks;                     /* Data blocks still read from a mapped backup image */
+    long long Generation;                       /* Backup generation stamped on every change */
+    long long NextFileId;
+    long long CopiedBlocks;                     /* Shared blocks copied because a file wrote them */
 };
 
 // Use #pragma pack(1) to avoid padding
@@ -72,14 +192,19 @@ struct Inode
 {
     char   FileName[20];
     int    InodeNumber;
-    int    FileSize;
-    int    ActualFileSize;
+    long long FileSize;                         /* Bytes of data blocks allocated to the file */
+    long long ActualFileSize;
     int    FileType;
     int    ReferenceCount;
     int    Permission;
-    char   *Buffer;
-    struct Inode *next;
+    long long FileId;                           /* Identity of the file in backup images */
+    long long Generation;                       /* Generation of the last change of data or metadata */
+    long long BaseGeneration;                   /* Generation the data was last started from empty */
+    struct BlockMap *BlockMap;                  /* Data blocks in file order, NULL = no data yet */
+    struct Filetable *OpenFiles;                /* Open file table entries of every session, one per descriptor */
+    struct Inode *next;                         /* Link in the free inode list */
 };
+#pragma pack()
 
 typedef struct Inode   INODE;
 typedef struct Inode* PINODE;
@@ -87,19 +212,576 @@ typedef struct Inode** PPINODE;
 
 struct Filetable
 {
-    int ReadOffset;
-    int WriteOffset;
+    long long ReadOffset;
+    long long WriteOffset;
     int Mode;
     PINODE ptrinode;
+    long long ReadAheadNext;                            /* Offset a sequential read goes on from */
+    long long ReadAheadEnd;                             /* Block index the read-ahead issued so far reaches */
+    int ReadAheadWindow;                                /* Blocks read ahead, 0 = access is not sequential */
+    int RefCount;                                       /* The UFDT slot and the calls using the entry */
+    bool bDeleted;                                      /* File unlinked, set under the inode write lock */
+    pthread_mutex_t Lock;                               /* Serializes the calls that move the offsets */
+    struct UAREA *Session;                              /* Session whose descriptor refers to the entry */
+    int Fd;
+    struct Filetable *NextOpen;                         /* Links in the OpenFiles list of the inode */
+    struct Filetable *PrevOpen;
 };
 
 typedef struct Filetable  FILETABLE;
 typedef struct Filetable* PFILETABLE;
 
+// Read-only mapping of a backup image, restored files read their blocks from it until written
+struct ImageMap
+{
+    char   *Base;
+    size_t Length;
+    long long Blocks;                                   /* Data blocks still pointing into the mapping */
+};
+
+typedef struct ImageMap  IMAGEMAP;
+typedef struct ImageMap* PIMAGEMAP;
+
+// Reference counted data block, shared between files by copy-on-write 'cp'
+struct DataBlock
+{
+    char *Data;                                         /* BLOCKSIZE bytes from the block arena or a mapping, NULL = disk block */
+    int  RefCount;                                      /* Block maps referencing this block */
+    PIMAGEMAP Map;                                      /* NULL = arena block, else read-only image data */
+    long long Generation;                               /* Generation of the last write */
+    unsigned int Checksum;                              /* CRC32C of the first ChecksumSize bytes */
+    int  ChecksumSize;                                  /* 0 = none, the block was written since */
+    struct CacheBuffer *Buffer;                         /* Disk block: buffer holding it, NULL = not cached */
+    long long DiskBlock;                                /* Disk block: place in the storage file, -1 = none yet */
+};
+
+typedef struct DataBlock  DATABLOCK;
+typedef struct DataBlock* PDATABLOCK;
+
+// In disk mode a data block has no memory of its own (Data is NULL): its data lives in the storage
+// file and is read into a buffer of the cache while the block is pinned
+struct CacheBuffer
+{
+    PDATABLOCK Block;                                   /* Block held, NULL = free buffer */
+    char *Data;                                         /* BLOCKSIZE bytes, aligned for O_DIRECT */
+    int  Pins;                                          /* Users of the data, a pinned buffer is never evicted */
+    bool bDirty;                                        /* Newer than the storage file */
+    bool bOverflow;                                     /* Allocated past the capacity, freed when unpinned */
+    bool bReading;                                      /* Read in flight (read-ahead or a pin), pins wait for it */
+    bool bWriting;                                      /* Write-back in flight, the block may still change */
+    bool bReadAhead;                                    /* Read ahead and not pinned since */
+    struct CacheBuffer *Prev;                           /* LRU list of unpinned buffers, newest first */
+    struct CacheBuffer *Next;                           /* Also links the free buffers */
+};
+
+typedef struct CacheBuffer  CACHEBUFFER;
+typedef struct CacheBuffer* PCACHEBUFFER;
+
+// First block of the storage file, the data blocks follow (block n at (n + 1) * BLOCKSIZE). Only the
+// settings outlive a restart: the files come back from the backup and the journal as always.
+struct StorageHeader
+{
+    char Magic[8];                                      /* STORAGE_MAGIC */
+    int  Version;                                       /* STORAGE_VERSION */
+    int  HeaderSize;
+    long long CacheBlocks;
+    int  Flags;                                         /* STORAGE_DIRECT */
+};
+
+typedef struct StorageHeader  STORAGEHEADER;
+typedef struct StorageHeader* PSTORAGEHEADER;
+
+// Block device on the storage file: block numbers handed out from the end or from the free list
+struct BlockDevice
+{
+    bool bEnabled;                                      /* New data blocks are disk blocks */
+    bool bDirect;                                       /* O_DIRECT asked for and accepted by the host */
+    int  Fd;
+    long long Blocks;                                   /* Blocks of the file in use or free */
+    long long *FreeBlocks;
+    long long FreeCount;
+    long long FreeCapacity;
+    long long Reads;
+    long long Writes;
+    long long Errors;                                   /* Host reads and writes that failed */
+};
+
+// Bounded LRU buffer cache in front of the block device, shared by the shell and the backup and
+// restore threads under one lock. A block stays in its buffer while pinned; when every buffer is
+// pinned the cache grows past its capacity and shrinks back as the pins go. The I/O thread reads
+// ahead for sequential readers and writes dirty buffers back in runs of adjacent blocks. The lock
+// is never held across device I/O: the I/O thread, a pin that misses and an eviction that writes
+// back pin the buffers they read or write and mark them, and other pins wait on Done.
+struct BufferCache
+{
+    PCACHEBUFFER Buffers;                               /* Capacity buffers */
+    char *Memory;                                       /* Their data */
+    int  Capacity;
+    int  Resident;                                      /* Buffers holding a block, overflow included */
+    int  Overflow;
+    PCACHEBUFFER FreeList;
+    PCACHEBUFFER Head;                                  /* Most recently used unpinned buffer */
+    PCACHEBUFFER Tail;                                  /* Next to be evicted */
+    long long Blocks;                                   /* Disk blocks referenced by files */
+    long long Hits;
+    long long Misses;                                   /* Pins that read the block from the device */
+    long long Evictions;
+    long long WriteBacks;                               /* Dirty buffers written to the device */
+    int  Dirty;                                         /* Dirty buffers, the flusher keeps them low */
+    int  Reading;                                       /* Read-ahead buffers queued or in flight */
+    PCACHEBUFFER ReadQueue;                             /* Read-ahead buffers for the I/O thread, oldest first */
+    PCACHEBUFFER ReadQueueTail;
+    long long ReadAheads;                               /* Blocks read ahead */
+    long long ReadAheadHits;                            /* Of them pinned before being evicted */
+    long long Flushes;                                  /* Writes issued by the flusher */
+    long long Flushed;                                  /* Blocks they carried */
+    long long Throttles;                                /* Writes held back at the dirty limit */
+    bool bThread;                                       /* The I/O thread runs */
+    bool bStop;                                         /* It is asked to end */
+    bool bStalled;                                      /* Its last flush pass found nothing to write */
+    bool bColdWanted;                                   /* Read-ahead wants the dirty cold end written back */
+    pthread_t Thread;
+    pthread_mutex_t Lock;
+    pthread_cond_t Wake;                                /* Work for the I/O thread */
+    pthread_cond_t Done;                                /* A read or write-back finished */
+};
+
+// Block map of a file, shared as a whole by copied files until one of them writes
+struct BlockMap
+{
+    int RefCount;                                       /* Inodes referencing this map */
+    int Count;                                          /* Entries covering the file */
+    int Capacity;
+    PDATABLOCK Blocks[];                                /* NULL entry = hole */
+};
+
+typedef struct BlockMap  BLOCKMAP;
+typedef struct BlockMap* PBLOCKMAP;
+
+// One contiguous piece of a read view, points straight into block memory
+struct ReadSegment
+{
+    const char *Data;
+    int Length;
+};
+
+typedef struct ReadSegment  READSEGMENT;
+typedef struct ReadSegment* PREADSEGMENT;
+
+// Zero-copy view over a byte range of a file, valid until releaseReadView()
+struct ReadView
+{
+    PREADSEGMENT Segments;
+    int SegmentCount;
+    long long Length;                                   /* Sum of all segment lengths */
+    PDATABLOCK *Pinned;                                 /* Blocks held while the view is alive */
+    int PinnedCount;
+};
+
+typedef struct ReadView  READVIEW;
+typedef struct ReadView* PREADVIEW;
+
+// Memory region of a slab cache or the arena, kept so the allocator can release it again
+struct MemoryRegion
+{
+    void *Memory;
+    struct MemoryRegion *Next;
+};
+
+typedef struct MemoryRegion  MEMORYREGION;
+typedef struct MemoryRegion* PMEMORYREGION;
+
+// Slab cache handing out objects of a single size
+struct SlabCache
+{
+    char   Name[20];
+    size_t ObjectSize;
+    int    ObjectsPerRegion;
+    void   *FreeList;                                   /* Released objects, linked through their first word */
+    char   *RegionNext;                                 /* Unused tail of the newest region */
+    int    RegionLeft;
+    int    Regions;
+    PMEMORYREGION RegionList;                           /* Every region, freed when the cache is set up again */
+    long long ReservedBytes;
+    long long InUse;
+    long long PeakInUse;
+    long long TotalAllocs;
+    long long TotalFrees;
+    pthread_mutex_t Lock;
+};
+
+typedef struct SlabCache  SLABCACHE;
+typedef struct SlabCache* PSLABCACHE;
+
+// Objects of one size class a thread allocates and frees without taking the lock of the cache.
+// They count as in use for the cache, the owner moves them in and out half a magazine at a time.
+struct Magazine
+{
+    void *Objects[MAGAZINESIZE];
+    int Count;
+    long long Allocs;                                   /* Objects handed out from the magazine */
+};
+
+typedef struct Magazine  MAGAZINE;
+typedef struct Magazine* PMAGAZINE;
+
+// Magazines of one thread for every size class, the record of an exited thread is reused
+struct ThreadCache
+{
+    MAGAZINE Magazines[SLABCLASSES];
+    bool bUsed;
+    struct ThreadCache *Next;
+};
+
+typedef struct ThreadCache  THREADCACHE;
+typedef struct ThreadCache* PTHREADCACHE;
+
+// Bump allocator for memory that is never released individually
+struct Arena
+{
+    char   *RegionNext;
+    size_t RegionLeft;
+    int    Regions;
+    PMEMORYREGION RegionList;
+    long long ReservedBytes;
+    long long UsedBytes;
+    pthread_mutex_t Lock;
+};
+
+// Growable inode table: chunks of INODECHUNKSIZE inodes, never moved once allocated. Every inode has
+// a reader/writer lock in the parallel lock chunk, so the packed inode itself stays as it is. The
+// chunk arrays have a fixed size and NextUnused is published last, so getInode() takes no lock.
+struct InodeTable
+{
+    PINODE Chunks[MAXINODE / INODECHUNKSIZE];
+    pthread_rwlock_t *Locks[MAXINODE / INODECHUNKSIZE];
+    int ChunkCount;
+    int NextUnused;                                     /* Lowest inode number never handed out */
+    PINODE FreeList;                                    /* Released inodes, linked through next */
+    pthread_mutex_t Lock;                               /* Allocation, release and the free list */
+};
+
+// Entry of the open addressing filename index. Lookups take no lock, so an entry is never changed
+// once it is in a slot: a rename publishes a new entry and removes the old one. Removed entries and
+// outgrown tables are freed once every lookup that could still see them has finished (epoch based
+// reclamation).
+struct IndexEntry
+{
+    unsigned int Hash;
+    char FileName[20];                                  /* Name the entry was published under */
+    PINODE ptrinode;
+    struct IndexEntry *NextRetired;
+};
+
+typedef struct IndexEntry  INDEXENTRY;
+typedef struct IndexEntry* PINDEXENTRY;
+
+struct IndexSlot
+{
+    unsigned int Hash;                                  /* Hash of Entry, compared before it is followed */
+    PINDEXENTRY Entry;                                  /* NULL = never used, INDEX_TOMBSTONE = removed */
+};
+
+typedef struct IndexSlot  INDEXSLOT;
+typedef struct IndexSlot* PINDEXSLOT;
+
+struct IndexTable
+{
+    PINDEXSLOT Slots;
+    int Capacity;
+    struct IndexTable *NextRetired;
+};
+
+typedef struct IndexTable  INDEXTABLE;
+typedef struct IndexTable* PINDEXTABLE;
+
+struct IndexReader
+{
+    long long Epoch;                                    /* Epoch the running lookup began in, 0 = none */
+    bool bUsed;                                         /* Owned by a thread */
+    struct IndexReader *Next;
+};
+
+typedef struct IndexReader  INDEXREADER;
+typedef struct IndexReader* PINDEXREADER;
+
+struct NameIndex
+{
+    PINDEXTABLE Table;                                  /* Replaced as a whole when it grows */
+    int Count;
+    int Tombstones;
+    long long Epoch;
+    PINDEXREADER Readers;                               /* One record per thread that looked up a name */
+    PINDEXENTRY RetiredEntries[INDEX_EPOCHS];           /* Removed in epoch i, freed in epoch i + 2 */
+    PINDEXTABLE RetiredTables[INDEX_EPOCHS];
+    pthread_mutex_t Lock;                               /* Serializes the changes */
+};
+
+// A session (process context) of a client. Every session has its own descriptor numbers, the open
+// file table entries they refer to are linked to the shared inodes. The shell runs in uareaobj,
+// threads of other clients bind their own session with setSession().
 struct UAREA
 {
     char ProcessName[20];
-    PFILETABLE UFDT[MAXOPENFILES];
+    PFILETABLE *UFDT;                                   /* Descriptor table, grows on demand */
+    int Capacity;                                       /* Slots in UFDT */
+    int OpenCount;                                      /* Descriptors in use */
+    unsigned long long *FreeMap[FDMAP_LEVELS];          /* Free slot bits, a bit of level i + 1 marks a
+                                                           word of level i that has a free bit */
+    struct UAREA *Next;                                 /* Next session, uareaobj heads the list */
+    pthread_rwlock_t Lock;                              /* Shared to use or claim a slot, taken alone to
+                                                           free a slot or grow the table */
+};
+
+typedef struct UAREA  UAREA;
+typedef struct UAREA* PUAREA;
+
+// On-disk backup image: header, inode table, then the data of every file packed back to back.
+// Only ActualFileSize bytes are stored per file, holes are stored as zeroes. Incremental
+// backups append delta segments after ImageSize; the header is rewritten last, so a segment
+// only counts once it is complete. New fields are only ever added at the end of a structure.
+#pragma pack(1)
+struct ImageHeader
+{
+    char Magic[8];                                      /* IMAGE_MAGIC */
+    int  Version;                                       /* IMAGE_VERSION */
+    int  HeaderSize;                                    /* sizeof(struct ImageHeader) */
+    int  InodeSize;                                     /* sizeof(struct ImageInode) */
+    int  InodeCount;
+    long long InodeTableOffset;
+    long long DataOffset;
+    long long DataSize;
+    long long ImageSize;                                /* End of the base image, segments follow */
+    unsigned long long ImageId;                         /* Random id, kept by later full images (version 2) */
+    long long Generation;                               /* +1 per full image or segment written */
+    long long NextFileId;                               /* All file ids in the image are lower */
+    long long EndOffset;                                /* End of the last complete segment */
+    int  SegmentCount;
+    int  Flags;                                         /* IMAGE_COMPRESSED, IMAGE_CHECKSUMS, IMAGE_INDEXED */
+    long long SnapshotGeneration;                       /* Changes up to this generation are in the image */
+    unsigned int TableChecksum;                         /* CRC32C of the inode table */
+    unsigned int HeaderChecksum;                        /* CRC32C of the header with this field 0 */
+    long long IndexOffset;                              /* Name index: IndexSlots slots, a power of two */
+    int  IndexSlots;
+    unsigned int IndexChecksum;                         /* CRC32C of the name index */
+};
+
+struct ImageInode
+{
+    char FileName[20];
+    int  InodeNumber;
+    int  Permission;
+    long long ActualFileSize;
+    long long DataOffset;                               /* Absolute offset of the file data in the image */
+    long long FileId;                                   /* Version 2 */
+    long long StoredSize;                               /* Bytes of the file data in a compressed image */
+    long long ChecksumOffset;                           /* Absolute offset of the CRC32C of every block */
+    unsigned int Checksum;                              /* CRC32C of those block checksums */
+};
+
+// A compressed image stores the data of a file as its blocks one after the other, followed by
+// the stored length of each block: 0 = all zeroes (not stored), the block size = stored as is,
+// anything shorter = compressed. Delta segments are never compressed.
+// With IMAGE_CHECKSUMS the block checksums of all files follow the file data (CRC32C of the bytes
+// of each block inside the file, holes count as zeroes) and every delta segment ends with the
+// CRC32C of the rest of the segment.
+
+// Name index of an image: open addressing by hashFileName() with linear probing, so one file
+// is found with a few small reads however large the image is
+struct ImageIndexSlot
+{
+    unsigned int Hash;                                  /* hashFileName() of the name */
+    int  Entry;                                         /* Inode table entry + 1, 0 = empty slot */
+};
+
+// Delta segment: header, deleted file ids, one record per changed file, then per record the
+// indices of its changed blocks followed by their data (the last block of a file may be short)
+struct ImageSegment
+{
+    char Magic[8];                                      /* SEGMENT_MAGIC */
+    long long Generation;
+    long long Size;                                     /* Whole segment including this header */
+    int  RecordCount;
+    int  DeleteCount;
+};
+
+struct ImageDelta
+{
+    char FileName[20];
+    int  Permission;
+    long long FileId;
+    long long ActualFileSize;
+    long long DataOffset;                               /* Offset of the block indices inside the segment */
+    int  BlockCount;
+    int  Flags;                                         /* DELTA_FULL */
+};
+#pragma pack()
+
+typedef struct ImageHeader   IMAGEHEADER;
+typedef struct ImageHeader*  PIMAGEHEADER;
+typedef struct ImageInode    IMAGEINODE;
+typedef struct ImageInode*   PIMAGEINODE;
+typedef struct ImageIndexSlot  IMAGEINDEXSLOT;
+typedef struct ImageIndexSlot* PIMAGEINDEXSLOT;
+typedef struct ImageSegment  IMAGESEGMENT;
+typedef struct ImageSegment* PIMAGESEGMENT;
+typedef struct ImageDelta    IMAGEDELTA;
+typedef struct ImageDelta*   PIMAGEDELTA;
+
+// Point-in-time copy of the filesystem a backup writes out. The inodes are copied and their
+// block maps held, so files written meanwhile copy the blocks they change (copy-on-write).
+struct Snapshot
+{
+    PINODE Files;                                       /* Copies of the inodes to store */
+    int  FileCount;
+    long long *DeletedFiles;                            /* Deletes to record */
+    int  DeletedCount;
+    long long Generation;                               /* Changes up to this generation are included */
+    long long BaseGeneration;                           /* Changes up to this one are in the image already */
+    long long NextFileId;
+    int  Fd;                                            /* Image to append a delta to, -1 = full image */
+    bool bCompress;                                     /* Store the data of a full image compressed */
+    IMAGEHEADER Header;                                 /* Header of that image, then of the one written */
+    long long JournalOffset;                            /* Journal records behind it are newer, -1 = none */
+    long long CopiedBlocks;                             /* superobj.CopiedBlocks when it was taken */
+    long long StartTime;                                /* Microseconds, monotonic */
+    long long PauseTime;                                /* Microseconds the shell waited for the snapshot */
+    long long ElapsedTime;                              /* Microseconds until the image was written */
+    long long TotalBytes;                               /* Bytes to write, 0 until known */
+    long long DoneBytes;                                /* Bytes written so far */
+    int  Status;
+};
+
+typedef struct Snapshot  SNAPSHOT;
+typedef struct Snapshot* PSNAPSHOT;
+
+// What the last backup wrote, so the next one can append only the changes since then
+struct BackupState
+{
+    unsigned long long ImageId;                         /* Image this filesystem is in sync with, 0 = none */
+    long long ImageGeneration;                          /* Generation of that image on disk */
+    long long BackupGeneration;                         /* Changes stamped later are not backed up yet */
+    long long SnapshotGeneration;                       /* Same, as stored in the restored image */
+    long long *DeletedFiles;                            /* File ids unlinked since the last backup */
+    int  DeletedCount;
+    int  DeletedCapacity;
+    bool bForceFull;                                    /* A delete could not be recorded */
+    bool bLastIncremental;
+    long long LastBytes;                                /* Bytes written by the last backup */
+    long long LastTime;                                 /* Microseconds it took */
+    long long LastPause;                                /* Microseconds the shell waited for its snapshot */
+    long long LastCopied;                               /* Blocks copied on write while it was written */
+    SNAPSHOT Snapshot;                                  /* Written by the backup thread */
+    pthread_t Thread;
+    bool bRunning;                                      /* Thread started and not joined yet */
+    bool bDone;                                         /* Set by the thread when the image is written */
+};
+
+// One block of an image (or of memory) to decompress and/or verify, the blocks are shared out to threads
+struct RestoreJob
+{
+    const char *Source;                                 /* Stored block in the image, NULL = read it from Fd */
+    PDATABLOCK Block;                                   /* Data block of the restored file, NULL = verify only */
+    int  StoredLength;                                  /* 0 = zero block, Size = stored as is */
+    int  Size;                                          /* Bytes of the block inside the file */
+    unsigned int Checksum;                              /* Expected CRC32C of the Size bytes */
+    bool bCheck;                                        /* Verify the checksum */
+    bool bDamaged;                                      /* Set by the worker */
+    int  File;                                          /* Entry or inode the block belongs to (for reports) */
+    int  BlockIndex;
+    int  Fd;                                            /* Image to read the block from, -1 = verify Block as it is */
+    long long Offset;                                   /* Where the block is in it */
+};
+
+typedef struct RestoreJob  RESTOREJOB;
+typedef struct RestoreJob* PRESTOREJOB;
+
+struct RestoreWorker
+{
+    PRESTOREJOB Jobs;
+    long long First;                                    /* Jobs [First, Last) */
+    long long Last;
+    bool bFailed;                                       /* A block did not decompress */
+    pthread_t Thread;
+};
+
+typedef struct RestoreWorker  RESTOREWORKER;
+typedef struct RestoreWorker* PRESTOREWORKER;
+
+// A full image is written in shards, contiguous runs of files with about the same amount of data,
+// one thread each. Uncompressed data goes straight to its place in the image; compressed data has
+// no known place yet, so every shard but the first is written to a file of its own and appended.
+struct BackupShard
+{
+    PSNAPSHOT Snapshot;
+    PIMAGEINODE Table;                                  /* Entries of the whole image */
+    unsigned int *Sums;                                 /* Block checksums of the whole image */
+    int  First;                                         /* Files [First, Last) */
+    int  Last;
+    long long FirstBlock;                               /* Index of its first block in Sums */
+    int  Fd;                                            /* Image or shard file, positioned where it starts */
+    long long Stored;                                   /* Bytes of file data written */
+    int  Status;
+    pthread_t Thread;
+};
+
+typedef struct BackupShard  BACKUPSHARD;
+typedef struct BackupShard* PBACKUPSHARD;
+
+// Staging buffer that turns many small image writes into a few large write() calls
+struct ImageWriter
+{
+    int  Fd;
+    char *Buffer;
+    long long Used;
+    long long Capacity;
+    long long Written;                                  /* Bytes handed to the host file so far */
+    int  Syscalls;
+    bool bError;
+    bool bChecksum;                                     /* Keep a CRC32C of everything written */
+    unsigned int Checksum;
+};
+
+typedef struct ImageWriter  IMAGEWRITER;
+typedef struct ImageWriter* PIMAGEWRITER;
+
+// Journal of the changes since the last backup: header, then one record per operation
+#pragma pack(1)
+struct JournalHeader
+{
+    char Magic[8];                                      /* JOURNAL_MAGIC */
+    int  Version;                                       /* JOURNAL_VERSION */
+    int  HeaderSize;
+    unsigned long long ImageId;                         /* Backup image the records apply to */
+    long long CommitInterval;                           /* Kept so a restart journals the same way */
+};
+
+struct JournalRecord
+{
+    unsigned int Checksum;                              /* Over the rest of the record and the payload */
+    int  Type;                                          /* JOURNAL_CREATE ... */
+    long long FileId;
+    long long Argument;
+    long long Generation;                               /* Records up to the image's snapshot are in it */
+    int  Length;                                        /* Payload bytes following the record */
+};
+#pragma pack()
+
+typedef struct JournalHeader  JOURNALHEADER;
+typedef struct JournalHeader* PJOURNALHEADER;
+typedef struct JournalRecord  JOURNALRECORD;
+typedef struct JournalRecord* PJOURNALRECORD;
+
+// Write-ahead journal: records are staged and made durable together (group commit)
+struct Journal
+{
+    bool bEnabled;
+    IMAGEWRITER Writer;                                 /* Records since the last commit */
+    long long CommitInterval;                           /* Microseconds a record may wait, 0 = commit every operation */
+    long long PendingSince;                             /* Time of the oldest uncommitted record, 0 = none */
+    long long Records;
+    long long Commits;
+    pthread_mutex_t Lock;                               /* Records are appended and committed one thread at a time */
 };
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -110,7 +792,30 @@ struct UAREA
 extern struct Bootblock  bootobj;
 extern struct Superblock superobj;
 extern struct UAREA      uareaobj;
-extern PINODE head;
+extern struct InodeTable inodetableobj;
+extern struct NameIndex  indexobj;
+extern struct SlabCache  slabclasses[SLABCLASSES];
+extern struct SlabCache  blockarena;
+extern struct Arena      arenaobj;
+extern bool bSystemAllocator;
+extern bool bMappedRestore;
+extern bool bCompressBackup;
+extern bool bBlockChecksums;
+extern int  backupThreads;
+extern struct BackupState backupobj;
+extern struct Journal    journalobj;
+extern struct BlockDevice deviceobj;
+extern struct BufferCache cacheobj;
+extern pthread_mutex_t   namespacelock;
+
+// The file calls may be made from several threads at once. The data and metadata of a file are
+// guarded by its inode lock (shared by readers), the offsets of a descriptor by its own lock, and
+// create, unlink and rename hold namespacelock so the journal records them in index order. Name
+// lookups take no lock at all. Locks are taken in this order: descriptor, inode, descriptor table
+// of a session, namespacelock, name index, journal, buffer cache. The buffer cache lock is dropped
+// around device reads and writes, so in disk mode misses of different threads overlap.
+// Commands that work on the whole filesystem (starting a backup, restore, scrub, storage, journal
+// on/off) expect no other thread inside a file call.
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //                                      FUNCTION PROTOTYPES
@@ -122,22 +827,139 @@ void createDILB();
 void startAuxillaryDataInitialization();
 void displayHelp();
 void manPageDisplay(char Name[]);
+PINODE getInode(int inodeNumber);
+PINODE allocateInode();
+void releaseInode(PINODE inode);
+void lockInode(PINODE inode, bool bWrite);
+void unlockInode(PINODE inode);
 bool isFileExists(const char* name);
 int createFile(char *name, int permission);
 void lsFile();
 int unlinkFile(char *name);
-int writeFile(int fd, char *data, int size);
-int readFile(int fd, char *data, int size);
+int writeFile(int fd, const void *data, int size);
+int readFile(int fd, void *data, int size);
+long long lseekFile(int fd, long long offset, int whence);
+int preadFile(int fd, void *data, int size, long long offset);
+int pwriteFile(int fd, const void *data, int size, long long offset);
+int readViewFile(int fd, int size, PREADVIEW view);
+int writevFile(int fd, const struct iovec *iov, int iovcnt);
+int readvFile(int fd, const struct iovec *iov, int iovcnt);
 int statFile(char *name);
 int fstatFile(int fd);
 int openFile(char *name, int mode);
 int closeFile(int fd);
+PUAREA createSession(const char *name);
+PUAREA findSession(const char *name);
+void setSession(PUAREA session);
+PUAREA getSession();
+int closeSession(PUAREA session);
+void displaySessions();
 int truncateFile(char *name);
 int renameFile(char *oldName, char *newName);
 int catFile(char *name);
 int copyFile(char *src, char *dest);
-int backupCVFS();
-void restoreCVFS();
+long long writeReadView(int hostFd, PREADVIEW view);
+int exportFile(char *name, char *hostPath);
+int importFile(char *hostPath, char *name);
 int chmodFile();
 
+// Memory allocator (cvfs_alloc.c)
+void initialiseAllocator();
+void *slabAlloc(PSLABCACHE cache);
+void slabFree(PSLABCACHE cache, void *object);
+void *allocObject(size_t size);
+void freeObject(void *object, size_t size);
+char *allocBlock();
+void freeBlock(char *block);
+void *arenaAlloc(size_t size);
+void displayMemoryStats();
+
+// File data blocks (cvfs_block.c)
+void holdDataBlock(PDATABLOCK block);
+void putDataBlock(PDATABLOCK block);
+void holdBlockMap(PBLOCKMAP map);
+void putBlockMap(PBLOCKMAP map);
+int getInodeBlockCount(PINODE inode);
+PDATABLOCK getInodeBlock(PINODE inode, int blockIndex);
+char *pinDataBlock(PDATABLOCK block);
+void unpinDataBlock(PDATABLOCK block, bool bDirty);
+int writevInodeData(PINODE inode, const struct iovec *iov, int iovcnt, long long offset);
+int writeInodeData(PINODE inode, const void *data, long long offset, int size);
+int readInodeData(PINODE inode, void *data, long long offset, int size);
+void shareInodeBlocks(PINODE dest, PINODE src);
+void freeInodeBlocks(PINODE inode);
+long long viewInodeData(PINODE inode, long long offset, long long size, PREADVIEW view);
+void releaseReadView(PREADVIEW view);
+int mapInodeData(PINODE inode, PIMAGEMAP map, long long offset, long long size);
+int mapInodeBlock(PINODE inode, PIMAGEMAP map, int blockIndex, const char *data);
+PDATABLOCK allocInodeBlock(PINODE inode, int blockIndex);
+unsigned int checksumInodeBlock(PINODE inode, int blockIndex, int size);
+void setInodeBlockChecksum(PINODE inode, int blockIndex, unsigned int checksum, int size);
+PDATABLOCK getCheckedBlock(PINODE inode, int blockIndex, unsigned int *checksum, int *size);
+long long readAheadInode(PINODE inode, long long firstBlock, long long count);
+
+// Backup image (cvfs_backup.c)
+int writeAll(int fd, const void *data, long long size);
+long long readAll(int fd, void *data, long long size);
+int imageWriterOpen(PIMAGEWRITER writer, int fd, long long capacity);
+int imageWriterAppend(PIMAGEWRITER writer, const void *data, long long size);
+int imageWriterAppendInode(PIMAGEWRITER writer, PINODE inode);
+long long imageWriterAppendCompressed(PIMAGEWRITER writer, PINODE inode);
+int imageWriterFlush(PIMAGEWRITER writer);
+void imageWriterClose(PIMAGEWRITER writer);
+void noteFileDeleted(PINODE inode);
+int backupCVFS(bool bFull);
+int backupStart(bool bFull);
+void backupPoll();
+int backupWait();
+void displayBackupStatus();
+void restoreCVFS();
+int restoreFile(const char *name);
+void scrubCVFS();
+
+// Disk storage and buffer cache (cvfs_disk.c)
+void initDiskBlock(PDATABLOCK block);
+char *pinDiskBlock(PDATABLOCK block);
+void unpinDiskBlock(PDATABLOCK block, bool bDirty);
+void dropDiskBlock(PDATABLOCK block);
+int prefetchDiskBlocks(PDATABLOCK *blocks, int count);
+void waitDirtyLimit();
+int storageStart(long long cacheBlocks, bool bDirect);
+int storageStop();
+void storageResume();
+void storageClose();
+void displayStorageStatus();
+
+// Block compression (cvfs_compress.c)
+int compressBlock(const char *source, int size, char *dest, int capacity);
+int decompressBlock(const char *source, int size, char *dest, int capacity);
+bool isZeroData(const char *data, int size);
+
+// Checksums (cvfs_checksum.c)
+unsigned int crc32c(unsigned int crc, const void *data, long long size);
+unsigned int crc32cSoftware(unsigned int crc, const void *data, long long size);
+unsigned int crc32cZeroes(int size);
+bool isCrc32cHardware();
+
+// Write-ahead journal (cvfs_journal.c)
+int journalStart(long long interval);
+void journalStop();
+void journalClose();
+int journalCommit();
+void journalLog(int type, PINODE inode, long long argument, const void *data, int length);
+void journalLogv(PINODE inode, long long offset, const struct iovec *iov, int iovcnt, long long length);
+long long journalMark();
+void journalTrim(long long offset);
+void journalRecover();
+void displayJournalStatus();
+
+// Filename index (cvfs_index.c)
+unsigned int hashFileName(const char *name);
+int initialiseNameIndex(int capacity);
+void destroyNameIndex();
+PINODE lookupNameIndex(const char *name);
+int insertNameIndex(PINODE inode);
+int removeNameIndex(const char *name);
+int renameNameIndex(PINODE inode, const char *newName);
+
 #endif // CVFS_H
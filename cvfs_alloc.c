@@ -0,0 +1,720 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  File Name:             cvfs_alloc.c
+//  Description:           CVFS memory allocator: size-class slabs for fixed objects, an arena for
+//                         long lived tables and a block arena for file data blocks
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "cvfs.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//     Global variables or objects used in the project
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct SlabCache slabclasses[SLABCLASSES];                      /* 16, 32, 64 ... 2048 byte objects */
+struct SlabCache blockarena;                                    /* BLOCKSIZE data blocks */
+struct Arena     arenaobj;                                      /* Inode chunks and other permanent tables */
+
+bool bSystemAllocator = false;                                  /* Route everything to malloc/free (benchmarks) */
+
+static PTHREADCACHE    threadcaches = NULL;                     /* Magazines of every thread */
+static pthread_mutex_t threadcachelock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t   threadCacheKey;                          /* Returns the magazines when a thread exits */
+static __thread PTHREADCACHE currentThreadCache = NULL;         /* Magazines of the calling thread */
+static pthread_once_t  threadCacheOnce = PTHREAD_ONCE_INIT;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         trackRegion()
+//  Description:           Records a region in the region list of its cache or arena
+//  Input:                 Region list, region memory
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int trackRegion(PMEMORYREGION *list, void *memory)
+{
+    PMEMORYREGION region = (PMEMORYREGION)malloc(sizeof(MEMORYREGION));
+
+    if(region == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    region -> Memory = memory;
+    region -> Next = *list;
+    *list = region;
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         releaseRegions()
+//  Description:           Frees every region of a region list, and with them all objects carved from
+//                         them
+//  Input:                 Region list
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void releaseRegions(PMEMORYREGION *list)
+{
+    PMEMORYREGION region = *list;
+    PMEMORYREGION next = NULL;
+
+    while(region != NULL)
+    {
+        next = region -> Next;
+        free(region -> Memory);
+        free(region);
+        region = next;
+    }
+
+    *list = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         initialiseSlabCache()
+//  Description:           Sets up an empty slab cache for objects of one size, releasing the regions
+//                         of an earlier setup
+//  Input:                 Cache, cache name, object size, objects carved from one region
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void initialiseSlabCache(PSLABCACHE cache, const char *name, size_t objectSize, int objectsPerRegion)
+{
+    releaseRegions(&cache -> RegionList);
+    memset(cache, 0, sizeof(SLABCACHE));
+
+    snprintf(cache -> Name, sizeof(cache -> Name), "%s", name);
+    cache -> ObjectSize = objectSize;
+    cache -> ObjectsPerRegion = objectsPerRegion;
+
+    pthread_mutex_init(&cache -> Lock, NULL);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         initialiseAllocator()
+//  Description:           Creates the size classes, the block arena and the general arena. Called
+//                         again it frees all memory they hold, every object of the allocator must be
+//                         out of use by then.
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void initialiseAllocator()
+{
+    PTHREADCACHE threadCache = NULL;
+    char name[20] = {'\0'};
+    size_t size = SLABMINOBJECT;
+    int i = 0;
+
+    for(i = 0; i < SLABCLASSES; i++)
+    {
+        snprintf(name, sizeof(name), "slab-%zu", size);
+        initialiseSlabCache(&slabclasses[i], name, size, (int)(SLABREGIONSIZE / size));
+        size = size * 2;
+    }
+
+    initialiseSlabCache(&blockarena, "data-blocks", BLOCKSIZE, BLOCKREGIONSIZE / BLOCKSIZE);
+
+    // Objects kept by threads belong to the caches just emptied
+    pthread_mutex_lock(&threadcachelock);
+    for(threadCache = threadcaches; threadCache != NULL; threadCache = threadCache -> Next)
+    {
+        memset(threadCache -> Magazines, 0, sizeof(threadCache -> Magazines));
+    }
+    pthread_mutex_unlock(&threadcachelock);
+
+    releaseRegions(&arenaobj.RegionList);
+    memset(&arenaobj, 0, sizeof(arenaobj));
+    pthread_mutex_init(&arenaobj.Lock, NULL);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         takeObject()
+//  Description:           Takes one object from a slab cache: free list first, then the unused tail of
+//                         the current region, then a new region. The caller holds the lock of the cache.
+//  Input:                 Cache
+//  Output:                Object pointer or NULL if memory is exhausted
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void *takeObject(PSLABCACHE cache)
+{
+    void *object = NULL;
+    char *region = NULL;
+    size_t regionSize = 0;
+
+    if(cache -> FreeList != NULL)
+    {
+        // Free objects keep the link to the next free object in their first word
+        object = cache -> FreeList;
+        cache -> FreeList = *(void **)object;
+        return object;
+    }
+
+    if(cache -> RegionLeft == 0)
+    {
+        regionSize = cache -> ObjectSize * cache -> ObjectsPerRegion;
+
+        // Page aligned regions keep every data block page aligned as well
+        region = (char *)aligned_alloc(SLABREGIONALIGN, (regionSize + SLABREGIONALIGN - 1) & ~(size_t)(SLABREGIONALIGN - 1));
+        if(region == NULL)
+        {
+            return NULL;
+        }
+
+        if(trackRegion(&cache -> RegionList, region) != EXECUTE_SUCCESS)
+        {
+            free(region);
+            return NULL;
+        }
+
+        cache -> RegionNext = region;
+        cache -> RegionLeft = cache -> ObjectsPerRegion;
+        cache -> Regions++;
+        cache -> ReservedBytes = cache -> ReservedBytes + regionSize;
+    }
+
+    object = cache -> RegionNext;
+    cache -> RegionNext = cache -> RegionNext + cache -> ObjectSize;
+    cache -> RegionLeft--;
+
+    return object;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         slabAlloc()
+//  Description:           Takes one object from a slab cache
+//  Input:                 Cache
+//  Output:                Object pointer or NULL if memory is exhausted
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void *slabAlloc(PSLABCACHE cache)
+{
+    void *object = NULL;
+
+    // Each cache has its own lock, threads allocating objects of other sizes never meet
+    pthread_mutex_lock(&cache -> Lock);
+
+    if(bSystemAllocator == true)
+    {
+        object = malloc(cache -> ObjectSize);
+    }
+    else
+    {
+        object = takeObject(cache);
+    }
+
+    if(object != NULL)
+    {
+        cache -> InUse++;
+        cache -> TotalAllocs++;
+        if(cache -> InUse > cache -> PeakInUse)
+        {
+            cache -> PeakInUse = cache -> InUse;
+        }
+    }
+
+    pthread_mutex_unlock(&cache -> Lock);
+
+    return object;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         slabFree()
+//  Description:           Returns an object to the free list of its slab cache
+//  Input:                 Cache, object pointer
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void slabFree(PSLABCACHE cache, void *object)
+{
+    if(object == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&cache -> Lock);
+
+    if(bSystemAllocator == true)
+    {
+        free(object);
+    }
+    else
+    {
+        *(void **)object = cache -> FreeList;
+        cache -> FreeList = object;
+    }
+
+    cache -> InUse--;
+    cache -> TotalFrees++;
+
+    pthread_mutex_unlock(&cache -> Lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         fillMagazine()
+//  Description:           Moves half a magazine of objects from a slab cache into an empty magazine
+//  Input:                 Cache, magazine of the calling thread
+//  Output:                Objects moved (0 if memory is exhausted)
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int fillMagazine(PSLABCACHE cache, PMAGAZINE magazine)
+{
+    void *object = NULL;
+    int count = 0;
+
+    pthread_mutex_lock(&cache -> Lock);
+
+    for(count = 0; count < MAGAZINESIZE / 2; count++)
+    {
+        object = takeObject(cache);
+        if(object == NULL)
+        {
+            break;
+        }
+        magazine -> Objects[count] = object;
+    }
+
+    cache -> InUse = cache -> InUse + count;
+    if(cache -> InUse > cache -> PeakInUse)
+    {
+        cache -> PeakInUse = cache -> InUse;
+    }
+
+    pthread_mutex_unlock(&cache -> Lock);
+
+    __atomic_store_n(&magazine -> Count, count, __ATOMIC_RELAXED);
+
+    return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         drainMagazine()
+//  Description:           Moves objects from the top of a magazine back to the free list of its cache
+//  Input:                 Cache, magazine, number of objects
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void drainMagazine(PSLABCACHE cache, PMAGAZINE magazine, int count)
+{
+    void *object = NULL;
+    int i = 0;
+
+    pthread_mutex_lock(&cache -> Lock);
+
+    for(i = 0; i < count; i++)
+    {
+        object = magazine -> Objects[magazine -> Count - 1 - i];
+        *(void **)object = cache -> FreeList;
+        cache -> FreeList = object;
+    }
+
+    cache -> InUse = cache -> InUse - count;
+
+    pthread_mutex_unlock(&cache -> Lock);
+
+    __atomic_store_n(&magazine -> Count, magazine -> Count - count, __ATOMIC_RELAXED);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         releaseThreadCache()
+//  Description:           Thread exit: returns the objects of every magazine to their caches and frees
+//                         the record for the next thread
+//  Input:                 Thread cache
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void releaseThreadCache(void *arg)
+{
+    PTHREADCACHE threadCache = (PTHREADCACHE)arg;
+    int i = 0;
+
+    pthread_mutex_lock(&threadcachelock);
+
+    for(i = 0; i < SLABCLASSES; i++)
+    {
+        drainMagazine(&slabclasses[i], &threadCache -> Magazines[i], threadCache -> Magazines[i].Count);
+    }
+
+    threadCache -> bUsed = false;
+    currentThreadCache = NULL;
+
+    pthread_mutex_unlock(&threadcachelock);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         createThreadCacheKey()
+//  Description:           Creates the thread specific key that holds the magazines of a thread
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void createThreadCacheKey()
+{
+    pthread_key_create(&threadCacheKey, releaseThreadCache);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getMagazine()
+//  Description:           Returns the magazine of the calling thread for a size class. The first
+//                         allocation of a thread takes over the record of an exited thread or adds one.
+//  Input:                 Size class
+//  Output:                Magazine or NULL (malloc mode, or no record could be allocated)
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PMAGAZINE getMagazine(PSLABCACHE cache)
+{
+    PTHREADCACHE threadCache = NULL;
+
+    if(bSystemAllocator == true)
+    {
+        return NULL;
+    }
+
+    threadCache = currentThreadCache;
+    if(threadCache == NULL)
+    {
+        pthread_once(&threadCacheOnce, createThreadCacheKey);
+        pthread_mutex_lock(&threadcachelock);
+
+        for(threadCache = threadcaches; threadCache != NULL; threadCache = threadCache -> Next)
+        {
+            if(threadCache -> bUsed == false)
+            {
+                break;
+            }
+        }
+
+        if(threadCache == NULL)
+        {
+            threadCache = (PTHREADCACHE)calloc(1, sizeof(THREADCACHE));
+            if(threadCache != NULL)
+            {
+                threadCache -> Next = threadcaches;
+                threadcaches = threadCache;
+            }
+        }
+
+        if(threadCache != NULL)
+        {
+            threadCache -> bUsed = true;
+        }
+
+        pthread_mutex_unlock(&threadcachelock);
+
+        if(threadCache == NULL)
+        {
+            return NULL;
+        }
+
+        pthread_setspecific(threadCacheKey, threadCache);
+        currentThreadCache = threadCache;
+    }
+
+    return &threadCache -> Magazines[cache - slabclasses];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getSlabClass()
+//  Description:           Finds the smallest size class that can hold an object
+//  Input:                 Object size
+//  Output:                Cache pointer or NULL if the object is larger than the biggest class
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PSLABCACHE getSlabClass(size_t size)
+{
+    int i = 0;
+
+    for(i = 0; i < SLABCLASSES; i++)
+    {
+        if(size <= slabclasses[i].ObjectSize)
+        {
+            return &slabclasses[i];
+        }
+    }
+
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         allocObject()
+//  Description:           Allocates a fixed size object from its size class, through the magazine of
+//                         the calling thread
+//  Input:                 Object size
+//  Output:                Object pointer or NULL
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void *allocObject(size_t size)
+{
+    PSLABCACHE cache = getSlabClass(size);
+    PMAGAZINE magazine = NULL;
+    int count = 0;
+
+    // Plain malloc without the lock of the cache, so benchmarks compare against malloc alone
+    if(cache == NULL || bSystemAllocator == true)
+    {
+        return malloc(size);
+    }
+
+    // The magazine of the thread first, the cache is locked once per half magazine
+    magazine = getMagazine(cache);
+    if(magazine == NULL)
+    {
+        return slabAlloc(cache);
+    }
+
+    count = magazine -> Count;
+    if(count == 0)
+    {
+        count = fillMagazine(cache, magazine);
+        if(count == 0)
+        {
+            return NULL;
+        }
+    }
+
+    __atomic_store_n(&magazine -> Count, count - 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&magazine -> Allocs, magazine -> Allocs + 1, __ATOMIC_RELAXED);
+
+    return magazine -> Objects[count - 1];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         freeObject()
+//  Description:           Releases an object allocated with allocObject()
+//  Input:                 Object pointer, object size (same as passed to allocObject)
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void freeObject(void *object, size_t size)
+{
+    PSLABCACHE cache = getSlabClass(size);
+    PMAGAZINE magazine = NULL;
+
+    if(cache == NULL || bSystemAllocator == true)
+    {
+        free(object);
+        return;
+    }
+
+    magazine = (object == NULL) ? NULL : getMagazine(cache);
+    if(magazine == NULL)
+    {
+        slabFree(cache, object);
+        return;
+    }
+
+    if(magazine -> Count == MAGAZINESIZE)
+    {
+        drainMagazine(cache, magazine, MAGAZINESIZE / 2);
+    }
+
+    magazine -> Objects[magazine -> Count] = object;
+    __atomic_store_n(&magazine -> Count, magazine -> Count + 1, __ATOMIC_RELAXED);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         allocBlock()
+//  Description:           Allocates one BLOCKSIZE data block from the block arena
+//  Input:                 void
+//  Output:                Block pointer or NULL
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+char *allocBlock()
+{
+    return (char *)slabAlloc(&blockarena);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         freeBlock()
+//  Description:           Returns a data block to the block arena
+//  Input:                 Block pointer
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void freeBlock(char *block)
+{
+    slabFree(&blockarena, block);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         arenaAlloc()
+//  Description:           Bump allocates memory that lives as long as the filesystem (inode chunks)
+//  Input:                 Size in bytes
+//  Output:                Memory pointer or NULL
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void *arenaAlloc(size_t size)
+{
+    void *memory = NULL;
+    size_t regionSize = ARENAREGIONSIZE;
+
+    pthread_mutex_lock(&arenaobj.Lock);
+
+    if(bSystemAllocator == true)
+    {
+        memory = malloc(size);
+    }
+    else
+    {
+        // Keep every allocation 16 byte aligned
+        size = (size + 15) & ~(size_t)15;
+
+        if(size > arenaobj.RegionLeft)
+        {
+            if(size > regionSize)
+            {
+                regionSize = size;
+            }
+
+            arenaobj.RegionNext = (char *)malloc(regionSize);
+            if(arenaobj.RegionNext == NULL)
+            {
+                arenaobj.RegionLeft = 0;
+                pthread_mutex_unlock(&arenaobj.Lock);
+                return NULL;
+            }
+
+            if(trackRegion(&arenaobj.RegionList, arenaobj.RegionNext) != EXECUTE_SUCCESS)
+            {
+                free(arenaobj.RegionNext);
+                arenaobj.RegionNext = NULL;
+                arenaobj.RegionLeft = 0;
+                pthread_mutex_unlock(&arenaobj.Lock);
+                return NULL;
+            }
+
+            arenaobj.RegionLeft = regionSize;
+            arenaobj.Regions++;
+            arenaobj.ReservedBytes = arenaobj.ReservedBytes + regionSize;
+        }
+
+        memory = arenaobj.RegionNext;
+        arenaobj.RegionNext = arenaobj.RegionNext + size;
+        arenaobj.RegionLeft = arenaobj.RegionLeft - size;
+    }
+
+    if(memory != NULL)
+    {
+        arenaobj.UsedBytes = arenaobj.UsedBytes + size;
+    }
+
+    pthread_mutex_unlock(&arenaobj.Lock);
+
+    return memory;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         displayMemoryStats()
+//  Description:           Prints the usage statistics of every slab cache and the arenas
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void displayMemoryStats()
+{
+    PSLABCACHE cache = NULL;
+    PTHREADCACHE threadCache = NULL;
+    long long kept = 0;
+    long long allocs = 0;
+    int i = 0;
+
+    printf("----------------------------------------------------------------------------\n");
+    printf("%-14s%-8s%-10s%-10s%-10s%-14s%-12s\n", "Cache", "Size", "In Use", "Peak", "Regions", "Reserved", "Allocs");
+    printf("----------------------------------------------------------------------------\n");
+
+    for(i = 0; i <= SLABCLASSES; i++)
+    {
+        cache = (i < SLABCLASSES) ? &slabclasses[i] : &blockarena;
+
+        // Objects kept in the magazines of threads are free
+        kept = 0;
+        allocs = cache -> TotalAllocs;
+        pthread_mutex_lock(&threadcachelock);
+        for(threadCache = threadcaches; threadCache != NULL && i < SLABCLASSES; threadCache = threadCache -> Next)
+        {
+            kept = kept + __atomic_load_n(&threadCache -> Magazines[i].Count, __ATOMIC_RELAXED);
+            allocs = allocs + __atomic_load_n(&threadCache -> Magazines[i].Allocs, __ATOMIC_RELAXED);
+        }
+        pthread_mutex_unlock(&threadcachelock);
+
+        // Size classes that were never used are not interesting
+        if(allocs == 0 && cache != &blockarena)
+        {
+            continue;
+        }
+
+        printf("%-14s%-8zu%-10lld%-10lld%-10d%-14lld%-12lld\n", cache -> Name, cache -> ObjectSize, cache -> InUse - kept,
+               cache -> PeakInUse, cache -> Regions, cache -> ReservedBytes, allocs);
+    }
+
+    printf("%-14s%-8s%-10lld%-10s%-10d%-14lld%-12s\n", "arena", "-", arenaobj.UsedBytes, "-", arenaobj.Regions,
+           arenaobj.ReservedBytes, "-");
+    printf("----------------------------------------------------------------------------\n");
+    printf("Inodes              : %d total, %d free\n", superobj.TotalInodes, superobj.FreeInodes);
+    printf("Data block memory   : %lld bytes in use\n", blockarena.InUse * BLOCKSIZE);
+    printf("Data blocks         : %lld referenced by files, %lld in memory, %lld saved by sharing\n",
+           superobj.LogicalBlocks, blockarena.InUse, superobj.LogicalBlocks - blockarena.InUse - superobj.MappedBlocks - cacheobj.Blocks);
+    printf("Mapped image blocks : %lld (read from the backup image until written)\n", superobj.MappedBlocks);
+    printf("Disk blocks         : %lld (in %s, %d cached, see 'storage')\n", cacheobj.Blocks, STORAGE_FILE, cacheobj.Resident);
+    printf("----------------------------------------------------------------------------\n");
+}
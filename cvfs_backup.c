@@ -0,0 +1,4074 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  File Name:             cvfs_backup.c
+//  Description:           Backup image of the filesystem: writing it through a staging buffer and
+//                         restoring it (current image format and the older record format)
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "cvfs.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//     Global variables or objects used in the project
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool bMappedRestore = true;                                     /* Map images on restore instead of reading them */
+bool bCompressBackup = true;                                    /* Store file data of full images compressed */
+int  backupThreads = 0;                                         /* Threads of a full backup or restore, 0 = per core */
+struct BackupState backupobj;                                   /* Image the next incremental backup appends to */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         writeAll()
+//  Description:           Writes a buffer completely, continuing after short writes and interrupts
+//  Input:                 Host file descriptor, data, number of bytes
+//  Output:                Number of write() calls made or -1 on a host I/O error
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int writeAll(int fd, const void *data, long long size)
+{
+    const char *next = (const char *)data;
+    ssize_t ret = 0;
+    int calls = 0;
+
+    while(size > 0)
+    {
+        ret = write(fd, next, (size_t)size);
+        calls++;
+
+        if(ret < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        next = next + ret;
+        size = size - ret;
+    }
+
+    return calls;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         imageWriterOpen()
+//  Description:           Prepares a staging buffer in front of a host file
+//  Input:                 Writer, host file descriptor, buffer size
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int imageWriterOpen(PIMAGEWRITER writer, int fd, long long capacity)
+{
+    memset(writer, 0, sizeof(IMAGEWRITER));
+
+    writer -> Buffer = (char *)malloc((size_t)capacity);
+    if(writer -> Buffer == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    writer -> Fd = fd;
+    writer -> Capacity = capacity;
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         imageWriterFlush()
+//  Description:           Writes out everything staged so far
+//  Input:                 Writer
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int imageWriterFlush(PIMAGEWRITER writer)
+{
+    int calls = 0;
+
+    if(writer -> bError == true)
+    {
+        return ERR_HOST_IO;
+    }
+
+    if(writer -> Used == 0)
+    {
+        return EXECUTE_SUCCESS;
+    }
+
+    // Whatever put the bytes into the buffer, they are checksummed on the way out
+    if(writer -> bChecksum == true)
+    {
+        writer -> Checksum = crc32c(writer -> Checksum, writer -> Buffer, writer -> Used);
+    }
+
+    calls = writeAll(writer -> Fd, writer -> Buffer, writer -> Used);
+    if(calls < 0)
+    {
+        writer -> bError = true;
+        return ERR_HOST_IO;
+    }
+
+    writer -> Syscalls = writer -> Syscalls + calls;
+    writer -> Written = writer -> Written + writer -> Used;
+    writer -> Used = 0;
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         imageWriterAppend()
+//  Description:           Adds bytes to the image, the buffer is written out whenever it fills up
+//  Input:                 Writer, data, number of bytes
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int imageWriterAppend(PIMAGEWRITER writer, const void *data, long long size)
+{
+    const char *next = (const char *)data;
+    long long chunk = 0;
+
+    while(size > 0)
+    {
+        if(writer -> Used == writer -> Capacity && imageWriterFlush(writer) != EXECUTE_SUCCESS)
+        {
+            return ERR_HOST_IO;
+        }
+
+        chunk = writer -> Capacity - writer -> Used;
+        if(chunk > size)
+        {
+            chunk = size;
+        }
+
+        memcpy(writer -> Buffer + writer -> Used, next, (size_t)chunk);
+        writer -> Used = writer -> Used + chunk;
+        next = next + chunk;
+        size = size - chunk;
+    }
+
+    return (writer -> bError == true) ? ERR_HOST_IO : EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         imageWriterAppendInode()
+//  Description:           Adds the data of a file to the image, copied from the blocks straight into
+//                         the staging buffer
+//  Input:                 Writer, Inode pointer
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int imageWriterAppendInode(PIMAGEWRITER writer, PINODE inode)
+{
+    long long offset = 0;
+    long long chunk = 0;
+
+    while(offset < inode -> ActualFileSize)
+    {
+        if(writer -> Used == writer -> Capacity && imageWriterFlush(writer) != EXECUTE_SUCCESS)
+        {
+            return ERR_HOST_IO;
+        }
+
+        chunk = writer -> Capacity - writer -> Used;
+        if(chunk > inode -> ActualFileSize - offset)
+        {
+            chunk = inode -> ActualFileSize - offset;
+        }
+
+        chunk = readInodeData(inode, writer -> Buffer + writer -> Used, offset, (int)chunk);
+        writer -> Used = writer -> Used + chunk;
+        offset = offset + chunk;
+    }
+
+    return (writer -> bError == true) ? ERR_HOST_IO : EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         imageWriterAppendCompressed()
+//  Description:           Adds the data of a file to a compressed image: every block is compressed
+//                         straight into the staging buffer (or copied when it does not shrink), zero
+//                         blocks and holes are left out, then the stored length of each block follows
+//  Input:                 Writer, Inode pointer
+//  Output:                Bytes added to the image or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+long long imageWriterAppendCompressed(PIMAGEWRITER writer, PINODE inode)
+{
+    PDATABLOCK block = NULL;
+    char *data = NULL;
+    int *lengths = NULL;
+    long long stored = 0;
+    int count = (int)((inode -> ActualFileSize + BLOCKSIZE - 1) / BLOCKSIZE);
+    int size = 0;
+    int i = 0;
+
+    lengths = (int *)malloc(sizeof(int) * (count + 1));
+    if(lengths == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        size = (int)((inode -> ActualFileSize - (long long)i * BLOCKSIZE > BLOCKSIZE) ? BLOCKSIZE : inode -> ActualFileSize - (long long)i * BLOCKSIZE);
+        block = getInodeBlock(inode, i);
+        if(block == NULL)
+        {
+            lengths[i] = 0;
+            continue;
+        }
+
+        data = pinDataBlock(block);
+        if(data == NULL)
+        {
+            free(lengths);
+            return ERR_INSUFFICIENT_SPACE;
+        }
+
+        if(isZeroData(data, size) == true)
+        {
+            unpinDataBlock(block, false);
+            lengths[i] = 0;
+            continue;
+        }
+
+        if(writer -> Capacity - writer -> Used < BLOCKSIZE && imageWriterFlush(writer) != EXECUTE_SUCCESS)
+        {
+            unpinDataBlock(block, false);
+            free(lengths);
+            return ERR_HOST_IO;
+        }
+
+        // Only a block that gets shorter is stored compressed
+        lengths[i] = compressBlock(data, size, writer -> Buffer + writer -> Used, size - 1);
+        if(lengths[i] == 0)
+        {
+            memcpy(writer -> Buffer + writer -> Used, data, size);
+            lengths[i] = size;
+        }
+
+        unpinDataBlock(block, false);
+        writer -> Used = writer -> Used + lengths[i];
+        stored = stored + lengths[i];
+    }
+
+    imageWriterAppend(writer, lengths, sizeof(int) * (long long)count);
+    free(lengths);
+
+    if(writer -> bError == true)
+    {
+        return ERR_HOST_IO;
+    }
+
+    return stored + sizeof(int) * (long long)count;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         imageWriterClose()
+//  Description:           Releases the staging buffer (does not flush or close the host file)
+//  Input:                 Writer
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void imageWriterClose(PIMAGEWRITER writer)
+{
+    free(writer -> Buffer);
+
+    writer -> Buffer = NULL;
+    writer -> Used = 0;
+    writer -> Capacity = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         readAll()
+//  Description:           Reads up to size bytes, continuing after short reads and interrupts
+//  Input:                 Host file descriptor, buffer, number of bytes
+//  Output:                Number of bytes read (less than size only at end of file) or -1 on error
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+long long readAll(int fd, void *data, long long size)
+{
+    char *next = (char *)data;
+    long long done = 0;
+    ssize_t ret = 0;
+
+    while(done < size)
+    {
+        ret = read(fd, next + done, (size_t)(size - done));
+        if(ret < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if(ret == 0)
+        {
+            break;
+        }
+
+        done = done + ret;
+    }
+
+    return done;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         noteFileDeleted()
+//  Description:           Remembers that a file is gone, so the next incremental backup can record
+//                         the delete (ids that never reached an image are ignored on restore)
+//  Input:                 Inode pointer of the file being unlinked
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void noteFileDeleted(PINODE inode)
+{
+    long long *newList = NULL;
+    int newCapacity = 0;
+
+    // Nothing to record when there is no image to append to and none being written
+    if(backupobj.ImageId == 0 && backupobj.bRunning == false)
+    {
+        return;
+    }
+
+    if(backupobj.DeletedCount == backupobj.DeletedCapacity)
+    {
+        newCapacity = (backupobj.DeletedCapacity == 0) ? 16 : backupobj.DeletedCapacity * 2;
+        newList = (long long *)realloc(backupobj.DeletedFiles, sizeof(long long) * newCapacity);
+        if(newList == NULL)
+        {
+            // Without the record the delete can not be replayed, the next backup must be full
+            backupobj.bForceFull = true;
+            return;
+        }
+
+        backupobj.DeletedFiles = newList;
+        backupobj.DeletedCapacity = newCapacity;
+    }
+
+    backupobj.DeletedFiles[backupobj.DeletedCount] = inode -> FileId;
+    backupobj.DeletedCount++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         backupNow()
+//  Description:           Returns a monotonic timestamp for backup timings
+//  Input:                 void
+//  Output:                Microseconds
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static long long backupNow()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         newImageId()
+//  Description:           Creates a random id for the first image of a filesystem
+//  Input:                 void
+//  Output:                Non zero id
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long long newImageId()
+{
+    struct timespec ts;
+    unsigned long long id = 0;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    id = ((unsigned long long)ts.tv_sec << 30) ^ (unsigned long long)ts.tv_nsec ^ ((unsigned long long)getpid() << 48);
+
+    return (id == 0) ? 1 : id;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getHeaderChecksum()
+//  Description:           Checksum of an image header, computed with the checksum field cleared
+//  Input:                 Header
+//  Output:                Checksum
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int getHeaderChecksum(PIMAGEHEADER header)
+{
+    IMAGEHEADER copy;
+
+    memcpy(&copy, header, sizeof(IMAGEHEADER));
+    copy.HeaderChecksum = 0;
+
+    return crc32c(0, &copy, header -> HeaderSize);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         takeSnapshot()
+//  Description:           Takes a point-in-time copy of what the next backup stores: the inodes (all
+//                         of them for a full image, only the changed ones for a delta) with a
+//                         reference on their block maps, and the deletes. Later changes get a new
+//                         generation and copy the blocks shared with the snapshot before writing
+//                         them, so the snapshot never changes while it is written.
+//  Input:                 Snapshot to fill, true to always write a full image
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int takeSnapshot(PSNAPSHOT snap, bool bFull)
+{
+    PINODE temp = NULL;
+    int i = 0;
+
+    memset(snap, 0, sizeof(SNAPSHOT));
+    snap -> Fd = -1;
+    snap -> StartTime = backupNow();
+
+    // The image must still be the one we know, with room for another segment
+    if(bFull == false && backupobj.bForceFull == false && backupobj.ImageId != 0)
+    {
+        snap -> Fd = open(BACKUP_FILE, O_RDWR);
+        if(snap -> Fd >= 0 &&
+           (readAll(snap -> Fd, &snap -> Header, sizeof(IMAGEHEADER)) != sizeof(IMAGEHEADER) ||
+            memcmp(snap -> Header.Magic, IMAGE_MAGIC, sizeof(snap -> Header.Magic)) != 0 ||
+            snap -> Header.Version != IMAGE_VERSION || snap -> Header.HeaderSize != sizeof(IMAGEHEADER) ||
+            (snap -> Header.Flags & IMAGE_CHECKSUMS) == 0 ||
+            snap -> Header.ImageId != backupobj.ImageId || snap -> Header.Generation != backupobj.ImageGeneration ||
+            snap -> Header.SegmentCount >= IMAGE_MAXSEGMENTS))
+        {
+            close(snap -> Fd);
+            snap -> Fd = -1;
+        }
+    }
+
+    // A full image keeps the id, so the journal stays valid on top of it
+    if(snap -> Fd < 0)
+    {
+        memset(&snap -> Header, 0, sizeof(IMAGEHEADER));
+        snap -> Header.ImageId = backupobj.ImageId;
+        snap -> Header.Generation = backupobj.ImageGeneration;
+    }
+
+    snap -> Files = (PINODE)malloc(sizeof(INODE) * (superobj.TotalInodes - superobj.FreeInodes + 1));
+    snap -> DeletedFiles = (long long *)malloc(sizeof(long long) * (backupobj.DeletedCount + 1));
+    if(snap -> Files == NULL || snap -> DeletedFiles == NULL)
+    {
+        free(snap -> Files);
+        free(snap -> DeletedFiles);
+        if(snap -> Fd >= 0)
+        {
+            close(snap -> Fd);
+        }
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    for(i = 1; i < inodetableobj.NextUnused; i++)
+    {
+        temp = getInode(i);
+        if(temp -> FileType == 0 || (snap -> Fd >= 0 && temp -> Generation <= backupobj.BackupGeneration))
+        {
+            continue;
+        }
+
+        memcpy(&snap -> Files[snap -> FileCount], temp, sizeof(INODE));
+        holdBlockMap(temp -> BlockMap);
+        snap -> FileCount++;
+    }
+
+    if(backupobj.DeletedCount > 0)
+    {
+        memcpy(snap -> DeletedFiles, backupobj.DeletedFiles, sizeof(long long) * backupobj.DeletedCount);
+    }
+    snap -> DeletedCount = backupobj.DeletedCount;
+
+    snap -> BaseGeneration = backupobj.BackupGeneration;
+    snap -> NextFileId = superobj.NextFileId;
+    snap -> bCompress = bCompressBackup;
+    snap -> JournalOffset = journalMark();
+
+    // Everything logged so far is in the snapshot, changes from now on belong to the next backup
+    snap -> Generation = superobj.Generation;
+    superobj.Generation++;
+
+    if(snap -> Fd < 0)
+    {
+        backupobj.bForceFull = false;
+    }
+
+    snap -> CopiedBlocks = superobj.CopiedBlocks;
+    snap -> PauseTime = backupNow() - snap -> StartTime;
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         releaseSnapshot()
+//  Description:           Drops the block map references of a snapshot and frees it
+//  Input:                 Snapshot
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void releaseSnapshot(PSNAPSHOT snap)
+{
+    int i = 0;
+
+    for(i = 0; i < snap -> FileCount; i++)
+    {
+        putBlockMap(snap -> Files[i].BlockMap);
+    }
+
+    if(snap -> Fd >= 0)
+    {
+        close(snap -> Fd);
+    }
+
+    free(snap -> Files);
+    free(snap -> DeletedFiles);
+
+    snap -> Files = NULL;
+    snap -> DeletedFiles = NULL;
+    snap -> FileCount = 0;
+    snap -> Fd = -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getWorkerThreads()
+//  Description:           Number of threads to share some work: one per core (or backupThreads when it
+//                         is set), at most maxThreads, and only as many as there is work for
+//  Input:                 Amount of work, amount worth a thread, upper bound
+//  Output:                Number of threads, at least 1
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int getWorkerThreads(long long work, long long workPerThread, int maxThreads)
+{
+    long threads = (backupThreads > 0) ? backupThreads : sysconf(_SC_NPROCESSORS_ONLN);
+
+    if(threads > maxThreads)
+    {
+        threads = maxThreads;
+    }
+    if(backupThreads <= 0 && threads > work / workPerThread)
+    {
+        threads = (long)(work / workPerThread);
+    }
+    if(threads < 1)
+    {
+        threads = 1;
+    }
+
+    return (int)threads;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         backupShardWorker()
+//  Description:           Writes the data of one shard of a full image through a staging buffer of
+//                         its own and checksums its blocks. The entries and checksums of its files
+//                         are filled in place, shards never share one.
+//  Input:                 Shard
+//  Output:                NULL
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void *backupShardWorker(void *arg)
+{
+    PBACKUPSHARD shard = (PBACKUPSHARD)arg;
+    PSNAPSHOT snap = shard -> Snapshot;
+    PIMAGEINODE table = shard -> Table;
+    IMAGEWRITER writer;
+    long long blocks = shard -> FirstBlock;
+    long long stored = 0;
+    int size = 0;
+    int i = 0, j = 0;
+
+    shard -> Status = imageWriterOpen(&writer, shard -> Fd, BACKUPBUFFERSIZE);
+    if(shard -> Status != EXECUTE_SUCCESS)
+    {
+        return NULL;
+    }
+
+    for(i = shard -> First; i < shard -> Last && writer.bError == false; i++)
+    {
+        // Compressed data is placed relative to the shard until the shards are joined
+        if(snap -> bCompress == true)
+        {
+            stored = imageWriterAppendCompressed(&writer, &snap -> Files[i]);
+            if(stored < 0)
+            {
+                writer.bError = true;
+                break;
+            }
+
+            table[i].DataOffset = shard -> Stored;
+            table[i].StoredSize = stored;
+            shard -> Stored = shard -> Stored + stored;
+        }
+        else
+        {
+            imageWriterAppendInode(&writer, &snap -> Files[i]);
+            shard -> Stored = shard -> Stored + table[i].ActualFileSize;
+        }
+
+        // The checksums of the blocks go behind all file data, the file checksum covers them
+        table[i].ChecksumOffset = blocks * (long long)sizeof(unsigned int);
+        for(j = 0; (long long)j * BLOCKSIZE < table[i].ActualFileSize; j++)
+        {
+            size = (int)((table[i].ActualFileSize - (long long)j * BLOCKSIZE > BLOCKSIZE) ? BLOCKSIZE : table[i].ActualFileSize - (long long)j * BLOCKSIZE);
+            shard -> Sums[blocks + j] = checksumInodeBlock(&snap -> Files[i], j, size);
+        }
+        table[i].Checksum = crc32c(0, &shard -> Sums[blocks], (long long)j * sizeof(unsigned int));
+        blocks = blocks + j;
+
+        // Progress counts the file data going in, compressed or not
+        __atomic_add_fetch(&snap -> DoneBytes, table[i].ActualFileSize, __ATOMIC_RELAXED);
+    }
+
+    shard -> Status = imageWriterFlush(&writer);
+    imageWriterClose(&writer);
+
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         appendShard()
+//  Description:           Copies a shard file to the end of the image
+//  Input:                 Image host file descriptor (positioned at its end), shard file, bytes
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int appendShard(int fd, int shardFd, long long size)
+{
+    char *buffer = NULL;
+    long long chunk = 0;
+    int iRet = EXECUTE_SUCCESS;
+
+    buffer = (char *)malloc(BACKUPBUFFERSIZE);
+    if(buffer == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    if(lseek(shardFd, 0, SEEK_SET) != 0)
+    {
+        iRet = ERR_HOST_IO;
+    }
+
+    while(size > 0 && iRet == EXECUTE_SUCCESS)
+    {
+        chunk = (size < BACKUPBUFFERSIZE) ? size : BACKUPBUFFERSIZE;
+        if(readAll(shardFd, buffer, chunk) != chunk || writeAll(fd, buffer, chunk) < 0)
+        {
+            iRet = ERR_HOST_IO;
+        }
+        size = size - chunk;
+    }
+
+    free(buffer);
+
+    return iRet;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         backupShards()
+//  Description:           Writes the file data of a full image as shards, one thread each. The first
+//                         shard goes through the image descriptor; the others write uncompressed data
+//                         at its precomputed offset through a descriptor of their own, compressed data
+//                         to a shard file that is appended in order afterwards.
+//  Input:                 Snapshot, inode table, block checksums, image host file descriptor
+//                         (positioned at the data), header
+//  Output:                Offset where the data ends or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static long long backupShards(PSNAPSHOT snap, PIMAGEINODE table, unsigned int *sums, int fd, PIMAGEHEADER header)
+{
+    BACKUPSHARD shards[BACKUP_MAXTHREADS];
+    bool bStarted[BACKUP_MAXTHREADS];
+    char name[64] = {'\0'};
+    long long position = header -> DataOffset;
+    long long blocks = 0;
+    long long bytes = 0;
+    int count = header -> InodeCount;
+    int shardCount = getWorkerThreads(header -> DataSize, BACKUP_SHARDBYTES, BACKUP_MAXTHREADS);
+    int iRet = EXECUTE_SUCCESS;
+    int i = 0, k = 0;
+
+    if(shardCount > count && count > 0)
+    {
+        shardCount = count;
+    }
+
+    // Cut the files into runs with about the same amount of data
+    memset(shards, 0, sizeof(shards));
+    for(k = 0, i = 0; k < shardCount; k++)
+    {
+        shards[k].Snapshot = snap;
+        shards[k].Table = table;
+        shards[k].Sums = sums;
+        shards[k].First = i;
+        shards[k].FirstBlock = blocks;
+        shards[k].Fd = -1;
+
+        while(i < count && (k == shardCount - 1 || bytes < header -> DataSize * (k + 1) / shardCount))
+        {
+            bytes = bytes + table[i].ActualFileSize;
+            blocks = blocks + (table[i].ActualFileSize + BLOCKSIZE - 1) / BLOCKSIZE;
+            i++;
+        }
+        shards[k].Last = i;
+        bStarted[k] = false;
+    }
+
+    shards[0].Fd = fd;
+    for(k = 1; k < shardCount && iRet == EXECUTE_SUCCESS; k++)
+    {
+        if(snap -> bCompress == true)
+        {
+            snprintf(name, sizeof(name), BACKUP_SHARD_FILE, k);
+            shards[k].Fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        }
+        else
+        {
+            shards[k].Fd = open(BACKUP_TEMP_FILE, O_WRONLY);
+            if(shards[k].Fd != -1 && shards[k].First < count &&
+               lseek(shards[k].Fd, table[shards[k].First].DataOffset, SEEK_SET) != table[shards[k].First].DataOffset)
+            {
+                iRet = ERR_HOST_IO;
+            }
+        }
+
+        if(shards[k].Fd == -1)
+        {
+            iRet = ERR_HOST_IO;
+        }
+    }
+
+    __atomic_store_n(&snap -> DoneBytes, header -> DataOffset, __ATOMIC_RELAXED);
+
+    // The calling thread writes the first shard itself, a shard without a thread is written inline too
+    if(iRet == EXECUTE_SUCCESS)
+    {
+        for(k = 1; k < shardCount; k++)
+        {
+            bStarted[k] = (pthread_create(&shards[k].Thread, NULL, backupShardWorker, &shards[k]) == 0);
+        }
+
+        backupShardWorker(&shards[0]);
+
+        for(k = 1; k < shardCount; k++)
+        {
+            if(bStarted[k] == true)
+            {
+                pthread_join(shards[k].Thread, NULL);
+            }
+            else
+            {
+                backupShardWorker(&shards[k]);
+            }
+        }
+
+        for(k = 0; k < shardCount; k++)
+        {
+            if(shards[k].Status != EXECUTE_SUCCESS)
+            {
+                iRet = shards[k].Status;
+            }
+        }
+    }
+
+    // Compressed shards are appended in order, the data of their files moves with them
+    for(k = 0; k < shardCount && iRet == EXECUTE_SUCCESS; k++)
+    {
+        if(snap -> bCompress == true)
+        {
+            if(k > 0)
+            {
+                iRet = appendShard(fd, shards[k].Fd, shards[k].Stored);
+            }
+
+            for(i = shards[k].First; i < shards[k].Last; i++)
+            {
+                table[i].DataOffset = table[i].DataOffset + position;
+            }
+        }
+        position = position + shards[k].Stored;
+    }
+
+    for(k = 1; k < shardCount; k++)
+    {
+        if(shards[k].Fd != -1)
+        {
+            close(shards[k].Fd);
+        }
+        if(snap -> bCompress == true)
+        {
+            snprintf(name, sizeof(name), BACKUP_SHARD_FILE, k);
+            unlink(name);
+        }
+    }
+
+    return (iRet != EXECUTE_SUCCESS) ? iRet : position;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         backupFullImage()
+//  Description:           Saves a snapshot to BACKUP_FILE as one image: header, inode table and the
+//                         packed file data. The image is staged in large buffers so it takes a few
+//                         write() calls, the data by several threads (see backupShards()); it goes
+//                         to a temporary file first and replaces the old backup only when it is
+//                         complete. Every block is checksummed on the way;
+//                         the table and header are rewritten at the end, when the checksums and the
+//                         place of compressed data are known.
+//  Input:                 Snapshot of every live file
+//  Output:                Status Code
+//  Date:                  28/01/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int backupFullImage(PSNAPSHOT snap)
+{
+    PINODE temp = NULL;
+    PIMAGEINODE table = NULL;
+    IMAGEHEADER header;
+    IMAGEWRITER writer;
+    PIMAGEINDEXSLOT index = NULL;
+    unsigned int *sums = NULL;
+    unsigned int hash = 0;
+    long long dataOffset = 0;
+    long long totalBlocks = 0;
+    long long indexSize = 0;
+    int count = snap -> FileCount;
+    int slots = 16;
+    int fd = 0;
+    int iRet = EXECUTE_SUCCESS;
+    int i = 0, j = 0;
+
+    for(i = 0; i < count; i++)
+    {
+        totalBlocks = totalBlocks + (snap -> Files[i].ActualFileSize + BLOCKSIZE - 1) / BLOCKSIZE;
+    }
+
+    // The name index is kept at most two thirds full
+    while((long long)slots * 2 < (long long)count * 3)
+    {
+        slots = slots * 2;
+    }
+    indexSize = (long long)slots * sizeof(IMAGEINDEXSLOT);
+
+    // Describe every file first, the offsets of the data follow from the sizes
+    table = (PIMAGEINODE)malloc(sizeof(IMAGEINODE) * (count + 1));
+    sums = (unsigned int *)malloc(sizeof(unsigned int) * (totalBlocks + 1));
+    index = (PIMAGEINDEXSLOT)calloc(slots, sizeof(IMAGEINDEXSLOT));
+    if(table == NULL || sums == NULL || index == NULL)
+    {
+        free(table);
+        free(sums);
+        free(index);
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.Magic, IMAGE_MAGIC, sizeof(header.Magic));
+    header.Version = IMAGE_VERSION;
+    header.HeaderSize = sizeof(IMAGEHEADER);
+    header.InodeSize = sizeof(IMAGEINODE);
+    header.InodeTableOffset = sizeof(IMAGEHEADER);
+    header.ImageId = (snap -> Header.ImageId != 0) ? snap -> Header.ImageId : newImageId();
+    header.Generation = snap -> Header.Generation + 1;
+    header.NextFileId = snap -> NextFileId;
+    header.SnapshotGeneration = snap -> Generation;
+    header.Flags = IMAGE_CHECKSUMS | IMAGE_INDEXED;
+    if(snap -> bCompress == true)
+    {
+        header.Flags = header.Flags | IMAGE_COMPRESSED;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        temp = &snap -> Files[i];
+
+        memset(&table[i], 0, sizeof(IMAGEINODE));
+        memcpy(table[i].FileName, temp -> FileName, sizeof(table[i].FileName));
+        table[i].InodeNumber = temp -> InodeNumber;
+        table[i].Permission = temp -> Permission;
+        table[i].ActualFileSize = temp -> ActualFileSize;
+        table[i].FileId = temp -> FileId;
+
+        hash = hashFileName(temp -> FileName);
+        j = hash & (slots - 1);
+        while(index[j].Entry != 0)
+        {
+            j = (j + 1) & (slots - 1);
+        }
+        index[j].Hash = hash;
+        index[j].Entry = i + 1;
+    }
+
+    header.InodeCount = count;
+    header.DataOffset = header.InodeTableOffset + (long long)count * sizeof(IMAGEINODE);
+
+    dataOffset = header.DataOffset;
+    for(i = 0; i < count; i++)
+    {
+        table[i].DataOffset = dataOffset;
+        dataOffset = dataOffset + table[i].ActualFileSize;
+    }
+
+    header.DataSize = dataOffset - header.DataOffset;
+    header.ImageSize = dataOffset + totalBlocks * (long long)sizeof(unsigned int) + indexSize;
+    header.EndOffset = header.ImageSize;
+
+    __atomic_store_n(&snap -> TotalBytes, header.ImageSize, __ATOMIC_RELAXED);
+
+    fd = open(BACKUP_TEMP_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd == -1)
+    {
+        free(table);
+        free(sums);
+        free(index);
+        return ERR_HOST_IO;
+    }
+
+    iRet = imageWriterOpen(&writer, fd, BACKUPBUFFERSIZE);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        close(fd);
+        unlink(BACKUP_TEMP_FILE);
+        free(table);
+        free(sums);
+        free(index);
+        return iRet;
+    }
+
+    imageWriterAppend(&writer, &header, sizeof(header));
+    imageWriterAppend(&writer, table, (long long)count * sizeof(IMAGEINODE));
+
+    // The data goes in the same order as the table, in shards written side by side
+    dataOffset = ERR_HOST_IO;
+    if(imageWriterFlush(&writer) == EXECUTE_SUCCESS)
+    {
+        dataOffset = backupShards(snap, table, sums, fd, &header);
+    }
+
+    iRet = (dataOffset < 0) ? (int)dataOffset : EXECUTE_SUCCESS;
+    if(iRet == EXECUTE_SUCCESS && lseek(fd, dataOffset, SEEK_SET) != dataOffset)
+    {
+        iRet = ERR_HOST_IO;
+    }
+
+    if(iRet == EXECUTE_SUCCESS)
+    {
+        imageWriterAppend(&writer, sums, totalBlocks * (long long)sizeof(unsigned int));
+        imageWriterAppend(&writer, index, indexSize);
+        iRet = imageWriterFlush(&writer);
+    }
+    imageWriterClose(&writer);
+    free(sums);
+
+    // Where the data ends is known now, the header and table are rewritten with the checksums
+    if(iRet == EXECUTE_SUCCESS)
+    {
+        for(i = 0; i < count; i++)
+        {
+            table[i].ChecksumOffset = table[i].ChecksumOffset + dataOffset;
+        }
+
+        header.DataSize = dataOffset - header.DataOffset;
+        header.IndexOffset = dataOffset + totalBlocks * (long long)sizeof(unsigned int);
+        header.IndexSlots = slots;
+        header.IndexChecksum = crc32c(0, index, indexSize);
+        header.ImageSize = header.IndexOffset + indexSize;
+        header.EndOffset = header.ImageSize;
+        header.TableChecksum = crc32c(0, table, (long long)count * sizeof(IMAGEINODE));
+        header.HeaderChecksum = getHeaderChecksum(&header);
+
+        if(pwrite(fd, &header, sizeof(header), 0) != sizeof(header) ||
+           pwrite(fd, table, (size_t)count * sizeof(IMAGEINODE), header.InodeTableOffset) != (ssize_t)((size_t)count * sizeof(IMAGEINODE)))
+        {
+            iRet = ERR_HOST_IO;
+        }
+    }
+    free(table);
+    free(index);
+
+    // The old backup is only replaced by a complete image
+    if(iRet == EXECUTE_SUCCESS && fsync(fd) != 0)
+    {
+        iRet = ERR_HOST_IO;
+    }
+    if(close(fd) != 0 && iRet == EXECUTE_SUCCESS)
+    {
+        iRet = ERR_HOST_IO;
+    }
+    if(iRet == EXECUTE_SUCCESS && rename(BACKUP_TEMP_FILE, BACKUP_FILE) != 0)
+    {
+        iRet = ERR_HOST_IO;
+    }
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        unlink(BACKUP_TEMP_FILE);
+        return iRet;
+    }
+
+    snap -> Header = header;
+    __atomic_store_n(&snap -> TotalBytes, header.ImageSize, __ATOMIC_RELAXED);
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         isDeltaBlock()
+//  Description:           Tells whether a block of a changed file goes into the delta segment
+//  Input:                 Inode pointer, block index, delta flags of the file, generation of the
+//                         previous backup
+//  Output:                true if the block is stored
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool isDeltaBlock(PINODE inode, int blockIndex, int flags, long long baseGeneration)
+{
+    PDATABLOCK block = inode -> BlockMap -> Blocks[blockIndex];
+
+    if(block == NULL || (long long)blockIndex * BLOCKSIZE >= inode -> ActualFileSize)
+    {
+        return false;
+    }
+
+    // A file stored from scratch needs every block, otherwise only the ones written since
+    return ((flags & DELTA_FULL) != 0 || block -> Generation > baseGeneration);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getDeltaBlockSize()
+//  Description:           Returns the number of bytes of a block that are inside the file
+//  Input:                 File size, block index
+//  Output:                Number of bytes (BLOCKSIZE except for the last block)
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int getDeltaBlockSize(long long fileSize, int blockIndex)
+{
+    long long size = fileSize - (long long)blockIndex * BLOCKSIZE;
+
+    return (size > BLOCKSIZE) ? BLOCKSIZE : (int)size;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         backupDeltaSegment()
+//  Description:           Appends a snapshot of the changes since the last backup to the image as
+//                         one segment: deleted files, and for every changed file its metadata and
+//                         the blocks written since. The header is rewritten only after the segment
+//                         is on disk, so an interrupted backup leaves the image as it was.
+//  Input:                 Snapshot of the changed files, with the image opened for reading and writing
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int backupDeltaSegment(PSNAPSHOT snap)
+{
+    PINODE files = snap -> Files;
+    PIMAGEHEADER header = &snap -> Header;
+    PIMAGEDELTA records = NULL;
+    IMAGESEGMENT segment;
+    IMAGEWRITER writer;
+    PDATABLOCK block = NULL;
+    char *data = NULL;
+    unsigned int checksum = 0;
+    long long offset = 0;
+    int count = snap -> FileCount;
+    int fd = snap -> Fd;
+    int iRet = EXECUTE_SUCCESS;
+    int i = 0, j = 0;
+
+    records = (PIMAGEDELTA)malloc(sizeof(IMAGEDELTA) * (count + 1));
+    if(records == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    // Only files stamped after the last backup are in the snapshot, their blocks are looked at one by one
+    for(i = 0; i < count; i++)
+    {
+        memset(&records[i], 0, sizeof(IMAGEDELTA));
+        memcpy(records[i].FileName, files[i].FileName, sizeof(records[i].FileName));
+        records[i].Permission = files[i].Permission;
+        records[i].FileId = files[i].FileId;
+        records[i].ActualFileSize = files[i].ActualFileSize;
+        records[i].Flags = (files[i].BaseGeneration > snap -> BaseGeneration) ? DELTA_FULL : 0;
+
+        for(j = 0; j < getInodeBlockCount(&files[i]); j++)
+        {
+            if(isDeltaBlock(&files[i], j, records[i].Flags, snap -> BaseGeneration) == true)
+            {
+                records[i].BlockCount++;
+            }
+        }
+    }
+
+    memset(&segment, 0, sizeof(segment));
+    memcpy(segment.Magic, SEGMENT_MAGIC, sizeof(segment.Magic));
+    segment.Generation = header -> Generation + 1;
+    segment.RecordCount = count;
+    segment.DeleteCount = snap -> DeletedCount;
+
+    // Lay out the block lists behind the record table
+    offset = sizeof(IMAGESEGMENT) + (long long)segment.DeleteCount * sizeof(long long) + (long long)count * sizeof(IMAGEDELTA);
+    for(i = 0; i < count; i++)
+    {
+        records[i].DataOffset = offset;
+        offset = offset + (long long)records[i].BlockCount * sizeof(int);
+
+        for(j = 0; j < getInodeBlockCount(&files[i]); j++)
+        {
+            if(isDeltaBlock(&files[i], j, records[i].Flags, snap -> BaseGeneration) == true)
+            {
+                offset = offset + getDeltaBlockSize(files[i].ActualFileSize, j);
+            }
+        }
+    }
+    segment.Size = offset + sizeof(unsigned int);
+
+    // Nothing changed since the last backup
+    if(count == 0 && segment.DeleteCount == 0)
+    {
+        free(records);
+        return EXECUTE_SUCCESS;
+    }
+
+    __atomic_store_n(&snap -> TotalBytes, segment.Size, __ATOMIC_RELAXED);
+
+    // Anything behind the last complete segment is left over from an interrupted backup
+    if(ftruncate(fd, header -> EndOffset) != 0 || lseek(fd, header -> EndOffset, SEEK_SET) != header -> EndOffset)
+    {
+        free(records);
+        return ERR_HOST_IO;
+    }
+
+    iRet = imageWriterOpen(&writer, fd, BACKUPBUFFERSIZE);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        free(records);
+        return iRet;
+    }
+
+    // The segment ends with the checksum of everything before it
+    writer.bChecksum = true;
+
+    imageWriterAppend(&writer, &segment, sizeof(segment));
+    imageWriterAppend(&writer, snap -> DeletedFiles, (long long)segment.DeleteCount * sizeof(long long));
+    imageWriterAppend(&writer, records, (long long)count * sizeof(IMAGEDELTA));
+
+    for(i = 0; i < count && writer.bError == false; i++)
+    {
+        for(j = 0; j < getInodeBlockCount(&files[i]); j++)
+        {
+            if(isDeltaBlock(&files[i], j, records[i].Flags, snap -> BaseGeneration) == true)
+            {
+                imageWriterAppend(&writer, &j, sizeof(int));
+            }
+        }
+
+        for(j = 0; j < getInodeBlockCount(&files[i]); j++)
+        {
+            if(isDeltaBlock(&files[i], j, records[i].Flags, snap -> BaseGeneration) == false)
+            {
+                continue;
+            }
+
+            block = getInodeBlock(&files[i], j);
+            data = pinDataBlock(block);
+            if(data == NULL)
+            {
+                writer.bError = true;
+                break;
+            }
+
+            imageWriterAppend(&writer, data, getDeltaBlockSize(files[i].ActualFileSize, j));
+            unpinDataBlock(block, false);
+            checksumInodeBlock(&files[i], j, getDeltaBlockSize(files[i].ActualFileSize, j));
+        }
+
+        __atomic_store_n(&snap -> DoneBytes, writer.Written + writer.Used, __ATOMIC_RELAXED);
+    }
+
+    if(imageWriterFlush(&writer) == EXECUTE_SUCCESS)
+    {
+        checksum = writer.Checksum;
+        imageWriterAppend(&writer, &checksum, sizeof(checksum));
+    }
+
+    iRet = imageWriterFlush(&writer);
+    imageWriterClose(&writer);
+    free(records);
+
+    if(iRet != EXECUTE_SUCCESS || fsync(fd) != 0)
+    {
+        return ERR_HOST_IO;
+    }
+
+    // Commit the segment by pointing the header past it
+    header -> Generation = segment.Generation;
+    header -> SegmentCount++;
+    header -> EndOffset = header -> EndOffset + segment.Size;
+    header -> NextFileId = snap -> NextFileId;
+    header -> SnapshotGeneration = snap -> Generation;
+    header -> HeaderChecksum = getHeaderChecksum(header);
+
+    if(pwrite(fd, header, sizeof(IMAGEHEADER), 0) != sizeof(IMAGEHEADER) || fsync(fd) != 0)
+    {
+        return ERR_HOST_IO;
+    }
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         writeSnapshot()
+//  Description:           Writes a snapshot out as a delta segment or a full image. Only touches the
+//                         snapshot and the backup file, so it can run on the backup thread while the
+//                         shell keeps changing files.
+//  Input:                 Snapshot
+//  Output:                void (the result is left in the snapshot)
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void writeSnapshot(PSNAPSHOT snap)
+{
+    if(snap -> Fd >= 0)
+    {
+        snap -> Status = backupDeltaSegment(snap);
+    }
+    else
+    {
+        snap -> Status = backupFullImage(snap);
+    }
+
+    snap -> ElapsedTime = backupNow() - snap -> StartTime;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         completeSnapshot()
+//  Description:           Finishes a backup on the shell side: after a successful write the image
+//                         holds every change up to the snapshot, later changes and deletes go into
+//                         the next delta and the journal keeps only the records logged since
+//  Input:                 Snapshot that was written
+//  Output:                Status Code of the write
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int completeSnapshot(PSNAPSHOT snap)
+{
+    int iRet = snap -> Status;
+
+    if(iRet == EXECUTE_SUCCESS)
+    {
+        backupobj.ImageId = snap -> Header.ImageId;
+        backupobj.ImageGeneration = snap -> Header.Generation;
+        backupobj.BackupGeneration = snap -> Generation;
+
+        // Deletes noted while the snapshot was written stay for the next backup
+        backupobj.DeletedCount = backupobj.DeletedCount - snap -> DeletedCount;
+        if(snap -> DeletedCount > 0)
+        {
+            memmove(backupobj.DeletedFiles, backupobj.DeletedFiles + snap -> DeletedCount, sizeof(long long) * backupobj.DeletedCount);
+        }
+
+        backupobj.bLastIncremental = (snap -> Fd >= 0);
+        backupobj.LastBytes = snap -> TotalBytes;
+        backupobj.LastTime = snap -> ElapsedTime;
+        backupobj.LastPause = snap -> PauseTime;
+        backupobj.LastCopied = superobj.CopiedBlocks - snap -> CopiedBlocks;
+
+        journalTrim(snap -> JournalOffset);
+    }
+    else if(snap -> Fd < 0)
+    {
+        // The delete that forced this full image is not on disk yet
+        backupobj.bForceFull = true;
+    }
+
+    releaseSnapshot(snap);
+
+    return iRet;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         backupCVFS()
+//  Description:           Saves the filesystem to BACKUP_FILE and waits for it. When the image on disk
+//                         is the one this filesystem was last backed up to (or restored from), only
+//                         the changes are appended as a delta segment, otherwise a full image is
+//                         written.
+//  Input:                 true to always write a full image (compacts the deltas)
+//  Output:                Status Code
+//  Author:                Ritesh Jillewad
+//  Date:                  28/01/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int backupCVFS(bool bFull)
+{
+    SNAPSHOT snapshot;
+    int iRet = 0;
+
+    // A backup still running in the background is older, it goes first
+    backupWait();
+
+    iRet = takeSnapshot(&snapshot, bFull);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        return iRet;
+    }
+
+    writeSnapshot(&snapshot);
+
+    return completeSnapshot(&snapshot);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         backupThread()
+//  Description:           Body of the backup thread: writes the snapshot and flags that it is done
+//  Input:                 Snapshot
+//  Output:                NULL
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void *backupThread(void *arg)
+{
+    writeSnapshot((PSNAPSHOT)arg);
+
+    __atomic_store_n(&backupobj.bDone, true, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         backupStart()
+//  Description:           Takes a snapshot and writes it out on a background thread, the shell keeps
+//                         serving reads and writes meanwhile. The backup is finished off by
+//                         backupPoll() or backupWait() on the shell side.
+//  Input:                 true to always write a full image
+//  Output:                Status Code (backupobj.bRunning tells whether it runs in the background)
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int backupStart(bool bFull)
+{
+    int iRet = 0;
+
+    if(backupobj.bRunning == true)
+    {
+        return ERR_BACKUP_RUNNING;
+    }
+
+    iRet = takeSnapshot(&backupobj.Snapshot, bFull);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        return iRet;
+    }
+
+    backupobj.bDone = false;
+
+    // Without a thread the snapshot is written right away
+    if(pthread_create(&backupobj.Thread, NULL, backupThread, &backupobj.Snapshot) != 0)
+    {
+        writeSnapshot(&backupobj.Snapshot);
+        return completeSnapshot(&backupobj.Snapshot);
+    }
+
+    backupobj.bRunning = true;
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         finishBackground()
+//  Description:           Joins the backup thread, completes its backup and reports the result
+//  Input:                 void
+//  Output:                Status Code of the backup
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int finishBackground()
+{
+    int iRet = 0;
+
+    pthread_join(backupobj.Thread, NULL);
+    backupobj.bRunning = false;
+
+    iRet = completeSnapshot(&backupobj.Snapshot);
+    if(iRet == EXECUTE_SUCCESS)
+    {
+        printf("CVFS: Backup created successfully (%s, %lld bytes written in %.1f ms).\n",
+               backupobj.bLastIncremental ? "incremental" : "full", backupobj.LastBytes, backupobj.LastTime / 1000.0);
+    }
+    else
+    {
+        printf("CVFS: Error creating backup.\n");
+    }
+
+    return iRet;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         backupPoll()
+//  Description:           Completes a background backup whose thread has finished, the shell calls
+//                         it before every prompt
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void backupPoll()
+{
+    if(backupobj.bRunning == true && __atomic_load_n(&backupobj.bDone, __ATOMIC_ACQUIRE) == true)
+    {
+        finishBackground();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         backupWait()
+//  Description:           Waits for a background backup to finish and completes it
+//  Input:                 void
+//  Output:                Status Code of the backup, EXECUTE_SUCCESS if none was running
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int backupWait()
+{
+    if(backupobj.bRunning == false)
+    {
+        return EXECUTE_SUCCESS;
+    }
+
+    return finishBackground();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         displayBackupStatus()
+//  Description:           Prints the progress of a background backup and what it costs the shell:
+//                         the pause for the snapshot and the blocks copied on write since
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void displayBackupStatus()
+{
+    PSNAPSHOT snap = &backupobj.Snapshot;
+    long long total = 0;
+    long long done = 0;
+
+    backupPoll();
+
+    if(backupobj.bRunning == true)
+    {
+        total = __atomic_load_n(&snap -> TotalBytes, __ATOMIC_RELAXED);
+        done = __atomic_load_n(&snap -> DoneBytes, __ATOMIC_RELAXED);
+
+        printf("Backup              : running (%s, %d files in the snapshot)\n", (snap -> Fd >= 0) ? "incremental" : "full", snap -> FileCount);
+        if(total == 0)
+        {
+            printf("Progress            : preparing\n");
+        }
+        else
+        {
+            printf("Progress            : %lld of %lld bytes (%.0f%%)\n", done, total, 100.0 * done / total);
+        }
+        printf("Running for         : %.1f ms\n", (backupNow() - snap -> StartTime) / 1000.0);
+        printf("Foreground cost     : %lld us snapshot pause, %lld blocks copied on write so far\n",
+               snap -> PauseTime, superobj.CopiedBlocks - snap -> CopiedBlocks);
+    }
+    else
+    {
+        printf("Backup              : idle\n");
+    }
+
+    if(backupobj.LastTime > 0)
+    {
+        printf("Last backup         : %s, %lld bytes in %.1f ms\n",
+               backupobj.bLastIncremental ? "incremental" : "full", backupobj.LastBytes, backupobj.LastTime / 1000.0);
+        printf("Last foreground cost: %lld us snapshot pause, %lld blocks copied on write\n", backupobj.LastPause, backupobj.LastCopied);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         restoreFileEntry()
+//  Description:           Creates an empty file for a backup entry unless a file with that name exists
+//  Input:                 Filename, permission
+//  Output:                New Inode pointer, NULL if the file was skipped
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PINODE restoreFileEntry(const char *name, int permission)
+{
+    PINODE temp = NULL;
+
+    // A file with the same name already exists, keep the live copy
+    if(isFileExists(name) == true)
+    {
+        return NULL;
+    }
+
+    // Take a free inode, restored files must not overwrite live ones
+    temp = allocateInode();
+    if(temp == NULL)
+    {
+        return NULL;
+    }
+
+    strncpy(temp -> FileName, name, sizeof(temp -> FileName) - 1);
+    temp -> FileName[sizeof(temp -> FileName) - 1] = '\0';
+    temp -> Permission = permission;
+    temp -> FileType = REGULARFILE;
+
+    // Make the file visible to name based lookups
+    insertNameIndex(temp);
+
+    return temp;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         restoreLegacyImage()
+//  Description:           Restores a backup written in the older format: one record per file made of
+//                         name, inode number, size and permission followed by the data
+//  Input:                 Host file descriptor positioned at the start of the backup, name of the
+//                         only file to restore (NULL for all)
+//  Output:                Number of files restored
+//  Date:                  28/01/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int restoreLegacyImage(int fd, const char *only)
+{
+    PINODE temp = NULL;
+    int iRet = 0;
+    int restored = 0;
+
+    // Temporary variables
+    char name[20] = {'\0'};
+    int inodeNum = 0;
+    long long fileSize = 0;
+    int permission = 0;
+    long long offset = 0;
+    char dataBlock[BLOCKSIZE];
+
+    // read() returns the number of bytes read. If it returns 0, it means End of File (EOF).
+    while((iRet = read(fd, name, sizeof(name))) > 0)
+    {
+        name[sizeof(name) - 1] = '\0';
+
+        // Read the rest of the metadata
+        read(fd, &inodeNum, sizeof(int));
+        read(fd, &fileSize, sizeof(long long));
+        read(fd, &permission, sizeof(int));
+
+        temp = NULL;
+        if(only == NULL || strcmp(name, only) == 0)
+        {
+            temp = restoreFileEntry(name, permission);
+        }
+        if(temp == NULL)
+        {
+            lseek(fd, fileSize, SEEK_CUR);
+            continue;
+        }
+
+        // Read the file content block by block, blocks are allocated as it is stored
+        for(offset = 0; offset < fileSize; offset = offset + iRet)
+        {
+            iRet = (fileSize - offset > BLOCKSIZE) ? BLOCKSIZE : (int)(fileSize - offset);
+            iRet = read(fd, dataBlock, iRet);
+            if(iRet <= 0)
+            {
+                break;
+            }
+            writeInodeData(temp, dataBlock, offset, iRet);
+        }
+
+        restored++;
+
+        if(only != NULL)
+        {
+            break;
+        }
+    }
+
+    return restored;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getImageEntry()
+//  Description:           Copies one entry of an image inode table into the current structure,
+//                         fields an older image does not have are left zero
+//  Input:                 Inode table, header, entry number, entry to fill
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void getImageEntry(const char *table, PIMAGEHEADER header, int index, PIMAGEINODE entry)
+{
+    memset(entry, 0, sizeof(IMAGEINODE));
+    memcpy(entry, table + (long long)index * header -> InodeSize, header -> InodeSize);
+
+    entry -> FileName[sizeof(entry -> FileName) - 1] = '\0';
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         isImageLayoutValid()
+//  Description:           Checks that the inode table and the data of an image are where the header
+//                         says and that the segments start behind them
+//  Input:                 Header
+//  Output:                true if the layout is consistent
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool isImageLayoutValid(PIMAGEHEADER header)
+{
+    return (header -> InodeCount >= 0 && header -> InodeTableOffset == header -> HeaderSize &&
+            header -> DataOffset == header -> InodeTableOffset + (long long)header -> InodeCount * header -> InodeSize &&
+            header -> ImageSize >= header -> DataOffset && header -> EndOffset >= header -> ImageSize &&
+            header -> SegmentCount >= 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         isImageTableValid()
+//  Description:           Checks the inode table against its checksum (images without checksums pass)
+//  Input:                 Header, inode table
+//  Output:                true if the table is intact
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool isImageTableValid(PIMAGEHEADER header, const char *table)
+{
+    if((header -> Flags & IMAGE_CHECKSUMS) == 0)
+    {
+        return true;
+    }
+
+    return crc32c(0, table, (long long)header -> InodeCount * header -> InodeSize) == header -> TableChecksum;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         loadEntryChecksums()
+//  Description:           Gets the block checksums of a file from the image (from memory when the
+//                         image is mapped or loaded, read otherwise) and checks them against the
+//                         checksum of the file
+//  Input:                 Host file descriptor, image in memory (NULL to read it), header, entry
+//  Output:                Checksum per block (to be freed) or NULL if they are missing or damaged
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int *loadEntryChecksums(int fd, const char *base, PIMAGEHEADER header, PIMAGEINODE entry)
+{
+    unsigned int *sums = NULL;
+    long long count = (entry -> ActualFileSize + BLOCKSIZE - 1) / BLOCKSIZE;
+    long long size = count * (long long)sizeof(unsigned int);
+
+    if(entry -> ChecksumOffset < header -> DataOffset + header -> DataSize || entry -> ChecksumOffset > header -> ImageSize - size)
+    {
+        return NULL;
+    }
+
+    sums = (unsigned int *)malloc(size + sizeof(unsigned int));
+    if(sums == NULL)
+    {
+        return NULL;
+    }
+
+    if(base != NULL)
+    {
+        memcpy(sums, base + entry -> ChecksumOffset, (size_t)size);
+    }
+    else if(pread(fd, sums, (size_t)size, entry -> ChecksumOffset) != (ssize_t)size)
+    {
+        free(sums);
+        return NULL;
+    }
+
+    if(crc32c(0, sums, size) != entry -> Checksum)
+    {
+        free(sums);
+        return NULL;
+    }
+
+    return sums;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         loadStoredLengths()
+//  Description:           Gets the stored length of every block of a file in a compressed image and
+//                         checks that they add up to the stored data of the file
+//  Input:                 Stored data of the file in memory, entry
+//  Output:                Length per block (to be freed) or NULL if the section is damaged
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int *loadStoredLengths(const char *section, PIMAGEINODE entry)
+{
+    int *lengths = NULL;
+    long long blockCount = (entry -> ActualFileSize + BLOCKSIZE - 1) / BLOCKSIZE;
+    long long data = entry -> StoredSize - blockCount * (long long)sizeof(int);
+    long long stored = 0;
+    long long size = 0;
+    long long i = 0;
+
+    if(data < 0)
+    {
+        return NULL;
+    }
+
+    lengths = (int *)malloc(sizeof(int) * (blockCount + 1));
+    if(lengths == NULL)
+    {
+        return NULL;
+    }
+
+    memcpy(lengths, section + data, sizeof(int) * (size_t)blockCount);
+
+    for(i = 0; i < blockCount; i++)
+    {
+        size = (entry -> ActualFileSize - i * BLOCKSIZE > BLOCKSIZE) ? BLOCKSIZE : entry -> ActualFileSize - i * BLOCKSIZE;
+        if(lengths[i] < 0 || lengths[i] > size)
+        {
+            break;
+        }
+        stored = stored + lengths[i];
+    }
+
+    if(i < blockCount || stored != data)
+    {
+        free(lengths);
+        return NULL;
+    }
+
+    return lengths;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         newRestoreJob()
+//  Description:           Adds an empty job to a growing job list
+//  Input:                 Job list, number of jobs, capacity
+//  Output:                The new job or NULL if memory is exhausted
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PRESTOREJOB newRestoreJob(PRESTOREJOB *jobs, long long *count, long long *capacity)
+{
+    PRESTOREJOB newJobs = NULL;
+
+    if(*count == *capacity)
+    {
+        newJobs = (PRESTOREJOB)realloc(*jobs, sizeof(RESTOREJOB) * ((*capacity == 0) ? 1024 : *capacity * 2));
+        if(newJobs == NULL)
+        {
+            return NULL;
+        }
+
+        *jobs = newJobs;
+        *capacity = (*capacity == 0) ? 1024 : *capacity * 2;
+    }
+
+    memset(&(*jobs)[*count], 0, sizeof(RESTOREJOB));
+    (*count)++;
+
+    return &(*jobs)[*count - 1];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         readRestoreRun()
+//  Description:           Reads the blocks of consecutive jobs that lie back to back in the image
+//                         with one preadv(), at most RESTORE_READBLOCKS of them. Blocks the image
+//                         does not have are marked damaged.
+//  Input:                 Jobs, first job of the run, end of the jobs of this worker
+//  Output:                Job after the run
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static long long readRestoreRun(PRESTOREJOB jobs, long long first, long long last)
+{
+    struct iovec iov[RESTORE_READBLOCKS];
+    ssize_t ret = 0;
+    long long size = 0;
+    long long end = first;
+    int count = 0;
+
+    while(end < last && count < RESTORE_READBLOCKS && jobs[end].Source == NULL && jobs[end].Block != NULL &&
+          jobs[end].StoredLength != 0 && jobs[end].Fd == jobs[first].Fd && jobs[end].Offset == jobs[first].Offset + size)
+    {
+        iov[count].iov_base = pinDataBlock(jobs[end].Block);
+        if(iov[count].iov_base == NULL)
+        {
+            break;
+        }
+
+        iov[count].iov_len = jobs[end].Size;
+        size = size + jobs[end].Size;
+        count++;
+        end++;
+    }
+
+    if(count == 0)
+    {
+        jobs[first].bDamaged = true;
+        return first + 1;
+    }
+
+    do
+    {
+        ret = preadv(jobs[first].Fd, iov, count, jobs[first].Offset);
+    } while(ret < 0 && errno == EINTR);
+
+    // A short read leaves the rest of the run out
+    for(size = 0; first < end; first++)
+    {
+        size = size + jobs[first].Size;
+        if(ret < size)
+        {
+            jobs[first].bDamaged = true;
+        }
+
+        unpinDataBlock(jobs[first].Block, true);
+    }
+
+    return end;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         restoreWorker()
+//  Description:           Decompresses, copies or reads a range of blocks into the data blocks of
+//                         the restored files and verifies their checksums (only touches the jobs, so
+//                         workers run in parallel)
+//  Input:                 Worker with its range of jobs
+//  Output:                NULL
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void *restoreWorker(void *arg)
+{
+    PRESTOREWORKER worker = (PRESTOREWORKER)arg;
+    PRESTOREJOB job = NULL;
+    char scratch[BLOCKSIZE];
+    const char *data = NULL;
+    char *out = NULL;
+    long long readEnd = 0;
+    long long i = 0;
+
+    for(i = worker -> First; i < worker -> Last; i++)
+    {
+        job = &worker -> Jobs[i];
+        data = job -> Source;
+
+        // A read run pins its blocks itself, the others are pinned while they are filled or checked
+        if(job -> StoredLength != 0 && job -> Source == NULL && job -> Fd >= 0 && i >= readEnd)
+        {
+            readEnd = readRestoreRun(worker -> Jobs, i, worker -> Last);
+        }
+
+        out = NULL;
+        if(job -> Block != NULL && job -> bDamaged == false)
+        {
+            out = pinDataBlock(job -> Block);
+            if(out == NULL)
+            {
+                job -> bDamaged = true;
+            }
+        }
+
+        // A zero block is a hole, only its checksum is left to check
+        if(job -> bDamaged == true)
+        {
+            data = NULL;
+        }
+        else if(job -> StoredLength == 0)
+        {
+            data = NULL;
+        }
+        else if(job -> Source == NULL)
+        {
+            data = out;
+        }
+        else if(job -> StoredLength < job -> Size)
+        {
+            if(decompressBlock(job -> Source, job -> StoredLength, (out != NULL) ? out : scratch, job -> Size) != job -> Size)
+            {
+                job -> bDamaged = true;
+            }
+            data = (out != NULL) ? out : scratch;
+        }
+        else if(out != NULL)
+        {
+            memcpy(out, job -> Source, job -> Size);
+        }
+
+        if(job -> bDamaged == false && job -> bCheck == true &&
+           ((data != NULL) ? crc32c(0, data, job -> Size) : crc32cZeroes(job -> Size)) != job -> Checksum)
+        {
+            job -> bDamaged = true;
+        }
+
+        // Only a block checked where it is stays unchanged
+        if(out != NULL)
+        {
+            unpinDataBlock(job -> Block, job -> Fd >= 0 || job -> Source != NULL);
+        }
+
+        if(job -> bDamaged == true)
+        {
+            worker -> bFailed = true;
+        }
+    }
+
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         runRestoreJobs()
+//  Description:           Shares the blocks to decompress out to one thread per core (at most
+//                         RESTORE_MAXTHREADS, and only as many as there is work for). Each thread
+//                         takes a contiguous range, so different files decompress at the same time.
+//  Input:                 Jobs, number of jobs
+//  Output:                true if every block decompressed
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool runRestoreJobs(PRESTOREJOB jobs, long long count)
+{
+    RESTOREWORKER workers[RESTORE_MAXTHREADS];
+    bool bStarted[RESTORE_MAXTHREADS];
+    int threads = getWorkerThreads(count, RESTORE_THREADBLOCKS, RESTORE_MAXTHREADS);
+    bool bOk = true;
+    int i = 0;
+
+    if(threads > count && count > 0)
+    {
+        threads = (int)count;
+    }
+
+    for(i = 0; i < threads; i++)
+    {
+        workers[i].Jobs = jobs;
+        workers[i].First = count * i / threads;
+        workers[i].Last = count * (i + 1) / threads;
+        workers[i].bFailed = false;
+        bStarted[i] = false;
+    }
+
+    // The calling thread takes the first range itself, a range without a thread is done inline too
+    for(i = 1; i < threads; i++)
+    {
+        bStarted[i] = (pthread_create(&workers[i].Thread, NULL, restoreWorker, &workers[i]) == 0);
+    }
+
+    restoreWorker(&workers[0]);
+
+    for(i = 1; i < threads; i++)
+    {
+        if(bStarted[i] == true)
+        {
+            pthread_join(workers[i].Thread, NULL);
+        }
+        else
+        {
+            restoreWorker(&workers[i]);
+        }
+    }
+
+    for(i = 0; i < threads; i++)
+    {
+        if(workers[i].bFailed == true)
+        {
+            bOk = false;
+        }
+    }
+
+    return bOk;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         reportDamagedJobs()
+//  Description:           Names the restored files whose blocks did not verify
+//  Input:                 Jobs (File holds the inode number), number of jobs
+//  Output:                Number of damaged blocks
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static long long reportDamagedJobs(PRESTOREJOB jobs, long long count)
+{
+    long long damaged = 0;
+    long long i = 0;
+
+    for(i = 0; i < count; i++)
+    {
+        if(jobs[i].bDamaged == true)
+        {
+            printf("CVFS: %s: block %d is damaged in the backup image.\n", getInode(jobs[i].File) -> FileName, jobs[i].BlockIndex);
+            damaged++;
+        }
+    }
+
+    return damaged;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         verifyRestoredBlocks()
+//  Description:           Checks the blocks of a file restored from an image against the checksums
+//                         the image has for them and keeps each checksum with its block
+//  Input:                 Restored Inode, image entry, checksum per block (NULL if they were damaged)
+//  Output:                EXECUTE_SUCCESS or ERR_CHECKSUM
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int verifyRestoredBlocks(PINODE temp, PIMAGEINODE entry, unsigned int *sums)
+{
+    PDATABLOCK block = NULL;
+    char *data = NULL;
+    unsigned int checksum = 0;
+    int size = 0;
+    int iRet = EXECUTE_SUCCESS;
+    int j = 0;
+
+    for(j = 0; j < getInodeBlockCount(temp) && (long long)j * BLOCKSIZE < entry -> ActualFileSize; j++)
+    {
+        size = (int)((entry -> ActualFileSize - (long long)j * BLOCKSIZE > BLOCKSIZE) ? BLOCKSIZE : entry -> ActualFileSize - (long long)j * BLOCKSIZE);
+        block = getInodeBlock(temp, j);
+        data = (block != NULL) ? pinDataBlock(block) : NULL;
+
+        checksum = crc32cZeroes(size);
+        if(data != NULL)
+        {
+            checksum = crc32c(0, data, size);
+            unpinDataBlock(block, false);
+        }
+
+        if(sums == NULL || (block != NULL && data == NULL) || checksum != sums[j])
+        {
+            printf("CVFS: %s: block %d is damaged in the backup image.\n", temp -> FileName, j);
+            iRet = ERR_CHECKSUM;
+            continue;
+        }
+
+        setInodeBlockChecksum(temp, j, sums[j], size);
+    }
+
+    return iRet;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         restoreImage()
+//  Description:           Restores the files of a versioned image by reading it: the files and their
+//                         blocks are set up first, then several threads read the blocks straight
+//                         into place (runs of them per call) and verify them
+//  Input:                 Host file descriptor, header, inodes by file id
+//  Output:                Number of files restored or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int restoreImage(int fd, PIMAGEHEADER header, PINODE *byId)
+{
+    PINODE temp = NULL;
+    PRESTOREJOB jobs = NULL;
+    PRESTOREJOB job = NULL;
+    IMAGEINODE entry;
+    struct stat info;
+    unsigned int *sums = NULL;
+    char *table = NULL;
+    PDATABLOCK dest = NULL;
+    bool bChecksums = ((header -> Flags & IMAGE_CHECKSUMS) != 0);
+    long long tableSize = 0;
+    long long jobCount = 0;
+    long long jobCapacity = 0;
+    long long position = 0;
+    int blockCount = 0;
+    int restored = 0;
+    int iRet = 0;
+    int i = 0, j = 0;
+
+    if(isImageLayoutValid(header) == false || fstat(fd, &info) != 0 || info.st_size < header -> ImageSize)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    tableSize = (long long)header -> InodeCount * header -> InodeSize;
+
+    table = (char *)malloc(tableSize + 1);
+    if(table == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    if(lseek(fd, header -> InodeTableOffset, SEEK_SET) != header -> InodeTableOffset || readAll(fd, table, tableSize) != tableSize)
+    {
+        free(table);
+        return ERR_INVALID_PARAMETER;
+    }
+
+    if(isImageTableValid(header, table) == false)
+    {
+        free(table);
+        return ERR_CHECKSUM;
+    }
+
+    // The data of the files is packed in table order right after the table
+    position = header -> DataOffset;
+
+    for(i = 0; i < header -> InodeCount && iRet == 0; i++)
+    {
+        getImageEntry(table, header, i, &entry);
+
+        if(entry.DataOffset != position || entry.ActualFileSize < 0 || entry.ActualFileSize > MAXFILESIZE ||
+           entry.ActualFileSize > header -> ImageSize - position)
+        {
+            iRet = ERR_INVALID_PARAMETER;
+            break;
+        }
+        position = position + entry.ActualFileSize;
+
+        sums = NULL;
+        if(bChecksums == true)
+        {
+            sums = loadEntryChecksums(fd, NULL, header, &entry);
+            if(sums == NULL)
+            {
+                printf("CVFS: %s: block checksums are damaged in the backup image.\n", entry.FileName);
+                iRet = ERR_CHECKSUM;
+            }
+        }
+
+        temp = restoreFileEntry(entry.FileName, entry.Permission);
+        if(temp != NULL && entry.FileId > 0 && entry.FileId < header -> NextFileId)
+        {
+            byId[entry.FileId] = temp;
+        }
+
+        // Every block is stored, its place in the image follows from its index
+        blockCount = (int)((entry.ActualFileSize + BLOCKSIZE - 1) / BLOCKSIZE);
+        for(j = 0; temp != NULL && j < blockCount; j++)
+        {
+            dest = allocInodeBlock(temp, j);
+            if(dest == NULL)
+            {
+                break;
+            }
+
+            job = newRestoreJob(&jobs, &jobCount, &jobCapacity);
+            if(job == NULL)
+            {
+                break;
+            }
+
+            job -> Block = dest;
+            job -> Size = (int)((entry.ActualFileSize - (long long)j * BLOCKSIZE > BLOCKSIZE) ? BLOCKSIZE : entry.ActualFileSize - (long long)j * BLOCKSIZE);
+            job -> StoredLength = job -> Size;
+            job -> Fd = fd;
+            job -> Offset = entry.DataOffset + (long long)j * BLOCKSIZE;
+            job -> File = temp -> InodeNumber;
+            job -> BlockIndex = j;
+
+            if(sums != NULL)
+            {
+                job -> Checksum = sums[j];
+                job -> bCheck = true;
+                setInodeBlockChecksum(temp, j, sums[j], job -> Size);
+            }
+        }
+
+        free(sums);
+
+        if(temp != NULL)
+        {
+            temp -> ActualFileSize = entry.ActualFileSize;
+            restored++;
+
+            if(j < blockCount)
+            {
+                iRet = ERR_INSUFFICIENT_SPACE;
+                break;
+            }
+        }
+    }
+
+    if(jobCount > 0 && runRestoreJobs(jobs, jobCount) == false)
+    {
+        reportDamagedJobs(jobs, jobCount);
+        iRet = ERR_CHECKSUM;
+    }
+
+    free(jobs);
+    free(table);
+
+    return (iRet < 0) ? iRet : restored;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         restoreMappedImage()
+//  Description:           Restores a backup image by mapping it: the inode table is read from the
+//                         mapping and file blocks point into it, so nothing is copied until a file
+//                         is written (copy-on-write). The mapping stays alive while any block uses it.
+//                         The mapped blocks are verified against their checksums by several threads.
+//  Input:                 Host file descriptor, header, inodes by file id
+//  Output:                Number of files restored or Error Code, the mapping is returned in ppmap
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int restoreMappedImage(int fd, PIMAGEHEADER header, PINODE *byId, PIMAGEMAP *ppmap)
+{
+    PINODE temp = NULL;
+    PIMAGEMAP map = NULL;
+    PRESTOREJOB jobs = NULL;
+    PRESTOREJOB job = NULL;
+    IMAGEINODE entry;
+    struct stat info;
+    unsigned int *sums = NULL;
+    bool bChecksums = ((header -> Flags & IMAGE_CHECKSUMS) != 0);
+    long long jobCount = 0;
+    long long jobCapacity = 0;
+    long long position = 0;
+    int restored = 0;
+    int iRet = 0;
+    int i = 0, j = 0;
+
+    // A short image would fault when a missing page is touched, check the size first
+    if(isImageLayoutValid(header) == false || fstat(fd, &info) != 0 || info.st_size < header -> EndOffset)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    map = (PIMAGEMAP)malloc(sizeof(IMAGEMAP));
+    if(map == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    // The delta segments are mapped as well, their blocks are used in place
+    map -> Length = (size_t)header -> EndOffset;
+    map -> Blocks = 0;
+    map -> Base = (char *)mmap(NULL, map -> Length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(map -> Base == MAP_FAILED)
+    {
+        free(map);
+        return ERR_HOST_IO;
+    }
+
+    *ppmap = map;
+
+    if(isImageTableValid(header, map -> Base + header -> InodeTableOffset) == false)
+    {
+        return ERR_CHECKSUM;
+    }
+
+    position = header -> DataOffset;
+
+    for(i = 0; i < header -> InodeCount; i++)
+    {
+        getImageEntry(map -> Base + header -> InodeTableOffset, header, i, &entry);
+
+        if(entry.DataOffset != position || entry.ActualFileSize < 0 || position + entry.ActualFileSize > header -> ImageSize)
+        {
+            break;
+        }
+        position = position + entry.ActualFileSize;
+
+        temp = restoreFileEntry(entry.FileName, entry.Permission);
+        if(temp == NULL)
+        {
+            continue;
+        }
+
+        if(entry.FileId > 0 && entry.FileId < header -> NextFileId)
+        {
+            byId[entry.FileId] = temp;
+        }
+
+        mapInodeData(temp, map, entry.DataOffset, entry.ActualFileSize);
+        restored++;
+
+        if(bChecksums == false)
+        {
+            continue;
+        }
+
+        sums = loadEntryChecksums(fd, map -> Base, header, &entry);
+        if(sums == NULL)
+        {
+            printf("CVFS: %s: block checksums are damaged in the backup image.\n", temp -> FileName);
+            iRet = ERR_CHECKSUM;
+            continue;
+        }
+
+        // Every mapped block is read once by a verifying thread
+        for(j = 0; (long long)j * BLOCKSIZE < temp -> ActualFileSize; j++)
+        {
+            job = newRestoreJob(&jobs, &jobCount, &jobCapacity);
+            if(job == NULL)
+            {
+                iRet = ERR_INSUFFICIENT_SPACE;
+                break;
+            }
+
+            job -> Source = map -> Base + entry.DataOffset + (long long)j * BLOCKSIZE;
+            job -> Size = (int)((temp -> ActualFileSize - (long long)j * BLOCKSIZE > BLOCKSIZE) ? BLOCKSIZE : temp -> ActualFileSize - (long long)j * BLOCKSIZE);
+            job -> StoredLength = job -> Size;
+            job -> Checksum = sums[j];
+            job -> bCheck = true;
+            job -> File = temp -> InodeNumber;
+            job -> BlockIndex = j;
+
+            setInodeBlockChecksum(temp, j, sums[j], job -> Size);
+        }
+        free(sums);
+    }
+
+    if(jobCount > 0 && runRestoreJobs(jobs, jobCount) == false && reportDamagedJobs(jobs, jobCount) > 0)
+    {
+        iRet = ERR_CHECKSUM;
+    }
+    free(jobs);
+
+    return (iRet < 0) ? iRet : restored;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         restoreCompressedImage()
+//  Description:           Restores an image with compressed file data. The image is mapped (or read
+//                         in one go), the files and their data blocks are created here and the
+//                         blocks are then decompressed and verified in parallel straight into them.
+//                         Zero blocks come back as holes.
+//  Input:                 Host file descriptor, header, inodes by file id
+//  Output:                Number of files restored or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int restoreCompressedImage(int fd, PIMAGEHEADER header, PINODE *byId)
+{
+    PINODE temp = NULL;
+    PRESTOREJOB jobs = NULL;
+    PRESTOREJOB job = NULL;
+    IMAGEINODE entry;
+    struct stat info;
+    unsigned int *sums = NULL;
+    int *lengths = NULL;
+    char *base = NULL;
+    PDATABLOCK dest = NULL;
+    bool bChecksums = ((header -> Flags & IMAGE_CHECKSUMS) != 0);
+    bool bMapped = false;
+    long long jobCount = 0;
+    long long jobCapacity = 0;
+    long long position = 0;
+    long long source = 0;
+    int blockCount = 0;
+    int restored = 0;
+    int iRet = 0;
+    int i = 0, j = 0;
+
+    if(isImageLayoutValid(header) == false || fstat(fd, &info) != 0 || info.st_size < header -> ImageSize)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // The stored blocks are used where they are, mapped or read into memory
+    if(bMappedRestore == true)
+    {
+        base = (char *)mmap(NULL, (size_t)header -> ImageSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        bMapped = (base != MAP_FAILED);
+    }
+    if(bMapped == false)
+    {
+        base = (char *)malloc(header -> ImageSize + 1);
+        if(base == NULL)
+        {
+            return ERR_INSUFFICIENT_SPACE;
+        }
+        if(lseek(fd, 0, SEEK_SET) != 0 || readAll(fd, base, header -> ImageSize) != header -> ImageSize)
+        {
+            free(base);
+            return ERR_INVALID_PARAMETER;
+        }
+    }
+
+    if(isImageTableValid(header, base + header -> InodeTableOffset) == false)
+    {
+        iRet = ERR_CHECKSUM;
+    }
+
+    position = header -> DataOffset;
+
+    for(i = 0; i < header -> InodeCount && iRet == 0; i++)
+    {
+        getImageEntry(base + header -> InodeTableOffset, header, i, &entry);
+
+        blockCount = (int)((entry.ActualFileSize + BLOCKSIZE - 1) / BLOCKSIZE);
+        if(entry.DataOffset != position || entry.ActualFileSize < 0 || entry.ActualFileSize > MAXFILESIZE ||
+           entry.StoredSize < (long long)blockCount * (long long)sizeof(int) || entry.StoredSize > header -> ImageSize - position)
+        {
+            iRet = ERR_INVALID_PARAMETER;
+            break;
+        }
+        position = position + entry.StoredSize;
+
+        // The block lengths follow the blocks and must add up to them
+        lengths = loadStoredLengths(base + entry.DataOffset, &entry);
+        if(lengths == NULL)
+        {
+            iRet = ERR_INVALID_PARAMETER;
+            break;
+        }
+
+        sums = NULL;
+        if(bChecksums == true)
+        {
+            sums = loadEntryChecksums(fd, base, header, &entry);
+            if(sums == NULL)
+            {
+                printf("CVFS: %s: block checksums are damaged in the backup image.\n", entry.FileName);
+                iRet = ERR_CHECKSUM;
+            }
+        }
+
+        temp = restoreFileEntry(entry.FileName, entry.Permission);
+        if(temp != NULL && entry.FileId > 0 && entry.FileId < header -> NextFileId)
+        {
+            byId[entry.FileId] = temp;
+        }
+
+        for(j = 0, source = entry.DataOffset; temp != NULL && j < blockCount; j++)
+        {
+            // Holes only have their checksum checked
+            if(lengths[j] == 0 && sums == NULL)
+            {
+                continue;
+            }
+
+            dest = NULL;
+            if(lengths[j] != 0)
+            {
+                dest = allocInodeBlock(temp, j);
+                if(dest == NULL)
+                {
+                    break;
+                }
+            }
+
+            job = newRestoreJob(&jobs, &jobCount, &jobCapacity);
+            if(job == NULL)
+            {
+                break;
+            }
+
+            job -> Block = dest;
+            job -> Size = (int)((entry.ActualFileSize - (long long)j * BLOCKSIZE > BLOCKSIZE) ? BLOCKSIZE : entry.ActualFileSize - (long long)j * BLOCKSIZE);
+            job -> Source = base + source;
+            job -> StoredLength = lengths[j];
+            job -> File = temp -> InodeNumber;
+            job -> BlockIndex = j;
+
+            if(sums != NULL)
+            {
+                job -> Checksum = sums[j];
+                job -> bCheck = true;
+                setInodeBlockChecksum(temp, j, sums[j], job -> Size);
+            }
+
+            source = source + lengths[j];
+        }
+
+        free(lengths);
+        free(sums);
+
+        if(temp != NULL)
+        {
+            temp -> ActualFileSize = entry.ActualFileSize;
+            restored++;
+
+            if(j < blockCount)
+            {
+                iRet = ERR_INSUFFICIENT_SPACE;
+                break;
+            }
+        }
+    }
+
+    if(jobCount > 0 && runRestoreJobs(jobs, jobCount) == false)
+    {
+        reportDamagedJobs(jobs, jobCount);
+        iRet = ERR_CHECKSUM;
+    }
+
+    free(jobs);
+
+    if(bMapped == true)
+    {
+        munmap(base, (size_t)header -> ImageSize);
+    }
+    else
+    {
+        free(base);
+    }
+
+    return (iRet < 0) ? iRet : restored;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         isSegmentValid()
+//  Description:           Checks that the deletes and records a segment header announces fit into it
+//  Input:                 Segment header, size of the segment
+//  Output:                true if the segment can be read
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool isSegmentValid(PIMAGESEGMENT segment, long long size)
+{
+    return (memcmp(segment -> Magic, SEGMENT_MAGIC, sizeof(segment -> Magic)) == 0 && segment -> Size == size &&
+            segment -> DeleteCount >= 0 && segment -> RecordCount >= 0 &&
+            (long long)sizeof(IMAGESEGMENT) + segment -> DeleteCount * (long long)sizeof(long long) +
+            segment -> RecordCount * (long long)sizeof(IMAGEDELTA) <= size);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         isDeltaRecordValid()
+//  Description:           Checks the file id, size and block list of a delta record
+//  Input:                 Record, size of its segment, number of file ids
+//  Output:                true if the record can be applied
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool isDeltaRecordValid(PIMAGEDELTA record, long long size, long long idCount)
+{
+    return (record -> FileId > 0 && record -> FileId < idCount && record -> BlockCount >= 0 &&
+            record -> ActualFileSize >= 0 && record -> ActualFileSize <= MAXFILESIZE && record -> DataOffset >= 0 &&
+            record -> DataOffset + record -> BlockCount * (long long)sizeof(int) <= size);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         applyDeltaRecord()
+//  Description:           Applies the blocks of one delta record to a restored file, a new or
+//                         truncated file is stored from scratch
+//  Input:                 Segment data, segment size, record, mapping (NULL when read), Inode
+//  Output:                EXECUTE_SUCCESS or ERR_INVALID_PARAMETER
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int applyDeltaRecord(const char *data, long long size, PIMAGEDELTA record, PIMAGEMAP map, PINODE temp)
+{
+    long long position = 0;
+    int blockIndex = 0;
+    int length = 0;
+    int j = 0;
+
+    if((record -> Flags & DELTA_FULL) != 0)
+    {
+        freeInodeBlocks(temp);
+        temp -> ActualFileSize = 0;
+    }
+
+    position = record -> DataOffset + (long long)record -> BlockCount * sizeof(int);
+
+    for(j = 0; j < record -> BlockCount; j++)
+    {
+        memcpy(&blockIndex, data + record -> DataOffset + (long long)j * sizeof(int), sizeof(int));
+
+        length = 0;
+        if(blockIndex >= 0 && (long long)blockIndex * BLOCKSIZE < record -> ActualFileSize)
+        {
+            length = getDeltaBlockSize(record -> ActualFileSize, blockIndex);
+        }
+        if(length <= 0 || position + length > size)
+        {
+            return ERR_INVALID_PARAMETER;
+        }
+
+        if(map != NULL)
+        {
+            mapInodeBlock(temp, map, blockIndex, data + position);
+        }
+        else
+        {
+            writeInodeData(temp, data + position, (long long)blockIndex * BLOCKSIZE, length);
+        }
+        setInodeBlockChecksum(temp, blockIndex, crc32c(0, data + position, length), length);
+
+        position = position + length;
+    }
+
+    temp -> ActualFileSize = record -> ActualFileSize;
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         replaySegment()
+//  Description:           Applies one delta segment to the restored files: deletes first, then the
+//                         names and permissions of the changed files, then their blocks. Blocks are
+//                         used in place when the image is mapped and copied otherwise.
+//  Input:                 Segment data, segment size, mapping (NULL when read), inodes by file id,
+//                         number of file ids
+//  Output:                Number of records that could not be applied or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int replaySegment(const char *data, long long size, PIMAGEMAP map, PINODE *byId, long long idCount)
+{
+    PINODE temp = NULL;
+    IMAGESEGMENT segment;
+    IMAGEDELTA record;
+    const char *records = NULL;
+    long long fileId = 0;
+    int skipped = 0;
+    int i = 0;
+
+    memcpy(&segment, data, sizeof(segment));
+
+    if(isSegmentValid(&segment, size) == false)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // 1. Deleted files, ids of files the image never had are ignored
+    for(i = 0; i < segment.DeleteCount; i++)
+    {
+        memcpy(&fileId, data + sizeof(IMAGESEGMENT) + (long long)i * sizeof(long long), sizeof(long long));
+
+        if(fileId > 0 && fileId < idCount && byId[fileId] != NULL)
+        {
+            unlinkFile(byId[fileId] -> FileName);
+            byId[fileId] = NULL;
+        }
+    }
+
+    records = data + sizeof(IMAGESEGMENT) + (long long)segment.DeleteCount * sizeof(long long);
+
+    // 2. Take the changed files out of the name index first, so renames between them can not clash
+    for(i = 0; i < segment.RecordCount; i++)
+    {
+        memcpy(&record, records + (long long)i * sizeof(IMAGEDELTA), sizeof(record));
+
+        if(record.FileId > 0 && record.FileId < idCount && byId[record.FileId] != NULL)
+        {
+            removeNameIndex(byId[record.FileId] -> FileName);
+        }
+    }
+
+    // 3. Names, permissions and blocks
+    for(i = 0; i < segment.RecordCount; i++)
+    {
+        memcpy(&record, records + (long long)i * sizeof(IMAGEDELTA), sizeof(record));
+        record.FileName[sizeof(record.FileName) - 1] = '\0';
+
+        if(isDeltaRecordValid(&record, size, idCount) == false)
+        {
+            return ERR_INVALID_PARAMETER;
+        }
+
+        temp = byId[record.FileId];
+        if(temp == NULL)
+        {
+            temp = restoreFileEntry(record.FileName, record.Permission);
+            if(temp == NULL)
+            {
+                skipped++;
+                continue;
+            }
+            byId[record.FileId] = temp;
+        }
+        else
+        {
+            strncpy(temp -> FileName, record.FileName, sizeof(temp -> FileName) - 1);
+            temp -> FileName[sizeof(temp -> FileName) - 1] = '\0';
+            temp -> Permission = record.Permission;
+
+            // A live file took the name, keep the live copy
+            if(insertNameIndex(temp) != EXECUTE_SUCCESS)
+            {
+                releaseInode(temp);
+                byId[record.FileId] = NULL;
+                skipped++;
+                continue;
+            }
+        }
+
+        if(applyDeltaRecord(data, size, &record, map, temp) != EXECUTE_SUCCESS)
+        {
+            return ERR_INVALID_PARAMETER;
+        }
+    }
+
+    return skipped;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         replaySegments()
+//  Description:           Applies the delta segments behind the base image in order
+//  Input:                 Host file descriptor, header, mapping (NULL to read the segments), inodes
+//                         by file id
+//  Output:                Number of records that could not be applied or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int replaySegments(int fd, PIMAGEHEADER header, PIMAGEMAP map, PINODE *byId)
+{
+    IMAGESEGMENT segment;
+    char *buffer = NULL;
+    const char *data = NULL;
+    unsigned int checksum = 0;
+    long long trailer = ((header -> Flags & IMAGE_CHECKSUMS) != 0) ? sizeof(unsigned int) : 0;
+    long long position = header -> ImageSize;
+    int skipped = 0;
+    int iRet = 0;
+    int i = 0;
+
+    for(i = 0; i < header -> SegmentCount; i++)
+    {
+        if(position + (long long)sizeof(IMAGESEGMENT) > header -> EndOffset)
+        {
+            return ERR_INVALID_PARAMETER;
+        }
+
+        if(map != NULL)
+        {
+            memcpy(&segment, map -> Base + position, sizeof(segment));
+        }
+        else if(pread(fd, &segment, sizeof(segment), position) != sizeof(segment))
+        {
+            return ERR_INVALID_PARAMETER;
+        }
+
+        if(segment.Size < (long long)sizeof(IMAGESEGMENT) + trailer || segment.Size > header -> EndOffset - position)
+        {
+            return ERR_INVALID_PARAMETER;
+        }
+
+        buffer = NULL;
+        if(map != NULL)
+        {
+            data = map -> Base + position;
+        }
+        else
+        {
+            buffer = (char *)malloc(segment.Size);
+            if(buffer == NULL)
+            {
+                return ERR_INSUFFICIENT_SPACE;
+            }
+
+            if(lseek(fd, position, SEEK_SET) != position || readAll(fd, buffer, segment.Size) != segment.Size)
+            {
+                free(buffer);
+                return ERR_INVALID_PARAMETER;
+            }
+            data = buffer;
+        }
+
+        // Nothing of a segment is applied unless all of it is intact
+        if(trailer != 0)
+        {
+            memcpy(&checksum, data + segment.Size - trailer, sizeof(checksum));
+        }
+        if(trailer != 0 && crc32c(0, data, segment.Size - trailer) != checksum)
+        {
+            printf("CVFS: Delta segment %d is damaged in the backup image.\n", i + 1);
+            iRet = ERR_CHECKSUM;
+        }
+        else
+        {
+            iRet = replaySegment(data, segment.Size, map, byId, header -> NextFileId);
+        }
+
+        free(buffer);
+
+        if(iRet < 0)
+        {
+            return iRet;
+        }
+
+        skipped = skipped + iRet;
+        position = position + segment.Size;
+    }
+
+    return skipped;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         adoptImage()
+//  Description:           Makes the restored files the backed up state of the image, so the next
+//                         backup appends a delta to it instead of writing a full image
+//  Input:                 Header, inodes by file id
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void adoptImage(PIMAGEHEADER header, PINODE *byId)
+{
+    long long i = 0;
+
+    for(i = 1; i < header -> NextFileId; i++)
+    {
+        if(byId[i] != NULL)
+        {
+            byId[i] -> FileId = i;
+        }
+    }
+
+    if(superobj.NextFileId < header -> NextFileId)
+    {
+        superobj.NextFileId = header -> NextFileId;
+    }
+
+    backupobj.ImageId = header -> ImageId;
+    backupobj.ImageGeneration = header -> Generation;
+    backupobj.SnapshotGeneration = header -> SnapshotGeneration;
+
+    // Generations go on from the image, so changes made from now on are newer than it
+    if(superobj.Generation < header -> SnapshotGeneration)
+    {
+        superobj.Generation = header -> SnapshotGeneration;
+    }
+
+    backupobj.BackupGeneration = superobj.Generation;
+    superobj.Generation++;
+
+    backupobj.DeletedCount = 0;
+    backupobj.bForceFull = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         checkImageHeader()
+//  Description:           Checks the header of a versioned image and completes the header of an
+//                         older image (fields it does not have are zero, version 1 has no segments)
+//  Input:                 Header as read from the file
+//  Output:                EXECUTE_SUCCESS or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int checkImageHeader(PIMAGEHEADER header)
+{
+    // Older images have a shorter header and inode entries and no segments
+    if(header -> HeaderSize < IMAGE_V1_HEADERSIZE || header -> HeaderSize > (int)sizeof(IMAGEHEADER) ||
+       header -> InodeSize < IMAGE_V1_INODESIZE || header -> InodeSize > (int)sizeof(IMAGEINODE))
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    memset((char *)header + header -> HeaderSize, 0, sizeof(IMAGEHEADER) - header -> HeaderSize);
+
+    if(header -> Version == 1)
+    {
+        header -> EndOffset = header -> ImageSize;
+        header -> SegmentCount = 0;
+        header -> NextFileId = 0;
+    }
+
+    if(header -> NextFileId < 0 || (header -> Flags & ~(IMAGE_COMPRESSED | IMAGE_CHECKSUMS | IMAGE_INDEXED)) != 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    if((header -> Flags & IMAGE_CHECKSUMS) != 0 && getHeaderChecksum(header) != header -> HeaderChecksum)
+    {
+        return ERR_CHECKSUM;
+    }
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         restoreVersionedImage()
+//  Description:           Restores an image (version 1 or 2) and replays its delta segments. An image
+//                         restored into an empty filesystem is adopted for incremental backups.
+//  Input:                 Host file descriptor, header as read from the file
+//  Output:                Number of files restored or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int restoreVersionedImage(int fd, PIMAGEHEADER header)
+{
+    PINODE *byId = NULL;
+    PIMAGEMAP map = NULL;
+    int liveFiles = superobj.TotalInodes - superobj.FreeInodes;
+    int restored = 0;
+    int iRet = 0;
+
+    iRet = checkImageHeader(header);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        return iRet;
+    }
+
+    byId = (PINODE *)calloc(header -> NextFileId + 1, sizeof(PINODE));
+    if(byId == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    // Reading the image is the fallback when it can not be mapped, compressed data is always decompressed
+    iRet = ERR_HOST_IO;
+    if((header -> Flags & IMAGE_COMPRESSED) != 0)
+    {
+        iRet = restoreCompressedImage(fd, header, byId);
+    }
+    else if(bMappedRestore == true)
+    {
+        iRet = restoreMappedImage(fd, header, byId, &map);
+    }
+    if(iRet == ERR_HOST_IO && (header -> Flags & IMAGE_COMPRESSED) == 0)
+    {
+        iRet = restoreImage(fd, header, byId);
+    }
+
+    // Deletes in a segment may drop the last block of the mapping, keep it until the replay is done
+    if(map != NULL)
+    {
+        map -> Blocks++;
+    }
+
+    if(iRet >= 0)
+    {
+        restored = iRet;
+        iRet = replaySegments(fd, header, map, byId);
+    }
+
+    // Only an image that is completely in memory and nothing else can be extended by deltas
+    if(iRet == 0 && liveFiles == 0 && restored == header -> InodeCount && header -> Version == IMAGE_VERSION)
+    {
+        adoptImage(header, byId);
+    }
+
+    // Nothing references the image (empty files only, or every name existed already)
+    if(map != NULL && --map -> Blocks == 0)
+    {
+        munmap(map -> Base, map -> Length);
+        free(map);
+    }
+
+    free(byId);
+
+    if(iRet < 0)
+    {
+        return iRet;
+    }
+
+    return superobj.TotalInodes - superobj.FreeInodes - liveFiles;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         readImageEntry()
+//  Description:           Reads one entry of the inode table of an image
+//  Input:                 Host file descriptor, header, entry number, entry to fill
+//  Output:                EXECUTE_SUCCESS or ERR_INVALID_PARAMETER
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int readImageEntry(int fd, PIMAGEHEADER header, int index, PIMAGEINODE entry)
+{
+    char buffer[sizeof(IMAGEINODE)];
+
+    if(index < 0 || index >= header -> InodeCount ||
+       pread(fd, buffer, header -> InodeSize, header -> InodeTableOffset + (long long)index * header -> InodeSize) != header -> InodeSize)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    getImageEntry(buffer, header, 0, entry);
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         findImageEntry()
+//  Description:           Finds the entry of one file in an image. A name is looked up in the name
+//                         index of the image, which takes a few small reads; images without an index,
+//                         names the index does not have and lookups by file id search the inode table.
+//  Input:                 Host file descriptor, header, filename (NULL to look up by id), file id,
+//                         entry to fill
+//  Output:                EXECUTE_SUCCESS, ERR_FILE_NOT_EXISTS or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int findImageEntry(int fd, PIMAGEHEADER header, const char *name, long long fileId, PIMAGEINODE entry)
+{
+    IMAGEINDEXSLOT slot;
+    char *table = NULL;
+    unsigned int hash = 0;
+    long long tableSize = 0;
+    int slots = header -> IndexSlots;
+    int iRet = ERR_FILE_NOT_EXISTS;
+    int i = 0, pos = 0;
+
+    if(name != NULL && (header -> Flags & IMAGE_INDEXED) != 0)
+    {
+        if(slots <= 0 || (slots & (slots - 1)) != 0 || header -> IndexOffset < header -> DataOffset + header -> DataSize ||
+           header -> IndexOffset > header -> ImageSize - slots * (long long)sizeof(IMAGEINDEXSLOT))
+        {
+            return ERR_INVALID_PARAMETER;
+        }
+
+        // An empty slot ends the probe, the entry a matching hash points to must have the name
+        hash = hashFileName(name);
+        for(i = 0, pos = hash & (slots - 1); i < slots; i++, pos = (pos + 1) & (slots - 1))
+        {
+            if(pread(fd, &slot, sizeof(slot), header -> IndexOffset + (long long)pos * sizeof(IMAGEINDEXSLOT)) != sizeof(slot))
+            {
+                return ERR_INVALID_PARAMETER;
+            }
+
+            if(slot.Entry == 0)
+            {
+                break;
+            }
+
+            if(slot.Hash == hash)
+            {
+                if(readImageEntry(fd, header, slot.Entry - 1, entry) != EXECUTE_SUCCESS)
+                {
+                    return ERR_INVALID_PARAMETER;
+                }
+                if(strcmp(entry -> FileName, name) == 0)
+                {
+                    return EXECUTE_SUCCESS;
+                }
+            }
+        }
+
+        // A miss is confirmed in the inode table below, so a damaged index only costs time
+    }
+
+    tableSize = (long long)header -> InodeCount * header -> InodeSize;
+
+    table = (char *)malloc(tableSize + 1);
+    if(table == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    if(lseek(fd, header -> InodeTableOffset, SEEK_SET) != header -> InodeTableOffset || readAll(fd, table, tableSize) != tableSize)
+    {
+        free(table);
+        return ERR_INVALID_PARAMETER;
+    }
+
+    if(isImageTableValid(header, table) == false)
+    {
+        free(table);
+        return ERR_CHECKSUM;
+    }
+
+    for(i = 0; i < header -> InodeCount; i++)
+    {
+        getImageEntry(table, header, i, entry);
+
+        if((name != NULL) ? strcmp(entry -> FileName, name) == 0 : entry -> FileId == fileId)
+        {
+            iRet = EXECUTE_SUCCESS;
+            break;
+        }
+    }
+
+    free(table);
+
+    return iRet;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         restoreEntryData()
+//  Description:           Reads the data of one image entry into a restored file and verifies it.
+//                         Only the stored data of that file and its block checksums are read.
+//  Input:                 Host file descriptor, header, entry, restored Inode
+//  Output:                EXECUTE_SUCCESS or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int restoreEntryData(int fd, PIMAGEHEADER header, PIMAGEINODE entry, PINODE temp)
+{
+    PRESTOREJOB jobs = NULL;
+    PRESTOREJOB job = NULL;
+    unsigned int *sums = NULL;
+    int *lengths = NULL;
+    char *buffer = NULL;
+    PDATABLOCK dest = NULL;
+    bool bCompressed = ((header -> Flags & IMAGE_COMPRESSED) != 0);
+    long long stored = (bCompressed == true) ? entry -> StoredSize : entry -> ActualFileSize;
+    long long jobCount = 0;
+    long long jobCapacity = 0;
+    long long offset = 0;
+    long long chunk = 0;
+    long long source = 0;
+    int blockCount = (int)((entry -> ActualFileSize + BLOCKSIZE - 1) / BLOCKSIZE);
+    int iRet = EXECUTE_SUCCESS;
+    int j = 0;
+
+    if(entry -> ActualFileSize < 0 || entry -> ActualFileSize > MAXFILESIZE || stored < 0 ||
+       entry -> DataOffset < header -> DataOffset || stored > header -> DataOffset + header -> DataSize - entry -> DataOffset)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    if((header -> Flags & IMAGE_CHECKSUMS) != 0)
+    {
+        sums = loadEntryChecksums(fd, NULL, header, entry);
+        if(sums == NULL)
+        {
+            printf("CVFS: %s: block checksums are damaged in the backup image.\n", entry -> FileName);
+            return ERR_CHECKSUM;
+        }
+    }
+
+    // Raw data is copied in large chunks and checked once it is in the blocks
+    if(bCompressed == false)
+    {
+        buffer = (char *)malloc((stored < BACKUPBUFFERSIZE) ? stored + 1 : BACKUPBUFFERSIZE);
+        if(buffer == NULL)
+        {
+            free(sums);
+            return ERR_INSUFFICIENT_SPACE;
+        }
+
+        for(offset = 0; offset < stored; offset = offset + chunk)
+        {
+            chunk = (stored - offset < BACKUPBUFFERSIZE) ? stored - offset : BACKUPBUFFERSIZE;
+            if(pread(fd, buffer, (size_t)chunk, entry -> DataOffset + offset) != (ssize_t)chunk)
+            {
+                iRet = ERR_INVALID_PARAMETER;
+                break;
+            }
+            writeInodeData(temp, buffer, offset, (int)chunk);
+        }
+
+        if(iRet == EXECUTE_SUCCESS && sums != NULL)
+        {
+            iRet = verifyRestoredBlocks(temp, entry, sums);
+        }
+
+        free(buffer);
+        free(sums);
+        return iRet;
+    }
+
+    // Compressed data is read as one section and its blocks go to the restore workers
+    buffer = (char *)malloc(stored + 1);
+    if(buffer == NULL)
+    {
+        free(sums);
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    if(lseek(fd, entry -> DataOffset, SEEK_SET) != entry -> DataOffset || readAll(fd, buffer, stored) != stored ||
+       (lengths = loadStoredLengths(buffer, entry)) == NULL)
+    {
+        free(buffer);
+        free(sums);
+        return ERR_INVALID_PARAMETER;
+    }
+
+    for(j = 0, source = 0; j < blockCount; j++)
+    {
+        // Holes only have their checksum checked
+        if(lengths[j] == 0 && sums == NULL)
+        {
+            continue;
+        }
+
+        dest = NULL;
+        if(lengths[j] != 0)
+        {
+            dest = allocInodeBlock(temp, j);
+            if(dest == NULL)
+            {
+                iRet = ERR_INSUFFICIENT_SPACE;
+                break;
+            }
+        }
+
+        job = newRestoreJob(&jobs, &jobCount, &jobCapacity);
+        if(job == NULL)
+        {
+            iRet = ERR_INSUFFICIENT_SPACE;
+            break;
+        }
+
+        job -> Block = dest;
+        job -> Size = (int)((entry -> ActualFileSize - (long long)j * BLOCKSIZE > BLOCKSIZE) ? BLOCKSIZE : entry -> ActualFileSize - (long long)j * BLOCKSIZE);
+        job -> Source = buffer + source;
+        job -> StoredLength = lengths[j];
+        job -> File = temp -> InodeNumber;
+        job -> BlockIndex = j;
+
+        if(sums != NULL)
+        {
+            job -> Checksum = sums[j];
+            job -> bCheck = true;
+            setInodeBlockChecksum(temp, j, sums[j], job -> Size);
+        }
+
+        source = source + lengths[j];
+    }
+
+    temp -> ActualFileSize = entry -> ActualFileSize;
+
+    if(jobCount > 0 && runRestoreJobs(jobs, jobCount) == false)
+    {
+        reportDamagedJobs(jobs, jobCount);
+        if(iRet == EXECUTE_SUCCESS)
+        {
+            iRet = ERR_CHECKSUM;
+        }
+    }
+
+    free(jobs);
+    free(lengths);
+    free(buffer);
+    free(sums);
+
+    return iRet;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         loadSegments()
+//  Description:           Reads the delta segments of an image into memory and checks their trailers
+//  Input:                 Host file descriptor, header, array to fill with one buffer per segment
+//  Output:                EXECUTE_SUCCESS or Error Code, the buffers are to be freed either way
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int loadSegments(int fd, PIMAGEHEADER header, char **segments)
+{
+    IMAGESEGMENT segment;
+    unsigned int checksum = 0;
+    long long trailer = ((header -> Flags & IMAGE_CHECKSUMS) != 0) ? sizeof(unsigned int) : 0;
+    long long position = header -> ImageSize;
+    int i = 0;
+
+    for(i = 0; i < header -> SegmentCount; i++)
+    {
+        if(position + (long long)sizeof(IMAGESEGMENT) > header -> EndOffset ||
+           pread(fd, &segment, sizeof(segment), position) != sizeof(segment) ||
+           segment.Size < (long long)sizeof(IMAGESEGMENT) + trailer || segment.Size > header -> EndOffset - position)
+        {
+            return ERR_INVALID_PARAMETER;
+        }
+
+        segments[i] = (char *)malloc(segment.Size);
+        if(segments[i] == NULL)
+        {
+            return ERR_INSUFFICIENT_SPACE;
+        }
+
+        if(lseek(fd, position, SEEK_SET) != position || readAll(fd, segments[i], segment.Size) != segment.Size ||
+           isSegmentValid(&segment, segment.Size) == false)
+        {
+            return ERR_INVALID_PARAMETER;
+        }
+
+        if(trailer != 0)
+        {
+            memcpy(&checksum, segments[i] + segment.Size - trailer, sizeof(checksum));
+            if(crc32c(0, segments[i], segment.Size - trailer) != checksum)
+            {
+                printf("CVFS: Delta segment %d is damaged in the backup image.\n", i + 1);
+                return ERR_CHECKSUM;
+            }
+        }
+
+        position = position + segment.Size;
+    }
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         restoreIndexedFile()
+//  Description:           Restores one file of a versioned image: its entry is found through the name
+//                         index, the segments tell which file id carries the name in the end (renames
+//                         and deletes) and only the data of that file and its delta records is read
+//  Input:                 Host file descriptor, header as read from the file, filename
+//  Output:                EXECUTE_SUCCESS or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int restoreIndexedFile(int fd, PIMAGEHEADER header, const char *name)
+{
+    PINODE temp = NULL;
+    IMAGEINODE entry;
+    IMAGESEGMENT segment;
+    IMAGEDELTA record;
+    char **segments = NULL;
+    const char *records = NULL;
+    PIMAGEDELTA matches = NULL;
+    int *matchSegments = NULL;
+    bool bFound = false;
+    bool bInBase = false;
+    long long fileId = 0;
+    long long deleted = 0;
+    int permission = 0;
+    int matchCount = 0;
+    int first = 0;
+    int iRet = 0;
+    int i = 0, j = 0;
+
+    iRet = checkImageHeader(header);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        return iRet;
+    }
+
+    if(isImageLayoutValid(header) == false)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    iRet = findImageEntry(fd, header, name, 0, &entry);
+    if(iRet != EXECUTE_SUCCESS && iRet != ERR_FILE_NOT_EXISTS)
+    {
+        return iRet;
+    }
+    bFound = bInBase = (iRet == EXECUTE_SUCCESS);
+    fileId = entry.FileId;
+    permission = entry.Permission;
+
+    // Each segment holds at most one record per file
+    segments = (char **)calloc(header -> SegmentCount + 1, sizeof(char *));
+    matches = (PIMAGEDELTA)malloc(sizeof(IMAGEDELTA) * (header -> SegmentCount + 1));
+    matchSegments = (int *)malloc(sizeof(int) * (header -> SegmentCount + 1));
+    if(segments == NULL || matches == NULL || matchSegments == NULL)
+    {
+        iRet = ERR_INSUFFICIENT_SPACE;
+    }
+    else
+    {
+        iRet = loadSegments(fd, header, segments);
+    }
+
+    // 1. Follow the name through the segments in the order they are replayed
+    for(i = 0; i < header -> SegmentCount && iRet == EXECUTE_SUCCESS; i++)
+    {
+        memcpy(&segment, segments[i], sizeof(segment));
+
+        for(j = 0; j < segment.DeleteCount; j++)
+        {
+            memcpy(&deleted, segments[i] + sizeof(IMAGESEGMENT) + (long long)j * sizeof(long long), sizeof(long long));
+            if(bFound == true && deleted == fileId)
+            {
+                bFound = false;
+            }
+        }
+
+        records = segments[i] + sizeof(IMAGESEGMENT) + (long long)segment.DeleteCount * sizeof(long long);
+
+        for(j = 0; j < segment.RecordCount; j++)
+        {
+            memcpy(&record, records + (long long)j * sizeof(IMAGEDELTA), sizeof(record));
+            record.FileName[sizeof(record.FileName) - 1] = '\0';
+
+            if(isDeltaRecordValid(&record, segment.Size, header -> NextFileId) == false)
+            {
+                iRet = ERR_INVALID_PARAMETER;
+                break;
+            }
+
+            if(strcmp(record.FileName, name) == 0)
+            {
+                bFound = true;
+                fileId = record.FileId;
+            }
+            else if(bFound == true && record.FileId == fileId)
+            {
+                bFound = false;
+            }
+        }
+    }
+
+    // 2. The records of that file, the last full one makes the earlier data irrelevant
+    for(i = 0; i < header -> SegmentCount && iRet == EXECUTE_SUCCESS && bFound == true; i++)
+    {
+        memcpy(&segment, segments[i], sizeof(segment));
+        records = segments[i] + sizeof(IMAGESEGMENT) + (long long)segment.DeleteCount * sizeof(long long);
+
+        for(j = 0; j < segment.RecordCount; j++)
+        {
+            memcpy(&record, records + (long long)j * sizeof(IMAGEDELTA), sizeof(record));
+            if(record.FileId != fileId)
+            {
+                continue;
+            }
+
+            if((record.Flags & DELTA_FULL) != 0)
+            {
+                first = matchCount;
+            }
+            permission = record.Permission;
+            matches[matchCount] = record;
+            matchSegments[matchCount] = i;
+            matchCount++;
+            break;
+        }
+    }
+
+    if(iRet == EXECUTE_SUCCESS && bFound == false)
+    {
+        iRet = ERR_FILE_NOT_EXISTS;
+    }
+
+    // A renamed file has its data in the base image under its old name
+    if(iRet == EXECUTE_SUCCESS && (matchCount == 0 || (matches[first].Flags & DELTA_FULL) == 0) &&
+       (bInBase == false || entry.FileId != fileId))
+    {
+        iRet = findImageEntry(fd, header, NULL, fileId, &entry);
+        if(iRet == ERR_FILE_NOT_EXISTS)
+        {
+            iRet = ERR_INVALID_PARAMETER;
+        }
+    }
+
+    // 3. The file itself: its base data, then its delta records
+    if(iRet == EXECUTE_SUCCESS)
+    {
+        temp = restoreFileEntry(name, permission);
+        if(temp == NULL)
+        {
+            iRet = ERR_NO_INODES;
+        }
+    }
+
+    if(temp != NULL && (matchCount == 0 || (matches[first].Flags & DELTA_FULL) == 0))
+    {
+        iRet = restoreEntryData(fd, header, &entry, temp);
+    }
+
+    for(i = first; temp != NULL && i < matchCount && iRet != ERR_INVALID_PARAMETER; i++)
+    {
+        memcpy(&segment, segments[matchSegments[i]], sizeof(segment));
+        if(applyDeltaRecord(segments[matchSegments[i]], segment.Size, &matches[i], NULL, temp) != EXECUTE_SUCCESS)
+        {
+            iRet = ERR_INVALID_PARAMETER;
+        }
+    }
+
+    // A file that could not be put together is not left behind, damaged blocks are reported but kept
+    if(temp != NULL && iRet != EXECUTE_SUCCESS && iRet != ERR_CHECKSUM)
+    {
+        unlinkFile(temp -> FileName);
+    }
+
+    for(i = 0; segments != NULL && i < header -> SegmentCount; i++)
+    {
+        free(segments[i]);
+    }
+    free(segments);
+    free(matches);
+    free(matchSegments);
+
+    return iRet;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         restoreCVFS()
+//  Description:           Restores the files of BACKUP_FILE, files that exist already are kept.
+//                         Runs at startup and on the 'restore' command; images are mapped when
+//                         possible and read otherwise.
+//  Input:                 void
+//  Output:                void
+//  Author:                Ritesh Jillewad
+//  Date:                  28/01/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void restoreCVFS()
+{
+    IMAGEHEADER header;
+    int fd = 0;
+    int iRet = 0;
+
+    // A backup still being written finishes first, the restore may change what it is based on
+    backupWait();
+
+    // Open the backup file
+    fd = open(BACKUP_FILE, O_RDONLY);
+
+    if(fd == -1)
+    {
+        printf("CVFS: No backup file found. Starting fresh.\n");
+        return;
+    }
+
+    // Images start with a magic string, anything else is a backup in the older format.
+    // Version 1 images have a shorter header, so a short read is not an error yet.
+    memset(&header, 0, sizeof(header));
+    if(readAll(fd, &header, sizeof(header)) >= IMAGE_V1_HEADERSIZE && memcmp(header.Magic, IMAGE_MAGIC, sizeof(header.Magic)) == 0)
+    {
+        if(header.Version < 1 || header.Version > IMAGE_VERSION)
+        {
+            printf("CVFS: Backup image version %d is not supported.\n", header.Version);
+            close(fd);
+            return;
+        }
+
+        iRet = restoreVersionedImage(fd, &header);
+    }
+    else
+    {
+        lseek(fd, 0, SEEK_SET);
+        iRet = restoreLegacyImage(fd, NULL);
+    }
+
+    // Close the file descriptor
+    close(fd);
+
+    // Restored files are not in the journal, a backup makes them durable
+    if(journalobj.bEnabled == true && iRet > 0)
+    {
+        backupCVFS(false);
+    }
+
+    if(iRet == ERR_CHECKSUM)
+    {
+        printf("CVFS: Backup image failed its checksums, restore is incomplete.\n");
+        return;
+    }
+
+    if(iRet < 0)
+    {
+        printf("CVFS: Backup image is damaged, restore is incomplete.\n");
+        return;
+    }
+
+    printf("CVFS: System restored successfully (%d files).\n", iRet);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         restoreFile()
+//  Description:           Restores a single file of BACKUP_FILE without touching the other files.
+//                         The cost follows the size of that file (and of the delta segments), not
+//                         the size of the image.
+//  Input:                 Filename
+//  Output:                EXECUTE_SUCCESS or Error Code (ERR_FILE_ALREADY_EXISTS if the name is in
+//                         use, ERR_FILE_NOT_EXISTS if the backup does not have it)
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int restoreFile(const char *name)
+{
+    IMAGEHEADER header;
+    int fd = 0;
+    int iRet = 0;
+
+    if(name == NULL || name[0] == '\0')
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // A backup still being written finishes first, the image is read as it is on disk
+    backupWait();
+
+    if(isFileExists(name) == true)
+    {
+        return ERR_FILE_ALREADY_EXISTS;
+    }
+
+    fd = open(BACKUP_FILE, O_RDONLY);
+    if(fd == -1)
+    {
+        return ERR_HOST_IO;
+    }
+
+    memset(&header, 0, sizeof(header));
+    if(readAll(fd, &header, sizeof(header)) >= IMAGE_V1_HEADERSIZE && memcmp(header.Magic, IMAGE_MAGIC, sizeof(header.Magic)) == 0)
+    {
+        iRet = ERR_INVALID_PARAMETER;
+        if(header.Version >= 1 && header.Version <= IMAGE_VERSION)
+        {
+            iRet = restoreIndexedFile(fd, &header, name);
+        }
+    }
+    else
+    {
+        // Older backups have no index, their records are skipped over up to the file
+        lseek(fd, 0, SEEK_SET);
+        iRet = (restoreLegacyImage(fd, name) > 0) ? EXECUTE_SUCCESS : ERR_FILE_NOT_EXISTS;
+    }
+
+    close(fd);
+
+    // Restored files are not in the journal, a backup makes them durable
+    if(journalobj.bEnabled == true && (iRet == EXECUTE_SUCCESS || iRet == ERR_CHECKSUM))
+    {
+        backupCVFS(false);
+    }
+
+    return iRet;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         scrubMemory()
+//  Description:           Verifies every data block that still has the checksum of its last backup
+//                         or restore, spread over several threads
+//  Input:                 void
+//  Output:                Number of damaged blocks or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static long long scrubMemory()
+{
+    PINODE temp = NULL;
+    PRESTOREJOB jobs = NULL;
+    PRESTOREJOB job = NULL;
+    PDATABLOCK block = NULL;
+    unsigned int checksum = 0;
+    long long jobCount = 0;
+    long long jobCapacity = 0;
+    long long bytes = 0;
+    long long unchecked = 0;
+    long long damaged = 0;
+    long long start = 0;
+    long long elapsed = 0;
+    int size = 0;
+    int i = 0, j = 0;
+
+    for(i = 1; i < inodetableobj.NextUnused; i++)
+    {
+        temp = getInode(i);
+        if(temp -> FileType == 0)
+        {
+            continue;
+        }
+
+        for(j = 0; j < getInodeBlockCount(temp); j++)
+        {
+            block = getCheckedBlock(temp, j, &checksum, &size);
+            if(block == NULL)
+            {
+                if(getInodeBlock(temp, j) != NULL)
+                {
+                    unchecked++;
+                }
+                continue;
+            }
+
+            job = newRestoreJob(&jobs, &jobCount, &jobCapacity);
+            if(job == NULL)
+            {
+                free(jobs);
+                return ERR_INSUFFICIENT_SPACE;
+            }
+
+            job -> Block = block;
+            job -> Fd = -1;
+            job -> StoredLength = size;
+            job -> Size = size;
+            job -> Checksum = checksum;
+            job -> bCheck = true;
+            job -> File = temp -> InodeNumber;
+            job -> BlockIndex = j;
+            bytes = bytes + size;
+        }
+    }
+
+    start = backupNow();
+    if(jobCount > 0 && runRestoreJobs(jobs, jobCount) == false)
+    {
+        for(i = 0; i < jobCount; i++)
+        {
+            if(jobs[i].bDamaged == true)
+            {
+                printf("CVFS: %s: block %d is damaged in memory.\n", getInode(jobs[i].File) -> FileName, jobs[i].BlockIndex);
+                damaged++;
+            }
+        }
+    }
+    elapsed = backupNow() - start;
+    free(jobs);
+
+    printf("CVFS: Memory: %lld blocks (%.1f MB) verified in %.2f ms (%.2f GB/s), %lld damaged, %lld written since the last backup.\n",
+           jobCount, bytes / 1048576.0, elapsed / 1000.0, (elapsed > 0) ? bytes / (elapsed * 1000.0) : 0.0, damaged, unchecked);
+
+    return damaged;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         scrubImage()
+//  Description:           Verifies the backup image on disk: header, inode table, the checksums and
+//                         data of every file (compressed blocks are decompressed first) and every
+//                         delta segment. Nothing is restored.
+//  Input:                 void
+//  Output:                Number of damaged parts or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static long long scrubImage()
+{
+    PRESTOREJOB jobs = NULL;
+    PRESTOREJOB job = NULL;
+    IMAGEHEADER header;
+    IMAGEINODE entry;
+    IMAGESEGMENT segment;
+    struct stat info;
+    unsigned int *sums = NULL;
+    int *lengths = NULL;
+    char *base = NULL;
+    unsigned int checksum = 0;
+    bool bMapped = false;
+    long long jobCount = 0;
+    long long jobCapacity = 0;
+    long long position = 0;
+    long long source = 0;
+    long long bytes = 0;
+    long long damaged = 0;
+    long long start = backupNow();
+    long long elapsed = 0;
+    int fd = 0;
+    int i = 0, j = 0;
+
+    fd = open(BACKUP_FILE, O_RDONLY);
+    if(fd == -1)
+    {
+        printf("CVFS: No backup file found.\n");
+        return 0;
+    }
+
+    memset(&header, 0, sizeof(header));
+    if(readAll(fd, &header, sizeof(header)) < IMAGE_V1_HEADERSIZE || memcmp(header.Magic, IMAGE_MAGIC, sizeof(header.Magic)) != 0 ||
+       header.Version != IMAGE_VERSION || header.HeaderSize < (int)offsetof(IMAGEHEADER, IndexOffset) ||
+       header.HeaderSize > (int)sizeof(IMAGEHEADER) || (header.Flags & IMAGE_CHECKSUMS) == 0)
+    {
+        printf("CVFS: Backup image has no checksums (older format), 'backup full' adds them.\n");
+        close(fd);
+        return 0;
+    }
+
+    memset((char *)&header + header.HeaderSize, 0, sizeof(IMAGEHEADER) - header.HeaderSize);
+
+    if(getHeaderChecksum(&header) != header.HeaderChecksum || isImageLayoutValid(&header) == false ||
+       fstat(fd, &info) != 0 || info.st_size < header.EndOffset)
+    {
+        printf("CVFS: Backup image header is damaged or the image is truncated.\n");
+        close(fd);
+        return 1;
+    }
+
+    base = (char *)mmap(NULL, (size_t)header.EndOffset, PROT_READ, MAP_PRIVATE, fd, 0);
+    bMapped = (base != MAP_FAILED);
+    if(bMapped == false)
+    {
+        base = (char *)malloc(header.EndOffset + 1);
+        if(base == NULL || lseek(fd, 0, SEEK_SET) != 0 || readAll(fd, base, header.EndOffset) != header.EndOffset)
+        {
+            free(base);
+            close(fd);
+            return ERR_HOST_IO;
+        }
+    }
+
+    if(isImageTableValid(&header, base + header.InodeTableOffset) == false)
+    {
+        printf("CVFS: Backup image inode table is damaged.\n");
+        damaged++;
+        header.InodeCount = 0;
+    }
+
+    // 1. The files, their blocks are checked by several threads below
+    position = header.DataOffset;
+    for(i = 0; i < header.InodeCount; i++)
+    {
+        getImageEntry(base + header.InodeTableOffset, &header, i, &entry);
+
+        sums = NULL;
+        lengths = NULL;
+        if(entry.DataOffset == position && entry.ActualFileSize >= 0 && entry.ActualFileSize <= MAXFILESIZE)
+        {
+            if((header.Flags & IMAGE_COMPRESSED) == 0 && entry.ActualFileSize <= header.ImageSize - position)
+            {
+                position = position + entry.ActualFileSize;
+                sums = loadEntryChecksums(fd, base, &header, &entry);
+            }
+            else if((header.Flags & IMAGE_COMPRESSED) != 0 && entry.StoredSize >= 0 && entry.StoredSize <= header.ImageSize - position)
+            {
+                position = position + entry.StoredSize;
+                lengths = loadStoredLengths(base + entry.DataOffset, &entry);
+                sums = (lengths != NULL) ? loadEntryChecksums(fd, base, &header, &entry) : NULL;
+            }
+        }
+
+        if(sums == NULL)
+        {
+            printf("CVFS: %s: data or block checksums are damaged in the backup image.\n", entry.FileName);
+            free(lengths);
+            damaged++;
+            break;
+        }
+
+        for(j = 0, source = entry.DataOffset; (long long)j * BLOCKSIZE < entry.ActualFileSize; j++)
+        {
+            job = newRestoreJob(&jobs, &jobCount, &jobCapacity);
+            if(job == NULL)
+            {
+                break;
+            }
+
+            job -> Size = (int)((entry.ActualFileSize - (long long)j * BLOCKSIZE > BLOCKSIZE) ? BLOCKSIZE : entry.ActualFileSize - (long long)j * BLOCKSIZE);
+            job -> Source = base + source;
+            job -> StoredLength = (lengths != NULL) ? lengths[j] : job -> Size;
+            job -> Checksum = sums[j];
+            job -> bCheck = true;
+            job -> File = i;
+            job -> BlockIndex = j;
+
+            source = source + job -> StoredLength;
+            bytes = bytes + job -> Size;
+        }
+
+        free(lengths);
+        free(sums);
+    }
+
+    if(jobCount > 0 && runRestoreJobs(jobs, jobCount) == false)
+    {
+        for(i = 0; i < jobCount; i++)
+        {
+            if(jobs[i].bDamaged == true)
+            {
+                getImageEntry(base + header.InodeTableOffset, &header, jobs[i].File, &entry);
+                printf("CVFS: %s: block %d is damaged in the backup image.\n", entry.FileName, jobs[i].BlockIndex);
+                damaged++;
+            }
+        }
+    }
+    free(jobs);
+
+    // 2. The name index
+    if((header.Flags & IMAGE_INDEXED) != 0)
+    {
+        if(header.IndexSlots <= 0 || header.IndexOffset < header.DataOffset + header.DataSize ||
+           header.IndexOffset > header.ImageSize - header.IndexSlots * (long long)sizeof(IMAGEINDEXSLOT) ||
+           crc32c(0, base + header.IndexOffset, (long long)header.IndexSlots * sizeof(IMAGEINDEXSLOT)) != header.IndexChecksum)
+        {
+            printf("CVFS: Backup image name index is damaged, 'backup full' rebuilds it.\n");
+            damaged++;
+        }
+        else
+        {
+            bytes = bytes + (long long)header.IndexSlots * sizeof(IMAGEINDEXSLOT);
+        }
+    }
+
+    // 3. The delta segments, each one is checksummed as a whole
+    position = header.ImageSize;
+    for(i = 0; i < header.SegmentCount; i++)
+    {
+        if(position + (long long)sizeof(IMAGESEGMENT) > header.EndOffset)
+        {
+            damaged++;
+            break;
+        }
+
+        memcpy(&segment, base + position, sizeof(segment));
+        if(segment.Size < (long long)(sizeof(IMAGESEGMENT) + sizeof(unsigned int)) || segment.Size > header.EndOffset - position)
+        {
+            printf("CVFS: Delta segment %d is damaged in the backup image.\n", i + 1);
+            damaged++;
+            break;
+        }
+
+        memcpy(&checksum, base + position + segment.Size - sizeof(unsigned int), sizeof(checksum));
+        if(crc32c(0, base + position, segment.Size - sizeof(unsigned int)) != checksum)
+        {
+            printf("CVFS: Delta segment %d is damaged in the backup image.\n", i + 1);
+            damaged++;
+        }
+
+        bytes = bytes + segment.Size;
+        position = position + segment.Size;
+    }
+
+    if(bMapped == true)
+    {
+        munmap(base, (size_t)header.EndOffset);
+    }
+    else
+    {
+        free(base);
+    }
+    close(fd);
+
+    elapsed = backupNow() - start;
+
+    printf("CVFS: Backup image: %d files, %d delta segments, %.1f MB verified in %.2f ms (%.2f GB/s), %lld damaged.\n",
+           header.InodeCount, header.SegmentCount, bytes / 1048576.0, elapsed / 1000.0, (elapsed > 0) ? bytes / (elapsed * 1000.0) : 0.0, damaged);
+
+    return damaged;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         scrubCVFS()
+//  Description:           Verifies the checksums of the data blocks in memory and of the backup
+//                         image on disk, and reports what is damaged
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void scrubCVFS()
+{
+    long long memoryDamage = 0;
+    long long imageDamage = 0;
+
+    // The backup thread stores block checksums, it finishes first
+    backupWait();
+
+    printf("CVFS: Scrubbing with %s CRC32C.\n", (isCrc32cHardware() == true) ? "SSE4.2" : "table driven");
+
+    if(bBlockChecksums == true)
+    {
+        memoryDamage = scrubMemory();
+    }
+    else
+    {
+        printf("CVFS: Block checksums are not kept in memory.\n");
+    }
+
+    imageDamage = scrubImage();
+
+    if(memoryDamage == 0 && imageDamage == 0)
+    {
+        printf("CVFS: Scrub found no damage.\n");
+    }
+}
@@ -0,0 +1,2230 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  File Name:             cvfs_bench.c
+//  Description:           Micro benchmarks for CVFS internals (run with 'make bench')
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define _GNU_SOURCE                                             /* O_DIRECT */
+#include "cvfs.h"
+#include<time.h>
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchNow()
+//  Description:           Returns a monotonic timestamp in nanoseconds
+//  Input:                 void
+//  Output:                Timestamp
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double benchNow()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchRandom()
+//  Description:           Small xorshift generator so runs are repeatable
+//  Input:                 Pointer to generator state
+//  Output:                Next pseudo random number
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int benchRandom(unsigned int *state)
+{
+    unsigned int x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return x;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchLookup()
+//  Description:           Measures name lookup latency of the filename index from 10 to 1M files
+//                         and compares it with the old linear inode list scan. Hot hits and misses
+//                         cycle through 1024 names, random hits touch another inode and slot each
+//                         time; the load factor and probe lengths show the table stays as short at
+//                         1M files as at 10, so the rise of random hits is CPU cache misses.
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchLookup()
+{
+    int sizes[] = {10, 100, 1000, 10000, 100000, 1000000};
+    int lookups = 1000000;
+    int linearLookups = 0;
+    PINODE inodes = NULL;
+    PINODE temp = NULL;
+    unsigned int seed = 0;
+    unsigned int mask = 0;
+    double start = 0, hotNs = 0, hitNs = 0, missNs = 0, linearNs = 0;
+    volatile long long found = 0;                               /* Keeps the lookups from being optimized away */
+    long long probes = 0;
+    int probe = 0, maxProbe = 0;
+    int i = 0, j = 0, n = 0;
+    const char *hotNames[1024];
+    char missNames[1024][20];
+
+    for(j = 0; j < 1024; j++)
+    {
+        snprintf(missNames[j], sizeof(missNames[j]), "miss%d", j);
+    }
+
+    printf("\n[ lookup ] filename index vs linear inode list scan\n");
+    printf("%-10s%-8s%-12s%-12s%-14s%-16s%-16s%-16s\n", "Files", "Load", "Avg probes", "Max probes", "Hot hit ns",
+           "Index hit ns", "Index miss ns", "Linear scan ns");
+
+    for(i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+    {
+        n = sizes[i];
+        inodes = (PINODE)calloc(n, sizeof(INODE));
+
+        initialiseNameIndex(0);
+        for(j = 0; j < n; j++)
+        {
+            snprintf(inodes[j].FileName, sizeof(inodes[j].FileName), "file%d", j);
+            inodes[j].InodeNumber = j + 1;
+            inodes[j].FileType = REGULARFILE;
+            inodes[j].next = (j + 1 < n) ? &inodes[j + 1] : NULL;
+            insertNameIndex(&inodes[j]);
+        }
+
+        // Probes a lookup of every entry needs: the slots from its home slot up to its own
+        mask = (unsigned int)indexobj.Table -> Capacity - 1;
+        probes = 0;
+        maxProbe = 0;
+        for(j = 0; j < indexobj.Table -> Capacity; j++)
+        {
+            if(indexobj.Table -> Slots[j].Entry != NULL && indexobj.Table -> Slots[j].Entry != INDEX_TOMBSTONE)
+            {
+                probe = (int)(((unsigned int)j - indexobj.Table -> Slots[j].Hash) & mask) + 1;
+                probes = probes + probe;
+                if(probe > maxProbe)
+                {
+                    maxProbe = probe;
+                }
+            }
+        }
+
+        // Hits on 1024 existing names, their inodes and slots stay in the CPU cache
+        seed = 2463534242u;
+        for(j = 0; j < 1024; j++)
+        {
+            hotNames[j] = inodes[benchRandom(&seed) % n].FileName;
+        }
+
+        start = benchNow();
+        for(j = 0; j < lookups; j++)
+        {
+            found = found + (lookupNameIndex(hotNames[j & 1023]) != NULL);
+        }
+        hotNs = (benchNow() - start) / lookups;
+
+        // Hits on random existing names
+        start = benchNow();
+        for(j = 0; j < lookups; j++)
+        {
+            found = found + (lookupNameIndex(inodes[benchRandom(&seed) % n].FileName) != NULL);
+        }
+        hitNs = (benchNow() - start) / lookups;
+
+        // Misses on names that were never created
+        start = benchNow();
+        for(j = 0; j < lookups; j++)
+        {
+            found = found + (lookupNameIndex(missNames[j & 1023]) != NULL);
+        }
+        missNs = (benchNow() - start) / lookups;
+
+        // The previous implementation walked the inode list with strcmp
+        linearLookups = (n <= 10000) ? 100000 / n + 100 : 200;
+        start = benchNow();
+        for(j = 0; j < linearLookups; j++)
+        {
+            const char *name = inodes[benchRandom(&seed) % n].FileName;
+
+            temp = &inodes[0];
+            while(temp != NULL)
+            {
+                if(strcmp(name, temp -> FileName) == 0 && temp -> FileType == REGULARFILE)
+                {
+                    break;
+                }
+                temp = temp -> next;
+            }
+            found = found + (temp != NULL);
+        }
+        linearNs = (benchNow() - start) / linearLookups;
+
+        printf("%-10d%-8.2f%-12.2f%-12d%-14.1f%-16.1f%-16.1f%-16.1f\n", n, (double)indexobj.Count / indexobj.Table -> Capacity,
+               (double)probes / indexobj.Count, maxProbe, hotNs, hitNs, missNs, linearNs);
+
+        destroyNameIndex();
+        free(inodes);
+    }
+
+    printf("%lld lookups found their file\n", (long long)found);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchAllocChurn()
+//  Description:           Runs open/close and create/write/unlink churn once with the current allocator,
+//                         then allocates and frees file table entries alone
+//  Input:                 Label printed in the result row
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchAllocChurn(const char *label)
+{
+    int openLoops = 2000000;
+    int createLoops = 200000;
+    int objectLoops = 1000000;
+    char data[4 * BLOCKSIZE];
+    char name[20] = {'\0'};
+    void *objects[16];
+    double start = 0, openNs = 0, createNs = 0, objectNs = 0;
+    int fd = 0;
+    int i = 0, j = 0;
+
+    memset(data, 'x', sizeof(data));
+
+    // open/close churn: one file table entry allocated and released per iteration
+    fd = createFile("churn", READ + WRITE);
+    closeFile(fd);
+
+    start = benchNow();
+    for(i = 0; i < openLoops; i++)
+    {
+        fd = openFile("churn", READ + WRITE);
+        closeFile(fd);
+    }
+    openNs = (benchNow() - start) / openLoops;
+
+    unlinkFile("churn");
+
+    // create/unlink churn: inode, file table entry and four data blocks per iteration
+    start = benchNow();
+    for(i = 0; i < createLoops; i++)
+    {
+        snprintf(name, sizeof(name), "churn%d", i & 63);
+        fd = createFile(name, READ + WRITE);
+        writeFile(fd, data, sizeof(data));
+        closeFile(fd);
+        unlinkFile(name);
+    }
+    createNs = (benchNow() - start) / createLoops;
+
+    // The allocator alone: bursts of 16 file table entries allocated and released
+    start = benchNow();
+    for(i = 0; i < objectLoops; i++)
+    {
+        for(j = 0; j < 16; j++)
+        {
+            objects[j] = allocObject(sizeof(FILETABLE));
+        }
+        for(j = 0; j < 16; j++)
+        {
+            freeObject(objects[j], sizeof(FILETABLE));
+        }
+    }
+    objectNs = (benchNow() - start) / (objectLoops * 16.0);
+
+    printf("%-16s%-20.0f%-20.0f%-20.0f\n", label, 1e9 / openNs, 1e9 / createNs, 1e9 / objectNs);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchAlloc()
+//  Description:           Compares churn throughput of the CVFS slab allocator with plain malloc/free
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchAlloc()
+{
+    startAuxillaryDataInitialization();
+
+    printf("\n[ alloc ] churn throughput, slab allocator vs malloc/free\n");
+    printf("%-16s%-20s%-20s%-20s\n", "Allocator", "open+close /s", "create+unlink /s", "alloc+free /s");
+
+    bSystemAllocator = false;
+    benchAllocChurn("slab");
+
+    // Every object is released by the churn loops, so switching allocators here is safe
+    bSystemAllocator = true;
+    benchAllocChurn("malloc");
+    bSystemAllocator = false;
+
+    displayMemoryStats();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchVectoredRun()
+//  Description:           Appends records made of equal fragments, either with one writeFile() per
+//                         fragment or with one writevFile() per record
+//  Input:                 Fragments per record, bytes per fragment, use writevFile() or not
+//  Output:                Nanoseconds per record
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double benchVectoredRun(int fragments, int fragmentSize, bool bVectored)
+{
+    int records = 200000;
+    static char data[16 * 64];
+    struct iovec iov[16];
+    double start = 0;
+    int fd = 0;
+    int i = 0, j = 0;
+
+    memset(data, 'v', sizeof(data));
+    for(j = 0; j < fragments; j++)
+    {
+        iov[j].iov_base = data + j * fragmentSize;
+        iov[j].iov_len = fragmentSize;
+    }
+
+    fd = createFile("records", READ + WRITE);
+
+    start = benchNow();
+    for(i = 0; i < records; i++)
+    {
+        if(bVectored == true)
+        {
+            writevFile(fd, iov, fragments);
+        }
+        else
+        {
+            for(j = 0; j < fragments; j++)
+            {
+                writeFile(fd, (char *)iov[j].iov_base, fragmentSize);
+            }
+        }
+    }
+    start = (benchNow() - start) / records;
+
+    closeFile(fd);
+    unlinkFile("records");
+
+    return start;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchVectored()
+//  Description:           Compares writevFile() with looped writeFile() calls for small records
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchVectored()
+{
+    int shapes[][2] = {{2, 16}, {2, 112}, {4, 32}, {16, 64}};
+    double loopNs = 0, vectorNs = 0;
+    int i = 0;
+
+    startAuxillaryDataInitialization();
+
+    // Warm up the block arena so neither variant pays for its first regions
+    benchVectoredRun(16, 64, true);
+
+    printf("\n[ writev ] appending records, looped writeFile() vs one writevFile() per record\n");
+    printf("%-12s%-12s%-18s%-18s%-10s\n", "Fragments", "Bytes", "loop records/s", "writev records/s", "Speedup");
+
+    for(i = 0; i < (int)(sizeof(shapes) / sizeof(shapes[0])); i++)
+    {
+        loopNs = benchVectoredRun(shapes[i][0], shapes[i][1], false);
+        vectorNs = benchVectoredRun(shapes[i][0], shapes[i][1], true);
+
+        printf("%-12d%-12d%-18.0f%-18.0f%-10.2f\n", shapes[i][0], shapes[i][0] * shapes[i][1],
+               1e9 / loopNs, 1e9 / vectorNs, loopNs / vectorNs);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchCopy()
+//  Description:           Measures writeFile()/readFile() throughput on large binary payloads and
+//                         compares it with a plain memcpy() of the same payload
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchCopy()
+{
+    int sizes[] = {64 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+    long long totalBytes = 1LL << 30;
+    unsigned int seed = 12345;
+    char *source = NULL;
+    char *target = NULL;
+    double start = 0, memcpyNs = 0, writeNs = 0, readNs = 0;
+    int loops = 0;
+    int fd = 0;
+    int i = 0, j = 0;
+
+    startAuxillaryDataInitialization();
+
+    source = (char *)malloc(sizes[2]);
+    target = (char *)malloc(sizes[2]);
+
+    // Random bytes, so the payload contains NUL bytes like any binary file
+    for(i = 0; i < sizes[2]; i++)
+    {
+        source[i] = (char)benchRandom(&seed);
+    }
+
+    printf("\n[ copy ] binary payload throughput in MB/s (%lld MB moved per row)\n", totalBytes >> 20);
+    printf("%-12s%-14s%-14s%-14s%-10s\n", "Payload", "memcpy", "writeFile", "readFile", "Verified");
+
+    fd = createFile("payload", READ + WRITE);
+
+    for(i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+    {
+        loops = (int)(totalBytes / sizes[i]);
+
+        // The first write allocates the blocks, the timed loops overwrite them
+        lseekFile(fd, 0, START);
+        writeFile(fd, source, sizes[i]);
+
+        start = benchNow();
+        for(j = 0; j < loops; j++)
+        {
+            memcpy(target, source, sizes[i]);
+        }
+        memcpyNs = benchNow() - start;
+
+        start = benchNow();
+        for(j = 0; j < loops; j++)
+        {
+            lseekFile(fd, 0, START);
+            writeFile(fd, source, sizes[i]);
+        }
+        writeNs = benchNow() - start;
+
+        memset(target, 0, sizes[i]);
+
+        start = benchNow();
+        for(j = 0; j < loops; j++)
+        {
+            lseekFile(fd, 0, START);
+            readFile(fd, target, sizes[i]);
+        }
+        readNs = benchNow() - start;
+
+        printf("%-12d%-14.0f%-14.0f%-14.0f%-10s\n", sizes[i], totalBytes / memcpyNs * 1e3, totalBytes / writeNs * 1e3,
+               totalBytes / readNs * 1e3, (memcmp(source, target, sizes[i]) == 0) ? "yes" : "NO");
+    }
+
+    closeFile(fd);
+    unlinkFile("payload");
+
+    free(source);
+    free(target);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchLegacyBackup()
+//  Description:           Writes a backup in the older record format (four field writes per file and
+//                         one write per data block), kept here as the baseline for benchBackup()
+//  Input:                 Host path
+//  Output:                Number of write() calls made
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static long long benchLegacyBackup(const char *path)
+{
+    PINODE temp = NULL;
+    PDATABLOCK block = NULL;
+    char zeroBlock[BLOCKSIZE] = {'\0'};
+    long long calls = 0;
+    int chunk = 0;
+    int fd = 0;
+    int i = 0, j = 0;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    for(i = 1; i < inodetableobj.NextUnused; i++)
+    {
+        temp = getInode(i);
+        if(temp -> FileType == 0)
+        {
+            continue;
+        }
+
+        write(fd, temp -> FileName, sizeof(temp -> FileName));
+        write(fd, &temp -> InodeNumber, sizeof(temp -> InodeNumber));
+        write(fd, &temp -> ActualFileSize, sizeof(temp -> ActualFileSize));
+        write(fd, &temp -> Permission, sizeof(temp -> Permission));
+        calls = calls + 4;
+
+        for(j = 0; (long long)j * BLOCKSIZE < temp -> ActualFileSize; j++)
+        {
+            chunk = (int)(temp -> ActualFileSize - (long long)j * BLOCKSIZE);
+            if(chunk > BLOCKSIZE)
+            {
+                chunk = BLOCKSIZE;
+            }
+
+            block = getInodeBlock(temp, j);
+            write(fd, (block != NULL) ? pinDataBlock(block) : zeroBlock, chunk);
+            if(block != NULL)
+            {
+                unpinDataBlock(block, false);
+            }
+            calls++;
+        }
+    }
+
+    fsync(fd);
+    close(fd);
+
+    return calls;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchFileSize()
+//  Description:           Returns the size of a host file
+//  Input:                 Host path
+//  Output:                Size in bytes
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static long long benchFileSize(const char *path)
+{
+    long long size = 0;
+    int fd = open(path, O_RDONLY);
+
+    size = lseek(fd, 0, SEEK_END);
+    close(fd);
+
+    return size;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchBackup()
+//  Description:           Compares size and time of the backup image with the older record format
+//                         for many small files plus a few large ones
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchBackup()
+{
+    const char *legacyPath = "CVFS_Backup_legacy.bin";
+    unsigned int seed = 777;
+    char *data = NULL;
+    char name[20] = {'\0'};
+    double start = 0, legacyNs = 0, imageNs = 0;
+    long long legacyCalls = 0;
+    int smallFiles = 20000;
+    int largeFiles = 16;
+    int largeSize = 4 * 1024 * 1024;
+    int fd = 0;
+    int i = 0;
+
+    startAuxillaryDataInitialization();
+
+    data = (char *)malloc(largeSize);
+    for(i = 0; i < largeSize; i++)
+    {
+        data[i] = (char)benchRandom(&seed);
+    }
+
+    for(i = 0; i < smallFiles + largeFiles; i++)
+    {
+        snprintf(name, sizeof(name), "file%d", i);
+        fd = createFile(name, READ + WRITE);
+        writeFile(fd, data, (i < smallFiles) ? (int)(benchRandom(&seed) % 2048) : largeSize);
+        closeFile(fd);
+    }
+
+    printf("\n[ backup ] %d small files (0-2 KB) + %d files of %d MB\n", smallFiles, largeFiles, largeSize >> 20);
+    printf("%-12s%-16s%-14s%-14s\n", "Format", "Image bytes", "Time ms", "write() calls");
+
+    start = benchNow();
+    legacyCalls = benchLegacyBackup(legacyPath);
+    legacyNs = benchNow() - start;
+
+    start = benchNow();
+    backupCVFS(true);
+    imageNs = benchNow() - start;
+
+    printf("%-12s%-16lld%-14.1f%-14lld\n", "legacy", benchFileSize(legacyPath), legacyNs / 1e6, legacyCalls);
+    printf("%-12s%-16lld%-14.1f%-14lld\n", "image", benchFileSize(BACKUP_FILE), imageNs / 1e6,
+           (benchFileSize(BACKUP_FILE) + BACKUPBUFFERSIZE - 1) / BACKUPBUFFERSIZE);
+
+    unlink(legacyPath);
+    unlink(BACKUP_FILE);
+
+    for(i = 0; i < smallFiles + largeFiles; i++)
+    {
+        snprintf(name, sizeof(name), "file%d", i);
+        unlinkFile(name);
+    }
+
+    free(data);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchUnlinkAll()
+//  Description:           Deletes every file so the next restore starts from an empty filesystem
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchUnlinkAll()
+{
+    char name[20] = {'\0'};
+    int i = 0;
+
+    for(i = 1; i < inodetableobj.NextUnused; i++)
+    {
+        if(getInode(i) -> FileType != 0)
+        {
+            strcpy(name, getInode(i) -> FileName);
+            unlinkFile(name);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchRestoreRun()
+//  Description:           Restores the backup image once and then reads every file completely
+//  Input:                 Label printed in the result row, map the image or read it
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchRestoreRun(const char *label, bool bMapped)
+{
+    static char buffer[BACKUPBUFFERSIZE];
+    PINODE temp = NULL;
+    double start = 0, restoreNs = 0, readNs = 0;
+    long long offset = 0;
+    int i = 0;
+
+    benchUnlinkAll();
+    bMappedRestore = bMapped;
+
+    start = benchNow();
+    restoreCVFS();
+    restoreNs = benchNow() - start;
+
+    // Touch all data, for a mapped image this is where the pages are read
+    start = benchNow();
+    for(i = 1; i < inodetableobj.NextUnused; i++)
+    {
+        temp = getInode(i);
+        if(temp -> FileType == 0)
+        {
+            continue;
+        }
+
+        for(offset = 0; offset < temp -> ActualFileSize; offset = offset + sizeof(buffer))
+        {
+            readInodeData(temp, buffer, offset, sizeof(buffer));
+        }
+    }
+    readNs = benchNow() - start;
+
+    printf("%-12s%-20.2f%-20.2f%-14lld\n", label, restoreNs / 1e6, readNs / 1e6, superobj.MappedBlocks);
+
+    bMappedRestore = true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchRestore()
+//  Description:           Compares a mapped restore of a backup image with reading it
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchRestore()
+{
+    unsigned int seed = 4242;
+    char *data = NULL;
+    char name[20] = {'\0'};
+    int smallFiles = 5000;
+    int largeFiles = 8;
+    int largeSize = 32 * 1024 * 1024;
+    int fd = 0;
+    int i = 0;
+
+    startAuxillaryDataInitialization();
+
+    data = (char *)malloc(largeSize);
+    for(i = 0; i < largeSize; i++)
+    {
+        data[i] = (char)benchRandom(&seed);
+    }
+
+    for(i = 0; i < smallFiles + largeFiles; i++)
+    {
+        snprintf(name, sizeof(name), "file%d", i);
+        fd = createFile(name, READ + WRITE);
+        writeFile(fd, data, (i < smallFiles) ? (int)(benchRandom(&seed) % 4096) : largeSize);
+        closeFile(fd);
+    }
+
+    // Only an uncompressed image can be mapped
+    bCompressBackup = false;
+    backupCVFS(true);
+    bCompressBackup = true;
+    free(data);
+
+    printf("\n[ restore ] image of %d small files + %d files of %d MB\n", smallFiles, largeFiles, largeSize >> 20);
+    printf("%-12s%-20s%-20s%-14s\n", "Restore", "Usable after ms", "Read all data ms", "Mapped blocks");
+
+    benchRestoreRun("read", false);
+    benchRestoreRun("mapped", true);
+
+    benchUnlinkAll();
+    unlink(BACKUP_FILE);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchCompressRun()
+//  Description:           Writes a full backup image in one mode, then restores it and reads all data
+//  Input:                 Label printed in the result row, compress the image or not
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchCompressRun(const char *label, bool bCompress)
+{
+    static char buffer[BACKUPBUFFERSIZE];
+    PINODE temp = NULL;
+    double start = 0, backupNs = 0, restoreNs = 0, readNs = 0;
+    long long offset = 0;
+    int i = 0;
+
+    bCompressBackup = bCompress;
+
+    start = benchNow();
+    backupCVFS(true);
+    backupNs = benchNow() - start;
+
+    benchUnlinkAll();
+
+    start = benchNow();
+    restoreCVFS();
+    restoreNs = benchNow() - start;
+
+    start = benchNow();
+    for(i = 1; i < inodetableobj.NextUnused; i++)
+    {
+        temp = getInode(i);
+        if(temp -> FileType == 0)
+        {
+            continue;
+        }
+
+        for(offset = 0; offset < temp -> ActualFileSize; offset = offset + sizeof(buffer))
+        {
+            readInodeData(temp, buffer, offset, sizeof(buffer));
+        }
+    }
+    readNs = benchNow() - start;
+
+    printf("%-14s%-16lld%-16.2f%-18.2f%-18.2f\n", label, benchFileSize(BACKUP_FILE), backupNs / 1e6, restoreNs / 1e6, readNs / 1e6);
+
+    bCompressBackup = true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchCompress()
+//  Description:           Compares compressed and uncompressed backup images (size, backup time and
+//                         restore time) for text, sparse and random files
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchCompress()
+{
+    unsigned int seed = 777;
+    char *data = NULL;
+    char name[20] = {'\0'};
+    int textFiles = 2000;
+    int largeFiles = 6;
+    int largeSize = 16 * 1024 * 1024;
+    int length = 0;
+    int fd = 0;
+    int i = 0, j = 0;
+
+    startAuxillaryDataInitialization();
+
+    // Log like text: repeated words and changing numbers
+    data = (char *)malloc(largeSize + 128);
+    for(i = 0; i < largeSize; i = i + length)
+    {
+        length = snprintf(data + i, 128, "%08u INFO request %u served by worker %u in %u us\n", (unsigned int)i, benchRandom(&seed) % 100000, benchRandom(&seed) % 16, benchRandom(&seed) % 5000);
+    }
+
+    for(i = 0; i < textFiles; i++)
+    {
+        snprintf(name, sizeof(name), "text%d", i);
+        fd = createFile(name, READ + WRITE);
+        writeFile(fd, data + (benchRandom(&seed) % 65536), 1024 + (int)(benchRandom(&seed) % 8192));
+        closeFile(fd);
+    }
+
+    for(i = 0; i < largeFiles; i++)
+    {
+        snprintf(name, sizeof(name), "large%d", i);
+        fd = createFile(name, READ + WRITE);
+
+        if(i % 3 == 0)
+        {
+            writeFile(fd, data, largeSize);
+        }
+        else if(i % 3 == 1)
+        {
+            // Sparse: a few blocks of data, the rest zero
+            for(j = 0; j < largeSize / BLOCKSIZE; j = j + 64)
+            {
+                lseekFile(fd, (long long)j * BLOCKSIZE, START);
+                writeFile(fd, data + (long long)j * 64, 512);
+            }
+            lseekFile(fd, largeSize - 1, START);
+            writeFile(fd, "", 1);
+        }
+        else
+        {
+            for(j = 0; j < largeSize; j++)
+            {
+                data[j] = (char)benchRandom(&seed);
+            }
+            writeFile(fd, data, largeSize);
+        }
+
+        closeFile(fd);
+    }
+
+    free(data);
+
+    printf("\n[ compress ] %d text files + %d files of %d MB (text, sparse, random)\n", textFiles, largeFiles, largeSize >> 20);
+    printf("%-14s%-16s%-16s%-18s%-18s\n", "Image", "Bytes", "Backup ms", "Usable after ms", "Read all data ms");
+
+    benchCompressRun("uncompressed", false);
+    benchCompressRun("compressed", true);
+
+    benchUnlinkAll();
+    unlink(BACKUP_FILE);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchSingleRun()
+//  Description:           Writes a full backup image in one mode, then restores everything once and
+//                         single files of both sizes one at a time
+//  Input:                 Label printed in the result row, compress the image or not, number of small
+//                         files, number of large files
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchSingleRun(const char *label, bool bCompress, int smallFiles, int largeFiles)
+{
+    struct stat info;
+    char name[20] = {'\0'};
+    double start = 0, fullNs = 0, smallNs = 0, largeNs = 0;
+    int rounds = 100;
+    int i = 0;
+
+    bCompressBackup = bCompress;
+    backupCVFS(true);
+    bCompressBackup = true;
+    stat(BACKUP_FILE, &info);
+
+    benchUnlinkAll();
+    start = benchNow();
+    restoreCVFS();
+    fullNs = benchNow() - start;
+
+    for(i = 0; i < rounds; i++)
+    {
+        snprintf(name, sizeof(name), "file%d", (i * 37) % smallFiles);
+        unlinkFile(name);
+
+        start = benchNow();
+        restoreFile(name);
+        smallNs = smallNs + benchNow() - start;
+    }
+
+    for(i = 0; i < largeFiles; i++)
+    {
+        snprintf(name, sizeof(name), "file%d", smallFiles + i);
+        unlinkFile(name);
+
+        start = benchNow();
+        restoreFile(name);
+        largeNs = largeNs + benchNow() - start;
+    }
+
+    printf("%-14s%-12.1f%-18.2f%-18.3f%-18.2f\n", label, info.st_size / 1048576.0, fullNs / 1e6, smallNs / rounds / 1e6, largeNs / largeFiles / 1e6);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchSingle()
+//  Description:           Compares restoring one file through the name index of the image with
+//                         restoring the whole image
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchSingle()
+{
+    unsigned int seed = 1818;
+    char *data = NULL;
+    char name[20] = {'\0'};
+    int smallFiles = 10000;
+    int largeFiles = 4;
+    int largeSize = 32 * 1024 * 1024;
+    int fd = 0;
+    int i = 0;
+
+    startAuxillaryDataInitialization();
+
+    // Half of the data compresses, half does not
+    data = (char *)malloc(largeSize);
+    for(i = 0; i < largeSize; i++)
+    {
+        data[i] = (i < largeSize / 2) ? (char)('a' + (i / 64) % 26) : (char)benchRandom(&seed);
+    }
+
+    for(i = 0; i < smallFiles + largeFiles; i++)
+    {
+        snprintf(name, sizeof(name), "file%d", i);
+        fd = createFile(name, READ + WRITE);
+        writeFile(fd, data + (i % 1024) * 16, (i < smallFiles) ? (int)(benchRandom(&seed) % 4096) : largeSize - 1024 * 16);
+        closeFile(fd);
+    }
+    free(data);
+
+    printf("\n[ single ] image of %d small files + %d files of %d MB\n", smallFiles, largeFiles, largeSize >> 20);
+    printf("%-14s%-12s%-18s%-18s%-18s\n", "Image", "MB", "Full restore ms", "Small file ms", "Large file ms");
+
+    benchSingleRun("uncompressed", false, smallFiles, largeFiles);
+    benchSingleRun("compressed", true, smallFiles, largeFiles);
+
+    benchUnlinkAll();
+    unlink(BACKUP_FILE);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchParallelRun()
+//  Description:           Writes and restores a full image in both modes with a given number of threads
+//  Input:                 Number of threads
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchParallelRun(int threads)
+{
+    double start = 0, times[4];
+    int i = 0;
+
+    backupThreads = threads;
+
+    // Uncompressed and compressed, each written and then restored by reading it
+    for(i = 0; i < 2; i++)
+    {
+        bCompressBackup = (i == 1);
+        start = benchNow();
+        backupCVFS(true);
+        times[i * 2] = benchNow() - start;
+
+        bMappedRestore = false;
+        benchUnlinkAll();
+        start = benchNow();
+        restoreCVFS();
+        times[i * 2 + 1] = benchNow() - start;
+    }
+
+    printf("%-10d%-18.2f%-18.2f%-18.2f%-18.2f\n", threads, times[0] / 1e6, times[1] / 1e6, times[2] / 1e6, times[3] / 1e6);
+
+    backupThreads = 0;
+    bCompressBackup = true;
+    bMappedRestore = true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchParallel()
+//  Description:           Shows how full backup (shards written side by side) and restore (blocks read
+//                         or decompressed side by side) scale with threads
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchParallel()
+{
+    unsigned int seed = 1919;
+    char *data = NULL;
+    char name[20] = {'\0'};
+    int smallFiles = 2000;
+    int largeFiles = 8;
+    int largeSize = 16 * 1024 * 1024;
+    int threads = 0;
+    int fd = 0;
+    int i = 0;
+
+    startAuxillaryDataInitialization();
+
+    // Half of the data compresses, half does not
+    data = (char *)malloc(largeSize);
+    for(i = 0; i < largeSize; i++)
+    {
+        data[i] = (i < largeSize / 2) ? (char)('a' + (i / 64) % 26) : (char)benchRandom(&seed);
+    }
+
+    for(i = 0; i < smallFiles + largeFiles; i++)
+    {
+        snprintf(name, sizeof(name), "file%d", i);
+        fd = createFile(name, READ + WRITE);
+        writeFile(fd, data + (i % 1024) * 16, (i < smallFiles) ? (int)(benchRandom(&seed) % 16384) : largeSize - 1024 * 16);
+        closeFile(fd);
+    }
+    free(data);
+
+    printf("\n[ parallel ] %d small files + %d files of %d MB, %ld cores\n", smallFiles, largeFiles, largeSize >> 20, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%-10s%-18s%-18s%-18s%-18s\n", "Threads", "Backup ms", "Restore ms", "Compressed ms", "Decompress ms");
+
+    for(threads = 1; threads <= BACKUP_MAXTHREADS; threads = threads * 2)
+    {
+        benchParallelRun(threads);
+    }
+
+    benchUnlinkAll();
+    unlink(BACKUP_FILE);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchIncremental()
+//  Description:           Compares incremental backups after a few random block writes with a full
+//                         backup of the same filesystem
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchIncremental()
+{
+    unsigned int seed = 777;
+    static int writes[] = {0, 10, 100, 1000};
+    char *data = NULL;
+    char name[20] = {'\0'};
+    double start = 0, ns = 0;
+    int files = 1000;
+    int fileSize = 128 * 1024;
+    PINODE inodes[1000];
+    int fd = 0;
+    int i = 0, j = 0;
+
+    startAuxillaryDataInitialization();
+
+    data = (char *)malloc(fileSize);
+    for(i = 0; i < fileSize; i++)
+    {
+        data[i] = (char)benchRandom(&seed);
+    }
+
+    for(i = 0; i < files; i++)
+    {
+        snprintf(name, sizeof(name), "file%d", i);
+        fd = createFile(name, READ + WRITE);
+        writeFile(fd, data, fileSize);
+        closeFile(fd);
+
+        inodes[i] = lookupNameIndex(name);
+    }
+
+    printf("\n[ incremental ] %d files of %d KB, random %d byte writes between backups\n", files, fileSize >> 10, BLOCKSIZE);
+    printf("%-20s%-16s%-14s\n", "Backup", "Bytes written", "Time ms");
+
+    start = benchNow();
+    backupCVFS(true);
+    ns = benchNow() - start;
+    printf("%-20s%-16lld%-14.2f\n", "full", backupobj.LastBytes, ns / 1e6);
+
+    for(i = 0; i < (int)(sizeof(writes) / sizeof(writes[0])); i++)
+    {
+        for(j = 0; j < writes[i]; j++)
+        {
+            writeInodeData(inodes[benchRandom(&seed) % files], data, (long long)(benchRandom(&seed) % (fileSize / BLOCKSIZE)) * BLOCKSIZE, BLOCKSIZE);
+        }
+
+        start = benchNow();
+        backupCVFS(false);
+        ns = benchNow() - start;
+
+        snprintf(name, sizeof(name), "delta %d writes", writes[i]);
+        printf("%-20s%-16lld%-14.2f\n", name, backupobj.LastBytes, ns / 1e6);
+    }
+
+    benchUnlinkAll();
+    unlink(BACKUP_FILE);
+    free(data);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchJournalRun()
+//  Description:           Runs small writes with journaling off or at one commit interval
+//  Input:                 Label printed in the result row, commit interval (-1 = journal off),
+//                         number of writes, open files, number of files
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchJournalRun(const char *label, long long interval, int ops, int *fds, int files)
+{
+    unsigned int seed = 99;
+    char data[512];
+    double start = 0, ns = 0;
+    long long commits = 0;
+    int i = 0;
+
+    memset(data, 'j', sizeof(data));
+
+    if(interval >= 0)
+    {
+        journalStart(interval);
+    }
+    commits = journalobj.Commits;
+
+    start = benchNow();
+    for(i = 0; i < ops; i++)
+    {
+        pwriteFile(fds[benchRandom(&seed) % files], data, sizeof(data), (long long)(benchRandom(&seed) % 1024) * sizeof(data));
+    }
+    journalCommit();
+    ns = benchNow() - start;
+
+    printf("%-16s%-14d%-16.0f%-12lld\n", label, ops, ops / (ns / 1e9), journalobj.Commits - commits);
+
+    journalStop();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchJournal()
+//  Description:           Reports write throughput of the write-ahead journal at different commit
+//                         intervals (group commit) against journaling off
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchJournal()
+{
+    char name[20] = {'\0'};
+    int fds[8];
+    int files = 8;
+    int i = 0;
+
+    startAuxillaryDataInitialization();
+
+    for(i = 0; i < files; i++)
+    {
+        snprintf(name, sizeof(name), "file%d", i);
+        fds[i] = createFile(name, READ + WRITE);
+    }
+
+    printf("\n[ journal ] 512 byte writes to %d files, one record each\n", files);
+    printf("%-16s%-14s%-16s%-12s\n", "Commit", "Writes", "Writes/sec", "fsyncs");
+
+    benchJournalRun("off", -1, 200000, fds, files);
+    benchJournalRun("every op", 0, 2000, fds, files);
+    benchJournalRun("100 us", 100, 20000, fds, files);
+    benchJournalRun("1 ms", 1000, 200000, fds, files);
+    benchJournalRun("10 ms", 10000, 200000, fds, files);
+
+    for(i = 0; i < files; i++)
+    {
+        closeFile(fds[i]);
+    }
+
+    benchUnlinkAll();
+    unlink(BACKUP_FILE);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchSnapshotWrites()
+//  Description:           Runs random block writes and records their latency, either a fixed number
+//                         of them or as long as a background backup is running
+//  Input:                 Label printed in the result row, inodes, number of files, file size, data,
+//                         number of writes (0 = until the background backup has finished)
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchSnapshotWrites(const char *label, PINODE *inodes, int files, int fileSize, char *data, int ops)
+{
+    unsigned int seed = 4242;
+    double start = 0, ns = 0, total = 0, worst = 0;
+    int count = 0;
+
+    while((ops > 0 && count < ops) || (ops == 0 && __atomic_load_n(&backupobj.bDone, __ATOMIC_ACQUIRE) == false))
+    {
+        start = benchNow();
+        writeInodeData(inodes[benchRandom(&seed) % files], data, (long long)(benchRandom(&seed) % (fileSize / BLOCKSIZE)) * BLOCKSIZE, BLOCKSIZE);
+        ns = benchNow() - start;
+
+        total = total + ns;
+        if(ns > worst)
+        {
+            worst = ns;
+        }
+        count++;
+    }
+
+    printf("%-24s%-12d%-16.2f%-16.2f\n", label, count, (count > 0) ? total / count / 1e3 : 0.0, worst / 1e3);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchSnapshot()
+//  Description:           Measures what a background backup costs the foreground: the pause for the
+//                         snapshot and the latency of writes while the image is written (they copy
+//                         the blocks shared with the snapshot), against a blocking backup
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchSnapshot()
+{
+    unsigned int seed = 555;
+    char *data = NULL;
+    char name[20] = {'\0'};
+    double start = 0, ns = 0;
+    int files = 1000;
+    int fileSize = 128 * 1024;
+    PINODE inodes[1000];
+    long long copied = 0;
+    int fd = 0;
+    int i = 0;
+
+    startAuxillaryDataInitialization();
+
+    data = (char *)malloc(fileSize);
+    for(i = 0; i < fileSize; i++)
+    {
+        data[i] = (char)benchRandom(&seed);
+    }
+
+    for(i = 0; i < files; i++)
+    {
+        snprintf(name, sizeof(name), "file%d", i);
+        fd = createFile(name, READ + WRITE);
+        writeFile(fd, data, fileSize);
+        closeFile(fd);
+
+        inodes[i] = lookupNameIndex(name);
+    }
+
+    printf("\n[ snapshot ] %d files of %d KB, full backup while %d byte writes go on\n", files, fileSize >> 10, BLOCKSIZE);
+
+    start = benchNow();
+    backupCVFS(true);
+    ns = benchNow() - start;
+    printf("Blocking backup         : %.2f ms with the shell stopped\n", ns / 1e6);
+
+    printf("%-24s%-12s%-16s%-16s\n", "Writes", "Count", "Avg us", "Max us");
+    benchSnapshotWrites("idle", inodes, files, fileSize, data, 20000);
+
+    copied = superobj.CopiedBlocks;
+    backupStart(true);
+    benchSnapshotWrites("during backup", inodes, files, fileSize, data, 0);
+    copied = superobj.CopiedBlocks - copied;
+    backupWait();
+
+    printf("Snapshot pause          : %lld us\n", backupobj.LastPause);
+    printf("Background backup       : %.2f ms, %lld blocks copied on write\n", backupobj.LastTime / 1e3, copied);
+
+    benchUnlinkAll();
+    unlink(BACKUP_FILE);
+    free(data);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchChecksum()
+//  Description:           Compares the CRC32C implementations with memcpy() (memory bandwidth) and
+//                         times a scrub of a filesystem backed up with checksums
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchChecksum()
+{
+    unsigned int seed = 99;
+    unsigned int checksum = 0;
+    char *data = NULL;
+    char *copy = NULL;
+    char name[20] = {'\0'};
+    double start = 0, softwareNs = 0, hardwareNs = 0, copyNs = 0;
+    int size = 64 * 1024 * 1024;
+    int files = 16;
+    int fd = 0;
+    int i = 0;
+
+    startAuxillaryDataInitialization();
+
+    data = (char *)malloc(size);
+    copy = (char *)malloc(size);
+    for(i = 0; i < size; i++)
+    {
+        data[i] = (char)benchRandom(&seed);
+    }
+    memcpy(copy, data, size);
+
+    start = benchNow();
+    checksum = crc32cSoftware(0, data, size);
+    softwareNs = benchNow() - start;
+
+    start = benchNow();
+    checksum = checksum ^ crc32c(0, data, size);
+    hardwareNs = benchNow() - start;
+
+    start = benchNow();
+    memcpy(copy, data, size);
+    copyNs = benchNow() - start;
+
+    // The copy is checked, so the compiler can not drop it
+    if(memcmp(copy + size / 2, data + size / 2, 64) != 0)
+    {
+        checksum = 1;
+    }
+
+    printf("\n[ checksum ] CRC32C over %d MB (results agree: %s)\n", size >> 20, (checksum == 0) ? "yes" : "NO");
+    printf("%-22s%-14s%-14s\n", "Method", "ms", "GB/s");
+    printf("%-22s%-14.2f%-14.2f\n", "table (slicing-by-8)", softwareNs / 1e6, size / softwareNs);
+    printf("%-22s%-14.2f%-14.2f\n", (isCrc32cHardware() == true) ? "sse4.2 crc32" : "table (no sse4.2)", hardwareNs / 1e6, size / hardwareNs);
+    printf("%-22s%-14.2f%-14.2f\n", "memcpy", copyNs / 1e6, size / copyNs);
+
+    for(i = 0; i < files; i++)
+    {
+        snprintf(name, sizeof(name), "file%d", i);
+        fd = createFile(name, READ + WRITE);
+        writeFile(fd, data + (i % 4) * (size / 4), size / 4);
+        closeFile(fd);
+    }
+
+    free(data);
+    free(copy);
+
+    bCompressBackup = false;
+    backupCVFS(true);
+    bCompressBackup = true;
+
+    printf("\n[ checksum ] scrub of %d files of %d MB\n", files, size >> 22);
+    scrubCVFS();
+
+    benchUnlinkAll();
+    unlink(BACKUP_FILE);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchStorageRun()
+//  Description:           Writes a data set, reads 4 KB blocks at random (most of them from a hot part
+//                         of it) and scans it once, with file data in memory or in the storage file
+//  Input:                 Label printed in the result row, buffer cache blocks (0 = memory), O_DIRECT
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchStorageRun(const char *label, long long cacheBlocks, bool bDirect)
+{
+    static char buffer[1024 * 1024];
+    unsigned int seed = 2020;
+    PINODE inodes[64];
+    char name[20] = {'\0'};
+    char hitRate[16] = {'\0'};
+    double start = 0, writeNs = 0, readNs = 0, scanNs = 0;
+    long long hits = 0, lookups = 0, evictions = 0;
+    long long offset = 0;
+    int files = 64;
+    int fileSize = 4 * 1024 * 1024;
+    int hotFiles = 4;
+    int reads = 100000;
+    int fd = 0;
+    int i = 0;
+
+    startAuxillaryDataInitialization();
+    if(cacheBlocks > 0 && storageStart(cacheBlocks, bDirect) != EXECUTE_SUCCESS)
+    {
+        printf("%-14sstorage file not available\n", label);
+        return;
+    }
+
+    for(i = 0; i < (int)sizeof(buffer); i++)
+    {
+        buffer[i] = (char)benchRandom(&seed);
+    }
+
+    start = benchNow();
+    for(i = 0; i < files; i++)
+    {
+        snprintf(name, sizeof(name), "file%d", i);
+        fd = createFile(name, READ + WRITE);
+        for(offset = 0; offset < fileSize; offset = offset + sizeof(buffer))
+        {
+            writeFile(fd, buffer, sizeof(buffer));
+        }
+        closeFile(fd);
+
+        inodes[i] = lookupNameIndex(name);
+    }
+    writeNs = benchNow() - start;
+
+    hits = cacheobj.Hits;
+    lookups = cacheobj.Hits + cacheobj.Misses;
+    evictions = cacheobj.Evictions;
+
+    // Nine reads in ten go to the hot files, the rest anywhere
+    start = benchNow();
+    for(i = 0; i < reads; i++)
+    {
+        fd = (benchRandom(&seed) % 10 != 0) ? (int)(benchRandom(&seed) % hotFiles) : (int)(benchRandom(&seed) % files);
+        readInodeData(inodes[fd], buffer, (long long)(benchRandom(&seed) % (fileSize / BLOCKSIZE)) * BLOCKSIZE, BLOCKSIZE);
+    }
+    readNs = benchNow() - start;
+
+    hits = cacheobj.Hits - hits;
+    lookups = cacheobj.Hits + cacheobj.Misses - lookups;
+    evictions = cacheobj.Evictions - evictions;
+
+    start = benchNow();
+    for(i = 0; i < files; i++)
+    {
+        for(offset = 0; offset < fileSize; offset = offset + sizeof(buffer))
+        {
+            readInodeData(inodes[i], buffer, offset, sizeof(buffer));
+        }
+    }
+    scanNs = benchNow() - start;
+
+    snprintf(hitRate, sizeof(hitRate), "%.1f", (lookups > 0) ? hits * 100.0 / lookups : 0.0);
+
+    // Memory holds the data blocks, or only the buffer cache
+    printf("%-14s%-12.1f%-14.1f%-12.2f%-10s%-12lld%-14.1f\n", label, (blockarena.InUse + cacheBlocks) * (double)BLOCKSIZE / (1024 * 1024),
+           (double)files * fileSize / (1024 * 1024) / (writeNs / 1e9), readNs / reads / 1e3,
+           (cacheBlocks > 0) ? hitRate : "-", evictions, (double)files * fileSize / (1024 * 1024) / (scanNs / 1e9));
+
+    benchUnlinkAll();
+    storageStop();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchStorage()
+//  Description:           Shows that a buffer cache smaller than the data set serves a hot working set
+//                         almost as fast as memory, while only the cache is held in memory
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchStorage()
+{
+    printf("\n[ storage ] 256 MB in 64 files, 100000 random 4 KB reads (90%% from 16 MB), then one scan\n");
+    printf("%-14s%-12s%-14s%-12s%-10s%-12s%-14s\n", "Mode", "Memory MB", "Write MB/s", "Read us", "Hit %", "Evictions", "Scan MB/s");
+
+    benchStorageRun("memory", 0, false);
+    benchStorageRun("disk 32 MB", 8192, false);
+    benchStorageRun("direct 32 MB", 8192, true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchStreamDevice()
+//  Description:           Writes and reads a host file in 1 MB requests: the bandwidth the storage file
+//                         can give at best
+//  Input:                 Label printed in the result row, size in bytes, O_DIRECT
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchStreamDevice(const char *label, long long size, bool bDirect)
+{
+    char *buffer = NULL;
+    double start = 0, writeNs = 0, readNs = 0;
+    long long offset = 0;
+    int chunk = 1024 * 1024;
+    int fd = 0;
+
+    fd = open(STORAGE_FILE, O_RDWR | O_CREAT | O_TRUNC | ((bDirect == true) ? O_DIRECT : 0), 0644);
+    if(fd < 0 || posix_memalign((void **)&buffer, BLOCKSIZE, chunk) != 0)
+    {
+        printf("%-18sstorage file not available\n", label);
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        return;
+    }
+    memset(buffer, 'd', chunk);
+
+    start = benchNow();
+    for(offset = 0; offset < size; offset = offset + chunk)
+    {
+        pwrite(fd, buffer, chunk, offset);
+    }
+    writeNs = benchNow() - start;
+
+    start = benchNow();
+    for(offset = 0; offset < size; offset = offset + chunk)
+    {
+        pread(fd, buffer, chunk, offset);
+    }
+    readNs = benchNow() - start;
+
+    printf("%-18s%-12.1f%-12.1f%-14s%-12lld%-12lld\n", label, size / (1024.0 * 1024) / (writeNs / 1e9),
+           size / (1024.0 * 1024) / (readNs / 1e9), "-", size / chunk, size / chunk);
+
+    close(fd);
+    unlink(STORAGE_FILE);
+    free(buffer);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchStreamRun()
+//  Description:           Streams a file through one descriptor in small writeFile() and readFile()
+//                         calls with the data on disk. With O_DIRECT it then reads the file again
+//                         block by block straight from the inode, which gets no read-ahead.
+//  Input:                 Label printed in the result row, size in bytes, buffer cache blocks, O_DIRECT
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchStreamRun(const char *label, long long size, long long cacheBlocks, bool bDirect)
+{
+    static char buffer[BLOCKSIZE];
+    PINODE inode = NULL;
+    char noReadAhead[16] = "-";
+    double start = 0, writeNs = 0, readNs = 0, blockNs = 0;
+    long long offset = 0;
+    long long writes = 0, reads = 0;
+    int fd = 0;
+
+    startAuxillaryDataInitialization();
+    if(storageStart(cacheBlocks, bDirect) != EXECUTE_SUCCESS)
+    {
+        printf("%-18sstorage file not available\n", label);
+        return;
+    }
+
+    memset(buffer, 's', sizeof(buffer));
+
+    start = benchNow();
+    fd = createFile("stream", READ + WRITE);
+    for(offset = 0; offset < size; offset = offset + 1024)
+    {
+        writeFile(fd, buffer, 1024);
+    }
+    closeFile(fd);
+    writeNs = benchNow() - start;
+
+    writes = deviceobj.Writes;
+    reads = deviceobj.Reads;
+
+    start = benchNow();
+    fd = openFile("stream", READ);
+    for(offset = 0; offset < size; offset = offset + BLOCKSIZE)
+    {
+        readFile(fd, buffer, BLOCKSIZE);
+    }
+    closeFile(fd);
+    readNs = benchNow() - start;
+
+    reads = deviceobj.Reads - reads;
+
+    // Buffered reads of the storage file are read ahead by the host kernel as well, only O_DIRECT shows ours
+    if(bDirect == true)
+    {
+        inode = lookupNameIndex("stream");
+        start = benchNow();
+        for(offset = 0; offset < size; offset = offset + BLOCKSIZE)
+        {
+            readInodeData(inode, buffer, offset, BLOCKSIZE);
+        }
+        blockNs = benchNow() - start;
+
+        snprintf(noReadAhead, sizeof(noReadAhead), "%.1f", size / (1024.0 * 1024) / (blockNs / 1e9));
+    }
+
+    printf("%-18s%-12.1f%-12.1f%-14s%-12lld%-12lld\n", label, size / (1024.0 * 1024) / (writeNs / 1e9),
+           size / (1024.0 * 1024) / (readNs / 1e9), noReadAhead, writes, reads);
+
+    benchUnlinkAll();
+    storageStop();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchStream()
+//  Description:           Shows that read-ahead and the background flusher turn small sequential
+//                         reads and writes into large device requests, near the bandwidth of the
+//                         storage file itself. The pass without read-ahead runs with O_DIRECT only:
+//                         buffered reads of the storage file are read ahead by the host kernel too,
+//                         so there it showed no gain, even with the file dropped from the host page
+//                         cache before each pass.
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchStream()
+{
+    long long size = 64LL * 1024 * 1024;
+
+    printf("\n[ stream ] 64 MB through one descriptor in 1 KB writes and 4 KB reads, 16 MB buffer cache\n");
+    printf("%-18s%-12s%-12s%-14s%-12s%-12s\n", "Mode", "Write MB/s", "Read MB/s", "No RA MB/s", "Dev writes", "Dev reads");
+
+    benchStreamDevice("device 1 MB I/O", size, false);
+    benchStreamRun("disk", size, 4096, false);
+    benchStreamDevice("device O_DIRECT", size, true);
+    benchStreamRun("direct", size, 4096, true);
+
+    printf("No RA: the same reads without read-ahead, measured with O_DIRECT only. Buffered reads of the storage\n"
+           "file are read ahead by the host kernel too, so 4 KB device reads cost about as much as large ones.\n");
+}
+
+struct BenchThread
+{
+    pthread_t Thread;
+    int Kind;                                           /* 0 = shared reads, 1 = private writes, 2 = create/unlink, 3 = private reads, 4 = lookups */
+    int Id;
+    int Fd;
+    int Ops;
+    long long Blocks;                                   /* Blocks in the file the thread reads or writes */
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchThreadWorker()
+//  Description:           Body of one stress thread: random 4 KB preads of the shared file or of its
+//                         own file, 4 KB pwrites of its own file, create / close / unlink of its own
+//                         names, or name lookups of the existing files
+//  Input:                 BENCHTHREAD of the thread
+//  Output:                NULL
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void *benchThreadWorker(void *arg)
+{
+    struct BenchThread *bench = (struct BenchThread *)arg;
+    char buffer[BLOCKSIZE];
+    char name[20] = {'\0'};
+    unsigned int seed = 2022 + bench -> Id;
+    int fd = 0;
+    int i = 0;
+
+    memset(buffer, 'a' + bench -> Id, sizeof(buffer));
+
+    for(i = 0; i < bench -> Ops; i++)
+    {
+        if(bench -> Kind == 0 || bench -> Kind == 3)
+        {
+            preadFile(bench -> Fd, buffer, BLOCKSIZE, (long long)(benchRandom(&seed) % bench -> Blocks) * BLOCKSIZE);
+        }
+        else if(bench -> Kind == 1)
+        {
+            pwriteFile(bench -> Fd, buffer, BLOCKSIZE, (long long)(benchRandom(&seed) % bench -> Blocks) * BLOCKSIZE);
+        }
+        else if(bench -> Kind == 4)
+        {
+            snprintf(name, sizeof(name), "private%u", benchRandom(&seed) % 8);
+            lookupNameIndex(name);
+        }
+        else
+        {
+            snprintf(name, sizeof(name), "t%d_%d", bench -> Id, i % 64);
+            fd = createFile(name, READ + WRITE);
+            if(fd >= 0)
+            {
+                closeFile(fd);
+            }
+            unlinkFile(name);
+        }
+    }
+
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchThreadsRun()
+//  Description:           Runs one kind of stress work on a number of threads and returns the
+//                         operations per second of all threads together
+//  Input:                 Kind of work, number of threads, operations per thread, blocks per file
+//  Output:                Operations per second
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double benchThreadsRun(int kind, int threads, int ops, long long blocks)
+{
+    struct BenchThread bench[8];
+    char name[20] = {'\0'};
+    double start = 0, elapsed = 0;
+    int i = 0;
+
+    // Every reader opens the shared file through its own descriptor, every writer and private reader has its own file
+    for(i = 0; i < threads; i++)
+    {
+        bench[i].Kind = kind;
+        bench[i].Id = i;
+        bench[i].Ops = ops;
+        bench[i].Blocks = blocks;
+        bench[i].Fd = -1;
+
+        snprintf(name, sizeof(name), "private%d", i);
+        if(kind == 0)
+        {
+            bench[i].Fd = openFile("shared", READ);
+        }
+        else if(kind == 1)
+        {
+            bench[i].Fd = openFile(name, READ + WRITE);
+        }
+        else if(kind == 3)
+        {
+            bench[i].Fd = openFile(name, READ);
+        }
+    }
+
+    start = benchNow();
+    for(i = 0; i < threads; i++)
+    {
+        pthread_create(&bench[i].Thread, NULL, benchThreadWorker, &bench[i]);
+    }
+    for(i = 0; i < threads; i++)
+    {
+        pthread_join(bench[i].Thread, NULL);
+    }
+    elapsed = benchNow() - start;
+
+    for(i = 0; i < threads; i++)
+    {
+        if(bench[i].Fd >= 0)
+        {
+            closeFile(bench[i].Fd);
+        }
+    }
+
+    return (double)threads * ops / (elapsed / 1e9);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchThreadsDisk()
+//  Description:           Shows that in disk mode readers of different files overlap their cache
+//                         misses, as the buffer cache lock is not held while a block is read from the
+//                         storage file. O_DIRECT and a 1 MB cache make nearly every read a device read,
+//                         so the host page cache does not hide them; with the lock held across the
+//                         read, 1/2/4/8 threads gave 133/110/106/118 MB/s here, and 157/226/295/382
+//                         MB/s without it.
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchThreadsDisk()
+{
+    static char buffer[BLOCKSIZE];
+    char name[20] = {'\0'};
+    long long blocks = 2048;
+    long long misses = 0;
+    double reads = 0;
+    int threads = 0;
+    int fd = 0;
+    int i = 0, j = 0;
+
+    startAuxillaryDataInitialization();
+    if(storageStart(CACHE_MIN_BLOCKS * 4, true) != EXECUTE_SUCCESS)
+    {
+        printf("\n[ threads ] disk mode: storage file not available\n");
+        return;
+    }
+
+    // An 8 MB file per reader, 64 MB in all against a 1 MB buffer cache, so nearly every read misses
+    memset(buffer, 'x', sizeof(buffer));
+    for(i = 0; i < 8; i++)
+    {
+        snprintf(name, sizeof(name), "private%d", i);
+        fd = createFile(name, READ + WRITE);
+        for(j = 0; j < blocks; j++)
+        {
+            writeFile(fd, buffer, BLOCKSIZE);
+        }
+        closeFile(fd);
+    }
+
+    printf("\n[ threads ] disk mode, O_DIRECT: 4 KB preads of an 8 MB file per thread, %d KB buffer cache\n",
+           cacheobj.Capacity * BLOCKSIZE / 1024);
+    printf("%-10s%-16s%-16s\n", "Threads", "Read MB/s", "Miss %");
+
+    for(threads = 1; threads <= 8; threads = threads * 2)
+    {
+        misses = cacheobj.Misses;
+        reads = benchThreadsRun(3, threads, 4000, blocks);
+        misses = cacheobj.Misses - misses;
+
+        printf("%-10d%-16.1f%-16.1f\n", threads, reads * BLOCKSIZE / (1024.0 * 1024), misses * 100.0 / (threads * 4000.0));
+    }
+
+    benchUnlinkAll();
+    storageStop();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchThreads()
+//  Description:           Shows how the file calls scale with threads: readers of one file share its
+//                         inode lock, writers of different files take different inode locks,
+//                         create / unlink meet at the name index and name lookups take no lock.
+//                         Then the same for readers in disk mode.
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchThreads()
+{
+    static char buffer[BLOCKSIZE];
+    char name[20] = {'\0'};
+    long long blocks = 4096;
+    double reads = 0, writes = 0, creates = 0, lookups = 0;
+    int threads = 0;
+    int fd = 0;
+    int i = 0, j = 0;
+
+    startAuxillaryDataInitialization();
+
+    // One 16 MB file shared by the readers and a 16 MB file of each writer
+    memset(buffer, 'x', sizeof(buffer));
+    for(i = 0; i <= 8; i++)
+    {
+        if(i == 8)
+        {
+            strcpy(name, "shared");
+        }
+        else
+        {
+            snprintf(name, sizeof(name), "private%d", i);
+        }
+
+        fd = createFile(name, READ + WRITE);
+        for(j = 0; j < blocks; j++)
+        {
+            writeFile(fd, buffer, BLOCKSIZE);
+        }
+        closeFile(fd);
+    }
+
+    printf("\n[ threads ] 4 KB preads of one 16 MB file, 4 KB pwrites of a 16 MB file per thread, create/unlink, lookups, %ld cores\n",
+           sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%-10s%-16s%-16s%-16s%-16s\n", "Threads", "Read MB/s", "Write MB/s", "Create/unlink/s", "Lookup/s");
+
+    for(threads = 1; threads <= 8; threads = threads * 2)
+    {
+        reads = benchThreadsRun(0, threads, 200000, blocks);
+        writes = benchThreadsRun(1, threads, 50000, blocks);
+        creates = benchThreadsRun(2, threads, 50000, blocks);
+        lookups = benchThreadsRun(4, threads, 1000000, blocks);
+
+        printf("%-10d%-16.1f%-16.1f%-16.0f%-16.0f\n", threads, reads * BLOCKSIZE / (1024.0 * 1024),
+               writes * BLOCKSIZE / (1024.0 * 1024), creates, lookups);
+    }
+
+    benchUnlinkAll();
+    benchThreadsDisk();
+}
+
+struct BenchSession
+{
+    pthread_t Thread;
+    int First;                                          /* First client of the thread */
+    int Count;                                          /* Clients of the thread */
+    int Opens;                                          /* Descriptors each client opens */
+    bool bClose;                                        /* Close the clients instead of opening */
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchSessionWorker()
+//  Description:           Creates a range of client sessions and opens the shared files in each of them
+//                         until it holds the given number of descriptors, or closes the sessions again
+//  Input:                 BENCHSESSION of the thread
+//  Output:                NULL
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void *benchSessionWorker(void *arg)
+{
+    struct BenchSession *bench = (struct BenchSession *)arg;
+    char name[20] = {'\0'};
+    int i = 0, j = 0;
+
+    for(i = bench -> First; i < bench -> First + bench -> Count; i++)
+    {
+        snprintf(name, sizeof(name), "client%d", i);
+
+        if(bench -> bClose == true)
+        {
+            closeSession(findSession(name));
+            continue;
+        }
+
+        setSession(createSession(name));
+        for(j = 0; j < bench -> Opens; j++)
+        {
+            snprintf(name, sizeof(name), "shared%d", j % 64);
+            openFile(name, READ);
+        }
+    }
+
+    setSession(NULL);
+
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchSessionsRun()
+//  Description:           Opens the descriptors of every client on 4 threads, checks the reference
+//                         counts of the shared files and closes the clients again
+//  Input:                 Number of clients, descriptors per client
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchSessionsRun(int clients, int opens)
+{
+    struct BenchSession bench[4];
+    char name[20] = {'\0'};
+    double start = 0, openNs = 0, closeNs = 0;
+    long long references = 0;
+    int threads = (clients < 4) ? clients : 4;
+    int i = 0, k = 0;
+
+    for(k = 0; k < 2; k++)
+    {
+        start = benchNow();
+        for(i = 0; i < threads; i++)
+        {
+            bench[i].First = clients * i / threads;
+            bench[i].Count = clients * (i + 1) / threads - bench[i].First;
+            bench[i].Opens = opens;
+            bench[i].bClose = (k == 1);
+            pthread_create(&bench[i].Thread, NULL, benchSessionWorker, &bench[i]);
+        }
+        for(i = 0; i < threads; i++)
+        {
+            pthread_join(bench[i].Thread, NULL);
+        }
+
+        if(k == 0)
+        {
+            openNs = benchNow() - start;
+
+            // Every descriptor of every client counts on its file
+            for(i = 0; i < 64; i++)
+            {
+                snprintf(name, sizeof(name), "shared%d", i);
+                references = references + lookupNameIndex(name) -> ReferenceCount;
+            }
+        }
+        else
+        {
+            closeNs = benchNow() - start;
+        }
+    }
+
+    printf("%-10d%-14d%-16.0f%-16.0f%-14s\n", clients, opens, (double)clients * opens / (openNs / 1e9),
+           (double)clients * opens / (closeNs / 1e9), (references == (long long)clients * opens) ? "ok" : "WRONG");
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchSessions()
+//  Description:           Shows many client sessions holding thousands of descriptors each over the same
+//                         files: open and close rates and the reference counts across sessions
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchSessions()
+{
+    char name[20] = {'\0'};
+    int fd = 0;
+    int i = 0;
+
+    startAuxillaryDataInitialization();
+
+    for(i = 0; i < 64; i++)
+    {
+        snprintf(name, sizeof(name), "shared%d", i);
+        fd = createFile(name, READ + WRITE);
+        writeFile(fd, name, (int)strlen(name));
+        closeFile(fd);
+    }
+
+    printf("\n[ sessions ] client sessions opening 64 shared files over and over, 4 threads\n");
+    printf("%-10s%-14s%-16s%-16s%-14s\n", "Clients", "Fds/client", "Opens/s", "Closes/s", "RefCounts");
+
+    benchSessionsRun(1, 1000);
+    benchSessionsRun(10, 1000);
+    benchSessionsRun(100, 2000);
+    benchSessionsRun(400, 2000);
+
+    benchUnlinkAll();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         benchDescriptors()
+//  Description:           Fills the descriptor table of the shell session up to a million descriptors and
+//                         measures, at each size, closing a random descriptor and opening again (which
+//                         must hand back the same, lowest free, descriptor), over the whole table and
+//                         over its lowest 1000 descriptors, next to a scan of the table for its lowest
+//                         free slot, as allocation used to do
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void benchDescriptors()
+{
+    int sizes[] = {1000, 10000, 100000, 1000000};
+    double start = 0, fillNs = 0, churnNs = 0, lowNs = 0, scanNs = 0;
+    unsigned int seed = 1;
+    int churns = 200000;
+    int scans = 0;
+    int found = 0;
+    PFILETABLE saved = NULL;
+    int opened = 0;
+    int fd = 0, slot = 0;
+    int i = 0, j = 0;
+    bool bLowest = true;
+
+    startAuxillaryDataInitialization();
+
+    fd = createFile("descriptors", READ + WRITE);
+    closeFile(fd);
+
+    printf("\n[ descriptors ] open/close on one growing descriptor table (lowest free fd)\n");
+    printf("%-12s%-16s%-18s%-18s%-18s%-10s\n", "Fds open", "Fill opens/s", "Close+open ns", "Lowest 1000 ns",
+           "Linear scan ns", "Lowest");
+
+    for(i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+    {
+        start = benchNow();
+        for(; opened < sizes[i]; opened++)
+        {
+            openFile("descriptors", READ);
+        }
+        fillNs = benchNow() - start;
+
+        // Closing any descriptor makes it the lowest free one, the next open takes it back
+        bLowest = true;
+        start = benchNow();
+        for(j = 0; j < churns; j++)
+        {
+            fd = 3 + (int)(rand_r(&seed) % sizes[i]);
+            closeFile(fd);
+            if(openFile("descriptors", READ) != fd)
+            {
+                bLowest = false;
+            }
+        }
+        churnNs = (benchNow() - start) / churns;
+
+        // The same on the lowest 1000 descriptors only: the cost of the table size, not of cache misses
+        start = benchNow();
+        for(j = 0; j < churns; j++)
+        {
+            fd = 3 + (int)(rand_r(&seed) % 1000);
+            closeFile(fd);
+            if(openFile("descriptors", READ) != fd)
+            {
+                bLowest = false;
+            }
+        }
+        lowNs = (benchNow() - start) / churns;
+
+        // What finding that slot cost with a scan from 3
+        scans = (sizes[i] > 100000) ? 200 : 2000;
+        found = 0;
+        start = benchNow();
+        for(j = 0; j < scans; j++)
+        {
+            fd = 3 + (int)(rand_r(&seed) % sizes[i]);
+            saved = uareaobj.UFDT[fd];
+            uareaobj.UFDT[fd] = NULL;
+            for(slot = 3; uareaobj.UFDT[slot] != NULL; slot++)
+            {
+            }
+            found += (slot == fd);
+            uareaobj.UFDT[fd] = saved;
+        }
+        scanNs = (benchNow() - start) / scans;
+
+        printf("%-12d%-16.0f%-18.0f%-18.0f%-18.0f%-10s\n", sizes[i], (double)sizes[i] / (fillNs / 1e9), churnNs, lowNs,
+               scanNs, (bLowest == true && found == scans) ? "ok" : "WRONG");
+    }
+
+    benchUnlinkAll();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//                                          ENTRY POINT OF BENCHMARK
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Benchmark
+{
+    const char *Name;
+    void (*Run)();
+};
+
+static struct Benchmark benchmarks[] =
+{
+    {"lookup", benchLookup},
+    {"alloc", benchAlloc},
+    {"writev", benchVectored},
+    {"copy", benchCopy},
+    {"backup", benchBackup},
+    {"restore", benchRestore},
+    {"compress", benchCompress},
+    {"checksum", benchChecksum},
+    {"single", benchSingle},
+    {"parallel", benchParallel},
+    {"incremental", benchIncremental},
+    {"journal", benchJournal},
+    {"snapshot", benchSnapshot},
+    {"storage", benchStorage},
+    {"stream", benchStream},
+    {"threads", benchThreads},
+    {"sessions", benchSessions},
+    {"descriptors", benchDescriptors},
+};
+
+int main(int argc, char *argv[])
+{
+    int count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+    int i = 0, j = 0;
+    bool bFound = false;
+
+    // Without arguments every benchmark is run
+    if(argc < 2)
+    {
+        for(i = 0; i < count; i++)
+        {
+            benchmarks[i].Run();
+        }
+        return 0;
+    }
+
+    for(j = 1; j < argc; j++)
+    {
+        bFound = false;
+        for(i = 0; i < count; i++)
+        {
+            if(strcmp(argv[j], benchmarks[i].Name) == 0)
+            {
+                benchmarks[i].Run();
+                bFound = true;
+            }
+        }
+
+        if(bFound == false)
+        {
+            printf("Unknown benchmark '%s'.\n", argv[j]);
+        }
+    }
+
+    return 0;
+}
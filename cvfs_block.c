@@ -0,0 +1,1161 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  File Name:             cvfs_block.c
+//  Description:           File data layer: reference counted data blocks and block maps with
+//                         copy-on-write, and the byte level read/write helpers built on them.
+//                         Block data is only touched while pinned (disk blocks live in the cache).
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "cvfs.h"
+
+bool bBlockChecksums = true;                                    /* Keep the checksums of backed up blocks for scrub */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         allocDataBlock()
+//  Description:           Allocates a data block descriptor together with its BLOCKSIZE data, in
+//                         memory or (disk mode) in the storage file
+//  Input:                 void
+//  Output:                Block descriptor (reference count 1) or NULL
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PDATABLOCK allocDataBlock()
+{
+    PDATABLOCK block = NULL;
+
+    block = (PDATABLOCK)allocObject(sizeof(DATABLOCK));
+    if(block == NULL)
+    {
+        return NULL;
+    }
+
+    block -> Data = NULL;
+    block -> Buffer = NULL;
+    block -> DiskBlock = -1;
+
+    if(deviceobj.bEnabled == true)
+    {
+        initDiskBlock(block);
+    }
+    else
+    {
+        block -> Data = allocBlock();
+        if(block -> Data == NULL)
+        {
+            freeObject(block, sizeof(DATABLOCK));
+            return NULL;
+        }
+    }
+
+    block -> RefCount = 1;
+    block -> Map = NULL;
+    block -> Generation = superobj.Generation;
+    block -> ChecksumSize = 0;
+
+    return block;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         holdDataBlock()
+//  Description:           Takes an additional reference on a data block
+//  Input:                 Block descriptor
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void holdDataBlock(PDATABLOCK block)
+{
+    __atomic_add_fetch(&block -> RefCount, 1, __ATOMIC_RELAXED);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         putDataBlock()
+//  Description:           Drops a reference on a data block, the last reference frees it
+//  Input:                 Block descriptor
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void putDataBlock(PDATABLOCK block)
+{
+    if(block == NULL)
+    {
+        return;
+    }
+
+    // Readers of different files holding views on a shared block drop it side by side
+    if(__atomic_sub_fetch(&block -> RefCount, 1, __ATOMIC_ACQ_REL) > 0)
+    {
+        return;
+    }
+
+    if(block -> Map == NULL && block -> Data == NULL)
+    {
+        dropDiskBlock(block);
+    }
+    else if(block -> Map == NULL)
+    {
+        freeBlock(block -> Data);
+    }
+    else
+    {
+        // The mapping goes away with the last block that still reads from it
+        __atomic_sub_fetch(&superobj.MappedBlocks, 1, __ATOMIC_RELAXED);
+        if(__atomic_sub_fetch(&block -> Map -> Blocks, 1, __ATOMIC_ACQ_REL) == 0)
+        {
+            munmap(block -> Map -> Base, block -> Map -> Length);
+            free(block -> Map);
+        }
+    }
+
+    freeObject(block, sizeof(DATABLOCK));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         holdBlockMap()
+//  Description:           Takes another reference on a block map (a backup snapshot holds the maps of
+//                         the files it stores, so writes to those files copy the map and the blocks)
+//  Input:                 Block map, NULL for a file without data
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void holdBlockMap(PBLOCKMAP map)
+{
+    if(map != NULL)
+    {
+        __atomic_add_fetch(&map -> RefCount, 1, __ATOMIC_RELAXED);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         putBlockMap()
+//  Description:           Drops a reference on a block map, the last reference releases every block
+//  Input:                 Block map
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void putBlockMap(PBLOCKMAP map)
+{
+    int i = 0;
+
+    if(map == NULL)
+    {
+        return;
+    }
+
+    if(__atomic_sub_fetch(&map -> RefCount, 1, __ATOMIC_ACQ_REL) > 0)
+    {
+        return;
+    }
+
+    for(i = 0; i < map -> Count; i++)
+    {
+        putDataBlock(map -> Blocks[i]);
+    }
+
+    free(map);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getPrivateBlockMap()
+//  Description:           Makes sure the inode owns its block map alone and that the map can hold
+//                         the given number of blocks. A shared map is copied first: the copy takes
+//                         its own reference on every block, the blocks themselves are not copied.
+//  Input:                 Inode pointer, number of block entries needed
+//  Output:                Block map or NULL if memory is exhausted
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PBLOCKMAP getPrivateBlockMap(PINODE inode, int entries)
+{
+    PBLOCKMAP map = inode -> BlockMap;
+    PBLOCKMAP newMap = NULL;
+    bool bPrivate = false;
+    int capacity = 4;
+    int i = 0;
+
+    // Only files sharing the map drop references to it meanwhile, a private map stays private
+    if(map != NULL)
+    {
+        bPrivate = (__atomic_load_n(&map -> RefCount, __ATOMIC_ACQUIRE) == 1);
+    }
+
+    if(bPrivate == true && map -> Capacity >= entries)
+    {
+        return map;
+    }
+
+    // Grow by doubling, only block pointers are moved, never the data
+    if(map != NULL)
+    {
+        capacity = map -> Capacity;
+    }
+    while(capacity < entries)
+    {
+        capacity = capacity * 2;
+    }
+
+    if(bPrivate == true)
+    {
+        newMap = (PBLOCKMAP)realloc(map, sizeof(BLOCKMAP) + sizeof(PDATABLOCK) * capacity);
+        if(newMap == NULL)
+        {
+            return NULL;
+        }
+
+        memset(newMap -> Blocks + newMap -> Capacity, 0, sizeof(PDATABLOCK) * (capacity - newMap -> Capacity));
+        newMap -> Capacity = capacity;
+    }
+    else
+    {
+        newMap = (PBLOCKMAP)calloc(1, sizeof(BLOCKMAP) + sizeof(PDATABLOCK) * capacity);
+        if(newMap == NULL)
+        {
+            return NULL;
+        }
+
+        newMap -> RefCount = 1;
+        newMap -> Capacity = capacity;
+
+        // Unshare: this inode now references the blocks through its own map
+        if(map != NULL)
+        {
+            newMap -> Count = map -> Count;
+            for(i = 0; i < map -> Count; i++)
+            {
+                newMap -> Blocks[i] = map -> Blocks[i];
+                if(newMap -> Blocks[i] != NULL)
+                {
+                    holdDataBlock(newMap -> Blocks[i]);
+                }
+            }
+            putBlockMap(map);
+        }
+    }
+
+    inode -> BlockMap = newMap;
+
+    return newMap;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getInodeBlockCount()
+//  Description:           Returns the number of block entries covering the file (including holes)
+//  Input:                 Inode pointer
+//  Output:                Number of entries
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int getInodeBlockCount(PINODE inode)
+{
+    if(inode -> BlockMap == NULL)
+    {
+        return 0;
+    }
+
+    return inode -> BlockMap -> Count;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getInodeBlock()
+//  Description:           Returns a block of a file for reading, the block may be shared. Its data
+//                         is read through pinDataBlock().
+//  Input:                 Inode pointer, block index
+//  Output:                Block descriptor or NULL for a hole
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PDATABLOCK getInodeBlock(PINODE inode, int blockIndex)
+{
+    if(inode -> BlockMap == NULL || blockIndex >= inode -> BlockMap -> Count)
+    {
+        return NULL;
+    }
+
+    return inode -> BlockMap -> Blocks[blockIndex];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         pinDataBlock()
+//  Description:           Returns the data of a block, which stays where it is until unpinDataBlock().
+//                         Memory and mapped blocks always are, a disk block is brought into the cache.
+//  Input:                 Block descriptor
+//  Output:                Block data or NULL if the cache could not take the block
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+char *pinDataBlock(PDATABLOCK block)
+{
+    if(block -> Data != NULL)
+    {
+        return block -> Data;
+    }
+
+    return pinDiskBlock(block);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         unpinDataBlock()
+//  Description:           Ends a pinDataBlock(), the cache may evict a disk block once nobody pins it
+//  Input:                 Block descriptor, true if the data was changed
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void unpinDataBlock(PDATABLOCK block, bool bDirty)
+{
+    if(block -> Data == NULL)
+    {
+        unpinDiskBlock(block, bDirty);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getWritableBlock()
+//  Description:           Returns the data block with the given index for writing. The block map is
+//                         unshared and grown as needed, a hole gets a new block (not zeroed) and a
+//                         block shared with another file or still mapped from a backup image is
+//                         copied first (copy-on-write).
+//  Input:                 Inode pointer, block index, set to true when the block was just allocated
+//  Output:                Block descriptor (to pin) or NULL if memory is exhausted
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PDATABLOCK getWritableBlock(PINODE inode, int blockIndex, bool *bFresh)
+{
+    PBLOCKMAP map = NULL;
+    PDATABLOCK block = NULL;
+    PDATABLOCK copy = NULL;
+    char *source = NULL;
+    char *dest = NULL;
+    long long live = 0;
+
+    *bFresh = false;
+
+    map = getPrivateBlockMap(inode, blockIndex + 1);
+    if(map == NULL)
+    {
+        return NULL;
+    }
+
+    if(blockIndex >= map -> Count)
+    {
+        map -> Count = blockIndex + 1;
+    }
+
+    block = map -> Blocks[blockIndex];
+
+    // Allocate the block on first use
+    if(block == NULL)
+    {
+        block = allocDataBlock();
+        if(block == NULL)
+        {
+            return NULL;
+        }
+
+        map -> Blocks[blockIndex] = block;
+        inode -> FileSize = inode -> FileSize + BLOCKSIZE;
+        __atomic_add_fetch(&superobj.LogicalBlocks, 1, __ATOMIC_RELAXED);
+        *bFresh = true;
+    }
+
+    // Another file still references this block or it is read-only image data,
+    // take a private copy of its live bytes
+    else if(__atomic_load_n(&block -> RefCount, __ATOMIC_ACQUIRE) > 1 || block -> Map != NULL)
+    {
+        copy = allocDataBlock();
+        if(copy == NULL)
+        {
+            return NULL;
+        }
+
+        live = inode -> ActualFileSize - (long long)blockIndex * BLOCKSIZE;
+        if(live > BLOCKSIZE)
+        {
+            live = BLOCKSIZE;
+        }
+        if(live > 0)
+        {
+            source = pinDataBlock(block);
+            dest = pinDataBlock(copy);
+            if(source != NULL && dest != NULL)
+            {
+                memcpy(dest, source, (size_t)live);
+            }
+            if(source != NULL)
+            {
+                unpinDataBlock(block, false);
+            }
+            if(dest != NULL)
+            {
+                unpinDataBlock(copy, true);
+            }
+            if(source == NULL || dest == NULL)
+            {
+                putDataBlock(copy);
+                return NULL;
+            }
+        }
+
+        putDataBlock(block);
+        map -> Blocks[blockIndex] = copy;
+        block = copy;
+        __atomic_add_fetch(&superobj.CopiedBlocks, 1, __ATOMIC_RELAXED);
+    }
+
+    // The next incremental backup picks up this block and the file, its checksum is gone
+    block -> Generation = superobj.Generation;
+    block -> ChecksumSize = 0;
+    inode -> Generation = superobj.Generation;
+
+    return block;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         zeroInodeRange()
+//  Description:           Clears a byte range of a file in the blocks that exist, holes are left alone
+//  Input:                 Inode pointer, start offset, end offset (exclusive)
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void zeroInodeRange(PINODE inode, long long start, long long end)
+{
+    PDATABLOCK block = NULL;
+    char *data = NULL;
+    bool bFresh = false;
+    int blockIndex = 0;
+    int blockOffset = 0;
+    int chunk = 0;
+
+    while(start < end)
+    {
+        blockIndex = (int)(start / BLOCKSIZE);
+        blockOffset = (int)(start % BLOCKSIZE);
+        chunk = BLOCKSIZE - blockOffset;
+        if(chunk > end - start)
+        {
+            chunk = (int)(end - start);
+        }
+
+        if(blockIndex >= getInodeBlockCount(inode))
+        {
+            break;
+        }
+
+        if(getInodeBlock(inode, blockIndex) != NULL)
+        {
+            block = getWritableBlock(inode, blockIndex, &bFresh);
+            data = (block != NULL) ? pinDataBlock(block) : NULL;
+            if(data != NULL)
+            {
+                memset(data + blockOffset, 0, chunk);
+                unpinDataBlock(block, true);
+            }
+        }
+
+        start = start + chunk;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         writevInodeData()
+//  Description:           Copies several buffers back to back into the blocks of a file starting at
+//                         the given offset and extends ActualFileSize when writing past the end.
+//                         Each block is looked up once and filled from as many fragments as it takes.
+//                         Bytes of a block beyond ActualFileSize are undefined, so only the parts
+//                         that become visible inside the file are zeroed, never whole blocks.
+//  Input:                 Inode pointer, iovec array, number of fragments, file offset
+//  Output:                Number of bytes written or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int writevInodeData(PINODE inode, const struct iovec *iov, int iovcnt, long long offset)
+{
+    PDATABLOCK block = NULL;
+    char *data = NULL;
+    bool bFresh = false;
+    long long oldSize = inode -> ActualFileSize;
+    long long blockStart = 0;
+    long long tailEnd = 0;
+    long long size = 0;
+    long long done = 0;
+    size_t fragmentDone = 0;
+    int fragment = 0;
+    int chunk = 0;
+    int piece = 0;
+    int filled = 0;
+    int blockOffset = 0;
+    int i = 0;
+
+    for(i = 0; i < iovcnt; i++)
+    {
+        size = size + (long long)iov[i].iov_len;
+    }
+
+    if(offset < 0 || size > 0x7fffffff || offset + size > MAXFILESIZE)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    // Writing past the end leaves a gap that must read back as zeroes
+    if(offset > oldSize)
+    {
+        zeroInodeRange(inode, oldSize, offset);
+    }
+
+    while(done < size)
+    {
+        blockOffset = (int)((offset + done) % BLOCKSIZE);
+        blockStart = offset + done - blockOffset;
+        chunk = BLOCKSIZE - blockOffset;
+        if(chunk > size - done)
+        {
+            chunk = (int)(size - done);
+        }
+
+        block = getWritableBlock(inode, (int)((offset + done) / BLOCKSIZE), &bFresh);
+        data = (block != NULL) ? pinDataBlock(block) : NULL;
+        if(data == NULL)
+        {
+            break;
+        }
+
+        // A new block replaces a hole: zero only the parts of it that lie inside the file
+        if(bFresh == true)
+        {
+            memset(data, 0, blockOffset);
+
+            tailEnd = oldSize - blockStart;
+            if(tailEnd > BLOCKSIZE)
+            {
+                tailEnd = BLOCKSIZE;
+            }
+            if(tailEnd > blockOffset + chunk)
+            {
+                memset(data + blockOffset + chunk, 0, (size_t)(tailEnd - blockOffset - chunk));
+            }
+        }
+
+        // Fill this block from the fragments, a fragment may end or start inside it
+        filled = 0;
+        while(filled < chunk)
+        {
+            piece = chunk - filled;
+            if((size_t)piece > iov[fragment].iov_len - fragmentDone)
+            {
+                piece = (int)(iov[fragment].iov_len - fragmentDone);
+            }
+
+            memcpy(data + blockOffset + filled, (const char *)iov[fragment].iov_base + fragmentDone, piece);
+            filled = filled + piece;
+            fragmentDone = fragmentDone + piece;
+
+            if(fragmentDone == iov[fragment].iov_len)
+            {
+                fragment++;
+                fragmentDone = 0;
+            }
+        }
+
+        unpinDataBlock(block, true);
+        done = done + chunk;
+    }
+
+    // Nothing could be stored at all
+    if(done == 0 && size > 0)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    if(offset + done > inode -> ActualFileSize)
+    {
+        inode -> ActualFileSize = offset + done;
+    }
+
+    return (int)done;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         writeInodeData()
+//  Description:           Copies one buffer into the blocks of a file starting at the given offset
+//  Input:                 Inode pointer, data, file offset, number of bytes
+//  Output:                Number of bytes written or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int writeInodeData(PINODE inode, const void *data, long long offset, int size)
+{
+    struct iovec iov;
+
+    if(size < 0)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    iov.iov_base = (void *)data;
+    iov.iov_len = (size_t)size;
+
+    return writevInodeData(inode, &iov, 1, offset);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         readInodeData()
+//  Description:           Copies data out of the blocks of a file, holes read back as zeroes
+//  Input:                 Inode pointer, output buffer, file offset, number of bytes
+//  Output:                Number of bytes read (short only if the buffer cache runs out of memory)
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int readInodeData(PINODE inode, void *data, long long offset, int size)
+{
+    PDATABLOCK block = NULL;
+    char *blockData = NULL;
+    int done = 0;
+    int chunk = 0;
+    int blockOffset = 0;
+
+    // Never read past the end of the file
+    if(offset >= inode -> ActualFileSize)
+    {
+        return 0;
+    }
+
+    if(size > inode -> ActualFileSize - offset)
+    {
+        size = (int)(inode -> ActualFileSize - offset);
+    }
+
+    while(done < size)
+    {
+        blockOffset = (int)((offset + done) % BLOCKSIZE);
+        chunk = BLOCKSIZE - blockOffset;
+        if(chunk > size - done)
+        {
+            chunk = size - done;
+        }
+
+        block = getInodeBlock(inode, (int)((offset + done) / BLOCKSIZE));
+        if(block != NULL)
+        {
+            // The cache could not take the block, the read ends short
+            blockData = pinDataBlock(block);
+            if(blockData == NULL)
+            {
+                break;
+            }
+
+            memcpy((char *)data + done, blockData + blockOffset, chunk);
+            unpinDataBlock(block, false);
+        }
+        else
+        {
+            memset((char *)data + done, 0, chunk);
+        }
+
+        done = done + chunk;
+    }
+
+    return done;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         shareInodeBlocks()
+//  Description:           Makes the destination file reference the data of the source file.
+//                         Both inodes share one block map until either of them writes (O(1)).
+//  Input:                 Destination inode, source inode
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void shareInodeBlocks(PINODE dest, PINODE src)
+{
+    freeInodeBlocks(dest);
+
+    dest -> BlockMap = src -> BlockMap;
+    if(dest -> BlockMap != NULL)
+    {
+        holdBlockMap(dest -> BlockMap);
+    }
+
+    dest -> FileSize = src -> FileSize;
+    dest -> ActualFileSize = src -> ActualFileSize;
+
+    __atomic_add_fetch(&superobj.LogicalBlocks, dest -> FileSize / BLOCKSIZE, __ATOMIC_RELAXED);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         freeInodeBlocks()
+//  Description:           Drops the reference of a file on its block map (and so on its blocks)
+//  Input:                 Inode pointer
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void freeInodeBlocks(PINODE inode)
+{
+    putBlockMap(inode -> BlockMap);
+
+    __atomic_sub_fetch(&superobj.LogicalBlocks, inode -> FileSize / BLOCKSIZE, __ATOMIC_RELAXED);
+
+    inode -> BlockMap = NULL;
+    inode -> FileSize = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         viewInodeData()
+//  Description:           Builds a read view over a byte range of a file: one segment per block that
+//                         points straight into the block data, holes point to a shared zero block.
+//                         Every block in the view is pinned (referenced, and held in the cache), so a
+//                         later write to the file copies the block instead of changing it and
+//                         truncate/unlink can not free it until releaseReadView() is called.
+//  Input:                 Inode pointer, file offset, number of bytes, view to fill
+//  Output:                Number of bytes covered by the view (less than size at end of file) or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+long long viewInodeData(PINODE inode, long long offset, long long size, PREADVIEW view)
+{
+    static const char zeroBlock[BLOCKSIZE] = {'\0'};
+    PDATABLOCK block = NULL;
+    char *data = NULL;
+    long long done = 0;
+    int blockIndex = 0;
+    int blockOffset = 0;
+    int chunk = 0;
+    int maxSegments = 0;
+
+    memset(view, 0, sizeof(READVIEW));
+
+    if(offset < 0 || size < 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // Never look past the end of the file
+    if(offset >= inode -> ActualFileSize)
+    {
+        return 0;
+    }
+    if(size > inode -> ActualFileSize - offset)
+    {
+        size = inode -> ActualFileSize - offset;
+    }
+
+    maxSegments = (int)((offset % BLOCKSIZE + size + BLOCKSIZE - 1) / BLOCKSIZE);
+
+    view -> Segments = (PREADSEGMENT)malloc(sizeof(READSEGMENT) * maxSegments);
+    view -> Pinned = (PDATABLOCK *)malloc(sizeof(PDATABLOCK) * maxSegments);
+    if(view -> Segments == NULL || view -> Pinned == NULL)
+    {
+        releaseReadView(view);
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    while(done < size)
+    {
+        blockIndex = (int)((offset + done) / BLOCKSIZE);
+        blockOffset = (int)((offset + done) % BLOCKSIZE);
+        chunk = BLOCKSIZE - blockOffset;
+        if(chunk > size - done)
+        {
+            chunk = (int)(size - done);
+        }
+
+        block = getInodeBlock(inode, blockIndex);
+        if(block != NULL)
+        {
+            data = pinDataBlock(block);
+            if(data == NULL)
+            {
+                releaseReadView(view);
+                return ERR_INSUFFICIENT_SPACE;
+            }
+
+            holdDataBlock(block);
+            view -> Pinned[view -> PinnedCount] = block;
+            view -> PinnedCount++;
+            view -> Segments[view -> SegmentCount].Data = data + blockOffset;
+        }
+        else
+        {
+            view -> Segments[view -> SegmentCount].Data = zeroBlock + blockOffset;
+        }
+
+        view -> Segments[view -> SegmentCount].Length = chunk;
+        view -> SegmentCount++;
+
+        done = done + chunk;
+    }
+
+    view -> Length = done;
+
+    return done;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         releaseReadView()
+//  Description:           Unpins the blocks of a read view and frees its segment list
+//  Input:                 View
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void releaseReadView(PREADVIEW view)
+{
+    int i = 0;
+
+    for(i = 0; i < view -> PinnedCount; i++)
+    {
+        unpinDataBlock(view -> Pinned[i], false);
+        putDataBlock(view -> Pinned[i]);
+    }
+
+    free(view -> Segments);
+    free(view -> Pinned);
+
+    memset(view, 0, sizeof(READVIEW));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         mapInodeData()
+//  Description:           Gives an empty file the data stored in a mapped backup image: every block
+//                         points into the mapping and is copied only when the file writes to it
+//  Input:                 Inode pointer, mapping, offset of the file data in the mapping, file size
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int mapInodeData(PINODE inode, PIMAGEMAP map, long long offset, long long size)
+{
+    PBLOCKMAP blockMap = NULL;
+    PDATABLOCK block = NULL;
+    int entries = 0;
+    int i = 0;
+
+    if(size <= 0)
+    {
+        return EXECUTE_SUCCESS;
+    }
+
+    if(size > MAXFILESIZE || offset < 0 || offset + size > (long long)map -> Length)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    entries = (int)((size + BLOCKSIZE - 1) / BLOCKSIZE);
+
+    blockMap = getPrivateBlockMap(inode, entries);
+    if(blockMap == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    for(i = 0; i < entries; i++)
+    {
+        block = (PDATABLOCK)allocObject(sizeof(DATABLOCK));
+        if(block == NULL)
+        {
+            break;
+        }
+
+        block -> Data = map -> Base + offset + (long long)i * BLOCKSIZE;
+        block -> Buffer = NULL;
+        block -> DiskBlock = -1;
+        block -> RefCount = 1;
+        block -> Map = map;
+        block -> Generation = superobj.Generation;
+        block -> ChecksumSize = 0;
+
+        blockMap -> Blocks[i] = block;
+        map -> Blocks++;
+        superobj.MappedBlocks++;
+        superobj.LogicalBlocks++;
+        inode -> FileSize = inode -> FileSize + BLOCKSIZE;
+    }
+
+    blockMap -> Count = i;
+
+    // The last block may end inside the data of the next file, only ActualFileSize bytes are ever read
+    inode -> ActualFileSize = (long long)i * BLOCKSIZE;
+    if(inode -> ActualFileSize > size)
+    {
+        inode -> ActualFileSize = size;
+    }
+
+    return (i == entries) ? EXECUTE_SUCCESS : ERR_INSUFFICIENT_SPACE;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         mapInodeBlock()
+//  Description:           Replaces one block of a file with block data in a mapped backup image
+//                         (used when a delta segment is replayed)
+//  Input:                 Inode pointer, mapping, block index, block data inside the mapping
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int mapInodeBlock(PINODE inode, PIMAGEMAP map, int blockIndex, const char *data)
+{
+    PBLOCKMAP blockMap = NULL;
+    PDATABLOCK block = NULL;
+
+    blockMap = getPrivateBlockMap(inode, blockIndex + 1);
+    if(blockMap == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    block = (PDATABLOCK)allocObject(sizeof(DATABLOCK));
+    if(block == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    block -> Data = (char *)data;
+    block -> Buffer = NULL;
+    block -> DiskBlock = -1;
+    block -> RefCount = 1;
+    block -> Map = map;
+    block -> Generation = superobj.Generation;
+    block -> ChecksumSize = 0;
+
+    map -> Blocks++;
+    superobj.MappedBlocks++;
+
+    if(blockIndex >= blockMap -> Count)
+    {
+        blockMap -> Count = blockIndex + 1;
+    }
+
+    if(blockMap -> Blocks[blockIndex] != NULL)
+    {
+        putDataBlock(blockMap -> Blocks[blockIndex]);
+    }
+    else
+    {
+        superobj.LogicalBlocks++;
+        inode -> FileSize = inode -> FileSize + BLOCKSIZE;
+    }
+
+    blockMap -> Blocks[blockIndex] = block;
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         allocInodeBlock()
+//  Description:           Returns a private block of a file to be filled in directly (used when a
+//                         backup image is restored). The contents are not cleared.
+//  Input:                 Inode pointer, block index
+//  Output:                Block descriptor (to pin) or NULL if memory is exhausted
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PDATABLOCK allocInodeBlock(PINODE inode, int blockIndex)
+{
+    bool bFresh = false;
+
+    return getWritableBlock(inode, blockIndex, &bFresh);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         checksumInodeBlock()
+//  Description:           Computes the checksum of the first bytes of a block (a hole counts as
+//                         zeroes) and keeps it with the block for scrub. Called by the backup threads
+//                         on snapshot blocks, which nobody writes (writers copy them first).
+//  Input:                 Inode pointer, block index, bytes of the block inside the file
+//  Output:                Checksum
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int checksumInodeBlock(PINODE inode, int blockIndex, int size)
+{
+    PDATABLOCK block = NULL;
+    unsigned int checksum = 0;
+    char *data = NULL;
+
+    block = getInodeBlock(inode, blockIndex);
+    if(block == NULL)
+    {
+        return crc32cZeroes(size);
+    }
+
+    // A block the cache can not take gets no checksum (it reads as damaged in the image)
+    data = pinDataBlock(block);
+    if(data == NULL)
+    {
+        return ~crc32cZeroes(size);
+    }
+
+    checksum = crc32c(0, data, size);
+    unpinDataBlock(block, false);
+
+    // Shards written side by side may share a copied block, they store the same values
+    if(bBlockChecksums == true && size > 0)
+    {
+        __atomic_store_n(&block -> Checksum, checksum, __ATOMIC_RELAXED);
+        __atomic_store_n(&block -> ChecksumSize, size, __ATOMIC_RELAXED);
+    }
+
+    return checksum;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         setInodeBlockChecksum()
+//  Description:           Keeps the checksum a block has in the backup image (set after restore)
+//  Input:                 Inode pointer, block index, checksum, bytes it covers
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void setInodeBlockChecksum(PINODE inode, int blockIndex, unsigned int checksum, int size)
+{
+    PDATABLOCK block = NULL;
+
+    if(bBlockChecksums == false || size <= 0 || inode -> BlockMap == NULL || blockIndex >= inode -> BlockMap -> Count)
+    {
+        return;
+    }
+
+    block = inode -> BlockMap -> Blocks[blockIndex];
+    if(block != NULL)
+    {
+        block -> Checksum = checksum;
+        block -> ChecksumSize = size;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getCheckedBlock()
+//  Description:           Returns a block that has a checksum, together with the checksum
+//  Input:                 Inode pointer, block index, checksum and bytes it covers (filled in)
+//  Output:                Block descriptor or NULL for a hole or a block written since its last backup
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PDATABLOCK getCheckedBlock(PINODE inode, int blockIndex, unsigned int *checksum, int *size)
+{
+    PDATABLOCK block = NULL;
+
+    if(inode -> BlockMap == NULL || blockIndex >= inode -> BlockMap -> Count || inode -> BlockMap -> Blocks[blockIndex] == NULL)
+    {
+        return NULL;
+    }
+
+    block = inode -> BlockMap -> Blocks[blockIndex];
+    if(block -> ChecksumSize == 0)
+    {
+        return NULL;
+    }
+
+    *checksum = block -> Checksum;
+    *size = block -> ChecksumSize;
+
+    return block;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         readAheadInode()
+//  Description:           Asks the buffer cache to read a range of blocks of a file ahead. Only disk
+//                         blocks are read, holes and memory or image blocks are skipped.
+//  Input:                 Inode pointer, first block index, number of blocks
+//  Output:                Block index the read-ahead reaches, short of the range when the cache is full
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+long long readAheadInode(PINODE inode, long long firstBlock, long long count)
+{
+    PDATABLOCK blocks[READAHEAD_MAX_BLOCKS];
+    long long indexes[READAHEAD_MAX_BLOCKS];
+    PDATABLOCK block = NULL;
+    long long last = firstBlock + count;
+    long long i = 0;
+    int found = 0;
+    int done = 0;
+
+    if(last > getInodeBlockCount(inode))
+    {
+        last = getInodeBlockCount(inode);
+    }
+
+    for(i = firstBlock; i < last; i++)
+    {
+        block = getInodeBlock(inode, (int)i);
+        if(block != NULL && block -> Data == NULL)
+        {
+            blocks[found] = block;
+            indexes[found] = i;
+            found++;
+        }
+
+        if(found == READAHEAD_MAX_BLOCKS || (i == last - 1 && found > 0))
+        {
+            done = prefetchDiskBlocks(blocks, found);
+            if(done < found)
+            {
+                return indexes[done];
+            }
+
+            found = 0;
+        }
+    }
+
+    return firstBlock + count;
+}
@@ -0,0 +1,202 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  File Name:             cvfs_checksum.c
+//  Description:           CRC32C (Castagnoli) checksums of backup images and data blocks: the SSE4.2
+//                         crc32 instruction when the processor has it, table driven otherwise
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "cvfs.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define CRC_HAVE_SSE42
+#endif
+
+static unsigned int crcTable[8][256];                   /* Slicing-by-8 tables of the fallback */
+static bool bCrcHardware = false;
+static pthread_once_t crcOnce = PTHREAD_ONCE_INIT;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         crc32cInit()
+//  Description:           Picks the implementation once and builds the tables of the fallback
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void crc32cInit()
+{
+    unsigned int crc = 0;
+    int i = 0, j = 0;
+
+    for(i = 0; i < 256; i++)
+    {
+        crc = (unsigned int)i;
+        for(j = 0; j < 8; j++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crcTable[0][i] = crc;
+    }
+
+    // Table k advances a byte through k more zero bytes
+    for(i = 0; i < 256; i++)
+    {
+        for(j = 1; j < 8; j++)
+        {
+            crcTable[j][i] = (crcTable[j - 1][i] >> 8) ^ crcTable[0][crcTable[j - 1][i] & 0xFF];
+        }
+    }
+
+#ifdef CRC_HAVE_SSE42
+    __builtin_cpu_init();
+    bCrcHardware = (__builtin_cpu_supports("sse4.2") != 0);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         crc32cSoftware()
+//  Description:           Table driven CRC32C, eight bytes per step (slicing-by-8)
+//  Input:                 Checksum so far (0 to start), data, number of bytes
+//  Output:                New checksum
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int crc32cSoftware(unsigned int crc, const void *data, long long size)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    unsigned int low = 0, high = 0;
+
+    pthread_once(&crcOnce, crc32cInit);
+
+    crc = ~crc;
+
+    for(; size >= 8; size = size - 8, p = p + 8)
+    {
+        low = crc ^ ((unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24));
+        high = (unsigned int)p[4] | ((unsigned int)p[5] << 8) | ((unsigned int)p[6] << 16) | ((unsigned int)p[7] << 24);
+
+        crc = crcTable[7][low & 0xFF] ^ crcTable[6][(low >> 8) & 0xFF] ^
+              crcTable[5][(low >> 16) & 0xFF] ^ crcTable[4][low >> 24] ^
+              crcTable[3][high & 0xFF] ^ crcTable[2][(high >> 8) & 0xFF] ^
+              crcTable[1][(high >> 16) & 0xFF] ^ crcTable[0][high >> 24];
+    }
+
+    for(; size > 0; size--, p++)
+    {
+        crc = (crc >> 8) ^ crcTable[0][(crc ^ *p) & 0xFF];
+    }
+
+    return ~crc;
+}
+
+#ifdef CRC_HAVE_SSE42
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         crc32cHardware()
+//  Description:           CRC32C with the SSE4.2 crc32 instruction, eight bytes at a time
+//  Input:                 Checksum so far (0 to start), data, number of bytes
+//  Output:                New checksum
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+__attribute__((target("sse4.2")))
+static unsigned int crc32cHardware(unsigned int crc, const void *data, long long size)
+{
+    const unsigned char *p = (const unsigned char *)data;
+#if defined(__x86_64__)
+    unsigned long long value = ~crc & 0xFFFFFFFFu;
+    unsigned long long word = 0;
+
+    for(; size >= 8; size = size - 8, p = p + 8)
+    {
+        memcpy(&word, p, sizeof(word));
+        value = _mm_crc32_u64(value, word);
+    }
+    crc = (unsigned int)value;
+#else
+    unsigned int word = 0;
+
+    crc = ~crc;
+    for(; size >= 4; size = size - 4, p = p + 4)
+    {
+        memcpy(&word, p, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+    }
+#endif
+
+    for(; size > 0; size--, p++)
+    {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+
+    return ~crc;
+}
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         crc32c()
+//  Description:           CRC32C of a buffer, in hardware when the processor supports it. Checksums
+//                         can be continued: crc32c(crc32c(0, a, n), b, m) covers a and b.
+//  Input:                 Checksum so far (0 to start), data, number of bytes
+//  Output:                New checksum
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int crc32c(unsigned int crc, const void *data, long long size)
+{
+    pthread_once(&crcOnce, crc32cInit);
+
+#ifdef CRC_HAVE_SSE42
+    if(bCrcHardware == true)
+    {
+        return crc32cHardware(crc, data, size);
+    }
+#endif
+
+    return crc32cSoftware(crc, data, size);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         crc32cZeroes()
+//  Description:           Checksum of a run of zero bytes (holes and zero blocks are not stored)
+//  Input:                 Number of bytes, at most BLOCKSIZE
+//  Output:                Checksum
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int crc32cZeroes(int size)
+{
+    static const char zeroes[BLOCKSIZE];
+
+    return crc32c(0, zeroes, size);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         isCrc32cHardware()
+//  Description:           Tells whether checksums are computed by the processor
+//  Input:                 void
+//  Output:                true for SSE4.2, false for the table driven fallback
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool isCrc32cHardware()
+{
+    pthread_once(&crcOnce, crc32cInit);
+
+    return bCrcHardware;
+}
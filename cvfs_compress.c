@@ -0,0 +1,322 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  File Name:             cvfs_compress.c
+//  Description:           Block compressor of the LZ77 family (LZ4 style sequences) used for the
+//                         file data of backup images: fast greedy matching through a small hash
+//                         table, a decoder that checks every length and offset
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "cvfs.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         lzRead32()
+//  Description:           Reads four bytes at any alignment
+//  Input:                 Pointer
+//  Output:                Value
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int lzRead32(const unsigned char *p)
+{
+    unsigned int value = 0;
+
+    memcpy(&value, p, sizeof(value));
+
+    return value;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         lzHash()
+//  Description:           Hashes the next four bytes into the match table (Fibonacci hashing)
+//  Input:                 Four bytes
+//  Output:                Table slot
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int lzHash(unsigned int sequence)
+{
+    return (sequence * 2654435761u) >> (32 - LZ_HASHLOG);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         lzWriteSequence()
+//  Description:           Emits one sequence: token, literals, and unless it is the last one the
+//                         match offset and length. Lengths of 15 and more continue in extra bytes.
+//  Input:                 Output position, output end, literals, number of literals, match offset,
+//                         match length (0 = last sequence)
+//  Output:                New output position or NULL if the output is full
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static unsigned char *lzWriteSequence(unsigned char *op, unsigned char *oend, const unsigned char *literals, int literalCount, int offset, int matchLength)
+{
+    unsigned char *token = op;
+    int length = 0;
+
+    // Worst case: token, extra length bytes for both lengths, literals, offset
+    if(oend - op < 1 + literalCount / 255 + 1 + literalCount + 2 + matchLength / 255 + 1)
+    {
+        return NULL;
+    }
+
+    op++;
+    *token = (unsigned char)(((literalCount >= 15) ? 15 : literalCount) << 4);
+
+    for(length = literalCount - 15; length >= 0; length = length - 255)
+    {
+        *op++ = (unsigned char)((length >= 255) ? 255 : length);
+        if(length < 255)
+        {
+            break;
+        }
+    }
+
+    memcpy(op, literals, literalCount);
+    op = op + literalCount;
+
+    if(matchLength == 0)
+    {
+        return op;
+    }
+
+    *op++ = (unsigned char)(offset & 0xFF);
+    *op++ = (unsigned char)(offset >> 8);
+
+    matchLength = matchLength - LZ_MINMATCH;
+    *token = *token | (unsigned char)((matchLength >= 15) ? 15 : matchLength);
+
+    for(length = matchLength - 15; length >= 0; length = length - 255)
+    {
+        *op++ = (unsigned char)((length >= 255) ? 255 : length);
+        if(length < 255)
+        {
+            break;
+        }
+    }
+
+    return op;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         compressBlock()
+//  Description:           Compresses up to 64 KB. Greedy: every position is looked up in a hash table
+//                         of the last position with the same four bytes; the search steps faster
+//                         through data that does not match, so incompressible input costs little.
+//  Input:                 Source data, source size, destination, destination capacity
+//  Output:                Compressed size, 0 if it does not fit into the capacity
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int compressBlock(const char *source, int size, char *dest, int capacity)
+{
+    const unsigned char *src = (const unsigned char *)source;
+    const unsigned char *ip = src;
+    const unsigned char *anchor = src;
+    const unsigned char *end = src + size;
+    const unsigned char *matchLimit = end - LZ_LASTLITERALS;
+    const unsigned char *ref = NULL;
+    unsigned char *op = (unsigned char *)dest;
+    unsigned char *oend = (unsigned char *)dest + capacity;
+    unsigned short table[1 << LZ_HASHLOG];              /* Last position + 1 per hash, 0 = none */
+    unsigned int sequence = 0;
+    unsigned int slot = 0;
+    int length = 0;
+
+    if(size < 0 || size > LZ_MAXINPUT)
+    {
+        return 0;
+    }
+
+    memset(table, 0, sizeof(table));
+
+    // Matches start at least LZ_MFLIMIT bytes before the end, the tail is stored as literals
+    while(size >= LZ_MFLIMIT && ip < end - LZ_MFLIMIT)
+    {
+        sequence = lzRead32(ip);
+        slot = lzHash(sequence);
+        ref = (table[slot] != 0) ? src + table[slot] - 1 : NULL;
+        table[slot] = (unsigned short)(ip - src + 1);
+
+        if(ref == NULL || lzRead32(ref) != sequence)
+        {
+            ip = ip + 1 + ((ip - anchor) >> LZ_SKIPSTRENGTH);
+            continue;
+        }
+
+        length = LZ_MINMATCH;
+        while(ip + length < matchLimit && ip[length] == ref[length])
+        {
+            length++;
+        }
+
+        op = lzWriteSequence(op, oend, anchor, (int)(ip - anchor), (int)(ip - ref), length);
+        if(op == NULL)
+        {
+            return 0;
+        }
+
+        ip = ip + length;
+        anchor = ip;
+    }
+
+    op = lzWriteSequence(op, oend, anchor, (int)(end - anchor), 0, 0);
+    if(op == NULL)
+    {
+        return 0;
+    }
+
+    return (int)(op - (unsigned char *)dest);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         decompressBlock()
+//  Description:           Decompresses the output of compressBlock(). Damaged input never reads or
+//                         writes out of bounds, it is reported instead.
+//  Input:                 Compressed data, compressed size, destination, destination capacity
+//  Output:                Decompressed size or -1 if the input is damaged
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int decompressBlock(const char *source, int size, char *dest, int capacity)
+{
+    const unsigned char *ip = (const unsigned char *)source;
+    const unsigned char *iend = ip + size;
+    unsigned char *op = (unsigned char *)dest;
+    unsigned char *oend = op + capacity;
+    const unsigned char *match = NULL;
+    int token = 0;
+    int length = 0;
+    int offset = 0;
+    int extra = 0;
+
+    while(ip < iend)
+    {
+        token = *ip++;
+
+        length = token >> 4;
+        if(length == 15)
+        {
+            do
+            {
+                if(ip >= iend)
+                {
+                    return -1;
+                }
+                extra = *ip++;
+                length = length + extra;
+            }
+            while(extra == 255);
+        }
+
+        if(length > iend - ip || length > oend - op)
+        {
+            return -1;
+        }
+
+        memcpy(op, ip, length);
+        op = op + length;
+        ip = ip + length;
+
+        // The last sequence has no match
+        if(ip == iend)
+        {
+            break;
+        }
+
+        if(iend - ip < 2)
+        {
+            return -1;
+        }
+
+        offset = ip[0] | (ip[1] << 8);
+        ip = ip + 2;
+        if(offset == 0 || offset > op - (unsigned char *)dest)
+        {
+            return -1;
+        }
+
+        length = token & 15;
+        if(length == 15)
+        {
+            do
+            {
+                if(ip >= iend)
+                {
+                    return -1;
+                }
+                extra = *ip++;
+                length = length + extra;
+            }
+            while(extra == 255);
+        }
+        length = length + LZ_MINMATCH;
+
+        if(length > oend - op)
+        {
+            return -1;
+        }
+
+        // A match may overlap the bytes it produces (runs), so it is copied forward byte by byte
+        match = op - offset;
+        if(offset >= length)
+        {
+            memcpy(op, match, length);
+            op = op + length;
+        }
+        else
+        {
+            while(length-- > 0)
+            {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return (int)(op - (unsigned char *)dest);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         isZeroData()
+//  Description:           Tells whether a buffer holds only zero bytes (such blocks are not stored)
+//  Input:                 Data, number of bytes
+//  Output:                true if every byte is zero
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool isZeroData(const char *data, int size)
+{
+    unsigned long long word = 0;
+    int i = 0;
+
+    for(i = 0; i + (int)sizeof(word) <= size; i = i + sizeof(word))
+    {
+        memcpy(&word, data + i, sizeof(word));
+        if(word != 0)
+        {
+            return false;
+        }
+    }
+
+    for(; i < size; i++)
+    {
+        if(data[i] != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,1634 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  File Name:             cvfs_disk.c
+//  Description:           Disk storage mode: a block device on one host file (pread/pwrite, optionally
+//                         O_DIRECT) and the bounded LRU buffer cache every disk block is read and
+//                         written through, so the files can be much larger than memory. An I/O thread
+//                         reads ahead for sequential readers and flushes dirty buffers in the
+//                         background, both in runs of adjacent blocks.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define _GNU_SOURCE                                             /* O_DIRECT */
+#include "cvfs.h"
+
+struct BlockDevice deviceobj = {.Fd = -1};
+struct BufferCache cacheobj = {.Lock = PTHREAD_MUTEX_INITIALIZER, .Wake = PTHREAD_COND_INITIALIZER, .Done = PTHREAD_COND_INITIALIZER};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         deviceTransfer()
+//  Description:           Reads or writes one block of the storage file
+//  Input:                 Block number, BLOCKSIZE bytes (aligned for O_DIRECT), true to write
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int deviceTransfer(long long blockNumber, char *data, bool bWrite)
+{
+    off_t offset = (off_t)(blockNumber + 1) * BLOCKSIZE;
+    ssize_t ret = 0;
+
+    do
+    {
+        ret = (bWrite == true) ? pwrite(deviceobj.Fd, data, BLOCKSIZE, offset) : pread(deviceobj.Fd, data, BLOCKSIZE, offset);
+    } while(ret < 0 && errno == EINTR);
+
+    // Pins and evictions call this without the cache lock
+    if(bWrite == true)
+    {
+        __atomic_add_fetch(&deviceobj.Writes, 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        __atomic_add_fetch(&deviceobj.Reads, 1, __ATOMIC_RELAXED);
+    }
+
+    if(ret != BLOCKSIZE)
+    {
+        __atomic_add_fetch(&deviceobj.Errors, 1, __ATOMIC_RELAXED);
+        return ERR_HOST_IO;
+    }
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         deviceAllocBlock()
+//  Description:           Hands out a block of the storage file, freed blocks first
+//  Input:                 void
+//  Output:                Block number
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static long long deviceAllocBlock()
+{
+    if(deviceobj.FreeCount > 0)
+    {
+        deviceobj.FreeCount--;
+        return deviceobj.FreeBlocks[deviceobj.FreeCount];
+    }
+
+    deviceobj.Blocks++;
+
+    return deviceobj.Blocks - 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         deviceFreeBlock()
+//  Description:           Gives a block of the storage file back for reuse
+//  Input:                 Block number
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void deviceFreeBlock(long long blockNumber)
+{
+    long long *newBlocks = NULL;
+    long long capacity = 0;
+
+    if(deviceobj.FreeCount == deviceobj.FreeCapacity)
+    {
+        capacity = (deviceobj.FreeCapacity == 0) ? 1024 : deviceobj.FreeCapacity * 2;
+        newBlocks = (long long *)realloc(deviceobj.FreeBlocks, sizeof(long long) * capacity);
+
+        // Without memory the block is only lost for reuse until the next start
+        if(newBlocks == NULL)
+        {
+            return;
+        }
+
+        deviceobj.FreeBlocks = newBlocks;
+        deviceobj.FreeCapacity = capacity;
+    }
+
+    deviceobj.FreeBlocks[deviceobj.FreeCount] = blockNumber;
+    deviceobj.FreeCount++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         lruRemove()
+//  Description:           Takes a buffer off the LRU list (it is pinned or reused). Cache lock held.
+//  Input:                 Buffer
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void lruRemove(PCACHEBUFFER buffer)
+{
+    if(buffer -> Prev != NULL)
+    {
+        buffer -> Prev -> Next = buffer -> Next;
+    }
+    else
+    {
+        cacheobj.Head = buffer -> Next;
+    }
+
+    if(buffer -> Next != NULL)
+    {
+        buffer -> Next -> Prev = buffer -> Prev;
+    }
+    else
+    {
+        cacheobj.Tail = buffer -> Prev;
+    }
+
+    buffer -> Prev = NULL;
+    buffer -> Next = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         lruPushHead()
+//  Description:           Puts an unpinned buffer at the most recently used end. Cache lock held.
+//  Input:                 Buffer
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void lruPushHead(PCACHEBUFFER buffer)
+{
+    buffer -> Prev = NULL;
+    buffer -> Next = cacheobj.Head;
+
+    if(cacheobj.Head != NULL)
+    {
+        cacheobj.Head -> Prev = buffer;
+    }
+    else
+    {
+        cacheobj.Tail = buffer;
+    }
+
+    cacheobj.Head = buffer;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         lruPushTail()
+//  Description:           Puts an unpinned buffer at the least recently used end, the flusher leaves
+//                         the buffers it cleaned there. Cache lock held.
+//  Input:                 Buffer
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void lruPushTail(PCACHEBUFFER buffer)
+{
+    buffer -> Next = NULL;
+    buffer -> Prev = cacheobj.Tail;
+
+    if(cacheobj.Tail != NULL)
+    {
+        cacheobj.Tail -> Next = buffer;
+    }
+    else
+    {
+        cacheobj.Head = buffer;
+    }
+
+    cacheobj.Tail = buffer;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         dirtyThreshold()
+//  Description:           Number of dirty buffers that makes the given share of the cache
+//  Input:                 Percent of the capacity
+//  Output:                Number of buffers, at least 1
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int dirtyThreshold(int percent)
+{
+    int threshold = (int)((long long)cacheobj.Capacity * percent / 100);
+
+    return (threshold > 0) ? threshold : 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         writeBackBuffer()
+//  Description:           Writes a dirty buffer to the block of the storage file its block owns (the
+//                         block gets one on its first write-back). Cache lock held, for the whole
+//                         cache operations that nothing runs alongside.
+//  Input:                 Buffer
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int writeBackBuffer(PCACHEBUFFER buffer)
+{
+    if(buffer -> bDirty == false)
+    {
+        return EXECUTE_SUCCESS;
+    }
+
+    if(buffer -> Block -> DiskBlock < 0)
+    {
+        buffer -> Block -> DiskBlock = deviceAllocBlock();
+    }
+
+    if(deviceTransfer(buffer -> Block -> DiskBlock, buffer -> Data, true) != EXECUTE_SUCCESS)
+    {
+        return ERR_HOST_IO;
+    }
+
+    buffer -> bDirty = false;
+    cacheobj.Dirty--;
+    cacheobj.WriteBacks++;
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         freeOverflowBuffer()
+//  Description:           Releases a buffer allocated past the capacity. Cache lock held.
+//  Input:                 Buffer, detached from its block
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void freeOverflowBuffer(PCACHEBUFFER buffer)
+{
+    free(buffer -> Data);
+    free(buffer);
+    cacheobj.Overflow--;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         putCacheBuffer()
+//  Description:           Gives back a buffer that holds no block: to the free list, or released if it
+//                         is an overflow buffer. Cache lock held.
+//  Input:                 Buffer
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void putCacheBuffer(PCACHEBUFFER buffer)
+{
+    if(buffer -> bOverflow == true)
+    {
+        freeOverflowBuffer(buffer);
+        return;
+    }
+
+    buffer -> Next = cacheobj.FreeList;
+    cacheobj.FreeList = buffer;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         writeBackPinned()
+//  Description:           Writes a dirty buffer back with the cache lock dropped: the caller has
+//                         pinned it, so it is not evicted, and it is marked as being written, so its
+//                         block is not dropped. A pin meanwhile may write it again, which marks it
+//                         dirty again. Cache lock held on entry and on return.
+//  Input:                 Buffer (dirty, pinned by the caller)
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int writeBackPinned(PCACHEBUFFER buffer)
+{
+    int iRet = EXECUTE_SUCCESS;
+
+    if(buffer -> Block -> DiskBlock < 0)
+    {
+        buffer -> Block -> DiskBlock = deviceAllocBlock();
+    }
+
+    buffer -> bWriting = true;
+    buffer -> bDirty = false;
+    cacheobj.Dirty--;
+
+    pthread_mutex_unlock(&cacheobj.Lock);
+    iRet = deviceTransfer(buffer -> Block -> DiskBlock, buffer -> Data, true);
+    pthread_mutex_lock(&cacheobj.Lock);
+
+    buffer -> bWriting = false;
+    if(iRet == EXECUTE_SUCCESS)
+    {
+        cacheobj.WriteBacks++;
+    }
+    else if(buffer -> bDirty == false)
+    {
+        buffer -> bDirty = true;
+        cacheobj.Dirty++;
+    }
+
+    pthread_cond_broadcast(&cacheobj.Done);
+
+    return iRet;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getCacheBuffer()
+//  Description:           Finds a buffer for a block: a free one, else the least recently used
+//                         unpinned one, else a new overflow buffer when every buffer is pinned or
+//                         the cold end can not be written back. A dirty buffer at the cold end is
+//                         written back with the cache lock dropped, so the state of the cache may
+//                         change meanwhile. Cache lock held.
+//  Input:                 void
+//  Output:                Buffer or NULL if memory is exhausted
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PCACHEBUFFER getCacheBuffer()
+{
+    PCACHEBUFFER buffer = NULL;
+
+    while(cacheobj.FreeList != NULL || cacheobj.Tail != NULL)
+    {
+        buffer = cacheobj.FreeList;
+        if(buffer != NULL)
+        {
+            cacheobj.FreeList = buffer -> Next;
+            buffer -> Next = NULL;
+            return buffer;
+        }
+
+        buffer = cacheobj.Tail;
+        lruRemove(buffer);
+
+        if(buffer -> bDirty == true)
+        {
+            buffer -> Pins = 1;
+            if(writeBackPinned(buffer) != EXECUTE_SUCCESS)
+            {
+                // A buffer that can not be written back keeps its block, the cache grows instead
+                buffer -> Pins--;
+                if(buffer -> Pins == 0)
+                {
+                    lruPushHead(buffer);
+                }
+                break;
+            }
+
+            // Pinned or written again meanwhile: it stays, look again
+            buffer -> Pins--;
+            if(buffer -> Pins > 0)
+            {
+                continue;
+            }
+            if(buffer -> bDirty == true)
+            {
+                lruPushTail(buffer);
+                continue;
+            }
+        }
+
+        buffer -> Block -> Buffer = NULL;
+        buffer -> Block = NULL;
+        cacheobj.Resident--;
+        cacheobj.Evictions++;
+        return buffer;
+    }
+
+    buffer = (PCACHEBUFFER)calloc(1, sizeof(CACHEBUFFER));
+    if(buffer == NULL)
+    {
+        return NULL;
+    }
+
+    if(posix_memalign((void **)&buffer -> Data, BLOCKSIZE, BLOCKSIZE) != 0)
+    {
+        free(buffer);
+        return NULL;
+    }
+
+    buffer -> bOverflow = true;
+    cacheobj.Overflow++;
+
+    return buffer;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         initDiskBlock()
+//  Description:           Makes a new data block a disk block: no memory and no place in the storage
+//                         file until it is pinned and written back
+//  Input:                 Block descriptor
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void initDiskBlock(PDATABLOCK block)
+{
+    block -> Data = NULL;
+    block -> Buffer = NULL;
+    block -> DiskBlock = -1;
+
+    pthread_mutex_lock(&cacheobj.Lock);
+    cacheobj.Blocks++;
+    pthread_mutex_unlock(&cacheobj.Lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         pinDiskBlock()
+//  Description:           Brings a disk block into the cache (read from the storage file on a miss, a
+//                         block never written back has nothing to read) and pins it there. The read
+//                         runs without the cache lock: the buffer is given to the block first and
+//                         marked as being read, other pins of the block wait for it.
+//  Input:                 Block descriptor
+//  Output:                Block data or NULL if memory is exhausted or the read failed
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+char *pinDiskBlock(PDATABLOCK block)
+{
+    PCACHEBUFFER buffer = NULL;
+    int iRet = EXECUTE_SUCCESS;
+
+    pthread_mutex_lock(&cacheobj.Lock);
+
+    while(true)
+    {
+        // A block being read (ahead or by another pin) is waited for, if that read failed it is read here
+        while(block -> Buffer != NULL && block -> Buffer -> bReading == true)
+        {
+            pthread_cond_wait(&cacheobj.Done, &cacheobj.Lock);
+        }
+
+        buffer = block -> Buffer;
+        if(buffer != NULL)
+        {
+            cacheobj.Hits++;
+            if(buffer -> bReadAhead == true)
+            {
+                buffer -> bReadAhead = false;
+                cacheobj.ReadAheadHits++;
+            }
+
+            if(buffer -> Pins == 0)
+            {
+                lruRemove(buffer);
+            }
+
+            buffer -> Pins++;
+            break;
+        }
+
+        buffer = getCacheBuffer();
+        if(buffer == NULL)
+        {
+            pthread_mutex_unlock(&cacheobj.Lock);
+            return NULL;
+        }
+
+        // Another pin brought the block in while a write-back had the lock dropped
+        if(block -> Buffer != NULL)
+        {
+            putCacheBuffer(buffer);
+            continue;
+        }
+
+        buffer -> Block = block;
+        buffer -> bDirty = false;
+        buffer -> bReadAhead = false;
+        buffer -> Pins = 1;
+        block -> Buffer = buffer;
+        cacheobj.Resident++;
+
+        if(block -> DiskBlock < 0)
+        {
+            break;
+        }
+
+        cacheobj.Misses++;
+        buffer -> bReading = true;
+
+        pthread_mutex_unlock(&cacheobj.Lock);
+        iRet = deviceTransfer(block -> DiskBlock, buffer -> Data, false);
+        pthread_mutex_lock(&cacheobj.Lock);
+
+        buffer -> bReading = false;
+        pthread_cond_broadcast(&cacheobj.Done);
+
+        if(iRet != EXECUTE_SUCCESS)
+        {
+            block -> Buffer = NULL;
+            buffer -> Block = NULL;
+            buffer -> Pins = 0;
+            cacheobj.Resident--;
+            putCacheBuffer(buffer);
+
+            pthread_mutex_unlock(&cacheobj.Lock);
+            return NULL;
+        }
+
+        break;
+    }
+
+    pthread_mutex_unlock(&cacheobj.Lock);
+
+    return buffer -> Data;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         unpinDiskBlock()
+//  Description:           Drops a pin of a cached disk block. The last pin puts the buffer on the LRU
+//                         list, an overflow buffer is written back (without the cache lock) and
+//                         released right away. Enough dirty buffers wake the flusher.
+//  Input:                 Block descriptor, true if the data was changed
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void unpinDiskBlock(PDATABLOCK block, bool bDirty)
+{
+    PCACHEBUFFER buffer = NULL;
+
+    pthread_mutex_lock(&cacheobj.Lock);
+
+    buffer = block -> Buffer;
+    if(bDirty == true && buffer -> bDirty == false)
+    {
+        buffer -> bDirty = true;
+        cacheobj.Dirty++;
+
+        if(cacheobj.bThread == true && cacheobj.Dirty > dirtyThreshold(CACHE_DIRTY_BACKGROUND))
+        {
+            cacheobj.bStalled = false;
+            pthread_cond_signal(&cacheobj.Wake);
+        }
+    }
+
+    buffer -> Pins--;
+
+    // An overflow buffer is written back without the lock, still pinned so it stays with its block
+    if(buffer -> Pins == 0 && buffer -> bOverflow == true && buffer -> bDirty == true)
+    {
+        buffer -> Pins = 1;
+        writeBackPinned(buffer);
+        buffer -> Pins--;
+    }
+
+    if(buffer -> Pins == 0)
+    {
+        if(buffer -> bOverflow == true && buffer -> bDirty == false)
+        {
+            block -> Buffer = NULL;
+            cacheobj.Resident--;
+            freeOverflowBuffer(buffer);
+        }
+        else
+        {
+            lruPushHead(buffer);
+        }
+    }
+
+    pthread_mutex_unlock(&cacheobj.Lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         dropDiskBlock()
+//  Description:           Forgets a disk block that is freed: its buffer and its place in the storage
+//                         file are reused, nothing is written back
+//  Input:                 Block descriptor (not pinned)
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void dropDiskBlock(PDATABLOCK block)
+{
+    PCACHEBUFFER buffer = NULL;
+
+    pthread_mutex_lock(&cacheobj.Lock);
+
+    // Another thread may still be reading or writing the block
+    while(block -> Buffer != NULL && (block -> Buffer -> bReading == true || block -> Buffer -> bWriting == true))
+    {
+        pthread_cond_wait(&cacheobj.Done, &cacheobj.Lock);
+    }
+
+    buffer = block -> Buffer;
+    if(buffer != NULL)
+    {
+        if(buffer -> bDirty == true)
+        {
+            buffer -> bDirty = false;
+            cacheobj.Dirty--;
+        }
+
+        lruRemove(buffer);
+        buffer -> Block = NULL;
+        cacheobj.Resident--;
+        putCacheBuffer(buffer);
+    }
+
+    if(block -> DiskBlock >= 0)
+    {
+        deviceFreeBlock(block -> DiskBlock);
+    }
+
+    block -> Buffer = NULL;
+    block -> DiskBlock = -1;
+    cacheobj.Blocks--;
+
+    pthread_mutex_unlock(&cacheobj.Lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         prefetchDiskBlocks()
+//  Description:           Queues disk blocks for the I/O thread to read ahead. Each gets a buffer now
+//                         (a free one or a clean one evicted, never a write-back or overflow) and is
+//                         pinned by the thread until its read is done.
+//  Input:                 Block descriptors, number of them
+//  Output:                Number of blocks dealt with before the cache had no more room
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int prefetchDiskBlocks(PDATABLOCK *blocks, int count)
+{
+    PCACHEBUFFER buffer = NULL;
+    bool bWake = false;
+    int i = 0;
+
+    pthread_mutex_lock(&cacheobj.Lock);
+
+    // Without the I/O thread blocks are only read when pinned
+    if(cacheobj.bThread == false)
+    {
+        pthread_mutex_unlock(&cacheobj.Lock);
+        return count;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        // Cached blocks and blocks never written back have nothing to read
+        if(blocks[i] -> Buffer != NULL || blocks[i] -> DiskBlock < 0)
+        {
+            continue;
+        }
+
+        // Read-ahead uses at most a quarter of the cache and does not push out dirty data, the
+        // flusher is asked to clean the cold end for the next window instead
+        if(cacheobj.Reading >= cacheobj.Capacity / 4 || (cacheobj.FreeList == NULL && cacheobj.Tail == NULL))
+        {
+            break;
+        }
+
+        if(cacheobj.FreeList == NULL && cacheobj.Tail -> bDirty == true)
+        {
+            cacheobj.bColdWanted = true;
+            cacheobj.bStalled = false;
+            bWake = true;
+            break;
+        }
+
+        buffer = getCacheBuffer();
+        if(buffer == NULL)
+        {
+            break;
+        }
+
+        buffer -> Block = blocks[i];
+        buffer -> bDirty = false;
+        buffer -> bReading = true;
+        buffer -> bReadAhead = true;
+        buffer -> Pins = 1;
+        buffer -> Next = NULL;
+        blocks[i] -> Buffer = buffer;
+        cacheobj.Resident++;
+        cacheobj.Reading++;
+
+        if(cacheobj.ReadQueueTail != NULL)
+        {
+            cacheobj.ReadQueueTail -> Next = buffer;
+        }
+        else
+        {
+            cacheobj.ReadQueue = buffer;
+        }
+        cacheobj.ReadQueueTail = buffer;
+        bWake = true;
+    }
+
+    if(bWake == true)
+    {
+        pthread_cond_signal(&cacheobj.Wake);
+    }
+
+    pthread_mutex_unlock(&cacheobj.Lock);
+
+    return i;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         waitDirtyLimit()
+//  Description:           Holds a writer back while more than CACHE_DIRTY_LIMIT percent of the cache is
+//                         dirty, until the flusher has brought it under the limit or can not
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void waitDirtyLimit()
+{
+    if(deviceobj.bEnabled == false)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&cacheobj.Lock);
+
+    if(cacheobj.bThread == true && cacheobj.Dirty > dirtyThreshold(CACHE_DIRTY_LIMIT))
+    {
+        cacheobj.Throttles++;
+        cacheobj.bStalled = false;
+        pthread_cond_signal(&cacheobj.Wake);
+
+        while(cacheobj.bStalled == false && cacheobj.Dirty > dirtyThreshold(CACHE_DIRTY_LIMIT))
+        {
+            pthread_cond_wait(&cacheobj.Done, &cacheobj.Lock);
+        }
+    }
+
+    pthread_mutex_unlock(&cacheobj.Lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         compareDiskBlocks()
+//  Description:           qsort() comparator ordering buffers by the place of their block in the
+//                         storage file
+//  Input:                 Two buffer pointers
+//  Output:                Negative, zero or positive
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int compareDiskBlocks(const void *first, const void *second)
+{
+    long long a = (*(const PCACHEBUFFER *)first) -> Block -> DiskBlock;
+    long long b = (*(const PCACHEBUFFER *)second) -> Block -> DiskBlock;
+
+    return (a > b) - (a < b);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         takeReadAheads()
+//  Description:           Takes the oldest queued read-ahead buffers for one pass. Cache lock held.
+//  Input:                 Array of IO_BATCH_BLOCKS buffers to fill
+//  Output:                Number of buffers taken
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int takeReadAheads(PCACHEBUFFER *batch)
+{
+    int count = 0;
+
+    while(cacheobj.ReadQueue != NULL && count < IO_BATCH_BLOCKS)
+    {
+        batch[count] = cacheobj.ReadQueue;
+        cacheobj.ReadQueue = batch[count] -> Next;
+        batch[count] -> Next = NULL;
+        count++;
+    }
+
+    if(cacheobj.ReadQueue == NULL)
+    {
+        cacheobj.ReadQueueTail = NULL;
+    }
+
+    return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         takeDirtyBuffers()
+//  Description:           Takes the least recently used dirty buffers for one flush pass, enough to
+//                         get half way under the background threshold (or as many as one pass takes
+//                         when read-ahead found the cold end dirty). They are pinned and marked
+//                         clean (a write while they are flushed marks them dirty again) and blocks
+//                         written back for the first time get their place in the storage file in
+//                         LRU order, which for a file written front to back is file order. Cache
+//                         lock held.
+//  Input:                 Array of IO_BATCH_BLOCKS buffers to fill
+//  Output:                Number of buffers taken
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int takeDirtyBuffers(PCACHEBUFFER *batch)
+{
+    PCACHEBUFFER buffer = cacheobj.Tail;
+    PCACHEBUFFER previous = NULL;
+    int target = (cacheobj.bColdWanted == true) ? 0 : dirtyThreshold(CACHE_DIRTY_BACKGROUND) / 2;
+    int count = 0;
+
+    cacheobj.bColdWanted = false;
+
+    // The most recently used buffer is left alone, small writes may still be filling it
+    while(buffer != NULL && buffer != cacheobj.Head && count < IO_BATCH_BLOCKS && cacheobj.Dirty > target)
+    {
+        previous = buffer -> Prev;
+
+        if(buffer -> bDirty == true && buffer -> bOverflow == false)
+        {
+            if(buffer -> Block -> DiskBlock < 0)
+            {
+                buffer -> Block -> DiskBlock = deviceAllocBlock();
+            }
+
+            lruRemove(buffer);
+            buffer -> Pins = 1;
+            buffer -> bWriting = true;
+            buffer -> bDirty = false;
+            cacheobj.Dirty--;
+
+            batch[count] = buffer;
+            count++;
+        }
+
+        buffer = previous;
+    }
+
+    return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         transferBatch()
+//  Description:           Reads or writes the buffers of a pass, sorted by block, with one preadv() or
+//                         pwritev() per run of adjacent blocks. Called without the cache lock: the
+//                         buffers are pinned by the I/O thread and their blocks can not go away.
+//  Input:                 Buffers, number of them, true to write, per buffer set to true if it failed,
+//                         set to the number of runs that failed
+//  Output:                Number of runs
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int transferBatch(PCACHEBUFFER *batch, int count, bool bWrite, bool *bFailed, int *failedRuns)
+{
+    struct iovec iov[IO_BATCH_BLOCKS];
+    off_t offset = 0;
+    ssize_t ret = 0;
+    int runs = 0;
+    int first = 0, i = 0, j = 0;
+
+    *failedRuns = 0;
+
+    for(first = 0; first < count; first = i)
+    {
+        for(i = first + 1; i < count && batch[i] -> Block -> DiskBlock == batch[i - 1] -> Block -> DiskBlock + 1; i++)
+        {
+        }
+
+        for(j = first; j < i; j++)
+        {
+            iov[j - first].iov_base = batch[j] -> Data;
+            iov[j - first].iov_len = BLOCKSIZE;
+        }
+
+        offset = (off_t)(batch[first] -> Block -> DiskBlock + 1) * BLOCKSIZE;
+        do
+        {
+            ret = (bWrite == true) ? pwritev(deviceobj.Fd, iov, i - first, offset) : preadv(deviceobj.Fd, iov, i - first, offset);
+        } while(ret < 0 && errno == EINTR);
+
+        for(j = first; j < i; j++)
+        {
+            bFailed[j] = (ret != (ssize_t)(i - first) * BLOCKSIZE);
+        }
+
+        if(bFailed[first] == true)
+        {
+            (*failedRuns)++;
+        }
+        runs++;
+    }
+
+    return runs;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         finishBatch()
+//  Description:           Releases the buffers of a pass. Written buffers go to the cold end of the
+//                         LRU list (dirty again if their write failed), read ahead ones to the hot
+//                         end; a failed read gives its buffer back. Cache lock held.
+//  Input:                 Buffers, number of them, true if they were written, per buffer failure
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void finishBatch(PCACHEBUFFER *batch, int count, bool bWrite, bool *bFailed)
+{
+    PCACHEBUFFER buffer = NULL;
+    int i = 0;
+
+    for(i = 0; i < count; i++)
+    {
+        buffer = batch[i];
+
+        if(bWrite == true)
+        {
+            buffer -> bWriting = false;
+            if(bFailed[i] == false)
+            {
+                cacheobj.WriteBacks++;
+            }
+            else if(buffer -> bDirty == false)
+            {
+                buffer -> bDirty = true;
+                cacheobj.Dirty++;
+            }
+        }
+        else
+        {
+            buffer -> bReading = false;
+            cacheobj.Reading--;
+
+            if(bFailed[i] == true)
+            {
+                buffer -> Block -> Buffer = NULL;
+                buffer -> Block = NULL;
+                buffer -> Pins = 0;
+                buffer -> bReadAhead = false;
+                buffer -> Next = cacheobj.FreeList;
+                cacheobj.FreeList = buffer;
+                cacheobj.Resident--;
+                continue;
+            }
+
+            cacheobj.ReadAheads++;
+        }
+
+        buffer -> Pins--;
+        if(buffer -> Pins == 0)
+        {
+            if(bWrite == true)
+            {
+                lruPushTail(buffer);
+            }
+            else
+            {
+                lruPushHead(buffer);
+            }
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         ioThread()
+//  Description:           Body of the I/O thread: serves queued read-ahead first, then flushes while
+//                         more than CACHE_DIRTY_BACKGROUND percent of the cache is dirty or when
+//                         read-ahead asks for the cold end to be written back. A flush pass
+//                         that finds nothing to write, or fails, waits for the next wake-up.
+//  Input:                 Unused
+//  Output:                NULL
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void *ioThread(void *arg)
+{
+    PCACHEBUFFER batch[IO_BATCH_BLOCKS];
+    bool bFailed[IO_BATCH_BLOCKS];
+    bool bWrite = false;
+    int count = 0, runs = 0, failedRuns = 0;
+
+    (void)arg;
+
+    pthread_mutex_lock(&cacheobj.Lock);
+
+    while(true)
+    {
+        bWrite = false;
+        count = takeReadAheads(batch);
+
+        if(count == 0 && cacheobj.bStalled == false &&
+           (cacheobj.Dirty > dirtyThreshold(CACHE_DIRTY_BACKGROUND) || cacheobj.bColdWanted == true))
+        {
+            bWrite = true;
+            count = takeDirtyBuffers(batch);
+            if(count == 0)
+            {
+                cacheobj.bStalled = true;
+                pthread_cond_broadcast(&cacheobj.Done);
+            }
+        }
+
+        if(count == 0)
+        {
+            if(cacheobj.bStop == true)
+            {
+                break;
+            }
+
+            pthread_cond_wait(&cacheobj.Wake, &cacheobj.Lock);
+            continue;
+        }
+
+        qsort(batch, count, sizeof(PCACHEBUFFER), compareDiskBlocks);
+
+        pthread_mutex_unlock(&cacheobj.Lock);
+        runs = transferBatch(batch, count, bWrite, bFailed, &failedRuns);
+        pthread_mutex_lock(&cacheobj.Lock);
+
+        finishBatch(batch, count, bWrite, bFailed);
+
+        __atomic_add_fetch(&deviceobj.Errors, failedRuns, __ATOMIC_RELAXED);
+        if(bWrite == true)
+        {
+            __atomic_add_fetch(&deviceobj.Writes, runs, __ATOMIC_RELAXED);
+            cacheobj.Flushes = cacheobj.Flushes + runs;
+            cacheobj.Flushed = cacheobj.Flushed + count;
+            cacheobj.bStalled = (failedRuns > 0);
+        }
+        else
+        {
+            __atomic_add_fetch(&deviceobj.Reads, runs, __ATOMIC_RELAXED);
+        }
+
+        pthread_cond_broadcast(&cacheobj.Done);
+    }
+
+    pthread_mutex_unlock(&cacheobj.Lock);
+
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         ioThreadStart()
+//  Description:           Starts the I/O thread for a new cache. Without it reads and write-backs
+//                         simply happen when a block is pinned or evicted.
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void ioThreadStart()
+{
+    pthread_mutex_lock(&cacheobj.Lock);
+
+    cacheobj.bStop = false;
+    cacheobj.bStalled = false;
+    cacheobj.bThread = (pthread_create(&cacheobj.Thread, NULL, ioThread, NULL) == 0);
+
+    pthread_mutex_unlock(&cacheobj.Lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         ioThreadStop()
+//  Description:           Ends the I/O thread once its queued read-ahead is done and its running flush
+//                         pass is over, so no buffer is left pinned by it
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void ioThreadStop()
+{
+    if(cacheobj.bThread == false)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&cacheobj.Lock);
+    cacheobj.bStop = true;
+    cacheobj.bStalled = true;
+    pthread_cond_signal(&cacheobj.Wake);
+    pthread_mutex_unlock(&cacheobj.Lock);
+
+    pthread_join(cacheobj.Thread, NULL);
+
+    pthread_mutex_lock(&cacheobj.Lock);
+    cacheobj.bThread = false;
+    pthread_mutex_unlock(&cacheobj.Lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         cacheCreate()
+//  Description:           Allocates the buffers of the cache, all free
+//  Input:                 Number of buffers
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int cacheCreate(int capacity)
+{
+    void *memory = NULL;
+    int i = 0;
+
+    // One mapping keeps every buffer page aligned, as O_DIRECT wants
+    memory = mmap(NULL, (size_t)capacity * BLOCKSIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(memory == MAP_FAILED)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    cacheobj.Buffers = (PCACHEBUFFER)calloc(capacity, sizeof(CACHEBUFFER));
+    if(cacheobj.Buffers == NULL)
+    {
+        munmap(memory, (size_t)capacity * BLOCKSIZE);
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    cacheobj.Memory = (char *)memory;
+    cacheobj.Capacity = capacity;
+    cacheobj.FreeList = NULL;
+    cacheobj.Head = NULL;
+    cacheobj.Tail = NULL;
+
+    for(i = capacity - 1; i >= 0; i--)
+    {
+        cacheobj.Buffers[i].Data = cacheobj.Memory + (long long)i * BLOCKSIZE;
+        cacheobj.Buffers[i].Next = cacheobj.FreeList;
+        cacheobj.FreeList = &cacheobj.Buffers[i];
+    }
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         cacheDestroy()
+//  Description:           Writes back every cached block and frees the buffers (nothing may be pinned,
+//                         the I/O thread is stopped)
+//  Input:                 void
+//  Output:                Status Code, the cache is kept if a block can not be written back
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int cacheDestroy()
+{
+    PCACHEBUFFER buffer = NULL;
+
+    pthread_mutex_lock(&cacheobj.Lock);
+
+    for(buffer = cacheobj.Head; buffer != NULL; buffer = buffer -> Next)
+    {
+        if(writeBackBuffer(buffer) != EXECUTE_SUCCESS)
+        {
+            pthread_mutex_unlock(&cacheobj.Lock);
+            return ERR_HOST_IO;
+        }
+    }
+
+    while(cacheobj.Head != NULL)
+    {
+        buffer = cacheobj.Head;
+        lruRemove(buffer);
+        buffer -> Block -> Buffer = NULL;
+        cacheobj.Resident--;
+
+        if(buffer -> bOverflow == true)
+        {
+            freeOverflowBuffer(buffer);
+        }
+    }
+
+    if(cacheobj.Buffers != NULL)
+    {
+        munmap(cacheobj.Memory, (size_t)cacheobj.Capacity * BLOCKSIZE);
+        free(cacheobj.Buffers);
+    }
+
+    cacheobj.Buffers = NULL;
+    cacheobj.Memory = NULL;
+    cacheobj.Capacity = 0;
+    cacheobj.FreeList = NULL;
+    cacheobj.Dirty = 0;
+
+    pthread_mutex_unlock(&cacheobj.Lock);
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         moveBlocks()
+//  Description:           Moves the data blocks of every file from memory to the storage file (through
+//                         the cache) or back. Mapped image blocks stay where they are.
+//  Input:                 true to move them to disk
+//  Output:                Status Code, the blocks moved so far stay moved
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int moveBlocks(bool bToDisk)
+{
+    PINODE temp = NULL;
+    PDATABLOCK block = NULL;
+    char *memory = NULL;
+    char *cached = NULL;
+    int i = 0, j = 0;
+
+    for(i = 1; i < inodetableobj.NextUnused; i++)
+    {
+        temp = getInode(i);
+        if(temp -> FileType == 0)
+        {
+            continue;
+        }
+
+        // Blocks shared by copied files are seen once per file, only the first visit moves them
+        for(j = 0; j < getInodeBlockCount(temp); j++)
+        {
+            block = getInodeBlock(temp, j);
+            if(block == NULL || block -> Map != NULL || (block -> Data == NULL) == bToDisk)
+            {
+                continue;
+            }
+
+            if(bToDisk == true)
+            {
+                memory = block -> Data;
+                initDiskBlock(block);
+
+                cached = pinDiskBlock(block);
+                if(cached == NULL)
+                {
+                    dropDiskBlock(block);
+                    block -> Data = memory;
+                    return ERR_INSUFFICIENT_SPACE;
+                }
+
+                memcpy(cached, memory, BLOCKSIZE);
+                unpinDiskBlock(block, true);
+                freeBlock(memory);
+            }
+            else
+            {
+                memory = allocBlock();
+                if(memory == NULL)
+                {
+                    return ERR_INSUFFICIENT_SPACE;
+                }
+
+                cached = pinDiskBlock(block);
+                if(cached == NULL)
+                {
+                    freeBlock(memory);
+                    return ERR_HOST_IO;
+                }
+
+                memcpy(memory, cached, BLOCKSIZE);
+                unpinDiskBlock(block, false);
+                dropDiskBlock(block);
+                block -> Data = memory;
+            }
+        }
+    }
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         deviceOpen()
+//  Description:           Opens the storage file with the given settings, a new one is created with
+//                         its header. O_DIRECT falls back to buffered I/O where the host refuses it.
+//  Input:                 Buffer cache size in blocks, O_DIRECT wanted, true to start a new file
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int deviceOpen(long long cacheBlocks, bool bDirect, bool bCreate)
+{
+    STORAGEHEADER header;
+    int fd = 0;
+
+    fd = open(STORAGE_FILE, O_RDWR | O_CREAT | ((bCreate == true) ? O_TRUNC : 0), 0644);
+    if(fd < 0)
+    {
+        return ERR_HOST_IO;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.Magic, STORAGE_MAGIC, sizeof(header.Magic));
+    header.Version = STORAGE_VERSION;
+    header.HeaderSize = sizeof(STORAGEHEADER);
+    header.CacheBlocks = cacheBlocks;
+    header.Flags = (bDirect == true) ? STORAGE_DIRECT : 0;
+
+    if(pwrite(fd, &header, sizeof(header), 0) != sizeof(header))
+    {
+        close(fd);
+        return ERR_HOST_IO;
+    }
+
+    deviceobj.bDirect = false;
+    if(bDirect == true)
+    {
+        deviceobj.Fd = open(STORAGE_FILE, O_RDWR | O_DIRECT);
+        deviceobj.bDirect = (deviceobj.Fd >= 0);
+    }
+
+    if(deviceobj.bDirect == true)
+    {
+        close(fd);
+    }
+    else
+    {
+        deviceobj.Fd = fd;
+    }
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         storageStart()
+//  Description:           Turns disk mode on, or changes its settings: the data blocks of all files
+//                         move to the storage file and from then on are read and written through a
+//                         buffer cache of the given size
+//  Input:                 Buffer cache size in blocks, true for O_DIRECT
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int storageStart(long long cacheBlocks, bool bDirect)
+{
+    int iRet = 0;
+
+    if(cacheBlocks < CACHE_MIN_BLOCKS || cacheBlocks > 0x7fffffff)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // The blocks a running backup reads must not move under it
+    backupWait();
+
+    // Already on: write the cached blocks out and start over with the new cache
+    if(deviceobj.Fd >= 0)
+    {
+        ioThreadStop();
+
+        iRet = cacheDestroy();
+        if(iRet != EXECUTE_SUCCESS)
+        {
+            ioThreadStart();
+            return iRet;
+        }
+
+        close(deviceobj.Fd);
+        deviceobj.Fd = -1;
+
+        iRet = deviceOpen(cacheBlocks, bDirect, false);
+        if(iRet == EXECUTE_SUCCESS)
+        {
+            iRet = cacheCreate((int)cacheBlocks);
+        }
+        if(iRet != EXECUTE_SUCCESS)
+        {
+            printf("CVFS: The storage file can not be reopened, disk blocks are unreadable.\n");
+            return iRet;
+        }
+
+        ioThreadStart();
+        deviceobj.bEnabled = true;
+        return EXECUTE_SUCCESS;
+    }
+
+    iRet = cacheCreate((int)cacheBlocks);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        return iRet;
+    }
+
+    iRet = deviceOpen(cacheBlocks, bDirect, true);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        cacheDestroy();
+        return iRet;
+    }
+
+    deviceobj.bEnabled = true;
+    deviceobj.Blocks = 0;
+    deviceobj.FreeCount = 0;
+    deviceobj.Reads = 0;
+    deviceobj.Writes = 0;
+    deviceobj.Errors = 0;
+    cacheobj.Hits = 0;
+    cacheobj.Misses = 0;
+    cacheobj.Evictions = 0;
+    cacheobj.WriteBacks = 0;
+    cacheobj.ReadAheads = 0;
+    cacheobj.ReadAheadHits = 0;
+    cacheobj.Flushes = 0;
+    cacheobj.Flushed = 0;
+    cacheobj.Throttles = 0;
+
+    ioThreadStart();
+
+    return moveBlocks(true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         storageStop()
+//  Description:           Turns disk mode off: the data blocks of all files move back to memory and
+//                         the storage file is removed
+//  Input:                 void
+//  Output:                Status Code, disk mode stays on if the blocks do not fit in memory
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int storageStop()
+{
+    int iRet = 0;
+
+    if(deviceobj.Fd < 0)
+    {
+        return EXECUTE_SUCCESS;
+    }
+
+    backupWait();
+
+    iRet = moveBlocks(false);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        return iRet;
+    }
+
+    // Only blocks of files are moved, nothing else may still live in the storage file
+    if(cacheobj.Blocks != 0)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    deviceobj.bEnabled = false;
+
+    ioThreadStop();
+
+    iRet = cacheDestroy();
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        ioThreadStart();
+        return iRet;
+    }
+
+    close(deviceobj.Fd);
+    unlink(STORAGE_FILE);
+
+    free(deviceobj.FreeBlocks);
+    deviceobj.FreeBlocks = NULL;
+    deviceobj.FreeCount = 0;
+    deviceobj.FreeCapacity = 0;
+    deviceobj.Blocks = 0;
+    deviceobj.Fd = -1;
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         storageResume()
+//  Description:           Turns disk mode back on at startup when the storage file of an earlier run
+//                         exists, with its settings. Called before the backup is restored, so a
+//                         filesystem larger than memory can come back.
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void storageResume()
+{
+    STORAGEHEADER header;
+    int fd = 0;
+
+    fd = open(STORAGE_FILE, O_RDONLY);
+    if(fd < 0)
+    {
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    if(readAll(fd, &header, sizeof(header)) != sizeof(header) || memcmp(header.Magic, STORAGE_MAGIC, sizeof(header.Magic)) != 0 ||
+       header.Version != STORAGE_VERSION || header.HeaderSize != sizeof(STORAGEHEADER))
+    {
+        printf("CVFS: Storage file is damaged, ignored.\n");
+        close(fd);
+        return;
+    }
+    close(fd);
+
+    if(storageStart(header.CacheBlocks, (header.Flags & STORAGE_DIRECT) != 0) != EXECUTE_SUCCESS)
+    {
+        printf("CVFS: Unable to turn disk storage back on, file data is kept in memory.\n");
+        return;
+    }
+
+    printf("CVFS: Disk storage on (%s, %lld MB buffer cache).\n", STORAGE_FILE, header.CacheBlocks * BLOCKSIZE / (1024 * 1024));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         storageClose()
+//  Description:           Gives the space of the storage file back at exit, only its header (the
+//                         settings for the next start) is kept
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void storageClose()
+{
+    if(deviceobj.Fd < 0)
+    {
+        return;
+    }
+
+    deviceobj.bEnabled = false;
+
+    ioThreadStop();
+
+    if(ftruncate(deviceobj.Fd, BLOCKSIZE) != 0)
+    {
+        printf("CVFS: Unable to shrink %s.\n", STORAGE_FILE);
+    }
+
+    close(deviceobj.Fd);
+    deviceobj.Fd = -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         displayStorageStatus()
+//  Description:           Shows where file data is kept and how the buffer cache is doing
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void displayStorageStatus()
+{
+    long long lookups = 0;
+
+    if(deviceobj.Fd < 0)
+    {
+        printf("Storage             : memory (file data is limited by RAM)\n");
+        return;
+    }
+
+    pthread_mutex_lock(&cacheobj.Lock);
+
+    lookups = cacheobj.Hits + cacheobj.Misses;
+
+    printf("Storage             : disk (%s%s)\n", STORAGE_FILE, (deviceobj.bDirect == true) ? ", O_DIRECT" : "");
+    printf("Buffer cache        : %d of %d buffers in use (%.1f MB), %d past capacity\n", cacheobj.Resident,
+           cacheobj.Capacity, (double)cacheobj.Capacity * BLOCKSIZE / (1024 * 1024), cacheobj.Overflow);
+    printf("Disk blocks         : %lld in files, %lld in the storage file (%lld free)\n", cacheobj.Blocks,
+           deviceobj.Blocks, deviceobj.FreeCount);
+    printf("Hits / misses       : %lld / %lld (%.1f%% hit rate)\n", cacheobj.Hits, cacheobj.Misses,
+           (lookups > 0) ? cacheobj.Hits * 100.0 / lookups : 0.0);
+    printf("Evictions           : %lld (%lld dirty blocks written back)\n", cacheobj.Evictions, cacheobj.WriteBacks);
+    printf("Read-ahead          : %lld blocks, %lld of them used\n", cacheobj.ReadAheads, cacheobj.ReadAheadHits);
+    printf("Flusher             : %lld blocks in %lld writes, %d dirty now, writers held back %lld times\n",
+           cacheobj.Flushed, cacheobj.Flushes, cacheobj.Dirty, cacheobj.Throttles);
+    printf("Device reads/writes : %lld / %lld, %lld failed\n", deviceobj.Reads, deviceobj.Writes, deviceobj.Errors);
+
+    pthread_mutex_unlock(&cacheobj.Lock);
+}
@@ -15,9 +15,295 @@
 
 struct Bootblock  bootobj;
 struct Superblock superobj;
-struct UAREA      uareaobj;
+struct UAREA      uareaobj = {.Lock = PTHREAD_RWLOCK_INITIALIZER};
 
-PINODE head = NULL;                                             /* Head pointer for the Inode Linked List */
+struct InodeTable inodetableobj = {.Lock = PTHREAD_MUTEX_INITIALIZER};   /* Chunked table holding every inode */
+pthread_mutex_t   namespacelock = PTHREAD_MUTEX_INITIALIZER;    /* Name changes and their journal records */
+
+static pthread_mutex_t sessionlock = PTHREAD_MUTEX_INITIALIZER;  /* The list of sessions */
+static pthread_key_t   sessionKey;                              /* Session a thread works in */
+static pthread_once_t  sessionOnce = PTHREAD_ONCE_INIT;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         descriptorWords()
+//  Description:           Number of words of a level of the free descriptor bitmap
+//  Input:                 Table slots, level
+//  Output:                Words
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static long long descriptorWords(long long capacity, int level)
+{
+    int i = 0;
+
+    for(i = 0; i < level; i++)
+    {
+        capacity = (capacity + 63) / 64;
+    }
+
+    return (capacity + 63) / 64;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         fillDescriptors()
+//  Description:           Marks a range of descriptor slots free, with the bits of every level above them.
+//                         The caller holds the session lock alone (or the session is not in use yet).
+//  Input:                 Session, first slot, end of the range
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void fillDescriptors(PUAREA session, long long from, long long to)
+{
+    long long bit = 0;
+    int level = 0;
+
+    if(from >= to)
+    {
+        return;
+    }
+
+    to = to - 1;
+    for(level = 0; level < FDMAP_LEVELS; level++)
+    {
+        for(bit = from; bit <= to; bit++)
+        {
+            session -> FreeMap[level][bit >> 6] |= 1ULL << (bit & 63);
+        }
+
+        from = from >> 6;
+        to = to >> 6;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         resetDescriptors()
+//  Description:           Marks every descriptor slot of a session free, except 0, 1, 2 (stdin, stdout,
+//                         stderr). The caller holds the session lock alone.
+//  Input:                 Session
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void resetDescriptors(PUAREA session)
+{
+    int level = 0;
+
+    session -> OpenCount = 0;
+
+    if(session -> Capacity == 0)
+    {
+        return;
+    }
+
+    memset(session -> UFDT, 0, sizeof(PFILETABLE) * session -> Capacity);
+    for(level = 0; level < FDMAP_LEVELS; level++)
+    {
+        memset(session -> FreeMap[level], 0, sizeof(unsigned long long) * descriptorWords(session -> Capacity, level));
+    }
+
+    fillDescriptors(session, 3, session -> Capacity);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         growDescriptors()
+//  Description:           Doubles the descriptor table of a session (the first call sizes it to
+//                         MAXOPENFILES) and marks the new slots free. The caller holds the session lock
+//                         alone (or the session is not in use yet).
+//  Input:                 Session
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int growDescriptors(PUAREA session)
+{
+    PFILETABLE *newTable = NULL;
+    unsigned long long *newMap = NULL;
+    long long oldWords = 0;
+    long long newWords = 0;
+    int capacity = 0;
+    int level = 0;
+
+    capacity = (session -> Capacity < MAXOPENFILES) ? MAXOPENFILES : session -> Capacity * 2;
+    if(capacity > MAXDESCRIPTORS)
+    {
+        capacity = MAXDESCRIPTORS;
+    }
+
+    if(capacity <= session -> Capacity)
+    {
+        return ERR_MAX_FILES_OPEN;
+    }
+
+    // Bitmap levels first, a level that grew before a failure just has spare zero words
+    for(level = 0; level < FDMAP_LEVELS; level++)
+    {
+        oldWords = descriptorWords(session -> Capacity, level);
+        newWords = descriptorWords(capacity, level);
+        if(newWords == oldWords)
+        {
+            continue;
+        }
+
+        newMap = (unsigned long long *)realloc(session -> FreeMap[level], sizeof(unsigned long long) * newWords);
+        if(newMap == NULL)
+        {
+            return ERR_MAX_FILES_OPEN;
+        }
+
+        memset(newMap + oldWords, 0, sizeof(unsigned long long) * (newWords - oldWords));
+        session -> FreeMap[level] = newMap;
+    }
+
+    newTable = (PFILETABLE *)realloc(session -> UFDT, sizeof(PFILETABLE) * capacity);
+    if(newTable == NULL)
+    {
+        return ERR_MAX_FILES_OPEN;
+    }
+
+    memset(newTable + session -> Capacity, 0, sizeof(PFILETABLE) * (capacity - session -> Capacity));
+    session -> UFDT = newTable;
+
+    fillDescriptors(session, (session -> Capacity > 3) ? session -> Capacity : 3, capacity);
+    session -> Capacity = capacity;
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         freeDescriptors()
+//  Description:           Frees the descriptor table of a session and its bitmap
+//  Input:                 Session
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void freeDescriptors(PUAREA session)
+{
+    int level = 0;
+
+    for(level = 0; level < FDMAP_LEVELS; level++)
+    {
+        free(session -> FreeMap[level]);
+        session -> FreeMap[level] = NULL;
+    }
+
+    free(session -> UFDT);
+    session -> UFDT = NULL;
+    session -> Capacity = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         clearDescriptorBit()
+//  Description:           Clears the bit of an upper bitmap level that marks a word of the level below
+//                         as having a free slot, once that word is empty, and goes on up while the words
+//                         it clears become empty. Slots are only freed with the session lock taken alone,
+//                         so while claims run bits only go from free to used.
+//  Input:                 Session, level (1 or more), bit
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void clearDescriptorBit(PUAREA session, int level, long long bit)
+{
+    unsigned long long mask = 0;
+    unsigned long long old = 0;
+
+    for(; level < FDMAP_LEVELS; level++)
+    {
+        mask = 1ULL << (bit & 63);
+        old = __atomic_fetch_and(&session -> FreeMap[level][bit >> 6], ~mask, __ATOMIC_ACQ_REL);
+
+        // Another claim cleared it already, or the word still marks other words
+        if((old & mask) == 0 || (old & ~mask) != 0)
+        {
+            return;
+        }
+
+        bit = bit >> 6;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         claimDescriptor()
+//  Description:           Takes the lowest free descriptor slot of a session: from the single word of
+//                         the top bitmap level, the lowest set bit of each level (find first set) leads
+//                         to the word below, so the cost does not depend on the table size. Threads
+//                         opening files in the same session claim slots at the same time with atomic
+//                         bit operations under the shared session lock.
+//  Input:                 Session
+//  Output:                Slot or ERR_MAX_FILES_OPEN if the table is full
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int claimDescriptor(PUAREA session)
+{
+    unsigned long long bits = 0;
+    unsigned long long mask = 0;
+    long long index = 0;
+    int level = 0;
+
+    if(session -> Capacity == 0)
+    {
+        return ERR_MAX_FILES_OPEN;
+    }
+
+    while(true)
+    {
+        index = 0;
+        for(level = FDMAP_LEVELS - 1; level >= 0; level--)
+        {
+            bits = __atomic_load_n(&session -> FreeMap[level][index], __ATOMIC_ACQUIRE);
+            if(bits == 0)
+            {
+                break;
+            }
+
+            index = index * 64 + __builtin_ctzll(bits);
+        }
+
+        if(level == FDMAP_LEVELS - 1)
+        {
+            return ERR_MAX_FILES_OPEN;
+        }
+
+        // Another claim emptied the word and has not cleared its mark yet
+        if(level >= 0)
+        {
+            clearDescriptorBit(session, level + 1, index);
+            continue;
+        }
+
+        // Lost the slot to another claim, look again
+        mask = 1ULL << (index & 63);
+        bits = __atomic_fetch_and(&session -> FreeMap[0][index >> 6], ~mask, __ATOMIC_ACQ_REL);
+        if((bits & mask) == 0)
+        {
+            continue;
+        }
+
+        if((bits & ~mask) == 0)
+        {
+            clearDescriptorBit(session, 1, index >> 6);
+        }
+
+        return (int)index;
+    }
+}
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -28,15 +314,25 @@ PINODE head = NULL;                                             /* Head pointer
 
 void initialiseUAREA()
 {
-    int i = 0;
+    PUAREA session = NULL;
 
     strcpy(uareaobj.ProcessName, "Myexe");                      /* Set the process name */
-    
-    /* Initialize all UFDT pointers to NULL */
-    for(i = 0; i < MAXOPENFILES; i++)
+
+    if(uareaobj.UFDT == NULL)
+    {
+        growDescriptors(&uareaobj);
+    }
+
+    /* Initialize all UFDT pointers to NULL, in every session (the files they refer to are gone) */
+    pthread_mutex_lock(&sessionlock);
+    for(session = &uareaobj; session != NULL; session = session -> Next)
     {
-        uareaobj.UFDT[i] = NULL;
+        pthread_rwlock_wrlock(&session -> Lock);
+        resetDescriptors(session);
+        pthread_rwlock_unlock(&session -> Lock);
     }
+    pthread_mutex_unlock(&sessionlock);
+
     printf("CVFS: UAREA initialized successfully.\n");
 }
 
@@ -51,8 +347,13 @@ void initialiseUAREA()
 
 void initialiseSuperBlock()
 {
-    superobj.TotalInodes = MAXINODE;
-    superobj.FreeInodes  = MAXINODE;                            /* Initially, all inodes are free */
+    superobj.TotalInodes = 0;                                   /* Capacity grows with the inode table */
+    superobj.FreeInodes  = 0;
+    superobj.LogicalBlocks = 0;
+    superobj.MappedBlocks = 0;
+    superobj.CopiedBlocks = 0;
+    superobj.Generation = 1;                                    /* Nothing is backed up yet (generation 0) */
+    superobj.NextFileId = 1;
 
     printf("CVFS: Superblock initialized successfully.\n");
 }
@@ -60,51 +361,204 @@ void initialiseSuperBlock()
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 //  Function Name:         createDILB()
-//  Description:           Creates the Disk Inode List Block (Linked List of Inodes)
+//  Description:           Creates the Disk Inode List Block (growable table of inode chunks)
 //  Author:                Ritesh Jillewad
 //  Date:                  13/01/2026
 //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void createDILB()                                               
+{
+    /* No inode is allocated up front, chunks are added on demand by allocateInode() */
+    inodetableobj.ChunkCount = 0;
+    inodetableobj.NextUnused = 1;                               /* Inode numbers start from 1 */
+    inodetableobj.FreeList = NULL;
+
+    printf("CVFS: DILB created successfully.\n");
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getInode()
+//  Description:           Returns the inode with the given number from the inode table
+//  Input:                 Inode number
+//  Output:                Inode pointer or NULL if the number was never handed out
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PINODE getInode(int inodeNumber)
+{
+    // Pairs with the store in allocateInode(): an inode below NextUnused is fully set up
+    if(inodeNumber < 1 || inodeNumber >= __atomic_load_n(&inodetableobj.NextUnused, __ATOMIC_ACQUIRE))
+    {
+        return NULL;
+    }
+
+    return &inodetableobj.Chunks[(inodeNumber - 1) / INODECHUNKSIZE][(inodeNumber - 1) % INODECHUNKSIZE];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         allocateInode()
+//  Description:           Takes a free inode from the free list, or the next unused one of the table,
+//                         adding a new chunk when the table is full
+//  Input:                 void
+//  Output:                Inode pointer or NULL if the table cannot grow
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PINODE allocateInode()
 {
     PINODE newnode = NULL;
-    PINODE temp = NULL;
-    int i = 0;                                                  /* Counter for inode numbers */
+    PINODE newChunk = NULL;
+    pthread_rwlock_t *newLocks = NULL;
+    int number = 0;
+    int i = 0;
 
-    temp = head;                                                /* Preserve the current head pointer */
-    
-    /* Iterate to create inodes */
-    for(i = 1; i <= MAXINODE; i++)
-    {
-        /* Allocate memory for a new inode */
-        newnode = (PINODE)malloc(sizeof(INODE));
-
-        /* Initialize inode members */
-        strcpy(newnode -> FileName, "\0");
-        newnode -> InodeNumber = i;
-        newnode -> FileSize = 0;
-        newnode -> ActualFileSize = 0;
-        newnode -> FileType = 0;
-        newnode -> ReferenceCount = 0;
-        newnode -> Permission = 0;
-        newnode -> Buffer = NULL;
+    pthread_mutex_lock(&inodetableobj.Lock);
+
+    // 1. Reuse a released inode
+    if(inodetableobj.FreeList != NULL)
+    {
+        newnode = inodetableobj.FreeList;
+        inodetableobj.FreeList = newnode -> next;
         newnode -> next = NULL;
 
-        /* Link the new inode to the list */
-        if(temp == NULL)                                        /* Case 1: Linked List is empty */
+        // A reused inode is a new file for the backup
+        newnode -> FileId = superobj.NextFileId++;
+        newnode -> Generation = superobj.Generation;
+        newnode -> BaseGeneration = superobj.Generation;
+
+        superobj.FreeInodes--;
+        pthread_mutex_unlock(&inodetableobj.Lock);
+        return newnode;
+    }
+
+    number = inodetableobj.NextUnused;
+    if(number > MAXINODE)
+    {
+        pthread_mutex_unlock(&inodetableobj.Lock);
+        return NULL;
+    }
+
+    // 2. All chunks are used up, add a new one together with the locks of its inodes
+    if(number > inodetableobj.ChunkCount * INODECHUNKSIZE)
+    {
+        newChunk = (PINODE)arenaAlloc(sizeof(INODE) * INODECHUNKSIZE);
+        newLocks = (pthread_rwlock_t *)arenaAlloc(sizeof(pthread_rwlock_t) * INODECHUNKSIZE);
+        if(newChunk == NULL || newLocks == NULL)
         {
-            head = newnode;
-            temp = head;
+            pthread_mutex_unlock(&inodetableobj.Lock);
+            return NULL;
         }
-        else                                                    /* Case 2: Linked List contains at least one node */
+
+        for(i = 0; i < INODECHUNKSIZE; i++)
         {
-            temp -> next = newnode;
-            temp = temp -> next;        
+            pthread_rwlock_init(&newLocks[i], NULL);
         }
+
+        inodetableobj.Chunks[inodetableobj.ChunkCount] = newChunk;
+        inodetableobj.Locks[inodetableobj.ChunkCount] = newLocks;
+        inodetableobj.ChunkCount++;
+
+        superobj.TotalInodes = superobj.TotalInodes + INODECHUNKSIZE;
+        superobj.FreeInodes = superobj.FreeInodes + INODECHUNKSIZE;
     }
 
-    printf("CVFS: DILB created successfully.\n");
+    // 3. Hand out the next unused inode of the last chunk
+    newnode = &inodetableobj.Chunks[(number - 1) / INODECHUNKSIZE][(number - 1) % INODECHUNKSIZE];
+
+    /* Initialize inode members */
+    memset(newnode, 0, sizeof(INODE));
+    newnode -> InodeNumber = number;
+    newnode -> BlockMap = NULL;
+    newnode -> next = NULL;
+    newnode -> FileId = superobj.NextFileId++;
+    newnode -> Generation = superobj.Generation;
+    newnode -> BaseGeneration = superobj.Generation;
+
+    // Lock-free readers of the table see the inode only from here on
+    __atomic_store_n(&inodetableobj.NextUnused, number + 1, __ATOMIC_RELEASE);
+
+    superobj.FreeInodes--;
+    pthread_mutex_unlock(&inodetableobj.Lock);
+    return newnode;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         releaseInode()
+//  Description:           Resets an inode and puts it back on the free list
+//  Input:                 Inode pointer (write locked by the caller while other threads may use it)
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void releaseInode(PINODE inode)
+{
+    freeInodeBlocks(inode);
+
+    inode -> ActualFileSize = 0;
+    inode -> FileType = 0;
+    inode -> ReferenceCount = 0;
+    inode -> OpenFiles = NULL;
+    inode -> Permission = 0;
+    memset(inode -> FileName, 0, sizeof(inode -> FileName));
+
+    pthread_mutex_lock(&inodetableobj.Lock);
+
+    inode -> next = inodetableobj.FreeList;
+    inodetableobj.FreeList = inode;
+
+    superobj.FreeInodes++;
+
+    pthread_mutex_unlock(&inodetableobj.Lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         lockInode()
+//  Description:           Takes the reader/writer lock of an inode: shared to read the file, exclusive
+//                         to change its data or metadata. Readers of one file run side by side, files
+//                         never wait for each other.
+//  Input:                 Inode pointer, true for the write lock
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void lockInode(PINODE inode, bool bWrite)
+{
+    int number = inode -> InodeNumber - 1;
+
+    if(bWrite == true)
+    {
+        pthread_rwlock_wrlock(&inodetableobj.Locks[number / INODECHUNKSIZE][number % INODECHUNKSIZE]);
+    }
+    else
+    {
+        pthread_rwlock_rdlock(&inodetableobj.Locks[number / INODECHUNKSIZE][number % INODECHUNKSIZE]);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         unlockInode()
+//  Description:           Releases the lock taken by lockInode()
+//  Input:                 Inode pointer
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void unlockInode(PINODE inode)
+{
+    int number = inode -> InodeNumber - 1;
+
+    pthread_rwlock_unlock(&inodetableobj.Locks[number / INODECHUNKSIZE][number % INODECHUNKSIZE]);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -121,10 +575,16 @@ void startAuxillaryDataInitialization()
     strcpy(bootobj.Information, "CVFS booting process completed.\n");
     printf("%s\n", bootobj.Information);
 
+    initialiseAllocator();
     initialiseSuperBlock();
     createDILB();
     initialiseUAREA();
 
+    if(initialiseNameIndex(INDEX_INITIAL_CAPACITY) == EXECUTE_SUCCESS)
+    {
+        printf("CVFS: Filename index initialized successfully.\n");
+    }
+
     printf("CVFS: Auxiliary data initialized successfully.\n");
 }
 
@@ -148,8 +608,12 @@ void displayHelp()
     printf("help    : Display this help manual.\n");
     printf("clear   : Clear the terminal screen.\n");
     printf("exit    : Terminate the CVFS application.\n");
-    printf("backup  : Backup filesystem to disk.\n");
-    printf("restore : Restore filesystem from disk.\n");
+    printf("backup  : Backup filesystem to disk in the background (full / status / wait).\n");
+    printf("restore : Restore filesystem from disk, or one file (restore name).\n");
+    printf("scrub   : Verify the checksums of the data in memory and of the backup.\n");
+    printf("journal : Log every change to disk as it happens (on [us] / off / status).\n");
+    printf("storage : Keep file data in memory or on disk behind a buffer cache.\n");
+    printf("session : Work with the descriptors of another session (close to end one).\n");
 
     printf("\n[ FILE OPERATIONS ]\n");
     printf("ls      : List all files currently in the system.\n");
@@ -158,16 +622,22 @@ void displayHelp()
     printf("close   : Close an opened file.\n");
     printf("read    : Read data from an open file.\n");
     printf("write   : Write data into an open file.\n");
+    printf("lseek   : Change the read/write offset of an open file.\n");
+    printf("pread   : Read data from a given offset of an open file.\n");
+    printf("pwrite  : Write data at a given offset of an open file.\n");
     printf("rm      : Delete a file from the system.\n");
     printf("cp      : Copy contents from source to destination.\n");
     printf("mv      : Rename a file (usage: rename old new).\n");
     printf("cat     : Display file contents.\n");
+    printf("export  : Copy a file out to the host system.\n");
+    printf("import  : Copy a file from the host system into CVFS.\n");
     printf("truncate: Remove all data from a file.\n");
     printf("chmod   : Change the file permissions.\n");
 
     printf("\n[ INFORMATION ]\n");
     printf("stat    : Display statistical information of a file by name.\n");
     printf("fstat   : Display statistical information of a file by descriptor.\n");
+    printf("memstat : Display memory allocator usage statistics.\n");
     printf("----------------------------------------------------------------------------\n");
 }
 
@@ -244,6 +714,33 @@ void manPageDisplay(char Name[])                             /* Name stores the
     }
 
     
+    /* Manual page for lseek command */
+    else if(strcmp("lseek", Name) == 0)
+    {
+        printf("NAME        : lseek\n");
+        printf("DESCRIPTION : Reposition the read and write offset of an opened file.\n");
+        printf("USAGE       : lseek <file_descriptor> <offset> <origin>\n");
+        printf("ARGUMENTS   : offset (Byte offset, may be negative for origin 1 and 2)\n");
+        printf("              origin (0:Start of file, 1:Current offset, 2:End of file)\n");
+    }
+
+    /* Manual page for pread command */
+    else if(strcmp("pread", Name) == 0)
+    {
+        printf("NAME        : pread\n");
+        printf("DESCRIPTION : Read data from a given offset without moving the file offset.\n");
+        printf("USAGE       : pread <file_descriptor> <number_of_bytes> <offset>\n");
+    }
+
+    /* Manual page for pwrite command */
+    else if(strcmp("pwrite", Name) == 0)
+    {
+        printf("NAME        : pwrite\n");
+        printf("DESCRIPTION : Write data at a given offset without moving the file offset.\n");
+        printf("USAGE       : pwrite <file_descriptor> <offset>\n");
+        printf("NOTE        : Follow the command by entering the data text.\n");
+    }
+
     /* Manual page for stat command */
     else if(strcmp("stat", Name) == 0)
     {
@@ -321,6 +818,8 @@ void manPageDisplay(char Name[])                             /* Name stores the
     {
         printf("NAME        : cp\n");
         printf("DESCRIPTION : Copy content from source file to destination file.\n");
+        printf("              The copy shares the data blocks of the source (copy-on-write),\n");
+        printf("              a block is duplicated only when one of the files writes to it.\n");
         printf("USAGE       : cp <source> <destination>\n");
     }
 
@@ -332,6 +831,27 @@ void manPageDisplay(char Name[])                             /* Name stores the
         printf("USAGE       : cat <filename>\n");
     }
 
+    /* Manual page for export command */
+    else if(strcmp("export", Name) == 0)
+    {
+        printf("NAME        : export\n");
+        printf("DESCRIPTION : Copy a file out of CVFS to a file on the host system.\n");
+        printf("USAGE       : export <file_name> <host_path>\n");
+        printf("ARGUMENTS   : file_name (Name of the CVFS file)\n");
+        printf("              host_path (Host file to create or overwrite)\n");
+    }
+
+    /* Manual page for import command */
+    else if(strcmp("import", Name) == 0)
+    {
+        printf("NAME        : import\n");
+        printf("DESCRIPTION : Create a CVFS file from a file on the host system.\n");
+        printf("              Binary content is copied byte for byte.\n");
+        printf("USAGE       : import <host_path> <file_name>\n");
+        printf("ARGUMENTS   : host_path (Host file to read)\n");
+        printf("              file_name (Name of the new CVFS file)\n");
+    }
+
     /* Manual page for rename command */
     else if(strcmp("rename", Name) == 0)
     {
@@ -344,19 +864,102 @@ void manPageDisplay(char Name[])                             /* Name stores the
     else if(strcmp("backup", Name) == 0)
     {
         printf("NAME        : backup\n");
-        printf("DESCRIPTION : Backup all files to a local binary file.\n");
-        printf("USAGE       : backup\n");
+        printf("DESCRIPTION : Backup all files to a local binary file. After the first\n");
+        printf("              backup only the files and blocks changed since the last\n");
+        printf("              one are appended as a delta; 'full' rewrites the whole\n");
+        printf("              image (also done after %d deltas).\n", IMAGE_MAXSEGMENTS);
+        printf("              The files are snapshotted at once and written by a\n");
+        printf("              background thread while the shell keeps working; blocks\n");
+        printf("              written meanwhile are copied first (copy-on-write).\n");
+        printf("              Full images are compressed block by block; blocks that\n");
+        printf("              do not shrink are stored raw, zero blocks not at all.\n");
+        printf("              'status' shows the progress and what the backup costs\n");
+        printf("              the shell, 'wait' blocks until it is finished.\n");
+        printf("USAGE       : backup [full | status | wait]\n");
+    }
+
+    /* Manual page for journal command */
+    else if(strcmp("journal", Name) == 0)
+    {
+        printf("NAME        : journal\n");
+        printf("DESCRIPTION : Write-ahead journal. Every change is logged to %s\n", JOURNAL_FILE);
+        printf("              and replayed on top of the backup at startup, so nothing\n");
+        printf("              is lost on a crash. Records are committed (fsync) in\n");
+        printf("              batches: a record waits at most the commit interval, 0\n");
+        printf("              commits every change. The shell also commits before it\n");
+        printf("              waits for the next command. Each backup drops the records\n");
+        printf("              it holds.\n");
+        printf("USAGE       : journal | journal on [interval_us] | journal off\n");
+    }
+
+    /* Manual page for session command */
+    else if(strcmp("session", Name) == 0)
+    {
+        printf("NAME        : session\n");
+        printf("DESCRIPTION : Sessions are independent clients of the file system. Each\n");
+        printf("              has its own descriptor numbers, which start from 3 and\n");
+        printf("              grow as files are opened, while the files themselves are\n");
+        printf("              shared. A name that is not in use creates a session, the\n");
+        printf("              shell then works in it. 'close' closes every descriptor of\n");
+        printf("              a session and ends it. Without arguments the sessions and\n");
+        printf("              their open files are listed.\n");
+        printf("USAGE       : session | session name | session close name\n");
+    }
+
+    /* Manual page for storage command */
+    else if(strcmp("storage", Name) == 0)
+    {
+        printf("NAME        : storage\n");
+        printf("DESCRIPTION : Where file data is kept. 'disk' moves every data block to\n");
+        printf("              %s and reads and writes them through an LRU\n", STORAGE_FILE);
+        printf("              buffer cache of the given size (default %d MB), so files\n", CACHE_DEFAULT_MB);
+        printf("              can be larger than memory. 'direct' does the same with\n");
+        printf("              O_DIRECT where the host supports it. Sequential reads on\n");
+        printf("              a descriptor are read ahead and dirty blocks are written\n");
+        printf("              back in the background, both in large requests. 'memory'\n");
+        printf("              brings the blocks back. The mode is kept across restarts;\n");
+        printf("              without arguments the cache hit rate, evictions,\n");
+        printf("              read-ahead and flusher activity are shown.\n");
+        printf("USAGE       : storage | storage disk [cache_MB] | storage direct [cache_MB] | storage memory\n");
     }
 
     /* Manual page for restore command */
     else if(strcmp("restore", Name) == 0)
     {
         printf("NAME        : restore\n");
-        printf("DESCRIPTION : Restore files from local backup.\n");
-        printf("USAGE       : restore\n");
+        printf("DESCRIPTION : Restore files from local backup (also done at startup).\n");
+        printf("              An uncompressed image is mapped, file data is read from\n");
+        printf("              it until a file is written. A compressed image is\n");
+        printf("              decompressed by several threads at once. Every block is\n");
+        printf("              verified against its checksum on the way in.\n");
+        printf("              With a filename only that file is restored: the image\n");
+        printf("              has a name index, so only its data is read. The name\n");
+        printf("              must not be in use.\n");
+        printf("USAGE       : restore | restore File_name\n");
     }
 
-    /* Manual page for chmod command */
+    /* Manual page for scrub command */
+    else if(strcmp("scrub", Name) == 0)
+    {
+        printf("NAME        : scrub\n");
+        printf("DESCRIPTION : Verify the CRC32C checksums of all data. Blocks in memory\n");
+        printf("              keep the checksum of their last backup or restore until\n");
+        printf("              they are written; the backup image has checksums for its\n");
+        printf("              header, inode table, every block and every delta segment.\n");
+        printf("              Damaged blocks are listed by file. SSE4.2 is used when\n");
+        printf("              the processor has it.\n");
+        printf("USAGE       : scrub\n");
+    }
+
+    /* Manual page for memstat command */
+    else if(strcmp("memstat", Name) == 0)
+    {
+        printf("NAME        : memstat\n");
+        printf("DESCRIPTION : Display usage of the slab caches, data block arena and inode table.\n");
+        printf("USAGE       : memstat\n");
+    }
+
+    /* Manual page for chmod command */
     else if(strcmp("chmod", Name) == 0)
     {
         printf("NAME        : changemod\n");
@@ -384,29 +987,312 @@ void manPageDisplay(char Name[])                             /* Name stores the
 //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool isFileExists(const char* name)                     /* Filename to search for in the inode list */
+bool isFileExists(const char* name)                     /* Filename to search for in the filename index */
+{
+    return (lookupNameIndex(name) != NULL);
+}// End of isFileExists()
+
+/* Note: Only live regular files are present in the index, deleted files (FileType 0) are removed on unlink. */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         lookupLockedInode()
+//  Description:           Finds a file by name and locks its inode. Between the lookup and the lock the
+//                         file may have been unlinked (and its inode reused) or renamed, then the name
+//                         is looked up again.
+//  Input:                 Filename, true for the write lock
+//  Output:                Locked inode or NULL if there is no such file
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PINODE lookupLockedInode(const char *name, bool bWrite)
 {
     PINODE temp = NULL;
-    bool bFlag = false;
 
-    temp = head;                            
-    while(temp != NULL)                                 /* Iterate through the inode list */
+    while((temp = lookupNameIndex(name)) != NULL)
     {
-        /* Check if filename matches and it is a regular file */
-        if((strcmp(name, temp -> FileName) == 0) && (temp -> FileType) == REGULARFILE)
+        lockInode(temp, bWrite);
+
+        if(temp -> FileType != 0 && strcmp(temp -> FileName, name) == 0)
         {
-            /* File found */
-            bFlag = true;
-            break;
+            return temp;
         }
 
-        temp = temp -> next;
+        unlockInode(temp);
     }
 
-    return bFlag;
-}// End of isFileExists()
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         newFile()
+//  Description:           Allocates and initializes a file table entry for an inode
+//  Input:                 Inode pointer, open mode
+//  Output:                File table entry (referenced once, by the UFDT slot it is meant for) or NULL
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PFILETABLE newFile(PINODE inode, int mode)
+{
+    PFILETABLE file = NULL;
+
+    file = (PFILETABLE)allocObject(sizeof(FILETABLE));
+    if(file == NULL)
+    {
+        return NULL;
+    }
+
+    file -> ReadOffset = 0;
+    file -> WriteOffset = 0;
+    file -> Mode = mode;
+    file -> ptrinode = inode;
+    file -> ReadAheadNext = 0;
+    file -> ReadAheadEnd = 0;
+    file -> ReadAheadWindow = 0;
+    file -> RefCount = 1;
+    file -> bDeleted = false;
+    pthread_mutex_init(&file -> Lock, NULL);
+    file -> Session = NULL;
+    file -> Fd = -1;
+    file -> NextOpen = NULL;
+    file -> PrevOpen = NULL;
+
+    return file;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         installFile()
+//  Description:           Puts a file table entry into the lowest free UFDT slot of the calling thread's
+//                         session, doubling the table when it is full. 0, 1, 2 are reserved (stdin,
+//                         stdout, stderr). The entry is linked to the inode, whose write lock the
+//                         caller holds.
+//  Input:                 File table entry
+//  Output:                File descriptor or ERR_MAX_FILES_OPEN
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int installFile(PFILETABLE file)
+{
+    PUAREA session = getSession();
+    PINODE inode = file -> ptrinode;
+    int i = 0;
+
+    pthread_rwlock_rdlock(&session -> Lock);
+
+    i = claimDescriptor(session);
+
+    // Full: grow it alone, unless another thread grew it or closed a descriptor meanwhile
+    if(i < 0)
+    {
+        pthread_rwlock_unlock(&session -> Lock);
+        pthread_rwlock_wrlock(&session -> Lock);
+
+        i = claimDescriptor(session);
+        if(i < 0 && growDescriptors(session) == EXECUTE_SUCCESS)
+        {
+            i = claimDescriptor(session);
+        }
+
+        if(i < 0)
+        {
+            pthread_rwlock_unlock(&session -> Lock);
+            return ERR_MAX_FILES_OPEN;
+        }
+    }
+
+    file -> Session = session;
+    file -> Fd = i;
+
+    __atomic_store_n(&session -> UFDT[i], file, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&session -> OpenCount, 1, __ATOMIC_RELAXED);
+
+    pthread_rwlock_unlock(&session -> Lock);
+
+    // Every descriptor of every session is on the list of its inode, ReferenceCount is its length
+    file -> NextOpen = inode -> OpenFiles;
+    file -> PrevOpen = NULL;
+    if(inode -> OpenFiles != NULL)
+    {
+        inode -> OpenFiles -> PrevOpen = file;
+    }
+    inode -> OpenFiles = file;
+    inode -> ReferenceCount++;
+
+    return i;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         detachFile()
+//  Description:           Takes a file table entry off the list of its inode. The caller holds the
+//                         inode write lock.
+//  Input:                 File table entry
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void detachFile(PFILETABLE file)
+{
+    PINODE inode = file -> ptrinode;
+
+    if(file -> PrevOpen != NULL)
+    {
+        file -> PrevOpen -> NextOpen = file -> NextOpen;
+    }
+    else
+    {
+        inode -> OpenFiles = file -> NextOpen;
+    }
+
+    if(file -> NextOpen != NULL)
+    {
+        file -> NextOpen -> PrevOpen = file -> PrevOpen;
+    }
+
+    file -> NextOpen = NULL;
+    file -> PrevOpen = NULL;
+    inode -> ReferenceCount--;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         putFile()
+//  Description:           Drops a reference to a file table entry, the last one frees it
+//  Input:                 File table entry
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void putFile(PFILETABLE file)
+{
+    if(__atomic_sub_fetch(&file -> RefCount, 1, __ATOMIC_ACQ_REL) > 0)
+    {
+        return;
+    }
+
+    pthread_mutex_destroy(&file -> Lock);
+    freeObject(file, sizeof(FILETABLE));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         removeFile()
+//  Description:           Empties the UFDT slot of an entry if it still holds it (a close by another
+//                         thread may have emptied it already) and drops the reference of the slot.
+//                         The caller holds the inode write lock and has marked the entry deleted,
+//                         so it is no longer on the list of the inode.
+//  Input:                 File table entry
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void removeFile(PFILETABLE file)
+{
+    PUAREA session = file -> Session;
+
+    pthread_rwlock_wrlock(&session -> Lock);
+
+    if(session -> UFDT[file -> Fd] == file)
+    {
+        session -> UFDT[file -> Fd] = NULL;
+        session -> OpenCount--;
+        fillDescriptors(session, file -> Fd, file -> Fd + 1);
+        putFile(file);
+    }
+
+    pthread_rwlock_unlock(&session -> Lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         leaveFile()
+//  Description:           Ends a call started with enterFile()
+//  Input:                 File table entry, true if the offsets were locked
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void leaveFile(PFILETABLE file, bool bOffsets)
+{
+    unlockInode(file -> ptrinode);
+
+    if(bOffsets == true)
+    {
+        pthread_mutex_unlock(&file -> Lock);
+    }
+
+    putFile(file);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         enterFile()
+//  Description:           Starts a call on a descriptor: takes a reference to its file table entry so a
+//                         close meanwhile does not free it, the lock of the offsets if the call moves
+//                         them, then the inode lock. A file unlinked meanwhile is reported as closed.
+//  Input:                 File descriptor, true to lock the offsets, true for the inode write lock,
+//                         where to return the entry
+//  Output:                Status Code, on success the call ends with leaveFile()
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int enterFile(int fd, bool bOffsets, bool bWrite, PFILETABLE *pfile)
+{
+    PUAREA session = getSession();
+    PFILETABLE file = NULL;
+
+    if(fd < 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    pthread_rwlock_rdlock(&session -> Lock);
 
-/* Note: The && condition ensures that deleted files (FileType 0) are ignored. */
+    if(fd < session -> Capacity)
+    {
+        file = __atomic_load_n(&session -> UFDT[fd], __ATOMIC_ACQUIRE);
+    }
+
+    if(file != NULL)
+    {
+        __atomic_add_fetch(&file -> RefCount, 1, __ATOMIC_RELAXED);
+    }
+
+    pthread_rwlock_unlock(&session -> Lock);
+
+    if(file == NULL)
+    {
+        return ERR_FILE_NOT_EXISTS;
+    }
+
+    if(bOffsets == true)
+    {
+        pthread_mutex_lock(&file -> Lock);
+    }
+
+    lockInode(file -> ptrinode, bWrite);
+
+    // bDeleted is set under the inode write lock before the inode is released
+    if(file -> bDeleted == true)
+    {
+        leaveFile(file, bOffsets);
+        return ERR_FILE_NOT_EXISTS;
+    }
+
+    *pfile = file;
+
+    return EXECUTE_SUCCESS;
+}
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -422,9 +1308,10 @@ bool isFileExists(const char* name)                     /* Filename to search fo
 int createFile(char *name, int permission)
 {
     PINODE temp = NULL;
+    PFILETABLE file = NULL;
     int i = 0;
+    int iRet = 0;
 
-    temp = head;
     // printf("Remaining inodes: %d\n", superobj.FreeInodes);
 
     /* Input Validation */
@@ -435,6 +1322,12 @@ int createFile(char *name, int permission)
         return ERR_INVALID_PARAMETER;
     }
 
+    // Filename must fit in the inode (the index is keyed by the stored name)
+    if(strlen(name) == 0 || strlen(name) >= sizeof(temp -> FileName))
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
     // Validate permissions
     // Permission = 1 -> READ
     // Permission = 2 -> WRITE
@@ -444,13 +1337,7 @@ int createFile(char *name, int permission)
         return ERR_INVALID_PARAMETER;
     }
 
-    // Check if there are free inodes available
-    if(superobj.FreeInodes == 0)
-    {
-        return ERR_NO_INODES;
-    }
-
-    // Check if the file already exists
+    // Check if the file already exists (checked again when the name is inserted)
     if(isFileExists(name) == true)
     {
         return ERR_FILE_ALREADY_EXISTS;
@@ -458,68 +1345,63 @@ int createFile(char *name, int permission)
 
     /* Validation Passed */
 
-    // 1. Search for a free Inode
-    while(temp != NULL)
+    // 1. Take a free Inode from the inode table (grows on demand), it stays locked until the file is complete
+    temp = allocateInode();
+    if(temp == NULL)
     {
-        if((temp -> FileType) == 0)
-        {
-            // Found a free inode
-            break;
-        }
-        temp = temp -> next;
+        return ERR_NO_INODES;
     }
 
-    if(temp == NULL)
+    lockInode(temp, true);
+
+    // Initialize inode properties (data blocks are allocated as the file grows)
+    strcpy(temp -> FileName, name);
+    temp -> FileSize = 0;
+    temp -> ActualFileSize = 0;
+    temp -> FileType = REGULARFILE;
+    temp -> Permission = permission;
+
+    // 2. Allocate memory and initialize the file table entry
+    file = newFile(temp, permission);
+    if(file == NULL)
     {
-        return ERR_NO_INODES;
+        releaseInode(temp);
+        unlockInode(temp);
+        return ERR_INSUFFICIENT_SPACE;
     }
 
-    // 2. Search for a free UFDT (User File Descriptor Table) slot
-    // Start from 3, as 0, 1, 2 are reserved (stdin, stdout, stderr)
-    for(i = 3; i < MAXOPENFILES; i++)
+    // 3. Search for a free UFDT (User File Descriptor Table) slot
+    i = installFile(file);
+    if(i < 0)
     {
-        if(uareaobj.UFDT[i] == NULL)
-        {
-            // Found an empty slot
-            break;
-        }
+        putFile(file);
+        releaseInode(temp);
+        unlockInode(temp);
+        return i;
     }
 
-    // UFDT is full; maximum open files limit reached
-    if(i == MAXOPENFILES)
+    // 4. Make the file visible to name based lookups, if another thread created the name meanwhile it wins
+    pthread_mutex_lock(&namespacelock);
+
+    iRet = insertNameIndex(temp);
+    if(iRet == EXECUTE_SUCCESS)
     {
-        return ERR_MAX_FILES_OPEN;
+        journalLog(JOURNAL_CREATE, temp, permission, name, (int)strlen(name));
     }
 
-    // 3. Allocate memory and initialize file structure
-    
-    // Allocate memory for the file table entry
-    uareaobj.UFDT[i] = (PFILETABLE)malloc(sizeof(FILETABLE));
-
-    // Initialize file table properties
-    uareaobj.UFDT[i] -> ReadOffset = 0;
-    uareaobj.UFDT[i] -> WriteOffset = 0;
-    uareaobj.UFDT[i] -> Mode = permission;
-
-    // Link the file table to the inode
-    uareaobj.UFDT[i] -> ptrinode = temp;
-
-    // Initialize inode properties
-    strcpy(uareaobj.UFDT[i] -> ptrinode -> FileName, name);
-    uareaobj.UFDT[i] -> ptrinode -> FileSize = MAXFILESIZE;
-    uareaobj.UFDT[i] -> ptrinode -> ActualFileSize = 0;
-    uareaobj.UFDT[i] -> ptrinode -> FileType = REGULARFILE;
-    uareaobj.UFDT[i] -> ptrinode -> ReferenceCount = 1;
-    uareaobj.UFDT[i] -> ptrinode -> Permission = permission;
-
-    // Allocate memory for file data buffer
-    uareaobj.UFDT[i] -> ptrinode -> Buffer = (char *)malloc(MAXFILESIZE);
-    
-    // Safety: Initialize buffer
-    memset(uareaobj.UFDT[i] -> ptrinode -> Buffer, 0, MAXFILESIZE);
+    pthread_mutex_unlock(&namespacelock);
 
-    // Decrement the free inode count
-    superobj.FreeInodes--;
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        file -> bDeleted = true;
+        detachFile(file);
+        removeFile(file);
+        releaseInode(temp);
+        unlockInode(temp);
+        return iRet;
+    }
+
+    unlockInode(temp);
 
     // Return the file descriptor
     return i;
@@ -540,17 +1422,20 @@ int createFile(char *name, int permission)
 
 void lsFile()
 {
-    PINODE temp = head;
+    PINODE temp = NULL;
+    int i = 0;
+
     printf("----------------------------------------------------------------------------\n");
-    printf("%-8s%-20s%-10s%-10s\n", "Inode", "File Name", "Size", "Actual Size");
+    printf("%-8s%-20s%-14s%-14s\n", "Inode", "File Name", "Size", "Actual Size");
     printf("----------------------------------------------------------------------------\n");
-    while(temp != NULL)
+    for(i = 1; (temp = getInode(i)) != NULL; i++)
     {
+        lockInode(temp, false);
         if(temp -> FileType != 0)
         {
-            printf("%-8d%-20s%-10d%-10d\n", temp->InodeNumber, temp->FileName, temp->FileSize, temp->ActualFileSize);
+            printf("%-8d%-20s%-14lld%-14lld\n", temp->InodeNumber, temp->FileName, temp->FileSize, temp->ActualFileSize);
         }
-        temp = temp -> next;
+        unlockInode(temp);
     }
     printf("----------------------------------------------------------------------------\n");
 }
@@ -568,8 +1453,9 @@ void lsFile()
 
 int unlinkFile(char *name)
 {
-    int i = 0;
-    PINODE temp = head;
+    PINODE temp = NULL;
+    PFILETABLE file = NULL;
+    PFILETABLE next = NULL;
 
     // Validate filename
     if(name == NULL)
@@ -577,51 +1463,34 @@ int unlinkFile(char *name)
         return ERR_INVALID_PARAMETER;
     }
 
-    // Check if file exists
-    if(isFileExists(name) == false)
+    // 1. Locate the file through the filename index
+    temp = lookupLockedInode(name, true);
+    if(temp == NULL)
     {
         return ERR_FILE_NOT_EXISTS;
     }
 
-    // 1. Locate the file in the Inode list
-    while(temp != NULL)
-    {
-        if((temp -> FileType != 0) && (strcmp(temp -> FileName, name) == 0)) 
-        {
-            break;
-        }
-        temp = temp -> next;
-    }
+    // The delete is logged in the same order as a create of the same name by another thread
+    pthread_mutex_lock(&namespacelock);
 
-    // 2. If the file is open, close it (release UFDT entry)
-    for(i = 0; i < MAXOPENFILES; i++)
-    {
-        if(uareaobj.UFDT[i] != NULL)
-        {
-            if(uareaobj.UFDT[i] -> ptrinode == temp)
-            {
-                 free(uareaobj.UFDT[i]);
-                 uareaobj.UFDT[i] = NULL;
-            }
-        }
-    }
+    removeNameIndex(name);
+    journalLog(JOURNAL_UNLINK, temp, 0, NULL, 0);
+    noteFileDeleted(temp);
+
+    pthread_mutex_unlock(&namespacelock);
 
-    // 3. Release Inode resources
-    if(temp -> Buffer != NULL)
+    // 2. If the file is open in any session, close it (release UFDT entry), calls still using the entry fail
+    for(file = temp -> OpenFiles; file != NULL; file = next)
     {
-        free(temp -> Buffer);
-        temp -> Buffer = NULL;
+        next = file -> NextOpen;
+        file -> bDeleted = true;
+        removeFile(file);
     }
+    temp -> OpenFiles = NULL;
 
-    temp -> FileSize = 0;
-    temp -> ActualFileSize = 0;
-    temp -> FileType = 0;
-    temp -> ReferenceCount = 0;
-    temp -> Permission = 0;
-    memset(temp -> FileName, 0, 20); 
-
-    // Increment the free inodes count
-    superobj.FreeInodes++;
+    // 3. Release Inode resources and return it to the free list
+    releaseInode(temp);
+    unlockInode(temp);
 
     return EXECUTE_SUCCESS;
 }// End of unlinkFile()
@@ -637,49 +1506,118 @@ int unlinkFile(char *name)
 //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int writeFile(int fd, char *data, int size)
+int writeFile(int fd, const void *data, int size)
 {
-    /*
-    printf("File descriptor: %d\n", fd);
-    printf("Data to write: %s\n", data);
-    printf("Bytes to write: %d\n", size);
-    */
+    PFILETABLE file = NULL;
+    int iRet = 0;
 
     // Validate file descriptor
-    if((fd < 0) || (fd > MAXOPENFILES))
+    if(fd < 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // Validate buffer and size, the data is copied by length so it may hold any bytes
+    if(data == NULL || size < 0)
     {
         return ERR_INVALID_PARAMETER;
     }
 
     // Check if file descriptor is valid (file is open)
-    if(uareaobj.UFDT[fd] == NULL)
+    iRet = enterFile(fd, true, true, &file);
+    if(iRet != EXECUTE_SUCCESS)
     {
-        return ERR_FILE_NOT_EXISTS;
+        return iRet;
     }
 
     // Check for write permission
-    if(uareaobj.UFDT[fd] -> ptrinode -> Permission < WRITE)
+    if(file -> ptrinode -> Permission < WRITE)
     {
-        return ERR_PERMISSION_DENIED;
+        iRet = ERR_PERMISSION_DENIED;
     }
 
     // Check for sufficient space
-    if((MAXFILESIZE - uareaobj.UFDT[fd] -> WriteOffset) < size)
+    else if((MAXFILESIZE - file -> WriteOffset) < size)
     {
-        return ERR_INSUFFICIENT_SPACE;
+        iRet = ERR_INSUFFICIENT_SPACE;
     }
 
-    // Perform write operation
-    strncpy(uareaobj.UFDT[fd] -> ptrinode -> Buffer + uareaobj.UFDT[fd] -> WriteOffset, data, size);   //  strncpy(uareaobj.UFDT[fd] -> ptrinode -> buffer This is the base address
+    // Perform write operation (allocates blocks as needed and updates the actual file size)
+    else
+    {
+        iRet = writeInodeData(file -> ptrinode, data, file -> WriteOffset, size);
+        if(iRet > 0)
+        {
+            journalLog(JOURNAL_WRITE, file -> ptrinode, file -> WriteOffset, data, iRet);
+
+            // Update write offset
+            file -> WriteOffset = file -> WriteOffset + iRet;
+        }
+    }
 
-    // Update write offset
-    uareaobj.UFDT[fd] -> WriteOffset = uareaobj.UFDT[fd] -> WriteOffset + size;
+    leaveFile(file, true);
 
-    // Update actual file size
-    uareaobj.UFDT[fd] -> ptrinode -> ActualFileSize = uareaobj.UFDT[fd] -> ptrinode -> ActualFileSize + size;
+    // In disk mode a writer far ahead of the flusher waits for it, with the file unlocked
+    if(iRet >= 0)
+    {
+        waitDirtyLimit();
+    }
 
     // Return the number of bytes written
-    return size;
+    return iRet;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         readAheadFile()
+//  Description:           Detects sequential reads on a descriptor and keeps a growing window of the
+//                         following blocks being read ahead by the buffer cache (disk mode only). The
+//                         next window is asked for once the reader is half way into the current one.
+//  Input:                 File table entry, offset and size of the read about to be done
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void readAheadFile(PFILETABLE file, long long offset, long long size)
+{
+    long long first = offset / BLOCKSIZE;
+    long long last = (offset + size - 1) / BLOCKSIZE;
+    long long start = 0;
+
+    if(deviceobj.bEnabled == false)
+    {
+        return;
+    }
+
+    // A read somewhere else ends the sequence, the next one may start a new one
+    if(offset != file -> ReadAheadNext)
+    {
+        file -> ReadAheadNext = offset + size;
+        file -> ReadAheadEnd = 0;
+        file -> ReadAheadWindow = 0;
+        return;
+    }
+
+    file -> ReadAheadNext = offset + size;
+
+    if(last + file -> ReadAheadWindow / 2 < file -> ReadAheadEnd)
+    {
+        return;
+    }
+
+    if(file -> ReadAheadWindow == 0)
+    {
+        file -> ReadAheadWindow = READAHEAD_MIN_BLOCKS;
+    }
+    else if(file -> ReadAheadWindow < READAHEAD_MAX_BLOCKS)
+    {
+        file -> ReadAheadWindow = file -> ReadAheadWindow * 2;
+    }
+
+    // Blocks the cache had no room for yet are asked for again by the next read
+    start = (file -> ReadAheadEnd > first) ? file -> ReadAheadEnd : first;
+    file -> ReadAheadEnd = readAheadInode(file -> ptrinode, start, last + 1 + file -> ReadAheadWindow - start);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -693,10 +1631,13 @@ int writeFile(int fd, char *data, int size)
 //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int readFile(int fd, char *data, int size)
+int readFile(int fd, void *data, int size)
 {
+    PFILETABLE file = NULL;
+    int iRet = 0;
+
     // Validate file descriptor
-    if(fd < 0 || fd > MAXOPENFILES)
+    if(fd < 0)
     {
         return ERR_INVALID_PARAMETER;
     }
@@ -712,81 +1653,528 @@ int readFile(int fd, char *data, int size)
         return ERR_INVALID_PARAMETER;
     }
 
-    // Check if file descriptor is valid
-    if(uareaobj.UFDT[fd] == NULL)
+    // Check if file descriptor is valid, readers of the same file share the inode lock
+    iRet = enterFile(fd, true, false, &file);
+    if(iRet != EXECUTE_SUCCESS)
     {
-        return ERR_FILE_NOT_EXISTS;
+        return iRet;
     }
 
     // Check for read permission
-    if(uareaobj.UFDT[fd] -> ptrinode -> Permission < READ)
+    if(file -> ptrinode -> Permission < READ)
     {
-        return ERR_PERMISSION_DENIED;
+        iRet = ERR_PERMISSION_DENIED;
     }
 
     // Check if requested data size exceeds available data
-    if((uareaobj.UFDT[fd] -> ptrinode -> ActualFileSize - uareaobj.UFDT[fd] -> ReadOffset) < size)
+    else if((file -> ptrinode -> ActualFileSize - file -> ReadOffset) < size)
     {
-        return ERR_INSUFFICIENT_DATA;
+        iRet = ERR_INSUFFICIENT_DATA;
     }
 
-    // Perform read operation
-    strncpy(data, uareaobj.UFDT[fd] -> ptrinode -> Buffer + uareaobj.UFDT[fd] -> ReadOffset, size);
-
-    // Update the read offset
-    uareaobj.UFDT[fd] -> ReadOffset = uareaobj.UFDT[fd] -> ReadOffset + size;
+    else
+    {
+        readAheadFile(file, file -> ReadOffset, size);
+
+        // Perform read operation, in disk storage mode it ends short if a block cannot be read
+        iRet = readInodeData(file -> ptrinode, data, file -> ReadOffset, size);
+
+        // Update the read offset by what was actually read
+        file -> ReadOffset = file -> ReadOffset + iRet;
+
+        // Return the number of bytes read
+        if(iRet == 0)
+        {
+            iRet = ERR_HOST_IO;
+        }
+    }
 
-    // Return the number of bytes read
-    return size;
+    leaveFile(file, true);
+
+    return iRet;
 }// End of readFile()
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
-//  Function Name:         statFile()
-//  Description:           Displays information about a given file
-//  Input:                 Filename
-//  Output:                Status Code (Integer)
-//  Author:                Ritesh Jillewad
-//  Date:                  26/01/2026
+//  Function Name:         lseekFile()
+//  Description:           Repositions the offset of an open file. Both the read and the write offset
+//                         are moved; CURRENT is relative to the read offset of descriptors opened for
+//                         reading, otherwise to the write offset. Seeking past the end is allowed,
+//                         a later write leaves a hole that reads back as zeroes.
+//  Input:                 File Descriptor, Offset, Origin (START, CURRENT or END)
+//  Output:                New offset or Error Code
+//  Date:                  17/10/2026
 //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int statFile(char *name)
+long long lseekFile(int fd, long long offset, int whence)
 {
-    PINODE temp = NULL;
+    PFILETABLE file = NULL;
+    long long newOffset = 0;
+    int iRet = 0;
+
+    // Validate file descriptor
+    if(fd < 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // Check if file descriptor is valid
+    iRet = enterFile(fd, true, false, &file);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        return iRet;
+    }
+
+    // Compute the new position from the requested origin
+    if(whence == START)
+    {
+        newOffset = offset;
+    }
+    else if(whence == CURRENT)
+    {
+        if((file -> Mode & READ) != 0)
+        {
+            newOffset = file -> ReadOffset + offset;
+        }
+        else
+        {
+            newOffset = file -> WriteOffset + offset;
+        }
+    }
+    else if(whence == END)
+    {
+        newOffset = file -> ptrinode -> ActualFileSize + offset;
+    }
+    else
+    {
+        newOffset = ERR_INVALID_PARAMETER;
+    }
+
+    // The offset can not move before the start or beyond the largest file
+    if(newOffset < 0 || newOffset > MAXFILESIZE)
+    {
+        newOffset = ERR_INVALID_PARAMETER;
+    }
+    else
+    {
+        file -> ReadOffset = newOffset;
+        file -> WriteOffset = newOffset;
+    }
+
+    leaveFile(file, true);
+
+    return newOffset;
+}// End of lseekFile()
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         preadFile()
+//  Description:           Reads data from a given offset without changing the offsets of the descriptor
+//  Input:                 File Descriptor, Output Buffer, Size of Data, File Offset
+//  Output:                Number of bytes read (less than size at end of file) or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int preadFile(int fd, void *data, int size, long long offset)
+{
+    PFILETABLE file = NULL;
+    int iRet = 0;
+
+    // Validate file descriptor
+    if(fd < 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // Validate buffer, size and offset
+    if(data == NULL || size <= 0 || offset < 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // Check if file descriptor is valid, the offsets are not used so only the inode is locked
+    iRet = enterFile(fd, false, false, &file);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        return iRet;
+    }
+
+    // Check for read permission
+    if(file -> ptrinode -> Permission < READ)
+    {
+        iRet = ERR_PERMISSION_DENIED;
+    }
+
+    // Perform read operation, the descriptor offsets stay where they are
+    else
+    {
+        iRet = readInodeData(file -> ptrinode, data, offset, size);
+    }
+
+    leaveFile(file, false);
+
+    return iRet;
+}// End of preadFile()
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         pwriteFile()
+//  Description:           Writes data at a given offset without changing the offsets of the descriptor
+//  Input:                 File Descriptor, Data Buffer, Size of Data, File Offset
+//  Output:                Number of bytes written or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int pwriteFile(int fd, const void *data, int size, long long offset)
+{
+    PFILETABLE file = NULL;
+    int iRet = 0;
+
+    // Validate file descriptor
+    if(fd < 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // Validate buffer, size and offset
+    if(data == NULL || size < 0 || offset < 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // Check if file descriptor is valid
+    iRet = enterFile(fd, false, true, &file);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        return iRet;
+    }
+
+    // Check for write permission
+    if(file -> ptrinode -> Permission < WRITE)
+    {
+        iRet = ERR_PERMISSION_DENIED;
+    }
+
+    // Check for sufficient space
+    else if((MAXFILESIZE - offset) < size)
+    {
+        iRet = ERR_INSUFFICIENT_SPACE;
+    }
+
+    // Perform write operation, the descriptor offsets stay where they are
+    else
+    {
+        iRet = writeInodeData(file -> ptrinode, data, offset, size);
+        if(iRet > 0)
+        {
+            journalLog(JOURNAL_WRITE, file -> ptrinode, offset, data, iRet);
+        }
+    }
+
+    leaveFile(file, false);
+
+    if(iRet >= 0)
+    {
+        waitDirtyLimit();
+    }
+
+    return iRet;
+}// End of pwriteFile()
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         readViewFile()
+//  Description:           Reads from an open file like readFile() but without copying: the view
+//                         points into the file blocks and must be released with releaseReadView()
+//  Input:                 File Descriptor, number of bytes, view to fill
+//  Output:                Number of bytes in the view or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int readViewFile(int fd, int size, PREADVIEW view)
+{
+    PFILETABLE file = NULL;
+    long long lRet = 0;
+    int iRet = 0;
+
+    // Validate file descriptor
+    if(fd < 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    if(view == NULL || size <= 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // Check if file descriptor is valid, the view holds its blocks after the inode is unlocked
+    iRet = enterFile(fd, true, false, &file);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        return iRet;
+    }
+
+    // Check for read permission
+    if(file -> ptrinode -> Permission < READ)
+    {
+        lRet = ERR_PERMISSION_DENIED;
+    }
+
+    // Check if requested data size exceeds available data
+    else if((file -> ptrinode -> ActualFileSize - file -> ReadOffset) < size)
+    {
+        lRet = ERR_INSUFFICIENT_DATA;
+    }
+
+    else
+    {
+        readAheadFile(file, file -> ReadOffset, size);
+
+        lRet = viewInodeData(file -> ptrinode, file -> ReadOffset, size, view);
+
+        // Update the read offset
+        if(lRet > 0)
+        {
+            file -> ReadOffset = file -> ReadOffset + lRet;
+        }
+    }
+
+    leaveFile(file, true);
+
+    return (int)lRet;
+}// End of readViewFile()
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getIovecSize()
+//  Description:           Validates an iovec array and adds up the length of its fragments
+//  Input:                 iovec array, number of fragments
+//  Output:                Total number of bytes or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static long long getIovecSize(const struct iovec *iov, int iovcnt)
+{
+    long long total = 0;
     int i = 0;
 
-    if(name == NULL)
+    if(iov == NULL || iovcnt <= 0 || iovcnt > MAXIOVECS)
     {
         return ERR_INVALID_PARAMETER;
     }
 
-    temp = head;
-    while(temp != NULL)
+    for(i = 0; i < iovcnt; i++)
     {
-        if(strcmp(name, temp -> FileName) == 0 && (temp -> FileType) == REGULARFILE)
+        if(iov[i].iov_base == NULL && iov[i].iov_len > 0)
         {
-            break;
+            return ERR_INVALID_PARAMETER;
+        }
+
+        total = total + (long long)iov[i].iov_len;
+
+        // The byte count is returned as an int, like writeFile() and readFile()
+        if(total > 0x7fffffff)
+        {
+            return ERR_INVALID_PARAMETER;
         }
-        
-        temp = temp -> next;
     }
 
-    if(temp == NULL)
+    return total;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         writevFile()
+//  Description:           Writes several buffers to an open file in one operation: the descriptor and
+//                         permission are checked once and the write offset is moved once at the end
+//  Input:                 File Descriptor, iovec array, number of fragments
+//  Output:                Number of bytes written or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int writevFile(int fd, const struct iovec *iov, int iovcnt)
+{
+    PFILETABLE file = NULL;
+    long long total = 0;
+    int iRet = 0;
+
+    // Validate file descriptor
+    if(fd < 0)
     {
-        return ERR_FILE_NOT_EXISTS;
+        return ERR_INVALID_PARAMETER;
+    }
+
+    total = getIovecSize(iov, iovcnt);
+    if(total < 0)
+    {
+        return (int)total;
+    }
+
+    // Check if file descriptor is valid (file is open)
+    iRet = enterFile(fd, true, true, &file);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        return iRet;
+    }
+
+    // Check for write permission
+    if(file -> ptrinode -> Permission < WRITE)
+    {
+        iRet = ERR_PERMISSION_DENIED;
+    }
+
+    // Check for sufficient space for all fragments together
+    else if((MAXFILESIZE - file -> WriteOffset) < total)
+    {
+        iRet = ERR_INSUFFICIENT_SPACE;
+    }
+
+    // Fragments are stored back to back, every block is looked up only once
+    else
+    {
+        iRet = writevInodeData(file -> ptrinode, iov, iovcnt, file -> WriteOffset);
+        if(iRet > 0)
+        {
+            journalLogv(file -> ptrinode, file -> WriteOffset, iov, iovcnt, iRet);
+
+            // Update write offset
+            file -> WriteOffset = file -> WriteOffset + iRet;
+        }
     }
 
+    leaveFile(file, true);
+
+    if(iRet >= 0)
+    {
+        waitDirtyLimit();
+    }
+
+    return iRet;
+}// End of writevFile()
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         readvFile()
+//  Description:           Reads from an open file into several buffers in one operation, filling
+//                         each fragment completely before the next one
+//  Input:                 File Descriptor, iovec array, number of fragments
+//  Output:                Number of bytes read or Error Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int readvFile(int fd, const struct iovec *iov, int iovcnt)
+{
+    PFILETABLE file = NULL;
+    long long total = 0;
+    long long offset = 0;
+    int done = 0;
+    int iRet = 0;
+    int i = 0;
+
+    // Validate file descriptor
+    if(fd < 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    total = getIovecSize(iov, iovcnt);
+    if(total <= 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // Check if file descriptor is valid
+    iRet = enterFile(fd, true, false, &file);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        return iRet;
+    }
+
+    // Check for read permission
+    if(file -> ptrinode -> Permission < READ)
+    {
+        iRet = ERR_PERMISSION_DENIED;
+    }
+
+    // Like readFile(), the whole request must be available
+    else if((file -> ptrinode -> ActualFileSize - file -> ReadOffset) < total)
+    {
+        iRet = ERR_INSUFFICIENT_DATA;
+    }
+
+    else
+    {
+        readAheadFile(file, file -> ReadOffset, total);
+
+        // A fragment that ends short (a block that cannot be read) ends the whole read
+        offset = file -> ReadOffset;
+        for(i = 0; i < iovcnt; i++)
+        {
+            done = readInodeData(file -> ptrinode, (char *)iov[i].iov_base, offset, (int)iov[i].iov_len);
+            offset = offset + done;
+            if(done < (int)iov[i].iov_len)
+            {
+                break;
+            }
+        }
+
+        // Update the read offset by what was actually read
+        iRet = (int)(offset - file -> ReadOffset);
+        file -> ReadOffset = offset;
+
+        if(iRet == 0)
+        {
+            iRet = ERR_HOST_IO;
+        }
+    }
+
+    leaveFile(file, true);
+
+    return iRet;
+}// End of readvFile()
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         displayInode()
+//  Description:           Prints the statistical information of a file for stat and fstat
+//  Input:                 Inode pointer (locked by the caller)
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void displayInode(PINODE temp)
+{
+    int shared = 0;
+
     printf("\n----------------------------------------------------------------------------\n");
     printf("-------------------- Statistical Information of File -----------------------\n");
     printf("----------------------------------------------------------------------------\n");
     printf("File Name           : %s\n", temp -> FileName);
     printf("Inode Number        : %d\n", temp -> InodeNumber);
-    printf("File Size           : %d\n", temp -> FileSize);
-    printf("Actual File Size    : %d\n", temp -> ActualFileSize);
+    printf("File Size           : %lld\n", temp -> FileSize);
+    printf("Actual File Size    : %lld\n", temp -> ActualFileSize);
     printf("Link Count          : %d\n", temp -> ReferenceCount);
     printf("Reference Count     : %d\n", temp -> ReferenceCount);
 
+    // The files sharing the map drop their references without this file's lock
+    if(temp -> BlockMap != NULL)
+    {
+        shared = __atomic_load_n(&temp -> BlockMap -> RefCount, __ATOMIC_RELAXED);
+    }
+    if(shared > 1)
+    {
+        printf("Shared Data         : Yes (copy-on-write, %d files)\n", shared);
+    }
+
     if(temp -> Permission == 1)
     {
         printf("File Permission     : Read only\n");
@@ -799,183 +2187,455 @@ int statFile(char *name)
     {
         printf("File Permission     : Read & Write\n");
     }
-    
-    printf("----------------------------------------------------------------------------\n\n");
+    
+    printf("----------------------------------------------------------------------------\n\n");
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         statFile()
+//  Description:           Displays information about a given file
+//  Input:                 Filename
+//  Output:                Status Code (Integer)
+//  Author:                Ritesh Jillewad
+//  Date:                  26/01/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int statFile(char *name)
+{
+    PINODE temp = NULL;
+
+    if(name == NULL)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    temp = lookupLockedInode(name, false);
+
+    if(temp == NULL)
+    {
+        return ERR_FILE_NOT_EXISTS;
+    }
+
+    displayInode(temp);
+    unlockInode(temp);
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         fstatFile()
+//  Description:           Displays information about a file using File Descriptor
+//  Input:                 File Descriptor
+//  Output:                Status Code (Integer)
+//  Author:                Ritesh Jillewad
+//  Date:                  26/01/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int fstatFile(int fd)
+{
+    PFILETABLE file = NULL;
+    int iRet = 0;
+
+    // Validate file descriptor
+    if(fd < 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // Check if file is closed/invalid
+    iRet = enterFile(fd, false, false, &file);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        return iRet;
+    }
+
+    displayInode(file -> ptrinode);
+    leaveFile(file, false);
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         openFile()
+//  Description:           Opens an existing file
+//  Input:                 Filename, Mode (1=Read, 2=Write, 3=Read+Write)
+//  Output:                File Descriptor (Integer)
+//  Author:                Ritesh Jillewad
+//  Date:                  26/01/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int openFile(char *name, int mode)
+{
+    PINODE temp = NULL;
+    PFILETABLE file = NULL;
+    int i = 0;
+
+    // Validation: Check parameters
+    if(name == NULL || mode <= 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // Now we need to find the file, it stays locked until the descriptor is in place
+    temp = lookupLockedInode(name, true);
+
+    // If temp is NULL, we reached the end without finding the file
+    if(temp == NULL)
+    {
+        return ERR_FILE_NOT_EXISTS;
+    }
+
+    // Check Permissions
+    // Strict Check: Ensure the requested mode matches or is allowed by the file's permission
+    if (temp->Permission != mode && temp->Permission != (READ + WRITE)) 
+    {
+        unlockInode(temp);
+        return ERR_PERMISSION_DENIED;
+    }
+
+    // Allocate memory for FileTable and link it to the Inode
+    file = newFile(temp, mode);
+    if(file == NULL)
+    {
+        unlockInode(temp);
+        return -1; // Memory allocation failed
+    }
+
+    // Find a free User File Descriptor Table (UFDT) slot
+    i = installFile(file);
+
+    // If there was none, the table is full (installing it counts the reference of the inode)
+    if(i < 0)
+    {
+        putFile(file);
+        unlockInode(temp);
+        return i;
+    }
+
+    unlockInode(temp);
+
+    return i; // Return the File Descriptor
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         closeDescriptor()
+//  Description:           Closes a descriptor of a session
+//  Input:                 Session, File Descriptor
+//  Output:                Status Code (0 for success, negative for error)
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int closeDescriptor(PUAREA session, int fd)
+{
+    PFILETABLE file = NULL;
+
+    // Validation: Check if FD is correct
+    if(fd < 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // Reset the UFDT entry to NULL so this FD can be reused
+    pthread_rwlock_wrlock(&session -> Lock);
+    if(fd < session -> Capacity)
+    {
+        file = session -> UFDT[fd];
+        session -> UFDT[fd] = NULL;
+    }
+    if(file != NULL)
+    {
+        session -> OpenCount--;
+        fillDescriptors(session, fd, fd + 1);
+    }
+    pthread_rwlock_unlock(&session -> Lock);
+
+    // File we want to close, does not exists, or is not opened
+    if(file == NULL)
+    {
+        return ERR_FILE_NOT_EXISTS;
+    }
+
+    // We need to decrement the reference count, as the we are closing the file
+    // (an unlinked file has no inode any more)
+    lockInode(file -> ptrinode, true);
+    if(file -> bDeleted == false)
+    {
+        detachFile(file);
+    }
+    unlockInode(file -> ptrinode);
+
+    // Free the memory of the FileTable structure once no call uses it any more
+    putFile(file);
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         closeFile()
+//  Description:           Closes an existing open file
+//  Input:                 File Descriptor (Integer)
+//  Output:                Status Code (0 for success, negative for error)
+//  Author:                Ritesh Jillewad
+//  Date:                  26/01/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int closeFile(int fd)
+{
+    return closeDescriptor(getSession(), fd);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         createSessionKey()
+//  Description:           Creates the thread specific key that holds the session of a thread
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void createSessionKey()
+{
+    pthread_key_create(&sessionKey, NULL);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getSession()
+//  Description:           Returns the session the calling thread works in, the shell session unless the
+//                         thread picked another one with setSession()
+//  Input:                 void
+//  Output:                Session
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PUAREA getSession()
+{
+    PUAREA session = NULL;
+
+    pthread_once(&sessionOnce, createSessionKey);
+
+    session = (PUAREA)pthread_getspecific(sessionKey);
+
+    return (session == NULL) ? &uareaobj : session;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         setSession()
+//  Description:           Makes the file calls of the calling thread use the descriptors of a session
+//  Input:                 Session, NULL for the shell session
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void setSession(PUAREA session)
+{
+    pthread_once(&sessionOnce, createSessionKey);
+
+    pthread_setspecific(sessionKey, (session == &uareaobj) ? NULL : session);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         findSession()
+//  Description:           Finds a session by its name
+//  Input:                 Session name
+//  Output:                Session or NULL
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PUAREA findSession(const char *name)
+{
+    PUAREA session = NULL;
+
+    if(name == NULL)
+    {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&sessionlock);
+
+    for(session = &uareaobj; session != NULL; session = session -> Next)
+    {
+        if(strcmp(session -> ProcessName, name) == 0)
+        {
+            break;
+        }
+    }
 
-    return EXECUTE_SUCCESS;
+    pthread_mutex_unlock(&sessionlock);
+
+    return session;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
-//  Function Name:         fstatFile()
-//  Description:           Displays information about a file using File Descriptor
-//  Input:                 File Descriptor
-//  Output:                Status Code (Integer)
-//  Author:                Ritesh Jillewad
-//  Date:                  26/01/2026
+//  Function Name:         createSession()
+//  Description:           Creates a session with an empty descriptor table. Files opened in it get
+//                         descriptors of their own, the files themselves are shared with every
+//                         other session.
+//  Input:                 Session name (unique)
+//  Output:                Session or NULL if the name is invalid, in use, or out of memory
+//  Date:                  17/10/2026
 //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int fstatFile(int fd)
+PUAREA createSession(const char *name)
 {
-    PINODE temp = NULL;
+    PUAREA session = NULL;
+    PUAREA temp = NULL;
 
-    // Validate file descriptor
-    if(fd < 0 || fd >= MAXOPENFILES)
+    if(name == NULL || strlen(name) == 0 || strlen(name) >= sizeof(session -> ProcessName))
     {
-        return ERR_INVALID_PARAMETER;
+        return NULL;
     }
 
-    // Check if file is closed/invalid
-    if(uareaobj.UFDT[fd] == NULL)
+    session = (PUAREA)calloc(1, sizeof(UAREA));
+    if(session == NULL)
     {
-        return ERR_FILE_NOT_EXISTS;
+        return NULL;
     }
 
-    temp = uareaobj.UFDT[fd]->ptrinode;
+    if(growDescriptors(session) != EXECUTE_SUCCESS)
+    {
+        freeDescriptors(session);
+        free(session);
+        return NULL;
+    }
 
-    printf("\n----------------------------------------------------------------------------\n");
-    printf("-------------------- Statistical Information of File -----------------------\n");
-    printf("----------------------------------------------------------------------------\n");
-    printf("File Name           : %s\n", temp -> FileName);
-    printf("Inode Number        : %d\n", temp -> InodeNumber);
-    printf("File Size           : %d\n", temp -> FileSize);
-    printf("Actual File Size    : %d\n", temp -> ActualFileSize);
-    printf("Link Count          : %d\n", temp -> ReferenceCount);
-    printf("Reference Count     : %d\n", temp -> ReferenceCount);
+    strcpy(session -> ProcessName, name);
+    pthread_rwlock_init(&session -> Lock, NULL);
 
-    if(temp -> Permission == 1)
-        printf("File Permission     : Read only\n");
-    else if(temp -> Permission == 2)
-        printf("File Permission     : Write\n");
-    else if(temp -> Permission == 3)
-        printf("File Permission     : Read & Write\n");
-    
-    printf("----------------------------------------------------------------------------\n\n");
+    pthread_mutex_lock(&sessionlock);
 
-    return EXECUTE_SUCCESS;
+    for(temp = &uareaobj; temp != NULL; temp = temp -> Next)
+    {
+        if(strcmp(temp -> ProcessName, name) == 0)
+        {
+            break;
+        }
+    }
+
+    if(temp == NULL)
+    {
+        session -> Next = uareaobj.Next;
+        uareaobj.Next = session;
+    }
+
+    pthread_mutex_unlock(&sessionlock);
+
+    if(temp != NULL)
+    {
+        pthread_rwlock_destroy(&session -> Lock);
+        freeDescriptors(session);
+        free(session);
+        return NULL;
+    }
+
+    return session;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
-//  Function Name:         openFile()
-//  Description:           Opens an existing file
-//  Input:                 Filename, Mode (1=Read, 2=Write, 3=Read+Write)
-//  Output:                File Descriptor (Integer)
-//  Author:                Ritesh Jillewad
-//  Date:                  26/01/2026
+//  Function Name:         closeSession()
+//  Description:           Closes every descriptor of a session and deletes it. No thread may work in
+//                         the session any more, the calling thread goes back to the shell session.
+//  Input:                 Session (not the shell session)
+//  Output:                Status Code
+//  Date:                  17/10/2026
 //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int openFile(char *name, int mode)
+int closeSession(PUAREA session)
 {
-    PINODE temp = NULL;
+    PUAREA temp = NULL;
     int i = 0;
 
-    // Validation: Check parameters
-    if(name == NULL || mode <= 0)
+    if(session == NULL || session == &uareaobj)
     {
         return ERR_INVALID_PARAMETER;
     }
 
-    // Now we need to find the file
-    temp = head;
-    while(temp != NULL)
+    for(i = 3; i < session -> Capacity; i++)
     {
-        if(strcmp(name, temp -> FileName) == 0 && (temp -> FileType) == REGULARFILE)
-        {
-            // This means we found the file we want to open
-            break;
-        }
-
-        temp = temp -> next;
+        closeDescriptor(session, i);
     }
 
-    // If temp is NULL, we reached the end without finding the file
-    if(temp == NULL)
-    {
-        return ERR_FILE_NOT_EXISTS;
-    }
+    pthread_mutex_lock(&sessionlock);
 
-    // Check Permissions
-    // Strict Check: Ensure the requested mode matches or is allowed by the file's permission
-    if (temp->Permission != mode && temp->Permission != (READ + WRITE)) 
+    for(temp = &uareaobj; temp -> Next != NULL && temp -> Next != session; temp = temp -> Next)
     {
-        return ERR_PERMISSION_DENIED;
     }
 
-    // Find a free User File Descriptor Table (UFDT) slot
-    // Start from 0 (standard) or 3 if you wish to reserve stdin/out/err like create
-    for(i = 3; i < MAXOPENFILES; i++)
+    if(temp -> Next == session)
     {
-        if(uareaobj.UFDT[i] == NULL)
-        {
-            break;
-        }
+        temp -> Next = session -> Next;
     }
 
-    // If i reached max, the table is full
-    if(i == MAXOPENFILES)
-    {
-        return ERR_MAX_FILES_OPEN;
-    }
+    pthread_mutex_unlock(&sessionlock);
 
-    // Allocate memory for FileTable
-    uareaobj.UFDT[i] = (PFILETABLE)malloc(sizeof(FILETABLE));
-    if(uareaobj.UFDT[i] == NULL)
+    if(getSession() == session)
     {
-        return -1; // Memory allocation failed
+        setSession(NULL);
     }
 
-    // Initialize FileTable
-    uareaobj.UFDT[i] -> ReadOffset = 0;
-    uareaobj.UFDT[i] -> WriteOffset = 0;
-    uareaobj.UFDT[i] -> Mode = mode;
-    
-    // Link to the Inode
-    uareaobj.UFDT[i] -> ptrinode = temp;
-
-    // Update Inode Metadata
-    uareaobj.UFDT[i] -> ptrinode->ReferenceCount++;
+    pthread_rwlock_destroy(&session -> Lock);
+    freeDescriptors(session);
+    free(session);
 
-    return i; // Return the File Descriptor
+    return EXECUTE_SUCCESS;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
-//  Function Name:         closeFile()
-//  Description:           Closes an existing open file
-//  Input:                 File Descriptor (Integer)
-//  Output:                Status Code (0 for success, negative for error)
-//  Author:                Ritesh Jillewad
-//  Date:                  26/01/2026
+//  Function Name:         displaySessions()
+//  Description:           Lists the sessions with their open descriptors, the current one is marked
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
 //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int closeFile(int fd)
+void displaySessions()
 {
-    // Validation: Check if FD is correct
-    if(fd < 0 || fd >= MAXOPENFILES)
-    {
-        return ERR_INVALID_PARAMETER;
-    }
+    PUAREA current = getSession();
+    PUAREA session = NULL;
+    long long total = 0;
+    int count = 0;
 
-    // File we want to close, does not exists, or is not opened
-    if(uareaobj.UFDT[fd] == NULL)
+    printf("----------------------------------------------------------------------------\n");
+    printf("  %-20s%-18s%-18s\n", "Session", "Open files", "Table slots");
+    printf("----------------------------------------------------------------------------\n");
+
+    pthread_mutex_lock(&sessionlock);
+
+    for(session = &uareaobj; session != NULL; session = session -> Next)
     {
-        return ERR_FILE_NOT_EXISTS;
+        pthread_rwlock_rdlock(&session -> Lock);
+        count = __atomic_load_n(&session -> OpenCount, __ATOMIC_RELAXED);
+        printf("%c %-20s%-18d%-18d\n", (session == current) ? '*' : ' ', session -> ProcessName, count, session -> Capacity);
+        total = total + count;
+        pthread_rwlock_unlock(&session -> Lock);
     }
 
-    // We need to decrement the reference count, as the we are closing the file
-    uareaobj.UFDT[fd] -> ptrinode -> ReferenceCount--;
-
-    // Free the memory of the FileTable structure
-    free(uareaobj.UFDT[fd]);
+    pthread_mutex_unlock(&sessionlock);
 
-    // Reset the UFDT entry to NULL so this FD can be reused
-    uareaobj.UFDT[fd] = NULL;
-    
-    return EXECUTE_SUCCESS;
+    printf("----------------------------------------------------------------------------\n");
+    printf("Open files of all sessions: %lld\n", total);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -992,7 +2652,7 @@ int closeFile(int fd)
 int truncateFile(char *name)
 {
     PINODE temp = NULL;
-    int i = 0;
+    PFILETABLE file = NULL;
 
     // if name field is null/missing
     if(name == NULL)
@@ -1000,17 +2660,7 @@ int truncateFile(char *name)
         return ERR_FILE_NOT_EXISTS;
     }
 
-    temp = head;
-    while(temp != NULL)
-    {
-        if(strcmp(name, temp -> FileName) == 0 && (temp -> FileType) == REGULARFILE)
-        {
-            // File to truncate is found
-            break;
-        }
-
-        temp = temp -> next;
-    }
+    temp = lookupLockedInode(name, true);
 
     // File not found
     if(temp == NULL)
@@ -1021,34 +2671,36 @@ int truncateFile(char *name)
     // Check Permissions (Must have WRITE permission to modify data)
     if(temp -> Permission < WRITE)
     {
+        unlockInode(temp);
         return ERR_PERMISSION_DENIED;
     }
 
     // Wipe the data
-    // We verify the buffer exists, then fill it with 0
-    if(temp -> Buffer != NULL)
-    {
-        memset(temp -> Buffer, '\0', MAXFILESIZE);
-    }
+    // Blocks are handed back to the block arena without clearing them, the file grows again from zero
+    freeInodeBlocks(temp);
 
     // Now we reset the actual file size
     temp -> ActualFileSize = 0;
 
+    // The next incremental backup stores this file from scratch
+    temp -> Generation = superobj.Generation;
+    temp -> BaseGeneration = superobj.Generation;
+
+    journalLog(JOURNAL_TRUNCATE, temp, 0, NULL, 0);
+
     // Reset Offsets for Open Files
-    // If this file is currently open in any slot of the UFDT, we must reset 
+    // If this file is currently open in any session, we must reset
     // the cursor (offsets) back to 0, otherwise the cursor will point to nowhere.
-    for(i = 0; i < MAXOPENFILES; i++)
+    // Calls moving an offset hold the inode lock as well, so none of them runs now.
+    for(file = temp -> OpenFiles; file != NULL; file = file -> NextOpen)
     {
-        if(uareaobj.UFDT[i] != NULL)
-        {
-            if(uareaobj.UFDT[i] -> ptrinode == temp)
-            {
-                uareaobj.UFDT[i] -> ReadOffset = 0;
-                uareaobj.UFDT[i] -> WriteOffset = 0;
-            }
-        }
+        file -> ReadOffset = 0;
+        file -> WriteOffset = 0;
+        file -> ReadAheadEnd = 0;
     }
 
+    unlockInode(temp);
+
     return EXECUTE_SUCCESS;
 }
 
@@ -1066,6 +2718,7 @@ int truncateFile(char *name)
 int renameFile(char *oldName, char *newName)
 {
     PINODE temp = NULL;
+    int iRet = 0;
 
     // If new name and old name parameters are null
     if(oldName == NULL || newName == NULL)
@@ -1073,41 +2726,36 @@ int renameFile(char *oldName, char *newName)
         return ERR_INVALID_PARAMETER;
     }
 
-    // Check if the old file exists
-    if(isFileExists(oldName) == false)
+    // New name must fit in the inode
+    if(strlen(newName) == 0 || strlen(newName) >= sizeof(temp -> FileName))
     {
-        return ERR_FILE_NOT_EXISTS;
+        return ERR_INVALID_PARAMETER;
     }
 
-    // Check if the new name is already taken by another file
-    if(isFileExists(newName) == true)
+    // Find the inode of the old file
+    temp = lookupLockedInode(oldName, true);
+    if(temp == NULL)
     {
-        return ERR_FILE_ALREADY_EXISTS;
+        return ERR_FILE_NOT_EXISTS;
     }
 
-    // Now we need to find the inode
-    temp = head;
-    while(temp != NULL)
+    // Now we update the filename and re-key the index entry in one step,
+    // it fails if the new name is already taken by another file
+    pthread_mutex_lock(&namespacelock);
+
+    iRet = renameNameIndex(temp, newName);
+    if(iRet == EXECUTE_SUCCESS)
     {
-        if(strcmp(oldName, temp -> FileName) == 0)
-        {
-            // We found the file
-            break;
-        }
+        temp -> Generation = superobj.Generation;
 
-        temp = temp -> next;
+        journalLog(JOURNAL_RENAME, temp, 0, newName, (int)strlen(newName));
     }
 
-    // safety check
-    if(temp == NULL)
-    {
-        return ERR_FILE_NOT_EXISTS;
-    }
+    pthread_mutex_unlock(&namespacelock);
 
-    // Now we simply update the old filename with new filename
-    strcpy(temp -> FileName, newName);
+    unlockInode(temp);
 
-    return EXECUTE_SUCCESS;
+    return iRet;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1124,6 +2772,10 @@ int renameFile(char *oldName, char *newName)
 int catFile(char *name)
 {
     PINODE temp = NULL;
+    READVIEW view;
+    long long offset = 0;
+    long long lRet = 0;
+    int i = 0;
 
     // If name is missing
     if(name == NULL)
@@ -1132,17 +2784,7 @@ int catFile(char *name)
     }
 
     // Finding the file
-    temp = head;
-    while(temp != NULL)
-    {
-        if(strcmp(name, temp -> FileName) == 0)
-        {
-            // Found the file
-            break;
-        }
-
-        temp = temp -> next;
-    }
+    temp = lookupLockedInode(name, false);
 
     // File not found
     if(temp == NULL)
@@ -1153,19 +2795,39 @@ int catFile(char *name)
     // If read permission is not given
     if(temp -> Permission < READ)
     {
+        unlockInode(temp);
         return ERR_PERMISSION_DENIED;
     }
 
     // Check if file is empty
     if(temp -> ActualFileSize == 0)
     {
+        unlockInode(temp);
         printf("File is empty!\n");
         return EXECUTE_SUCCESS;
     }
 
-    // There is data, we will print it
+    // There is data, we will print it straight from the blocks one window at a time
     printf("File contents: \n");
-    printf("%s\n", temp -> Buffer);
+    while(offset < temp -> ActualFileSize)
+    {
+        lRet = viewInodeData(temp, offset, VIEWWINDOWSIZE, &view);
+        if(lRet <= 0)
+        {
+            break;
+        }
+
+        for(i = 0; i < view.SegmentCount; i++)
+        {
+            fwrite(view.Segments[i].Data, 1, view.Segments[i].Length, stdout);
+        }
+
+        releaseReadView(&view);
+        offset = offset + lRet;
+    }
+    printf("\n");
+
+    unlockInode(temp);
 
     return EXECUTE_SUCCESS;
 }
@@ -1184,8 +2846,9 @@ int catFile(char *name)
 int copyFile(char *src, char *dest)
 {
     PINODE tempSrc = NULL;
-    PINODE tempDest = NULL;
+    PFILETABLE file = NULL;
     int fd = 0;
+    int iRet = 0;
 
     // Name validation
     if(src == NULL || dest == NULL)
@@ -1193,8 +2856,9 @@ int copyFile(char *src, char *dest)
         return ERR_INVALID_PARAMETER;
     }
 
-    // Check if Source exists
-    if(isFileExists(src) == false)
+    // Check if Source exists, it is read locked until the copy shares its blocks
+    tempSrc = lookupLockedInode(src, false);
+    if(tempSrc == NULL)
     {
         return ERR_FILE_NOT_EXISTS;
     }
@@ -1202,6 +2866,7 @@ int copyFile(char *src, char *dest)
     // Check if Destination already exists (if it already exists we cannot copy it as)
     if(isFileExists(dest) == true)
     {
+        unlockInode(tempSrc);
         return ERR_FILE_ALREADY_EXISTS;
     }
 
@@ -1210,146 +2875,235 @@ int copyFile(char *src, char *dest)
     fd = createFile(dest, 3);
     if(fd < 0)
     {
+        unlockInode(tempSrc);
         return fd; // Return the error code from createFile (e.g., ERR_NO_INODES)
     }
 
-    // Finding the source node
-    tempSrc = head;
-    while(tempSrc != NULL)
+    // Get Destination Inode from the FD we just created and lock it as well. The source is always
+    // locked first: it is older than the destination, no thread holds the destination and waits for it.
+    iRet = enterFile(fd, false, true, &file);
+    if(iRet == EXECUTE_SUCCESS)
     {
-        if(strcmp(src, tempSrc -> FileName) == 0)
-        {
-            // Found the source file
-            break;
-        }
-        tempSrc = tempSrc -> next;
+        // Perform the Copy
+        // Copy-on-write: the destination shares the data blocks of the source, a block
+        // is only duplicated when one of the two files writes to it
+        shareInodeBlocks(file -> ptrinode, tempSrc);
+        journalLog(JOURNAL_COPY, file -> ptrinode, tempSrc -> FileId, NULL, 0);
+
+        leaveFile(file, false);
     }
 
-    // Get Destination Inode from the FD we just created
-    // uareaobj.UFDT[fd] points to the FileTable, which points to the Inode
-    tempDest = uareaobj.UFDT[fd] -> ptrinode;
+    unlockInode(tempSrc);
 
-    // Perform the Copy
-    // Copy the actual data buffer
-    memcpy(tempDest -> Buffer, tempSrc -> Buffer, MAXFILESIZE);
-    
-    // Copy the metadata (Size)
-    tempDest -> ActualFileSize = tempSrc -> ActualFileSize;
+    // The descriptor was only needed to create the destination
+    closeFile(fd);
     
-    return EXECUTE_SUCCESS;
+    return iRet;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
-//  Function Name:         backupCVFS()
-//  Description:           Saves data to disk
-//  Input:                 void
-//  Output:                void
-//  Author:                Ritesh Jillewad
-//  Date:                  28/01/2026
+//  Function Name:         writeReadView()
+//  Description:           Writes every segment of a view to a host file with writev(), short writes
+//                         are continued from the first byte that was not written
+//  Input:                 Host file descriptor, view
+//  Output:                Number of bytes written or -1 on a host I/O error
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+long long writeReadView(int hostFd, PREADVIEW view)
+{
+    struct iovec iov[VIEWMAXIOV];
+    long long written = 0;
+    ssize_t ret = 0;
+    int segment = 0;
+    int skip = 0;
+    int count = 0;
+
+    while(segment < view -> SegmentCount)
+    {
+        // Gather the next batch of segments, the first one may be partly written already
+        count = 0;
+        while(count < VIEWMAXIOV && segment + count < view -> SegmentCount)
+        {
+            iov[count].iov_base = (void *)view -> Segments[segment + count].Data;
+            iov[count].iov_len = view -> Segments[segment + count].Length;
+            count++;
+        }
+        iov[0].iov_base = (char *)iov[0].iov_base + skip;
+        iov[0].iov_len = iov[0].iov_len - skip;
+
+        ret = writev(hostFd, iov, count);
+        if(ret < 0)
+        {
+            return -1;
+        }
+        written = written + ret;
+
+        // Step over the segments that were written completely
+        ret = ret + skip;
+        skip = 0;
+        while(segment < view -> SegmentCount && ret >= view -> Segments[segment].Length)
+        {
+            ret = ret - view -> Segments[segment].Length;
+            segment++;
+        }
+        skip = (int)ret;
+    }
+
+    return written;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         exportFile()
+//  Description:           Copies a CVFS file to a file on the host, the data goes from the blocks
+//                         to the kernel without an intermediate buffer
+//  Input:                 Filename, host path
+//  Output:                Status Code
+//  Date:                  17/10/2026
 //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int backupCVFS()
+int exportFile(char *name, char *hostPath)
 {
     PINODE temp = NULL;
-    int fd = 0;
+    READVIEW view;
+    long long offset = 0;
+    long long lRet = 0;
+    int hostFd = 0;
+    int iRet = EXECUTE_SUCCESS;
 
-    // Open the file 
-    fd = open(BACKUP_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-    
-    if(fd == -1)
+    if(name == NULL || hostPath == NULL)
     {
-        printf("Error: Unable to open backup file.\n");
-        return -1;
+        return ERR_INVALID_PARAMETER;
     }
 
-    // Traverse the list
-    temp = head;
-    while(temp != NULL)
+    temp = lookupLockedInode(name, false);
+    if(temp == NULL)
     {
-        // If filetype is 0, it means it's regualr file, but the backup file is binary
-        if(temp -> FileType != 0)
+        return ERR_FILE_NOT_EXISTS;
+    }
+
+    if(temp -> Permission < READ)
+    {
+        unlockInode(temp);
+        return ERR_PERMISSION_DENIED;
+    }
+
+    hostFd = open(hostPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(hostFd < 0)
+    {
+        unlockInode(temp);
+        return ERR_HOST_IO;
+    }
+
+    while(offset < temp -> ActualFileSize)
+    {
+        lRet = viewInodeData(temp, offset, VIEWWINDOWSIZE, &view);
+        if(lRet <= 0)
+        {
+            break;
+        }
+
+        if(writeReadView(hostFd, &view) != lRet)
         {
-            // Write data
-            write(fd, temp -> FileName, sizeof(temp -> FileName));
-            write(fd, &temp -> InodeNumber, sizeof(temp -> InodeNumber));
-            write(fd, &temp -> ActualFileSize, sizeof(temp -> ActualFileSize));
-            write(fd, &temp -> Permission, sizeof(temp -> Permission));
-            
-            // Write the buffer content
-            write(fd, temp -> Buffer, MAXFILESIZE);
+            releaseReadView(&view);
+            iRet = ERR_HOST_IO;
+            break;
         }
-        temp = temp -> next;
+
+        releaseReadView(&view);
+        offset = offset + lRet;
     }
 
-    // Close the file descriptor
-    close(fd);
-    
-    return EXECUTE_SUCCESS;
+    unlockInode(temp);
+
+    if(close(hostFd) != 0)
+    {
+        return ERR_HOST_IO;
+    }
+
+    return iRet;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
-//  Function Name:         restoreCVFS()
-//  Description:           Restores the data from disk
-//  Input:                 void
-//  Output:                void
-//  Author:                Ritesh Jillewad
-//  Date:                  28/01/2026
+//  Function Name:         importFile()
+//  Description:           Creates a CVFS file with the exact contents of a file on the host, any
+//                         bytes (including NUL) are copied unchanged
+//  Input:                 Host path, Filename
+//  Output:                Status Code
+//  Date:                  17/10/2026
 //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void restoreCVFS()
+int importFile(char *hostPath, char *name)
 {
-    PINODE temp = head;
+    char *buffer = NULL;
+    ssize_t bytes = 0;
+    int hostFd = 0;
     int fd = 0;
-    int iRet = 0;
+    int iRet = EXECUTE_SUCCESS;
+
+    if(hostPath == NULL || name == NULL)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
 
-    // Temporary variables
-    char name[20] = {'\0'};
-    int inodeNum = 0;
-    int fileSize = 0;
-    int permission = 0;
+    if(isFileExists(name) == true)
+    {
+        return ERR_FILE_ALREADY_EXISTS;
+    }
 
-    // Open the backup file
-    fd = open(BACKUP_FILE, O_RDONLY);
+    hostFd = open(hostPath, O_RDONLY);
+    if(hostFd < 0)
+    {
+        return ERR_HOST_IO;
+    }
 
-    if(fd == -1)
+    buffer = (char *)malloc(IMPORTBUFFERSIZE);
+    if(buffer == NULL)
     {
-        printf("CVFS: No backup file found. Starting fresh.\n");
-        return;
+        close(hostFd);
+        return ERR_INSUFFICIENT_SPACE;
     }
 
-    // Read the file
-    // read() returns the number of bytes read. If it returns 0, it means End of File (EOF).
-    while((iRet = read(fd, name, sizeof(name))) > 0)
+    // Imported files get READ+WRITE permissions like copies
+    fd = createFile(name, READ + WRITE);
+    if(fd < 0)
     {
-        if(temp == NULL) break;
+        free(buffer);
+        close(hostFd);
+        return fd;
+    }
 
-        // Read the rest of the metadata
-        read(fd, &inodeNum, sizeof(int));
-        read(fd, &fileSize, sizeof(int));
-        read(fd, &permission, sizeof(int));
-        
-        // Read the data buffer
-        read(fd, temp -> Buffer, MAXFILESIZE);
+    while((bytes = read(hostFd, buffer, IMPORTBUFFERSIZE)) > 0)
+    {
+        if(writeFile(fd, buffer, (int)bytes) != bytes)
+        {
+            iRet = ERR_INSUFFICIENT_SPACE;
+            break;
+        }
+    }
 
-        // 3. Restore to Inode
-        strcpy(temp -> FileName, name);
-        temp -> ActualFileSize = fileSize;
-        temp -> Permission = permission;
-        temp -> FileType = REGULARFILE; 
+    if(bytes < 0)
+    {
+        iRet = ERR_HOST_IO;
+    }
 
-        // Update Superblock
-        superobj.FreeInodes--;
+    closeFile(fd);
+    free(buffer);
+    close(hostFd);
 
-        temp = temp -> next;
+    // Do not leave a partial file behind
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        unlinkFile(name);
     }
 
-    // Close the file descriptor
-    close(fd);
-    printf("CVFS: System restored successfully.\n");
+    return iRet;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1382,17 +3136,7 @@ int chmodFile(char *name, int new_permission)
     }
 
     // Now we need to find the file
-    temp = head;
-    while(temp != NULL)
-    {
-        if(strcmp(name, temp -> FileName) == 0)
-        {
-            // We found the file
-            break;
-        }
-
-        temp = temp -> next;
-    }
+    temp = lookupLockedInode(name, true);
 
     // File not found
     if(temp == NULL)
@@ -1402,6 +3146,11 @@ int chmodFile(char *name, int new_permission)
 
     // Now we will update the permission
     temp -> Permission = new_permission;
+    temp -> Generation = superobj.Generation;
+
+    journalLog(JOURNAL_CHMOD, temp, new_permission, NULL, 0);
+
+    unlockInode(temp);
 
     return EXECUTE_SUCCESS;
 }
@@ -0,0 +1,727 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  File Name:             cvfs_index.c
+//  Description:           Filename index (open addressing hash table) used for name based lookups
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "cvfs.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//     Global variables or objects used in the project
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct NameIndex indexobj = {.Epoch = 1, .Lock = PTHREAD_MUTEX_INITIALIZER};
+
+static pthread_key_t indexReaderKey;
+static pthread_once_t indexReaderOnce = PTHREAD_ONCE_INIT;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         hashFileName()
+//  Description:           Computes the FNV-1a hash of a filename
+//  Input:                 Filename
+//  Output:                32 bit hash value
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int hashFileName(const char *name)
+{
+    unsigned int hash = 2166136261u;
+
+    while(*name != '\0')
+    {
+        hash = hash ^ (unsigned char)(*name);
+        hash = hash * 16777619u;
+        name++;
+    }
+
+    // Zero stays reserved, the name index of backup images stores these hashes
+    if(hash == INDEX_EMPTY_HASH)
+    {
+        hash = 1;
+    }
+
+    return hash;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         releaseIndexReader()
+//  Description:           Gives the reader record of an exiting thread back for reuse
+//  Input:                 Reader record
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void releaseIndexReader(void *reader)
+{
+    __atomic_store_n(&((PINDEXREADER)reader) -> bUsed, false, __ATOMIC_RELEASE);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         createIndexReaderKey()
+//  Description:           Creates the thread specific key that holds the reader record of a thread
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void createIndexReaderKey()
+{
+    pthread_key_create(&indexReaderKey, releaseIndexReader);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getIndexReader()
+//  Description:           Returns the reader record of the calling thread. The first lookup of a thread
+//                         takes over the record of an exited thread or adds a new one to the list.
+//  Input:                 void
+//  Output:                Reader record or NULL if none could be allocated
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PINDEXREADER getIndexReader()
+{
+    PINDEXREADER reader = NULL;
+    bool bUsed = false;
+
+    pthread_once(&indexReaderOnce, createIndexReaderKey);
+
+    reader = (PINDEXREADER)pthread_getspecific(indexReaderKey);
+    if(reader != NULL)
+    {
+        return reader;
+    }
+
+    for(reader = __atomic_load_n(&indexobj.Readers, __ATOMIC_ACQUIRE); reader != NULL; reader = reader -> Next)
+    {
+        bUsed = false;
+        if(__atomic_compare_exchange_n(&reader -> bUsed, &bUsed, true, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) == true)
+        {
+            break;
+        }
+    }
+
+    // Records are never freed, the list only grows to the largest number of threads seen at once
+    if(reader == NULL)
+    {
+        reader = (PINDEXREADER)calloc(1, sizeof(INDEXREADER));
+        if(reader == NULL)
+        {
+            return NULL;
+        }
+
+        reader -> bUsed = true;
+        reader -> Next = __atomic_load_n(&indexobj.Readers, __ATOMIC_RELAXED);
+        while(__atomic_compare_exchange_n(&indexobj.Readers, &reader -> Next, reader, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED) == false)
+        {
+        }
+    }
+
+    pthread_setspecific(indexReaderKey, reader);
+
+    return reader;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         reclaimNameIndex()
+//  Description:           Moves to the next epoch when every running lookup began in the current one,
+//                         and frees what was removed two epochs ago: no lookup can still see it.
+//                         The caller holds the index lock.
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void reclaimNameIndex()
+{
+    PINDEXREADER reader = NULL;
+    PINDEXENTRY entry = NULL;
+    PINDEXTABLE table = NULL;
+    long long epoch = indexobj.Epoch;
+    long long seen = 0;
+    int old = 0;
+
+    // Pairs with the fence in lookupNameIndex(): a lookup this scan misses sees the removals
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    for(reader = __atomic_load_n(&indexobj.Readers, __ATOMIC_ACQUIRE); reader != NULL; reader = reader -> Next)
+    {
+        seen = __atomic_load_n(&reader -> Epoch, __ATOMIC_ACQUIRE);
+        if(seen != 0 && seen != epoch)
+        {
+            return;
+        }
+    }
+
+    epoch++;
+    __atomic_store_n(&indexobj.Epoch, epoch, __ATOMIC_RELEASE);
+
+    old = (int)((epoch + 1) % INDEX_EPOCHS);
+
+    while(indexobj.RetiredEntries[old] != NULL)
+    {
+        entry = indexobj.RetiredEntries[old];
+        indexobj.RetiredEntries[old] = entry -> NextRetired;
+        free(entry);
+    }
+
+    while(indexobj.RetiredTables[old] != NULL)
+    {
+        table = indexobj.RetiredTables[old];
+        indexobj.RetiredTables[old] = table -> NextRetired;
+        free(table -> Slots);
+        free(table);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         createIndexTable()
+//  Description:           Allocates an empty slot table
+//  Input:                 Capacity (power of two)
+//  Output:                Table pointer or NULL
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PINDEXTABLE createIndexTable(int capacity)
+{
+    PINDEXTABLE table = NULL;
+
+    table = (PINDEXTABLE)calloc(1, sizeof(INDEXTABLE));
+    if(table == NULL)
+    {
+        return NULL;
+    }
+
+    table -> Slots = (PINDEXSLOT)calloc(capacity, sizeof(INDEXSLOT));
+    if(table -> Slots == NULL)
+    {
+        free(table);
+        return NULL;
+    }
+
+    table -> Capacity = capacity;
+
+    return table;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         initialiseNameIndex()
+//  Description:           Allocates the slot table of the filename index, an existing index is dropped
+//  Input:                 Initial capacity (rounded up to a power of two)
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int initialiseNameIndex(int capacity)
+{
+    PINDEXTABLE table = NULL;
+    int size = INDEX_INITIAL_CAPACITY;
+
+    while(size < capacity)
+    {
+        size = size * 2;
+    }
+
+    table = createIndexTable(size);
+    if(table == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    destroyNameIndex();
+
+    __atomic_store_n(&indexobj.Table, table, __ATOMIC_RELEASE);
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         destroyNameIndex()
+//  Description:           Releases the filename index, no lookup may be running
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void destroyNameIndex()
+{
+    PINDEXTABLE table = indexobj.Table;
+    PINDEXENTRY entry = NULL;
+    int i = 0;
+
+    if(table != NULL)
+    {
+        for(i = 0; i < table -> Capacity; i++)
+        {
+            if(table -> Slots[i].Entry != NULL && table -> Slots[i].Entry != INDEX_TOMBSTONE)
+            {
+                free(table -> Slots[i].Entry);
+            }
+        }
+        free(table -> Slots);
+        free(table);
+    }
+
+    for(i = 0; i < INDEX_EPOCHS; i++)
+    {
+        while(indexobj.RetiredEntries[i] != NULL)
+        {
+            entry = indexobj.RetiredEntries[i];
+            indexobj.RetiredEntries[i] = entry -> NextRetired;
+            free(entry);
+        }
+
+        while(indexobj.RetiredTables[i] != NULL)
+        {
+            table = indexobj.RetiredTables[i];
+            indexobj.RetiredTables[i] = table -> NextRetired;
+            free(table -> Slots);
+            free(table);
+        }
+    }
+
+    indexobj.Table = NULL;
+    indexobj.Count = 0;
+    indexobj.Tombstones = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         resizeNameIndex()
+//  Description:           Rehashes all live entries into a new table (drops tombstones) and publishes
+//                         it. Lookups still probing the old table find the same entries there.
+//                         The caller holds the index lock.
+//  Input:                 New capacity (power of two)
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int resizeNameIndex(int capacity)
+{
+    PINDEXTABLE oldTable = indexobj.Table;
+    PINDEXTABLE newTable = NULL;
+    PINDEXENTRY entry = NULL;
+    unsigned int mask = 0;
+    unsigned int pos = 0;
+    int i = 0;
+
+    newTable = createIndexTable(capacity);
+    if(newTable == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    mask = (unsigned int)capacity - 1;
+
+    // Move every live entry; tombstones are simply left behind
+    for(i = 0; i < oldTable -> Capacity; i++)
+    {
+        entry = oldTable -> Slots[i].Entry;
+        if(entry != NULL && entry != INDEX_TOMBSTONE)
+        {
+            pos = entry -> Hash & mask;
+            while(newTable -> Slots[pos].Entry != NULL)
+            {
+                pos = (pos + 1) & mask;
+            }
+            newTable -> Slots[pos] = oldTable -> Slots[i];
+        }
+    }
+
+    __atomic_store_n(&indexobj.Table, newTable, __ATOMIC_RELEASE);
+    indexobj.Tombstones = 0;
+
+    oldTable -> NextRetired = indexobj.RetiredTables[indexobj.Epoch % INDEX_EPOCHS];
+    indexobj.RetiredTables[indexobj.Epoch % INDEX_EPOCHS] = oldTable;
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         findNameIndexSlot()
+//  Description:           Probes a table for the entry of the given filename. The entry of a slot is
+//                         loaded before its hash, which was stored first, so lookups can run while
+//                         the table is changed.
+//  Input:                 Table, filename, its hash, where to store the entry (may be NULL)
+//  Output:                Slot position or -1 if the name is not indexed
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int findNameIndexSlot(PINDEXTABLE table, const char *name, unsigned int hash, PINDEXENTRY *pentry)
+{
+    PINDEXENTRY entry = NULL;
+    unsigned int mask = 0;
+    unsigned int pos = 0;
+
+    if(table == NULL)
+    {
+        return -1;
+    }
+
+    mask = (unsigned int)table -> Capacity - 1;
+    pos = hash & mask;
+
+    // Linear probing stops at the first never-used slot
+    while((entry = __atomic_load_n(&table -> Slots[pos].Entry, __ATOMIC_ACQUIRE)) != NULL)
+    {
+        if(entry != INDEX_TOMBSTONE && __atomic_load_n(&table -> Slots[pos].Hash, __ATOMIC_RELAXED) == hash &&
+           strcmp(entry -> FileName, name) == 0)
+        {
+            if(pentry != NULL)
+            {
+                *pentry = entry;
+            }
+            return (int)pos;
+        }
+
+        pos = (pos + 1) & mask;
+    }
+
+    return -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         lookupNameIndex()
+//  Description:           Finds the inode of a file by its name without taking a lock. The inode may be
+//                         unlinked or renamed as soon as this returns, callers recheck it under the
+//                         inode lock. Inodes are never freed, so the pointer itself stays valid.
+//  Input:                 Filename
+//  Output:                Inode pointer or NULL if not found
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PINODE lookupNameIndex(const char *name)
+{
+    PINDEXREADER reader = NULL;
+    PINDEXENTRY entry = NULL;
+    PINODE temp = NULL;
+    unsigned int hash = 0;
+
+    if(name == NULL)
+    {
+        return NULL;
+    }
+
+    hash = hashFileName(name);
+
+    reader = getIndexReader();
+    if(reader == NULL)
+    {
+        pthread_mutex_lock(&indexobj.Lock);
+        if(findNameIndexSlot(indexobj.Table, name, hash, &entry) >= 0)
+        {
+            temp = entry -> ptrinode;
+        }
+        pthread_mutex_unlock(&indexobj.Lock);
+
+        return temp;
+    }
+
+    // Announce the epoch before touching the table, entries removed from now on stay allocated
+    __atomic_store_n(&reader -> Epoch, __atomic_load_n(&indexobj.Epoch, __ATOMIC_ACQUIRE), __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if(findNameIndexSlot(__atomic_load_n(&indexobj.Table, __ATOMIC_ACQUIRE), name, hash, &entry) >= 0)
+    {
+        temp = entry -> ptrinode;
+    }
+
+    __atomic_store_n(&reader -> Epoch, 0, __ATOMIC_RELEASE);
+
+    return temp;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         addNameIndexEntry()
+//  Description:           Publishes an entry under a name that is not in the table yet, growing or
+//                         purging the table first when needed. The caller holds the index lock.
+//  Input:                 Entry
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int addNameIndexEntry(PINDEXENTRY entry)
+{
+    PINDEXTABLE table = indexobj.Table;
+    unsigned int mask = 0;
+    unsigned int pos = 0;
+    int iRet = 0;
+
+    // Keep the load factor (live entries + tombstones) below 3/4
+    if((indexobj.Count + indexobj.Tombstones + 1) * 4 > table -> Capacity * 3)
+    {
+        if((indexobj.Count + 1) * 2 > table -> Capacity)
+        {
+            iRet = resizeNameIndex(table -> Capacity * 2);
+        }
+        else
+        {
+            iRet = resizeNameIndex(table -> Capacity);           /* Only tombstones to purge */
+        }
+
+        if(iRet != EXECUTE_SUCCESS)
+        {
+            return iRet;
+        }
+
+        table = indexobj.Table;
+    }
+
+    mask = (unsigned int)table -> Capacity - 1;
+    pos = entry -> Hash & mask;
+
+    // Reuse the first tombstone or empty slot on the probe path
+    while(table -> Slots[pos].Entry != NULL && table -> Slots[pos].Entry != INDEX_TOMBSTONE)
+    {
+        pos = (pos + 1) & mask;
+    }
+
+    if(table -> Slots[pos].Entry == INDEX_TOMBSTONE)
+    {
+        indexobj.Tombstones--;
+    }
+
+    // The entry and the hash are complete before a lookup can load the entry
+    __atomic_store_n(&table -> Slots[pos].Hash, entry -> Hash, __ATOMIC_RELAXED);
+    __atomic_store_n(&table -> Slots[pos].Entry, entry, __ATOMIC_RELEASE);
+    indexobj.Count++;
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         removeNameIndexSlot()
+//  Description:           Turns a used slot into a tombstone and retires its entry, it is freed once
+//                         no lookup can hold it any more. The caller holds the index lock.
+//  Input:                 Slot position
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void removeNameIndexSlot(int pos)
+{
+    PINDEXENTRY entry = indexobj.Table -> Slots[pos].Entry;
+
+    // A tombstone keeps probe chains that pass through this slot intact
+    __atomic_store_n(&indexobj.Table -> Slots[pos].Entry, INDEX_TOMBSTONE, __ATOMIC_RELEASE);
+    indexobj.Count--;
+    indexobj.Tombstones++;
+
+    entry -> NextRetired = indexobj.RetiredEntries[indexobj.Epoch % INDEX_EPOCHS];
+    indexobj.RetiredEntries[indexobj.Epoch % INDEX_EPOCHS] = entry;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         createIndexEntry()
+//  Description:           Allocates an entry for an inode under a name
+//  Input:                 Inode pointer, filename, its hash
+//  Output:                Entry or NULL
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PINDEXENTRY createIndexEntry(PINODE inode, const char *name, unsigned int hash)
+{
+    PINDEXENTRY entry = NULL;
+
+    entry = (PINDEXENTRY)malloc(sizeof(INDEXENTRY));
+    if(entry == NULL)
+    {
+        return NULL;
+    }
+
+    entry -> Hash = hash;
+    strncpy(entry -> FileName, name, sizeof(entry -> FileName) - 1);
+    entry -> FileName[sizeof(entry -> FileName) - 1] = '\0';
+    entry -> ptrinode = inode;
+    entry -> NextRetired = NULL;
+
+    return entry;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         insertNameIndex()
+//  Description:           Adds an inode to the index under its current FileName. Two threads creating
+//                         the same name both get here, only the first one succeeds.
+//  Input:                 Inode pointer
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int insertNameIndex(PINODE inode)
+{
+    PINDEXENTRY entry = NULL;
+    int iRet = EXECUTE_SUCCESS;
+
+    if(inode == NULL)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    entry = createIndexEntry(inode, inode -> FileName, hashFileName(inode -> FileName));
+    if(entry == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    pthread_mutex_lock(&indexobj.Lock);
+
+    if(indexobj.Table == NULL)
+    {
+        iRet = initialiseNameIndex(INDEX_INITIAL_CAPACITY);
+    }
+
+    if(iRet == EXECUTE_SUCCESS && findNameIndexSlot(indexobj.Table, entry -> FileName, entry -> Hash, NULL) >= 0)
+    {
+        iRet = ERR_FILE_ALREADY_EXISTS;
+    }
+
+    if(iRet == EXECUTE_SUCCESS)
+    {
+        iRet = addNameIndexEntry(entry);
+    }
+
+    if(iRet == EXECUTE_SUCCESS)
+    {
+        reclaimNameIndex();
+    }
+
+    pthread_mutex_unlock(&indexobj.Lock);
+
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        free(entry);
+    }
+
+    return iRet;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         removeNameIndex()
+//  Description:           Removes a filename from the index
+//  Input:                 Filename
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int removeNameIndex(const char *name)
+{
+    int pos = 0;
+
+    if(name == NULL)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    pthread_mutex_lock(&indexobj.Lock);
+
+    pos = findNameIndexSlot(indexobj.Table, name, hashFileName(name), NULL);
+    if(pos >= 0)
+    {
+        removeNameIndexSlot(pos);
+        reclaimNameIndex();
+    }
+
+    pthread_mutex_unlock(&indexobj.Lock);
+
+    return (pos >= 0) ? EXECUTE_SUCCESS : ERR_FILE_NOT_EXISTS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         renameNameIndex()
+//  Description:           Moves an indexed inode to a new name. The entry under the new name is
+//                         published before the old one is removed, so a concurrent lookup never
+//                         misses the file (it may briefly find it under both names and rechecks
+//                         FileName under the inode lock). The caller holds the inode write lock.
+//  Input:                 Inode pointer, new filename (must fit in FileName)
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int renameNameIndex(PINODE inode, const char *newName)
+{
+    PINDEXENTRY oldEntry = NULL;
+    PINDEXENTRY newEntry = NULL;
+    unsigned int oldHash = 0;
+    int iRet = EXECUTE_SUCCESS;
+
+    if(inode == NULL || newName == NULL)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    newEntry = createIndexEntry(inode, newName, hashFileName(newName));
+    if(newEntry == NULL)
+    {
+        return ERR_INSUFFICIENT_SPACE;
+    }
+
+    oldHash = hashFileName(inode -> FileName);
+
+    pthread_mutex_lock(&indexobj.Lock);
+
+    if(findNameIndexSlot(indexobj.Table, inode -> FileName, oldHash, &oldEntry) < 0 || oldEntry -> ptrinode != inode)
+    {
+        iRet = ERR_FILE_NOT_EXISTS;
+    }
+    else if(findNameIndexSlot(indexobj.Table, newEntry -> FileName, newEntry -> Hash, NULL) >= 0)
+    {
+        iRet = ERR_FILE_ALREADY_EXISTS;
+    }
+    else
+    {
+        // The table is unchanged when the new entry does not fit, the file keeps its old name
+        iRet = addNameIndexEntry(newEntry);
+    }
+
+    if(iRet == EXECUTE_SUCCESS)
+    {
+        // Adding may have moved the old entry into a grown table
+        removeNameIndexSlot(findNameIndexSlot(indexobj.Table, inode -> FileName, oldHash, NULL));
+        strcpy(inode -> FileName, newEntry -> FileName);
+        reclaimNameIndex();
+    }
+
+    pthread_mutex_unlock(&indexobj.Lock);
+
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        free(newEntry);
+    }
+
+    return iRet;
+}
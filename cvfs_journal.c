@@ -0,0 +1,853 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  File Name:             cvfs_journal.c
+//  Description:           Write-ahead journal: every change since the last backup is logged as a small
+//                         record, records are made durable in batches (group commit) and replayed on
+//                         top of the backup image at startup. Records carry the generation of their
+//                         change, so the ones the image already holds are skipped.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "cvfs.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//     Global variables or objects used in the project
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Journal journalobj = {.Lock = PTHREAD_MUTEX_INITIALIZER};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalNow()
+//  Description:           Returns a monotonic timestamp for the commit policy
+//  Input:                 void
+//  Output:                Microseconds
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static long long journalNow()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalChecksum()
+//  Description:           Continues an FNV-1a checksum over more bytes, a record whose checksum does
+//                         not match was torn by a crash
+//  Input:                 Checksum so far, data, number of bytes
+//  Output:                New checksum
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int journalChecksum(unsigned int hash, const void *data, long long size)
+{
+    const unsigned char *next = (const unsigned char *)data;
+    long long i = 0;
+
+    for(i = 0; i < size; i++)
+    {
+        hash = hash ^ next[i];
+        hash = hash * 16777619u;
+    }
+
+    return hash;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         fillJournalHeader()
+//  Description:           Builds the journal header for the backup image and the current policy
+//  Input:                 Header to fill
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void fillJournalHeader(PJOURNALHEADER header)
+{
+    memset(header, 0, sizeof(JOURNALHEADER));
+    memcpy(header -> Magic, JOURNAL_MAGIC, sizeof(header -> Magic));
+    header -> Version = JOURNAL_VERSION;
+    header -> HeaderSize = sizeof(JOURNALHEADER);
+    header -> ImageId = backupobj.ImageId;
+    header -> CommitInterval = journalobj.CommitInterval;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalWriteHeader()
+//  Description:           Starts the journal file over: only a header naming the current backup image
+//  Input:                 Host file descriptor
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int journalWriteHeader(int fd)
+{
+    JOURNALHEADER header;
+
+    fillJournalHeader(&header);
+
+    if(ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0 || writeAll(fd, &header, sizeof(header)) < 0 || fsync(fd) != 0)
+    {
+        return ERR_HOST_IO;
+    }
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalFail()
+//  Description:           Turns journaling off after the journal file could not be written
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void journalFail()
+{
+    printf("CVFS: Journal write failed, journaling is off until 'journal on'.\n");
+
+    close(journalobj.Writer.Fd);
+    imageWriterClose(&journalobj.Writer);
+
+    __atomic_store_n(&journalobj.bEnabled, false, __ATOMIC_RELEASE);
+    journalobj.PendingSince = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalOpen()
+//  Description:           Turns journaling on with records appended at the current file position
+//  Input:                 Host file descriptor
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int journalOpen(int fd)
+{
+    int iRet = 0;
+
+    iRet = imageWriterOpen(&journalobj.Writer, fd, JOURNALBUFFERSIZE);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        close(fd);
+        return iRet;
+    }
+
+    journalobj.PendingSince = 0;
+    __atomic_store_n(&journalobj.bEnabled, true, __ATOMIC_RELEASE);
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalStart()
+//  Description:           Turns journaling on (or changes the commit interval). The journal holds the
+//                         changes on top of a backup image, so the changes made so far are backed
+//                         up first (a full image when there is none yet).
+//  Input:                 Commit interval in microseconds, 0 = commit every operation
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int journalStart(long long interval)
+{
+    JOURNALHEADER header;
+    int fd = 0;
+    int iRet = 0;
+
+    if(interval < 0)
+    {
+        return ERR_INVALID_PARAMETER;
+    }
+
+    // Already on: commit what waits under the old policy and remember the new one
+    if(journalobj.bEnabled == true)
+    {
+        iRet = journalCommit();
+        if(iRet != EXECUTE_SUCCESS)
+        {
+            return iRet;
+        }
+
+        journalobj.CommitInterval = interval;
+        fillJournalHeader(&header);
+        if(pwrite(journalobj.Writer.Fd, &header, sizeof(header), 0) != sizeof(header))
+        {
+            journalFail();
+            return ERR_HOST_IO;
+        }
+
+        return EXECUTE_SUCCESS;
+    }
+
+    iRet = backupCVFS(false);
+    if(iRet != EXECUTE_SUCCESS)
+    {
+        return iRet;
+    }
+
+    fd = open(JOURNAL_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+    {
+        return ERR_HOST_IO;
+    }
+
+    journalobj.CommitInterval = interval;
+
+    if(journalWriteHeader(fd) != EXECUTE_SUCCESS)
+    {
+        close(fd);
+        unlink(JOURNAL_FILE);
+        return ERR_HOST_IO;
+    }
+
+    return journalOpen(fd);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalClose()
+//  Description:           Commits the pending records and closes the journal, it stays on disk and
+//                         is replayed (and journaling resumed) at the next start
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void journalClose()
+{
+    if(journalobj.bEnabled == false)
+    {
+        return;
+    }
+
+    if(journalCommit() != EXECUTE_SUCCESS)
+    {
+        return;                                         /* journalFail() closed it already */
+    }
+
+    close(journalobj.Writer.Fd);
+    imageWriterClose(&journalobj.Writer);
+
+    journalobj.bEnabled = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalStop()
+//  Description:           Turns journaling off and removes the journal file, changes are durable
+//                         again only through 'backup'
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void journalStop()
+{
+    journalClose();
+
+    unlink(JOURNAL_FILE);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalCommitLocked()
+//  Description:           Makes every staged record durable with one write and one fsync, the caller
+//                         holds the journal lock
+//  Input:                 void
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int journalCommitLocked()
+{
+    if(journalobj.bEnabled == false || journalobj.PendingSince == 0)
+    {
+        return EXECUTE_SUCCESS;
+    }
+
+    if(imageWriterFlush(&journalobj.Writer) != EXECUTE_SUCCESS || fdatasync(journalobj.Writer.Fd) != 0)
+    {
+        journalFail();
+        return ERR_HOST_IO;
+    }
+
+    journalobj.Commits++;
+    journalobj.PendingSince = 0;
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalCommit()
+//  Description:           Makes every staged record durable with one write and one fsync
+//  Input:                 void
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int journalCommit()
+{
+    int iRet = 0;
+
+    pthread_mutex_lock(&journalobj.Lock);
+    iRet = journalCommitLocked();
+    pthread_mutex_unlock(&journalobj.Lock);
+
+    return iRet;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalAppend()
+//  Description:           Stages one record and commits the batch when the oldest record has waited
+//                         the commit interval or the batch fills half of the staging buffer
+//  Input:                 Record type, file id, argument, payload fragments, number of fragments,
+//                         payload bytes
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void journalAppend(int type, long long fileId, long long argument, const struct iovec *iov, int iovcnt, long long length)
+{
+    JOURNALRECORD record;
+    long long left = 0;
+    long long chunk = 0;
+    long long now = 0;
+    int i = 0;
+
+    memset(&record, 0, sizeof(record));
+    record.Type = type;
+    record.FileId = fileId;
+    record.Argument = argument;
+    record.Generation = superobj.Generation;
+    record.Length = (int)length;
+
+    record.Checksum = journalChecksum(2166136261u, (char *)&record + sizeof(record.Checksum), sizeof(record) - sizeof(record.Checksum));
+    for(i = 0, left = length; i < iovcnt && left > 0; i++, left = left - chunk)
+    {
+        chunk = ((long long)iov[i].iov_len < left) ? (long long)iov[i].iov_len : left;
+        record.Checksum = journalChecksum(record.Checksum, iov[i].iov_base, chunk);
+    }
+
+    // The checksum is computed outside the lock, a failed commit may have turned journaling off since
+    pthread_mutex_lock(&journalobj.Lock);
+    if(journalobj.bEnabled == false)
+    {
+        pthread_mutex_unlock(&journalobj.Lock);
+        return;
+    }
+
+    imageWriterAppend(&journalobj.Writer, &record, sizeof(record));
+    for(i = 0, left = length; i < iovcnt && left > 0; i++, left = left - chunk)
+    {
+        chunk = ((long long)iov[i].iov_len < left) ? (long long)iov[i].iov_len : left;
+        imageWriterAppend(&journalobj.Writer, iov[i].iov_base, chunk);
+    }
+
+    journalobj.Records++;
+
+    now = journalNow();
+    if(journalobj.PendingSince == 0)
+    {
+        journalobj.PendingSince = now;
+    }
+
+    if(journalobj.Writer.bError == true || journalobj.CommitInterval == 0 ||
+       now - journalobj.PendingSince >= journalobj.CommitInterval || journalobj.Writer.Used >= journalobj.Writer.Capacity / 2)
+    {
+        journalCommitLocked();
+    }
+    pthread_mutex_unlock(&journalobj.Lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalLog()
+//  Description:           Logs a change of a file, called after the change was made in memory
+//  Input:                 Record type, Inode pointer, argument, payload (name or data), payload bytes
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void journalLog(int type, PINODE inode, long long argument, const void *data, int length)
+{
+    struct iovec iov;
+
+    if(__atomic_load_n(&journalobj.bEnabled, __ATOMIC_ACQUIRE) == false)
+    {
+        return;
+    }
+
+    iov.iov_base = (void *)data;
+    iov.iov_len = (data == NULL) ? 0 : (size_t)length;
+
+    journalAppend(type, inode -> FileId, argument, &iov, 1, (data == NULL) ? 0 : length);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalLogv()
+//  Description:           Logs a vectored write as one record, the fragments are gathered into it
+//  Input:                 Inode pointer, file offset, iovec array, number of fragments, bytes written
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void journalLogv(PINODE inode, long long offset, const struct iovec *iov, int iovcnt, long long length)
+{
+    if(__atomic_load_n(&journalobj.bEnabled, __ATOMIC_ACQUIRE) == false || length <= 0)
+    {
+        return;
+    }
+
+    journalAppend(JOURNAL_WRITE, inode -> FileId, offset, iov, iovcnt, length);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalMark()
+//  Description:           Commits the staged records and returns where the next record will go, a
+//                         backup snapshot taken now holds every record before that offset
+//  Input:                 void
+//  Output:                Offset in the journal file, -1 when journaling is off
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+long long journalMark()
+{
+    long long offset = -1;
+
+    pthread_mutex_lock(&journalobj.Lock);
+    if(journalobj.bEnabled == true && journalCommitLocked() == EXECUTE_SUCCESS)
+    {
+        offset = lseek(journalobj.Writer.Fd, 0, SEEK_CUR);
+    }
+    pthread_mutex_unlock(&journalobj.Lock);
+
+    return offset;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalTrimLocked()
+//  Description:           Drops the records a finished backup holds. Records logged while the backup
+//                         was written are copied behind a new header into a temporary file that
+//                         then replaces the journal. Either file is valid after a crash, records
+//                         already in the image are skipped by their generation. The caller holds
+//                         the journal lock.
+//  Input:                 Offset returned by journalMark() when the backup snapshot was taken
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void journalTrimLocked(long long offset)
+{
+    long long end = 0;
+    long long position = 0;
+    long long chunk = 0;
+    int fd = 0;
+
+    if(journalobj.bEnabled == false || offset < 0 || journalCommitLocked() != EXECUTE_SUCCESS)
+    {
+        return;
+    }
+
+    // Nothing was logged behind the snapshot, the journal starts over
+    end = lseek(journalobj.Writer.Fd, 0, SEEK_CUR);
+    if(end <= offset)
+    {
+        if(journalWriteHeader(journalobj.Writer.Fd) != EXECUTE_SUCCESS)
+        {
+            journalFail();
+        }
+        return;
+    }
+
+    fd = open(JOURNAL_TEMP_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+    {
+        return;
+    }
+
+    // The staging buffer is empty after the commit and carries the copy
+    position = offset;
+    if(journalWriteHeader(fd) == EXECUTE_SUCCESS)
+    {
+        while(position < end)
+        {
+            chunk = (end - position < journalobj.Writer.Capacity) ? end - position : journalobj.Writer.Capacity;
+            chunk = pread(journalobj.Writer.Fd, journalobj.Writer.Buffer, (size_t)chunk, position);
+            if(chunk <= 0 || writeAll(fd, journalobj.Writer.Buffer, chunk) < 0)
+            {
+                break;
+            }
+            position = position + chunk;
+        }
+    }
+
+    // On any error the old journal stays in use, it is only longer
+    if(position < end || fsync(fd) != 0 || rename(JOURNAL_TEMP_FILE, JOURNAL_FILE) != 0)
+    {
+        close(fd);
+        unlink(JOURNAL_TEMP_FILE);
+        return;
+    }
+
+    close(journalobj.Writer.Fd);
+    journalobj.Writer.Fd = fd;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalTrim()
+//  Description:           Drops the records a finished backup holds, file calls on other threads
+//                         wait to log until the journal is replaced
+//  Input:                 Offset returned by journalMark() when the backup snapshot was taken
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void journalTrim(long long offset)
+{
+    pthread_mutex_lock(&journalobj.Lock);
+    journalTrimLocked(offset);
+    pthread_mutex_unlock(&journalobj.Lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         getJournalInode()
+//  Description:           Finds the inode of a file id during replay
+//  Input:                 Inodes by file id, number of entries, file id
+//  Output:                Inode pointer or NULL
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static PINODE getJournalInode(PINODE *byId, long long count, long long fileId)
+{
+    if(fileId <= 0 || fileId >= count)
+    {
+        return NULL;
+    }
+
+    return byId[fileId];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalApply()
+//  Description:           Repeats one logged change, records of files that do not exist are skipped
+//  Input:                 Record, payload, inodes by file id (grows for new files), number of entries
+//  Output:                Status Code
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int journalApply(PJOURNALRECORD record, char *payload, PINODE **pbyId, long long *pcount)
+{
+    PINODE temp = getJournalInode(*pbyId, *pcount, record -> FileId);
+    PINODE source = NULL;
+    PINODE *newById = NULL;
+    long long newCount = 0;
+    char name[20] = {'\0'};
+
+    if(record -> Type == JOURNAL_CREATE || record -> Type == JOURNAL_RENAME)
+    {
+        if(record -> Length <= 0 || record -> Length >= (int)sizeof(name))
+        {
+            return ERR_INVALID_PARAMETER;
+        }
+
+        memcpy(name, payload, record -> Length);
+        if(isFileExists(name) == true)
+        {
+            return ERR_FILE_ALREADY_EXISTS;
+        }
+    }
+
+    if(record -> Type == JOURNAL_CREATE)
+    {
+        if(temp != NULL || record -> FileId <= 0)
+        {
+            return ERR_FILE_ALREADY_EXISTS;
+        }
+
+        if(record -> FileId >= *pcount)
+        {
+            newCount = (*pcount * 2 > record -> FileId + 1) ? *pcount * 2 : record -> FileId + 1;
+            newById = (PINODE *)realloc(*pbyId, sizeof(PINODE) * newCount);
+            if(newById == NULL)
+            {
+                return ERR_INSUFFICIENT_SPACE;
+            }
+
+            memset(newById + *pcount, 0, sizeof(PINODE) * (newCount - *pcount));
+            *pbyId = newById;
+            *pcount = newCount;
+        }
+
+        temp = allocateInode();
+        if(temp == NULL)
+        {
+            return ERR_NO_INODES;
+        }
+
+        strcpy(temp -> FileName, name);
+        temp -> FileType = REGULARFILE;
+        temp -> Permission = (int)record -> Argument;
+        temp -> FileId = record -> FileId;
+        insertNameIndex(temp);
+
+        (*pbyId)[record -> FileId] = temp;
+        if(superobj.NextFileId <= record -> FileId)
+        {
+            superobj.NextFileId = record -> FileId + 1;
+        }
+
+        return EXECUTE_SUCCESS;
+    }
+
+    if(temp == NULL)
+    {
+        return ERR_FILE_NOT_EXISTS;
+    }
+
+    switch(record -> Type)
+    {
+        case JOURNAL_WRITE:
+            if(record -> Argument < 0 || record -> Argument > MAXFILESIZE - record -> Length)
+            {
+                return ERR_INVALID_PARAMETER;
+            }
+            writeInodeData(temp, payload, record -> Argument, record -> Length);
+            break;
+
+        case JOURNAL_TRUNCATE:
+            freeInodeBlocks(temp);
+            temp -> ActualFileSize = 0;
+            temp -> Generation = superobj.Generation;
+            temp -> BaseGeneration = superobj.Generation;
+            break;
+
+        case JOURNAL_UNLINK:
+            unlinkFile(temp -> FileName);
+            (*pbyId)[record -> FileId] = NULL;
+            break;
+
+        case JOURNAL_RENAME:
+            renameNameIndex(temp, name);
+            temp -> Generation = superobj.Generation;
+            break;
+
+        case JOURNAL_CHMOD:
+            temp -> Permission = (int)record -> Argument;
+            temp -> Generation = superobj.Generation;
+            break;
+
+        case JOURNAL_COPY:
+            source = getJournalInode(*pbyId, *pcount, record -> Argument);
+            if(source == NULL)
+            {
+                return ERR_FILE_NOT_EXISTS;
+            }
+            shareInodeBlocks(temp, source);
+            break;
+
+        default:
+            return ERR_INVALID_PARAMETER;
+    }
+
+    return EXECUTE_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         journalRecover()
+//  Description:           Runs at startup after the backup image was restored: replays the records of
+//                         the journal that belongs to that image and are newer than it, cuts off a
+//                         record torn by a crash and resumes journaling behind the last good record
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void journalRecover()
+{
+    JOURNALHEADER header;
+    JOURNALRECORD record;
+    struct stat info;
+    PINODE *byId = NULL;
+    char *payload = NULL;
+    char *newPayload = NULL;
+    long long count = 0;
+    long long position = 0;
+    long long replayed = 0;
+    long long newest = 0;
+    int payloadCapacity = 0;
+    int fd = 0;
+    int i = 0;
+
+    fd = open(JOURNAL_FILE, O_RDWR);
+    if(fd < 0)
+    {
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    if(readAll(fd, &header, sizeof(header)) != sizeof(header) || memcmp(header.Magic, JOURNAL_MAGIC, sizeof(header.Magic)) != 0 ||
+       header.Version != JOURNAL_VERSION || header.HeaderSize != sizeof(JOURNALHEADER) || fstat(fd, &info) != 0)
+    {
+        printf("CVFS: Journal file is damaged, ignored.\n");
+        close(fd);
+        return;
+    }
+
+    journalobj.CommitInterval = (header.CommitInterval < 0) ? JOURNAL_DEFAULT_INTERVAL : header.CommitInterval;
+
+    // A journal of another image has nothing to add
+    if(header.ImageId == 0 || header.ImageId != backupobj.ImageId)
+    {
+        close(fd);
+        printf("CVFS: Journal does not belong to the backup image, starting a new one.\n");
+        journalStart(journalobj.CommitInterval);
+        return;
+    }
+
+    count = superobj.NextFileId + 1;
+    byId = (PINODE *)calloc(count, sizeof(PINODE));
+    if(byId == NULL)
+    {
+        close(fd);
+        printf("CVFS: Not enough memory to replay the journal.\n");
+        return;
+    }
+
+    for(i = 1; i < inodetableobj.NextUnused; i++)
+    {
+        if(getInode(i) -> FileType != 0 && getInode(i) -> FileId > 0 && getInode(i) -> FileId < count)
+        {
+            byId[getInode(i) -> FileId] = getInode(i);
+        }
+    }
+
+    position = sizeof(header);
+
+    while(readAll(fd, &record, sizeof(record)) == sizeof(record))
+    {
+        if(record.Length < 0 || record.Length > info.st_size - position - (long long)sizeof(record))
+        {
+            break;
+        }
+
+        if(record.Length > payloadCapacity)
+        {
+            newPayload = (char *)realloc(payload, record.Length);
+            if(newPayload == NULL)
+            {
+                break;
+            }
+            payload = newPayload;
+            payloadCapacity = record.Length;
+        }
+
+        if(readAll(fd, payload, record.Length) != record.Length)
+        {
+            break;
+        }
+
+        // The first torn record ends the journal
+        if(journalChecksum(journalChecksum(2166136261u, (char *)&record + sizeof(record.Checksum), sizeof(record) - sizeof(record.Checksum)),
+                           payload, record.Length) != record.Checksum)
+        {
+            break;
+        }
+
+        // Records up to the snapshot of the image are in it already (the backup finished, the trim did not)
+        if(record.Generation > backupobj.SnapshotGeneration)
+        {
+            journalApply(&record, payload, &byId, &count);
+            replayed++;
+        }
+
+        if(record.Generation > newest)
+        {
+            newest = record.Generation;
+        }
+
+        position = position + sizeof(record) + record.Length;
+    }
+
+    free(payload);
+    free(byId);
+
+    // Records logged from now on must be newer than the ones kept in the journal
+    if(superobj.Generation <= newest)
+    {
+        superobj.Generation = newest + 1;
+    }
+
+    // Records are appended behind the last good one
+    if(ftruncate(fd, position) != 0 || lseek(fd, position, SEEK_SET) != position || journalOpen(fd) != EXECUTE_SUCCESS)
+    {
+        close(fd);
+        printf("CVFS: Journal could not be reopened, journaling is off.\n");
+        return;
+    }
+
+    printf("CVFS: Journal replayed (%lld changes).\n", replayed);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Function Name:         displayJournalStatus()
+//  Description:           Prints whether journaling is on, its commit policy and counters
+//  Input:                 void
+//  Output:                void
+//  Date:                  17/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void displayJournalStatus()
+{
+    if(journalobj.bEnabled == false)
+    {
+        printf("Journal             : off (changes are durable after 'backup')\n");
+        return;
+    }
+
+    printf("Journal             : on (%s)\n", JOURNAL_FILE);
+    printf("Commit interval     : %lld us%s\n", journalobj.CommitInterval, (journalobj.CommitInterval == 0) ? " (every operation)" : "");
+    printf("Records / commits   : %lld / %lld\n", journalobj.Records, journalobj.Commits);
+    printf("Pending bytes       : %lld\n", journalobj.Writer.Used);
+}
@@ -10,15 +10,29 @@ int main()
 {
     char str[80] = {'\0'};
     char Command[5][80];                        // Buffer to store parsed command tokens
-    char InputBuffer[MAXFILESIZE] = {'\0'};
+    char InputBuffer[MAXINPUTSIZE] = {'\0'};
     char * EmptyBuffer = NULL;
+    READVIEW view;
+    PUAREA pSession = NULL;
 
     int iCount = 0;
+    int i = 0;
     int iRet = 0;
+    long long lRet = 0;
 
     // Initialize the auxilary data
     startAuxillaryDataInitialization();
 
+    // File data goes back to disk storage if the last run kept it there
+    storageResume();
+
+    // Bring back the files of the last backup, an image is mapped so this takes
+    // milliseconds even for a large backup
+    restoreCVFS();
+
+    // Changes logged after that backup are replayed on top of it
+    journalRecover();
+
     printf("\n");
     printf("----------------------------------------------------------------------------\n");
     printf("------------ Customised Virtual Filesystem Started Successfully ------------\n");
@@ -29,6 +43,12 @@ int main()
         fflush(stdin);
         strcpy(str, " ");
 
+        // Nothing the user has seen succeed waits in the journal while the shell is idle
+        journalCommit();
+
+        // Report a backup that finished in the background
+        backupPoll();
+
         printf("\nCVFS > ");
         fgets(str, sizeof(str), stdin);                                         /* Read input line */
 
@@ -49,6 +69,9 @@ int main()
             {
                 printf("Thank you for using CVFS.\n");
                 printf("Releasing resources...\n");
+                backupWait();
+                journalClose();
+                storageClose();
                 break;                                                         // End of infinite listening loop
             }// End of exit command
 
@@ -89,10 +112,19 @@ int main()
             /* backup command */
             else if(strcmp("backup", Command[0]) == 0)
             {
-                iRet = backupCVFS();
-                if(iRet == EXECUTE_SUCCESS)
+                iRet = backupStart(false);
+                if(iRet == EXECUTE_SUCCESS && backupobj.bRunning == true)
+                {
+                     printf("CVFS: Backup started in the background (snapshot took %lld us).\n", backupobj.Snapshot.PauseTime);
+                }
+                else if(iRet == EXECUTE_SUCCESS)
                 {
-                     printf("CVFS: Backup created successfully.\n");
+                     printf("CVFS: Backup created successfully (%s, %lld bytes written).\n",
+                            backupobj.bLastIncremental ? "incremental" : "full", backupobj.LastBytes);
+                }
+                else if(iRet == ERR_BACKUP_RUNNING)
+                {
+                     printf("CVFS: A backup is still running, see 'backup status'.\n");
                 }
                 else
                 {
@@ -106,6 +138,41 @@ int main()
                 restoreCVFS();
             }
 
+            /* scrub command */
+            /* CVFS > scrub */
+            else if(strcmp("scrub", Command[0]) == 0)
+            {
+                scrubCVFS();
+            }
+
+            /* memstat command */
+            /* CVFS > memstat */
+            else if(strcmp("memstat", Command[0]) == 0)
+            {
+                displayMemoryStats();
+            }
+
+            /* journal command */
+            /* CVFS > journal */
+            else if(strcmp("journal", Command[0]) == 0)
+            {
+                displayJournalStatus();
+            }
+
+            /* storage command */
+            /* CVFS > storage */
+            else if(strcmp("storage", Command[0]) == 0)
+            {
+                displayStorageStatus();
+            }
+
+            /* session command */
+            /* CVFS > session */
+            else if(strcmp("session", Command[0]) == 0)
+            {
+                displaySessions();
+            }
+
             else 
             {
                 printf("ERROR: Command '%s' not recognized! Refer to 'help' for command info.\n", Command[0]);
@@ -124,6 +191,168 @@ int main()
                 manPageDisplay(Command[1]);            // Command[1] contains the name of command
             }
 
+            /* session switch command, a new name creates the session */
+            /* CVFS > session client1 */
+            else if(strcmp("session", Command[0]) == 0)
+            {
+                pSession = findSession(Command[1]);
+                if(pSession == NULL)
+                {
+                    pSession = createSession(Command[1]);
+                }
+
+                if(pSession == NULL)
+                {
+                    printf("ERROR: Unable to create the session (name too long?).\n");
+                }
+                else
+                {
+                    setSession(pSession);
+                    printf("Working in session '%s'.\n", pSession -> ProcessName);
+                }
+            }
+
+            /* journal on/off command */
+            /* CVFS > journal on */
+            else if(strcmp("journal", Command[0]) == 0)
+            {
+                if(strcmp("on", Command[1]) == 0)
+                {
+                    iRet = journalStart(journalobj.bEnabled ? journalobj.CommitInterval : JOURNAL_DEFAULT_INTERVAL);
+                    if(iRet == EXECUTE_SUCCESS)
+                    {
+                        printf("CVFS: Journaling is on (commit interval %lld us).\n", journalobj.CommitInterval);
+                    }
+                    else
+                    {
+                        printf("ERROR: Unable to start the journal.\n");
+                    }
+                }
+                else if(strcmp("off", Command[1]) == 0)
+                {
+                    journalStop();
+                    printf("CVFS: Journaling is off.\n");
+                }
+                else
+                {
+                    printf("ERROR: Use 'journal on' or 'journal off'.\n");
+                }
+            }
+
+            /* storage mode command */
+            /* CVFS > storage disk */
+            else if(strcmp("storage", Command[0]) == 0)
+            {
+                if(strcmp("disk", Command[1]) == 0 || strcmp("direct", Command[1]) == 0)
+                {
+                    iRet = storageStart(CACHE_DEFAULT_MB * (1024LL * 1024 / BLOCKSIZE), strcmp("direct", Command[1]) == 0);
+                    if(iRet == EXECUTE_SUCCESS)
+                    {
+                        printf("CVFS: File data is kept in %s (%d MB buffer cache%s).\n", STORAGE_FILE, CACHE_DEFAULT_MB,
+                               deviceobj.bDirect ? ", O_DIRECT" : "");
+                    }
+                    else
+                    {
+                        printf("ERROR: Unable to move file data to %s.\n", STORAGE_FILE);
+                    }
+                }
+                else if(strcmp("memory", Command[1]) == 0)
+                {
+                    iRet = storageStop();
+                    if(iRet == EXECUTE_SUCCESS)
+                    {
+                        printf("CVFS: File data is kept in memory.\n");
+                    }
+                    else
+                    {
+                        printf("ERROR: Not enough memory for the file data, it stays on disk.\n");
+                    }
+                }
+                else
+                {
+                    printf("ERROR: Use 'storage disk', 'storage direct' or 'storage memory'.\n");
+                }
+            }
+
+            /* backup full command */
+            /* CVFS > backup full */
+            else if(strcmp("backup", Command[0]) == 0 && strcmp("full", Command[1]) == 0)
+            {
+                iRet = backupStart(true);
+                if(iRet == EXECUTE_SUCCESS && backupobj.bRunning == true)
+                {
+                     printf("CVFS: Full backup started in the background (snapshot took %lld us).\n", backupobj.Snapshot.PauseTime);
+                }
+                else if(iRet == EXECUTE_SUCCESS)
+                {
+                     printf("CVFS: Full backup created successfully (%lld bytes written).\n", backupobj.LastBytes);
+                }
+                else if(iRet == ERR_BACKUP_RUNNING)
+                {
+                     printf("CVFS: A backup is still running, see 'backup status'.\n");
+                }
+                else
+                {
+                     printf("CVFS: Error creating backup.\n");
+                }
+            }
+
+            /* backup status command */
+            /* CVFS > backup status */
+            else if(strcmp("backup", Command[0]) == 0 && strcmp("status", Command[1]) == 0)
+            {
+                displayBackupStatus();
+            }
+
+            /* restore file command */
+            /* CVFS > restore demo.txt */
+            else if(strcmp("restore", Command[0]) == 0)
+            {
+                iRet = restoreFile(Command[1]);
+                if(iRet == EXECUTE_SUCCESS)
+                {
+                     printf("CVFS: %s restored from the backup.\n", Command[1]);
+                }
+                else if(iRet == ERR_FILE_ALREADY_EXISTS)
+                {
+                     printf("CVFS: %s exists already, delete it to restore the backed up copy.\n", Command[1]);
+                }
+                else if(iRet == ERR_FILE_NOT_EXISTS)
+                {
+                     printf("CVFS: %s is not in the backup.\n", Command[1]);
+                }
+                else if(iRet == ERR_HOST_IO)
+                {
+                     printf("CVFS: No backup file found.\n");
+                }
+                else if(iRet == ERR_NO_INODES)
+                {
+                     printf("CVFS: No free inodes available.\n");
+                }
+                else if(iRet == ERR_CHECKSUM)
+                {
+                     printf("CVFS: Backup image failed its checksums, %s is incomplete.\n", Command[1]);
+                }
+                else
+                {
+                     printf("CVFS: Backup image is damaged, %s could not be restored.\n", Command[1]);
+                }
+            }
+
+            /* backup wait command */
+            /* CVFS > backup wait */
+            else if(strcmp("backup", Command[0]) == 0 && strcmp("wait", Command[1]) == 0)
+            {
+                if(backupobj.bRunning == false)
+                {
+                     printf("CVFS: No backup is running.\n");
+                }
+                else
+                {
+                     backupWait();
+                }
+            }
+
             /* truncate command */
             /* CVFS > truncate demo.txt */
             else if(strcmp("truncate", Command[0]) == 0)
@@ -217,9 +446,10 @@ int main()
             else if(strcmp("write", Command[0]) == 0)
             {
                 printf("Enter the data: \n");
-                fgets(InputBuffer, MAXFILESIZE, stdin);
+                fgets(InputBuffer, MAXINPUTSIZE, stdin);
 
-                iRet = writeFile(atoi(Command[1]), InputBuffer, strlen(InputBuffer) - 1);           // We sent the stirng excuding \0
+                // Only the line break is dropped, a last line without one is written completely
+                iRet = writeFile(atoi(Command[1]), InputBuffer, strcspn(InputBuffer, "\n"));
                 if(iRet == ERR_INVALID_PARAMETER)
                 {
                     printf("ERROR: Invalid parameters.\n");
@@ -337,9 +567,8 @@ int main()
             // CVFS > read 3 10
             else if(strcmp("read", Command[0]) == 0)
             {
-                EmptyBuffer = (char*)malloc(atoi(Command[2]) + 1);
-
-                iRet = readFile(atoi(Command[1]), EmptyBuffer, atoi(Command[2]));
+                // The data is printed straight from the file blocks, no buffer is needed
+                iRet = readViewFile(atoi(Command[1]), atoi(Command[2]), &view);
                 if(iRet == ERR_INVALID_PARAMETER)
                 {
                     printf("ERROR: Invalid parameters.\n");
@@ -363,10 +592,14 @@ int main()
                 else
                 {
                     printf("Read operation successful.\n");
-                    EmptyBuffer[iRet] = '\0';
-                    printf("Data read from file: %s\n", EmptyBuffer);
+                    printf("Data read from file: ");
+                    for(i = 0; i < view.SegmentCount; i++)
+                    {
+                        fwrite(view.Segments[i].Data, 1, view.Segments[i].Length, stdout);
+                    }
+                    printf("\n");
 
-                    free(EmptyBuffer);
+                    releaseReadView(&view);
                 }
             }
 
@@ -413,6 +646,88 @@ int main()
                 }
             }
 
+            // import command
+            // CVFS > import /tmp/photo.jpg photo.jpg
+            else if(strcmp("import", Command[0]) == 0)
+            {
+                iRet = importFile(Command[1], Command[2]);
+
+                if(iRet == EXECUTE_SUCCESS)
+                {
+                    printf("File imported successfully.\n");
+                }
+                else if(iRet == ERR_FILE_ALREADY_EXISTS)
+                {
+                    printf("Error: A file with this name already exists.\n");
+                }
+                else if(iRet == ERR_HOST_IO)
+                {
+                    printf("Error: Unable to read the host file.\n");
+                }
+                else if(iRet == ERR_NO_INODES || iRet == ERR_MAX_FILES_OPEN || iRet == ERR_INVALID_PARAMETER)
+                {
+                    printf("Error: Unable to create the file.\n");
+                }
+                else if(iRet == ERR_INSUFFICIENT_SPACE)
+                {
+                    printf("Error: Insufficient space.\n");
+                }
+            }
+
+            // export command
+            // CVFS > export Demo.txt /tmp/Demo.txt
+            else if(strcmp("export", Command[0]) == 0)
+            {
+                iRet = exportFile(Command[1], Command[2]);
+
+                if(iRet == EXECUTE_SUCCESS)
+                {
+                    printf("File exported successfully.\n");
+                }
+                else if(iRet == ERR_FILE_NOT_EXISTS)
+                {
+                    printf("Error: File does not exist.\n");
+                }
+                else if(iRet == ERR_PERMISSION_DENIED)
+                {
+                    printf("Error: Permission denied.\n");
+                }
+                else if(iRet == ERR_HOST_IO)
+                {
+                    printf("Error: Unable to write the host file.\n");
+                }
+            }
+
+            // pwrite command
+            // CVFS > pwrite 3 100
+            else if(strcmp("pwrite", Command[0]) == 0)
+            {
+                printf("Enter the data: \n");
+                fgets(InputBuffer, MAXINPUTSIZE, stdin);
+
+                iRet = pwriteFile(atoi(Command[1]), InputBuffer, strcspn(InputBuffer, "\n"), atoll(Command[2]));
+                if(iRet == ERR_INVALID_PARAMETER)
+                {
+                    printf("ERROR: Invalid parameters.\n");
+                }
+                else if(iRet == ERR_FILE_NOT_EXISTS)
+                {
+                    printf("ERROR: File does not exist.\n");
+                }
+                else if(iRet == ERR_PERMISSION_DENIED)
+                {
+                    printf("ERROR: Write failed. Permission denied.\n");
+                }
+                else if(iRet == ERR_INSUFFICIENT_SPACE)
+                {
+                    printf("ERROR: Write failed. Insufficient space.\n");
+                }
+                else
+                {
+                    printf("%d bytes were successfully written at offset %lld.\n", iRet, atoll(Command[2]));
+                }
+            }
+
             // CVFS > chmod Demo.txt 1
             else if(strcmp("chmod", Command[0]) == 0)
             {
@@ -432,6 +747,66 @@ int main()
                 }
             }
 
+            /* storage with a buffer cache size */
+            /* CVFS > storage disk 256 */
+            else if(strcmp("storage", Command[0]) == 0 && (strcmp("disk", Command[1]) == 0 || strcmp("direct", Command[1]) == 0))
+            {
+                iRet = ERR_INVALID_PARAMETER;
+                if(atoll(Command[2]) > 0)
+                {
+                    iRet = storageStart(atoll(Command[2]) * (1024LL * 1024 / BLOCKSIZE), strcmp("direct", Command[1]) == 0);
+                }
+
+                if(iRet == EXECUTE_SUCCESS)
+                {
+                    printf("CVFS: File data is kept in %s (%lld MB buffer cache%s).\n", STORAGE_FILE, atoll(Command[2]),
+                           deviceobj.bDirect ? ", O_DIRECT" : "");
+                }
+                else if(iRet == ERR_INVALID_PARAMETER)
+                {
+                    printf("ERROR: The buffer cache size is given in MB, at least 1.\n");
+                }
+                else
+                {
+                    printf("ERROR: Unable to move file data to %s.\n", STORAGE_FILE);
+                }
+            }
+
+            /* journal on with a commit interval */
+            /* CVFS > journal on 5000 */
+            else if(strcmp("journal", Command[0]) == 0 && strcmp("on", Command[1]) == 0)
+            {
+                iRet = journalStart(atoll(Command[2]));
+                if(iRet == EXECUTE_SUCCESS)
+                {
+                    printf("CVFS: Journaling is on (commit interval %lld us).\n", journalobj.CommitInterval);
+                }
+                else if(iRet == ERR_INVALID_PARAMETER)
+                {
+                    printf("ERROR: The commit interval must not be negative.\n");
+                }
+                else
+                {
+                    printf("ERROR: Unable to start the journal.\n");
+                }
+            }
+
+            /* session close command */
+            /* CVFS > session close client1 */
+            else if(strcmp("session", Command[0]) == 0 && strcmp("close", Command[1]) == 0)
+            {
+                iRet = closeSession(findSession(Command[2]));
+
+                if(iRet == EXECUTE_SUCCESS)
+                {
+                    printf("Session '%s' closed, its files are closed.\n", Command[2]);
+                }
+                else
+                {
+                    printf("ERROR: No such session (the shell session '%s' cannot be closed).\n", uareaobj.ProcessName);
+                }
+            }
+
             else 
             {
                 printf("ERROR: Command '%s' not recognized! Refer to 'help' for command info.\n", Command[0]);
@@ -440,7 +815,81 @@ int main()
         
         else if(iCount == 4)
         {
+            // lseek command
+            // CVFS > lseek 3 100 0
+            if(strcmp("lseek", Command[0]) == 0)
+            {
+                lRet = lseekFile(atoi(Command[1]), atoll(Command[2]), atoi(Command[3]));
+                if(lRet == ERR_INVALID_PARAMETER)
+                {
+                    printf("ERROR: Invalid parameters.\n");
+                }
+                else if(lRet == ERR_FILE_NOT_EXISTS)
+                {
+                    printf("ERROR: File descriptor not open/found.\n");
+                }
+                else
+                {
+                    printf("File offset set to %lld.\n", lRet);
+                }
+            }
+
+            // pread command
+            // CVFS > pread 3 10 100
+            else if(strcmp("pread", Command[0]) == 0)
+            {
+                // The buffer has the size asked for, sizes no file can have are rejected first
+                lRet = atoll(Command[2]);
+                EmptyBuffer = NULL;
+
+                if(lRet <= 0 || lRet > MAXFILESIZE)
+                {
+                    iRet = ERR_INVALID_PARAMETER;
+                }
+                else
+                {
+                    EmptyBuffer = (char*)malloc(lRet);
+                    if(EmptyBuffer == NULL)
+                    {
+                        iRet = ERR_INSUFFICIENT_SPACE;
+                    }
+                    else
+                    {
+                        iRet = preadFile(atoi(Command[1]), EmptyBuffer, (int)lRet, atoll(Command[3]));
+                    }
+                }
+
+                if(iRet == ERR_INVALID_PARAMETER)
+                {
+                    printf("ERROR: Invalid parameters.\n");
+                }
+                else if(iRet == ERR_INSUFFICIENT_SPACE)
+                {
+                    printf("ERROR: Not enough memory to read %lld bytes.\n", lRet);
+                }
+                else if(iRet == ERR_FILE_NOT_EXISTS)
+                {
+                    printf("ERROR: File does not exist.\n");
+                }
+                else if(iRet == ERR_PERMISSION_DENIED)
+                {
+                    printf("ERROR: Permission denied.\n");
+                }
+                else
+                {
+                    printf("%d bytes read from offset %lld.\n", iRet, atoll(Command[3]));
+                    printf("Data read from file: ");
+                    fwrite(EmptyBuffer, 1, iRet, stdout);
+                    printf("\n");
+                }
+
+                free(EmptyBuffer);
+            }
 
+            else 
+            {
+                printf("ERROR: Command '%s' not recognized! Refer to 'help' for command info.\n", Command[0]);
+            }
         }
 
         else 